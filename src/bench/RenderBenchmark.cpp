@@ -0,0 +1,672 @@
+#ifndef GL_GLEXT_PROTOTYPES
+#define GL_GLEXT_PROTOTYPES
+#endif
+#include "RenderBenchmark.hpp"
+
+#include <SDL_opengl.h>
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <string_view>
+
+#include <spdlog/spdlog.h>
+
+#include "render/RenderEngine.hpp"
+
+namespace {
+
+/**
+ * Camera pan per frame with --camera-motion pan, in view units (a slow drag at the default zoom).
+ */
+constexpr float kCameraPanStep = 0.05f;
+
+/**
+ * Frame-time distribution of one run, in milliseconds.
+ */
+struct FrameTimeStats {
+    float min{0.0f};
+    float p50{0.0f};
+    float p90{0.0f};
+    float p95{0.0f};
+    float p99{0.0f};
+    float max{0.0f};
+    float avg{0.0f};
+};
+
+/**
+ * Results of one (resolution, lights, casters) configuration.
+ */
+struct RunResult {
+    int width{0};
+    int height{0};
+    render::RenderEngine::LightConfig lights{};
+    int shadowCasters{0};
+    FrameTimeStats frame{};
+    std::vector<std::string> passNames;
+    std::vector<render::FrameProfiler::PassStats> passes;
+    render::ShadowSystem::CullStats dirCulling{};
+    render::ShadowSystem::CullStats spotCulling{};
+    render::ShadowSystem::CullStats pointCulling{};
+    render::ShadowSystem::AllocationStats shadowAllocation{};
+    render::MeshPool::Stats meshPool{};
+    bool multiDrawIndirect{false};
+    float lightUpdateAvg{0.0f};
+    float lightUpdateMax{0.0f};
+    render::SceneStreamer::Stats streaming{};
+    render::RenderEngine::CullingStats culling{};
+    float renderScaleMin{1.0f};
+    float renderScaleAvg{1.0f};
+    float renderScaleFinal{1.0f};
+    render::FrameProfiler::PacingStats pacing{};
+    render::RenderTargetPool::Stats renderTargets{};
+};
+
+/**
+ * Scene summary captured after init.
+ */
+struct SceneInfo {
+    std::string source;
+    bool mapped{false};
+    int groundTiles{1};
+    int actors{0};
+    bool instancing{true};
+    int chunks{0};
+    int meshes{0};
+    int instances{0};
+    int lights{0};
+    size_t bytes{0};
+    float loadMs{0.0f};
+};
+
+/**
+ * Shader build summary captured after init.
+ */
+struct ShaderInfo {
+    bool cacheEnabled{false};
+    bool parallelCompile{false};
+    int cacheHits{0};
+    int cacheMisses{0};
+    float buildMs{0.0f};
+};
+
+render::RenderEngine::LightConfig lightConfigFor(int lightCount, int casters, bool animated) {
+    render::RenderEngine::LightConfig lights{};
+    lights.pointLights = lightCount - lightCount / 5;
+    lights.spotLights = lightCount / 5;
+    lights.spotShadowCasters = std::min((casters + 1) / 2, lights.spotLights);
+    lights.pointShadowCasters = std::min(casters - lights.spotShadowCasters, lights.pointLights);
+    lights.animated = animated;
+    return lights;
+}
+
+bool parseInt(std::string_view text, int& outValue) {
+    const char* end = text.data() + text.size();
+    const auto result = std::from_chars(text.data(), end, outValue);
+    return result.ec == std::errc{} && result.ptr == end;
+}
+
+bool parseFloat(std::string_view text, float& outValue) {
+    const char* end = text.data() + text.size();
+    const auto result = std::from_chars(text.data(), end, outValue);
+    return result.ec == std::errc{} && result.ptr == end;
+}
+
+template <typename Fn>
+bool forEachToken(std::string_view list, Fn&& fn) {
+    while (!list.empty()) {
+        const size_t comma = list.find(',');
+        const std::string_view token = list.substr(0, comma);
+        if (token.empty() || !fn(token)) {
+            return false;
+        }
+        if (comma == std::string_view::npos) {
+            break;
+        }
+        list.remove_prefix(comma + 1);
+    }
+    return true;
+}
+
+bool parseIntList(std::string_view list, std::vector<int>& outValues) {
+    outValues.clear();
+    return forEachToken(list, [&](std::string_view token) {
+        int value = 0;
+        if (!parseInt(token, value) || value < 0) {
+            return false;
+        }
+        outValues.push_back(value);
+        return true;
+    });
+}
+
+bool parseResolutionList(std::string_view list, std::vector<std::pair<int, int>>& outValues) {
+    outValues.clear();
+    return forEachToken(list, [&](std::string_view token) {
+        const size_t x = token.find('x');
+        int w = 0;
+        int h = 0;
+        if (x == std::string_view::npos || !parseInt(token.substr(0, x), w) || !parseInt(token.substr(x + 1), h)
+            || w <= 0 || h <= 0) {
+            return false;
+        }
+        outValues.emplace_back(w, h);
+        return true;
+    });
+}
+
+float percentile(const std::vector<float>& sorted, float p) {
+    if (sorted.empty()) {
+        return 0.0f;
+    }
+    // Nearest-rank percentile.
+    const size_t rank = static_cast<size_t>(std::ceil(p * static_cast<float>(sorted.size())));
+    return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+}
+
+FrameTimeStats computeFrameStats(std::vector<float> samples) {
+    FrameTimeStats stats{};
+    if (samples.empty()) {
+        return stats;
+    }
+    std::sort(samples.begin(), samples.end());
+    float sum = 0.0f;
+    for (float value : samples) {
+        sum += value;
+    }
+    stats.min = samples.front();
+    stats.p50 = percentile(samples, 0.50f);
+    stats.p90 = percentile(samples, 0.90f);
+    stats.p95 = percentile(samples, 0.95f);
+    stats.p99 = percentile(samples, 0.99f);
+    stats.max = samples.back();
+    stats.avg = sum / static_cast<float>(samples.size());
+    return stats;
+}
+
+std::string jsonEscape(std::string_view text) {
+    std::string out;
+    out.reserve(text.size());
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out.push_back('\\');
+            out.push_back(c);
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            out.push_back(' ');
+        } else {
+            out.push_back(c);
+        }
+    }
+    return out;
+}
+
+std::string glString(GLenum name) {
+    const GLubyte* value = glGetString(name);
+    return value ? reinterpret_cast<const char*>(value) : "unknown";
+}
+
+bool writeReport(const bench::BenchmarkConfig& config, const std::string& renderer, const std::string& version,
+                 const std::string& rendererPath, const std::string& shadowMode, int workers,
+                 const ShaderInfo& shaders, const SceneInfo& scene, const std::vector<RunResult>& runs) {
+    std::ofstream out(config.outputPath, std::ios::trunc);
+    if (!out) {
+        spdlog::error("RenderBenchmark: cannot open '{}' for writing", config.outputPath);
+        return false;
+    }
+
+    out << "{\n";
+    out << "  \"gl_renderer\": \"" << jsonEscape(renderer) << "\",\n";
+    out << "  \"gl_version\": \"" << jsonEscape(version) << "\",\n";
+    out << "  \"renderer_path\": \"" << jsonEscape(rendererPath) << "\",\n";
+    out << "  \"light_volumes\": \"" << (config.stencilLightVolumes ? "stencil" : "instanced") << "\",\n";
+    out << "  \"light_resolution\": \"" << (config.halfResLightVolumes ? "half" : "full") << "\",\n";
+    out << "  \"shadow_mode\": \"" << jsonEscape(shadowMode) << "\",\n";
+    out << "  \"shadow_filter\": \"" << (config.poissonShadowFilter ? "poisson" : "pcf") << "\",\n";
+    out << "  \"cascade_schedule\": \""
+        << (!config.staggeredCascades ? "every-frame" : config.cascadeMotionInvalidate ? "motion" : "staggered") << "\",\n";
+    out << "  \"cascade_fit\": {\"mode\": \"" << (config.receiverCascadeFit ? "receivers" : "frustum")
+        << "\", \"size\": " << config.directionalShadowSize << "},\n";
+    out << "  \"static_cascade_cache\": " << (config.staticCascadeCache ? "true" : "false") << ",\n";
+    out << "  \"light_motion\": \"" << (config.animatedLights ? "animated" : "static") << "\",\n";
+    out << "  \"camera_motion\": \"" << (config.panCamera ? "pan" : "static") << "\",\n";
+    out << "  \"frame_pacing\": {\"present\": \"" << jsonEscape(config.presentMode) << "\", \"max_fps\": " << config.maxFps
+        << ", \"frames_in_flight\": " << config.framesInFlight << "},\n";
+    out << "  \"vertex_format\": \"" << (config.compactVertices ? "compact" : "standard") << "\",\n";
+    out << "  \"frame_pipeline\": {\"pipelined\": " << (config.pipelinedFrames ? "true" : "false")
+        << ", \"workers\": " << workers << "},\n";
+    out << "  \"dynamic_resolution\": {\"enabled\": " << (config.gpuBudgetMs > 0.0f ? "true" : "false")
+        << ", \"budget_ms\": " << config.gpuBudgetMs << "},\n";
+    out << "  \"light_kernel\": \"" << render::LightStore::simdName() << "\",\n";
+    out << "  \"shaders\": {\"cache\": " << (shaders.cacheEnabled ? "true" : "false")
+        << ", \"parallel_compile\": " << (shaders.parallelCompile ? "true" : "false")
+        << ", \"cache_hits\": " << shaders.cacheHits << ", \"cache_misses\": " << shaders.cacheMisses
+        << ", \"build_ms\": " << shaders.buildMs << "},\n";
+    out << "  \"scene\": {\"source\": \"" << jsonEscape(scene.source) << "\", \"mapped\": " << (scene.mapped ? "true" : "false")
+        << ", \"ground_tiles\": " << scene.groundTiles << ", \"actors\": " << scene.actors
+        << ", \"instancing\": " << (scene.instancing ? "true" : "false")
+        << ", \"chunks\": " << scene.chunks << ", \"meshes\": " << scene.meshes << ", \"instances\": " << scene.instances
+        << ", \"lights\": " << scene.lights
+        << ", \"bytes\": " << scene.bytes << ", \"load_ms\": " << scene.loadMs << "},\n";
+    out << "  \"warmup_frames\": " << config.warmupFrames << ",\n";
+    out << "  \"measured_frames\": " << config.measuredFrames << ",\n";
+    out << "  \"timestep\": " << config.timestep << ",\n";
+    out << "  \"runs\": [\n";
+    for (size_t r = 0; r < runs.size(); ++r) {
+        const RunResult& run = runs[r];
+        const FrameTimeStats& f = run.frame;
+        out << "    {\n";
+        out << "      \"width\": " << run.width << ", \"height\": " << run.height << ",\n";
+        out << "      \"point_lights\": " << run.lights.pointLights
+            << ", \"spot_lights\": " << run.lights.spotLights << ",\n";
+        out << "      \"shadow_casters\": " << run.shadowCasters
+            << ", \"point_shadow_casters\": " << run.lights.pointShadowCasters
+            << ", \"spot_shadow_casters\": " << run.lights.spotShadowCasters << ",\n";
+        out << "      \"frame_ms\": {\"min\": " << f.min << ", \"p50\": " << f.p50 << ", \"p90\": " << f.p90
+            << ", \"p95\": " << f.p95 << ", \"p99\": " << f.p99 << ", \"max\": " << f.max
+            << ", \"avg\": " << f.avg << "},\n";
+        const auto writeCulling = [&out](const char* name, const render::ShadowSystem::CullStats& stats) {
+            out << "\"" << name << "\": {\"drawn\": " << stats.drawn << ", \"culled\": " << stats.culled << "}";
+        };
+        out << "      \"shadow_culling\": {";
+        writeCulling("directional", run.dirCulling);
+        out << ", ";
+        writeCulling("spot", run.spotCulling);
+        out << ", ";
+        writeCulling("point", run.pointCulling);
+        out << "},\n";
+        const render::ShadowSystem::AllocationStats& a = run.shadowAllocation;
+        out << "      \"shadow_allocation\": {\"spot\": {\"requested\": " << a.spotRequested
+            << ", \"granted\": " << a.spotGranted << ", \"rendered\": " << a.spotRendered
+            << ", \"cached\": " << a.spotCached << "}, \"point\": {\"requested\": " << a.pointRequested
+            << ", \"granted\": " << a.pointGranted << ", \"rendered\": " << a.pointRendered
+            << ", \"cached\": " << a.pointCached << "}, \"cascade\": {\"rendered\": " << a.cascadeRendered
+            << ", \"cached\": " << a.cascadeCached << ", \"static_rendered\": " << a.cascadeStaticRendered
+            << "}},\n";
+        const render::MeshPool::Stats& m = run.meshPool;
+        out << "      \"mesh_pool\": {\"multi_draw_indirect\": " << (run.multiDrawIndirect ? "true" : "false")
+            << ", \"batches\": " << m.batches << ", \"commands\": " << m.commands
+            << ", \"draw_calls\": " << m.drawCalls << ", \"instances\": " << m.instances
+            << ", \"vertices\": {\"used\": " << m.vertexUsed
+            << ", \"capacity\": " << m.vertexCapacity << "}, \"indices\": {\"used\": " << m.indexUsed
+            << ", \"capacity\": " << m.indexCapacity << "}, \"vertex_bytes\": " << m.vertexSize << "},\n";
+        const render::SceneStreamer::Stats& st = run.streaming;
+        out << "      \"scene_streaming\": {\"resident_chunks\": " << st.residentChunks
+            << ", \"resident_meshes\": " << st.residentMeshes << ", \"resident_bytes\": " << st.residentBytes
+            << ", \"peak_resident_bytes\": " << st.peakResidentBytes << ", \"loads\": " << st.loads
+            << ", \"unloads\": " << st.unloads << "},\n";
+        const render::RenderEngine::CullingStats& cs = run.culling;
+        out << "      \"spatial_index\": {\"mesh_grid\": {\"items\": " << cs.meshGrid.items
+            << ", \"cells\": " << cs.meshGrid.cells << ", \"oversized\": " << cs.meshGrid.oversized
+            << "}, \"light_grid\": {\"items\": " << cs.lightGrid.items << ", \"cells\": " << cs.lightGrid.cells
+            << ", \"oversized\": " << cs.lightGrid.oversized << "}, \"visible_meshes\": " << cs.visibleMeshes
+            << ", \"visible_lights\": " << cs.visibleLights << ", \"shadow_candidates\": " << cs.shadowCandidates
+            << ", \"fit_casters\": " << cs.fitCasters << "},\n";
+        out << "      \"light_update_ms\": {\"avg\": " << run.lightUpdateAvg << ", \"max\": " << run.lightUpdateMax
+            << "},\n";
+        out << "      \"render_scale\": {\"min\": " << run.renderScaleMin << ", \"avg\": " << run.renderScaleAvg
+            << ", \"final\": " << run.renderScaleFinal << "},\n";
+        const render::RenderTargetPool::Stats& rt = run.renderTargets;
+        out << "      \"render_targets\": {\"textures\": " << rt.textures << ", \"bytes\": " << rt.bytes
+            << ", \"peak_bytes\": " << rt.peakBytes << ", \"allocations\": " << rt.allocations
+            << ", \"reuses\": " << rt.reuses << "},\n";
+        const auto writeHistogram = [&out](const auto& buckets) {
+            out << "[";
+            for (size_t b = 0; b < buckets.size(); ++b) {
+                out << (b > 0 ? ", " : "") << buckets[b];
+            }
+            out << "]";
+        };
+        const render::FrameProfiler::PacingStats& pacing = run.pacing;
+        out << "      \"pacing\": {\"samples\": " << pacing.samples << ", \"latency_ms\": {\"min\": " << pacing.latencyMin
+            << ", \"avg\": " << pacing.latencyAvg << ", \"max\": " << pacing.latencyMax << "}, \"jitter_ms\": {\"avg\": "
+            << pacing.jitterAvg << ", \"max\": " << pacing.jitterMax << "}, \"histogram_bucket_ms\": "
+            << render::FrameProfiler::kHistogramBucketMs << ", \"latency_histogram\": ";
+        writeHistogram(pacing.latencyHistogram);
+        out << ", \"jitter_histogram\": ";
+        writeHistogram(pacing.jitterHistogram);
+        out << "},\n";
+        out << "      \"passes\": {";
+        bool first = true;
+        for (size_t p = 0; p < run.passes.size(); ++p) {
+            const render::FrameProfiler::PassStats& s = run.passes[p];
+            if (s.samples == 0) {
+                continue;
+            }
+            out << (first ? "\n" : ",\n");
+            first = false;
+            out << "        \"" << jsonEscape(run.passNames[p]) << "\": {"
+                << "\"gpu_ms\": {\"min\": " << s.gpuMin << ", \"avg\": " << s.gpuAvg << ", \"max\": " << s.gpuMax << "}, "
+                << "\"cpu_ms\": {\"min\": " << s.cpuMin << ", \"avg\": " << s.cpuAvg << ", \"max\": " << s.cpuMax << "}, "
+                << "\"samples\": " << s.samples << "}";
+        }
+        out << (first ? "}\n" : "\n      }\n");
+        out << "    }" << (r + 1 < runs.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n";
+    out << "}\n";
+
+    if (!out) {
+        spdlog::error("RenderBenchmark: failed writing '{}'", config.outputPath);
+        return false;
+    }
+    return true;
+}
+
+}  // namespace
+
+namespace bench {
+
+bool parseBenchmarkArgs(int argc, char** argv, BenchmarkConfig& outConfig) {
+    bool requested = false;
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg{argv[i]};
+        const bool hasValue = i + 1 < argc;
+        const std::string_view value = hasValue ? std::string_view{argv[i + 1]} : std::string_view{};
+        bool ok = hasValue;
+        if (arg == "--bench" || arg == "-b") {
+            if (ok) {
+                requested = value == "RenderEngine";
+                if (!requested) {
+                    spdlog::error("RenderBenchmark: unknown benchmark '{}'", value);
+                    return false;
+                }
+            }
+        } else if (arg == "--frames") {
+            ok = ok && parseInt(value, outConfig.measuredFrames) && outConfig.measuredFrames > 0;
+        } else if (arg == "--warmup") {
+            ok = ok && parseInt(value, outConfig.warmupFrames) && outConfig.warmupFrames >= 0;
+        } else if (arg == "--resolutions") {
+            ok = ok && parseResolutionList(value, outConfig.resolutions);
+        } else if (arg == "--lights") {
+            ok = ok && parseIntList(value, outConfig.lightCounts);
+        } else if (arg == "--casters") {
+            ok = ok && parseIntList(value, outConfig.shadowCasterCounts);
+        } else if (arg == "--lighting") {
+            ok = ok && (value == "tiled" || value == "volumes" || value == "stencil");
+            outConfig.tiledLighting = value == "tiled";
+            outConfig.stencilLightVolumes = value == "stencil";
+        } else if (arg == "--light-resolution") {
+            ok = ok && (value == "full" || value == "half");
+            outConfig.halfResLightVolumes = value == "half";
+        } else if (arg == "--shadows") {
+            ok = ok && (value == "layered" || value == "per-layer");
+            outConfig.layeredShadows = value == "layered";
+        } else if (arg == "--shadow-filter") {
+            ok = ok && (value == "pcf" || value == "poisson");
+            outConfig.poissonShadowFilter = value == "poisson";
+        } else if (arg == "--cascade-schedule") {
+            ok = ok && (value == "every-frame" || value == "staggered" || value == "motion");
+            outConfig.staggeredCascades = value != "every-frame";
+            outConfig.cascadeMotionInvalidate = value == "motion";
+        } else if (arg == "--cascade-fit") {
+            ok = ok && (value == "frustum" || value == "receivers");
+            outConfig.receiverCascadeFit = value == "receivers";
+        } else if (arg == "--static-cascades") {
+            ok = ok && (value == "on" || value == "off");
+            outConfig.staticCascadeCache = value == "on";
+        } else if (arg == "--dir-shadow-size") {
+            ok = ok && parseInt(value, outConfig.directionalShadowSize) && outConfig.directionalShadowSize > 0;
+        } else if (arg == "--light-motion") {
+            ok = ok && (value == "animated" || value == "static");
+            outConfig.animatedLights = value == "animated";
+        } else if (arg == "--camera-motion") {
+            ok = ok && (value == "pan" || value == "static");
+            outConfig.panCamera = value == "pan";
+        } else if (arg == "--present") {
+            ok = ok && (value == "vsync" || value == "adaptive" || value == "uncapped");
+            if (ok) {
+                outConfig.presentMode = std::string{value};
+            }
+        } else if (arg == "--max-fps") {
+            ok = ok && parseFloat(value, outConfig.maxFps) && outConfig.maxFps >= 0.0f;
+        } else if (arg == "--frames-in-flight") {
+            ok = ok && parseInt(value, outConfig.framesInFlight) && outConfig.framesInFlight > 0;
+        } else if (arg == "--vertex-format") {
+            ok = ok && (value == "compact" || value == "standard");
+            outConfig.compactVertices = value == "compact";
+        } else if (arg == "--pipeline") {
+            ok = ok && (value == "on" || value == "off");
+            outConfig.pipelinedFrames = value == "on";
+        } else if (arg == "--workers") {
+            ok = ok && parseInt(value, outConfig.workerThreads) && outConfig.workerThreads >= 0;
+        } else if (arg == "--shader-cache") {
+            ok = ok && (value == "on" || value == "off");
+            outConfig.shaderCache = value == "on";
+        } else if (arg == "--dynamic-resolution") {
+            outConfig.gpuBudgetMs = 0.0f;
+            ok = ok && (value == "off" || (parseFloat(value, outConfig.gpuBudgetMs) && outConfig.gpuBudgetMs > 0.0f));
+        } else if (arg == "--scene") {
+            if (ok && value.substr(0, 6) == "rooms:") {
+                std::vector<std::pair<int, int>> rooms;
+                ok = parseResolutionList(value.substr(6), rooms) && rooms.size() == 1;
+                outConfig.scenePath.clear();
+                outConfig.sceneRoomsX = ok ? rooms.front().first : 1;
+                outConfig.sceneRoomsZ = ok ? rooms.front().second : 1;
+            } else if (ok) {
+                outConfig.scenePath = std::string{value};
+            }
+        } else if (arg == "--ground-tiles") {
+            ok = ok && parseInt(value, outConfig.sceneGroundTiles) && outConfig.sceneGroundTiles > 0;
+        } else if (arg == "--actors") {
+            ok = ok && parseInt(value, outConfig.sceneActors) && outConfig.sceneActors >= 0;
+        } else if (arg == "--instancing") {
+            ok = ok && (value == "on" || value == "off");
+            outConfig.sceneInstancing = value == "on";
+        } else if (arg == "--export-scene") {
+            if (ok) {
+                outConfig.exportScenePath = std::string{value};
+            }
+        } else if (arg == "--output" || arg == "-o") {
+            if (ok) {
+                outConfig.outputPath = std::string{value};
+            }
+        } else {
+            spdlog::error("RenderBenchmark: unknown argument '{}'", arg);
+            return false;
+        }
+        if (!ok) {
+            spdlog::error("RenderBenchmark: invalid or missing value for '{}'", arg);
+            return false;
+        }
+        ++i;
+    }
+    if (!requested) {
+        spdlog::error("RenderBenchmark: usage: --bench RenderEngine [--frames N] [--warmup N] "
+                      "[--resolutions WxH,...] [--lights N,...] [--casters N,...] [--lighting tiled|volumes|stencil] "
+                      "[--light-resolution full|half] "
+                      "[--shadows layered|per-layer] [--shadow-filter pcf|poisson] "
+                      "[--cascade-schedule every-frame|staggered|motion] [--cascade-fit frustum|receivers] [--dir-shadow-size N] "
+                      "[--static-cascades on|off] "
+                      "[--light-motion animated|static] [--camera-motion static|pan] "
+                      "[--present vsync|adaptive|uncapped] [--max-fps N] [--frames-in-flight N] "
+                      "[--vertex-format compact|standard] "
+                      "[--pipeline on|off] [--workers N] [--shader-cache on|off] [--dynamic-resolution off|MS] [--scene rooms:WxH|path] "
+                      "[--ground-tiles N] [--actors N] [--instancing on|off] [--export-scene path] [--output path]");
+    }
+    return requested;
+}
+
+bool runRenderBenchmark(const BenchmarkConfig& config) {
+    if (config.resolutions.empty() || config.lightCounts.empty() || config.shadowCasterCounts.empty()) {
+        spdlog::error("RenderBenchmark: empty sweep");
+        return false;
+    }
+
+    const auto [initialWidth, initialHeight] = config.resolutions.front();
+    render::RenderEngine::Options options{};
+    options.pacing.mode = config.presentMode == "vsync" ? render::FramePacer::Mode::Vsync
+        : config.presentMode == "adaptive"               ? render::FramePacer::Mode::Adaptive
+                                                         : render::FramePacer::Mode::Uncapped;
+    options.pacing.maxFps = config.maxFps;
+    options.pacing.maxFramesInFlight = config.framesInFlight;
+    options.headless = true;
+    options.tiledLighting = config.tiledLighting;
+    options.stencilLightVolumes = config.stencilLightVolumes;
+    options.halfResLightVolumes = config.halfResLightVolumes;
+    options.layeredShadows = config.layeredShadows;
+    options.shadowFilter = config.poissonShadowFilter ? render::ShadowSystem::ShadowFilter::Poisson
+                                                      : render::ShadowSystem::ShadowFilter::Pcf;
+    if (!config.staggeredCascades) {
+        options.cascadeSchedule.updateEvery.fill(1);
+    }
+    options.cascadeSchedule.invalidateOnMotion = config.cascadeMotionInvalidate;
+    options.cascadeFit = config.receiverCascadeFit ? render::ShadowSystem::CascadeFit::Receivers
+                                                   : render::ShadowSystem::CascadeFit::ViewFrustum;
+    options.staticCascadeCache = config.staticCascadeCache;
+    options.directionalShadowSize = config.directionalShadowSize;
+    options.compactVertices = config.compactVertices;
+    options.pipelinedFrames = config.pipelinedFrames;
+    options.workerThreads = config.workerThreads;
+    options.shaderCache = config.shaderCache;
+    options.dynamicResolution = config.gpuBudgetMs > 0.0f;
+    options.gpuBudgetMs = config.gpuBudgetMs;
+    render::RenderEngine engine(initialWidth, initialHeight, "AlKanzar - Benchmark", options);
+    render::RenderEngine::SceneConfig sceneConfig{};
+    sceneConfig.path = config.scenePath;
+    sceneConfig.roomsX = config.sceneRoomsX;
+    sceneConfig.roomsZ = config.sceneRoomsZ;
+    sceneConfig.groundTiles = config.sceneGroundTiles;
+    sceneConfig.actors = config.sceneActors;
+    sceneConfig.instancing = config.sceneInstancing;
+    engine.setSceneConfig(sceneConfig);
+    if (!engine.init()) {
+        spdlog::error("RenderBenchmark: engine initialization failed");
+        return false;
+    }
+
+    render::FrameProfiler& profiler = engine.profiler();
+    profiler.setReportInterval(0.0f);
+
+    const std::string renderer = glString(GL_RENDERER);
+    const std::string version = glString(GL_VERSION);
+    const std::string rendererPath = engine.rendererPathName();
+    const std::string shadowMode = engine.shadowSystem().layeredRendering() ? "layered" : "per-layer";
+    spdlog::info("RenderBenchmark: {} | {} | {} | {} shadows", renderer, version, rendererPath, shadowMode);
+
+    ShaderInfo shaders{};
+    shaders.cacheEnabled = engine.shaderCache().enabled();
+    shaders.parallelCompile = engine.shaderCache().parallelCompile();
+    shaders.cacheHits = engine.shaderCache().stats().hits;
+    shaders.cacheMisses = engine.shaderCache().stats().misses;
+    shaders.buildMs = engine.shaderBuildMs();
+
+    SceneInfo scene{};
+    scene.source = config.scenePath.empty()
+        ? "rooms:" + std::to_string(config.sceneRoomsX) + "x" + std::to_string(config.sceneRoomsZ)
+        : config.scenePath;
+    scene.mapped = engine.sceneAsset().mapped();
+    scene.groundTiles = config.sceneGroundTiles;
+    scene.actors = config.sceneActors;
+    scene.instancing = config.sceneInstancing;
+    scene.chunks = engine.sceneAsset().chunkCount();
+    scene.meshes = engine.sceneAsset().meshCount();
+    scene.instances = engine.sceneAsset().instanceCount();
+    scene.lights = engine.sceneAsset().lightCount();
+    scene.bytes = engine.sceneAsset().size();
+    scene.loadMs = engine.sceneLoadMs();
+    if (!config.exportScenePath.empty()) {
+        engine.setLightConfig(lightConfigFor(config.lightCounts.front(), config.shadowCasterCounts.front(), config.animatedLights));
+        if (!engine.exportScene(config.exportScenePath)) {
+            return false;
+        }
+        spdlog::info("RenderBenchmark: wrote scene to {}", config.exportScenePath);
+    }
+
+    // The GPU is idle after waitForGpu, so cycling the query slots lands every in-flight result.
+    auto drainQueries = [&profiler]() {
+        for (int i = 0; i < render::FrameProfiler::kQueryLatency; ++i) {
+            profiler.beginFrame();
+            profiler.endFrame();
+        }
+    };
+
+    std::vector<RunResult> runs;
+    std::vector<float> frameTimes;
+    frameTimes.reserve(static_cast<size_t>(config.measuredFrames));
+
+    for (const auto& [width, height] : config.resolutions) {
+        engine.resize(width, height);
+        for (int lightCount : config.lightCounts) {
+            for (int casters : config.shadowCasterCounts) {
+                RunResult run{};
+                run.width = width;
+                run.height = height;
+                run.shadowCasters = casters;
+                run.lights = lightConfigFor(lightCount, casters, config.animatedLights);
+                engine.setLightConfig(run.lights);
+                // Restart the clock so every run animates the same frames.
+                engine.setFixedTimestep(config.timestep);
+                // Panned along the view's x axis, so every run sees the same camera path.
+                int panFrame = 0;
+                auto renderFrame = [&]() {
+                    if (config.panCamera) {
+                        engine.setCameraPan(kCameraPanStep * static_cast<float>(panFrame++), 0.0f);
+                    }
+                    engine.framePacer().waitForFrame();
+                    engine.renderFrame();
+                };
+
+                for (int i = 0; i < config.warmupFrames; ++i) {
+                    renderFrame();
+                }
+                engine.waitForGpu();
+                drainQueries();
+                profiler.reset();
+
+                frameTimes.clear();
+                float lightUpdateTotal = 0.0f;
+                float renderScaleTotal = 0.0f;
+                run.renderScaleMin = 1.0f;
+                for (int i = 0; i < config.measuredFrames; ++i) {
+                    const auto start = std::chrono::steady_clock::now();
+                    renderFrame();
+                    engine.waitForGpu();
+                    frameTimes.push_back(
+                        std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count()
+                    );
+                    lightUpdateTotal += engine.lightUpdateMs();
+                    run.lightUpdateMax = std::max(run.lightUpdateMax, engine.lightUpdateMs());
+                    renderScaleTotal += engine.renderScale();
+                    run.renderScaleMin = std::min(run.renderScaleMin, engine.renderScale());
+                }
+                run.lightUpdateAvg = config.measuredFrames > 0 ? lightUpdateTotal / static_cast<float>(config.measuredFrames) : 0.0f;
+                run.renderScaleAvg = config.measuredFrames > 0 ? renderScaleTotal / static_cast<float>(config.measuredFrames) : 1.0f;
+                run.renderScaleFinal = engine.renderScale();
+                run.pacing = profiler.pacingStats();
+                run.renderTargets = engine.renderTargets().stats();
+                drainQueries();
+
+                run.frame = computeFrameStats(frameTimes);
+                // Counts from the last rendered frame; the scene is deterministic per timestep.
+                run.dirCulling = engine.shadowSystem().directionalCullStats();
+                run.spotCulling = engine.shadowSystem().spotCullStats();
+                run.pointCulling = engine.shadowSystem().pointCullStats();
+                run.shadowAllocation = engine.shadowSystem().allocationStats();
+                run.meshPool = engine.meshPool().stats();
+                run.multiDrawIndirect = engine.meshPool().multiDrawIndirect();
+                run.streaming = engine.sceneStreamer().stats();
+                run.culling = engine.cullingStats();
+                for (int p = 0; p < profiler.passCount(); ++p) {
+                    run.passNames.push_back(profiler.passName(p));
+                    run.passes.push_back(profiler.passStats(p));
+                }
+                spdlog::info(
+                    "RenderBenchmark: {}x{} lights {}+{} casters {} | frame p50 {:.3f} ms p99 {:.3f} ms",
+                    width, height, run.lights.pointLights, run.lights.spotLights, casters,
+                    run.frame.p50, run.frame.p99
+                );
+                runs.push_back(std::move(run));
+            }
+        }
+    }
+
+    if (!writeReport(config, renderer, version, rendererPath, shadowMode, engine.workerCount(), shaders, scene, runs)) {
+        return false;
+    }
+    spdlog::info("RenderBenchmark: wrote {} runs to {}", runs.size(), config.outputPath);
+    return true;
+}
+
+}  // namespace bench
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace bench {
+
+/**
+ * Parameters for a render benchmark sweep.
+ */
+struct BenchmarkConfig {
+    /**
+     * Resolutions to render at, as (width, height) pairs.
+     */
+    std::vector<std::pair<int, int>> resolutions{{1280, 720}, {1920, 1080}};
+    /**
+     * Total light counts to sweep (split 4:1 between point and spot lights).
+     */
+    std::vector<int> lightCounts{40, 256, 1024};
+    /**
+     * Shadow caster counts to sweep (split between spot and point lights).
+     */
+    std::vector<int> shadowCasterCounts{0, 2, 6};
+    /**
+     * Frames rendered before measuring, per run.
+     */
+    int warmupFrames{30};
+    /**
+     * Frames measured per run (per-pass GPU stats cover at most FrameProfiler::kHistorySize of them).
+     */
+    int measuredFrames{120};
+    /**
+     * Uses the tiled compute lighting path when available (false forces light volumes).
+     */
+    bool tiledLighting{true};
+    /**
+     * Stencil-masks light volumes on the volume path (set by --lighting stencil).
+     */
+    bool stencilLightVolumes{false};
+    /**
+     * Accumulates light volumes at half resolution (set by --light-resolution half).
+     */
+    bool halfResLightVolumes{false};
+    /**
+     * Stores meshes in the compact quantized vertex format (false uses 36-byte float vertices).
+     */
+    bool compactVertices{true};
+    /**
+     * Prepares the next frame's CPU work on worker threads (false runs it inline each frame).
+     */
+    bool pipelinedFrames{true};
+    /**
+     * Job system worker threads; 0 uses one fewer than the hardware threads.
+     */
+    int workerThreads{0};
+    /**
+     * Renders shadow maps with one layered pass per map (false renders one layer per pass).
+     */
+    bool layeredShadows{true};
+    /**
+     * Filters shadow lookups with the Poisson disk kernel (false uses the half-texel PCF grid).
+     */
+    bool poissonShadowFilter{false};
+    /**
+     * Lets the far directional cascades re-render on alternating frames (false renders every
+     * cascade whenever it changes; set by --cascade-schedule).
+     */
+    bool staggeredCascades{true};
+    /**
+     * Re-renders a staggered cascade out of turn when its fit moves (--cascade-schedule motion).
+     */
+    bool cascadeMotionInvalidate{false};
+    /**
+     * Fits the directional cascades to the visible receivers (false fits the whole view frustum;
+     * set by --cascade-fit).
+     */
+    bool receiverCascadeFit{true};
+    /**
+     * Caches the static casters of each cascade apart from the dynamic ones (--static-cascades).
+     */
+    bool staticCascadeCache{true};
+    /**
+     * Directional shadow map size per cascade (--dir-shadow-size).
+     */
+    int directionalShadowSize{1024};
+    /**
+     * Animates lights along their orbits (false keeps them still so shadow caches can hit).
+     */
+    bool animatedLights{true};
+    /**
+     * Pans the camera a fixed step every frame (set by --camera-motion pan).
+     */
+    bool panCamera{false};
+    /**
+     * Swap interval mode of the frame pacer (--present vsync|adaptive|uncapped).
+     */
+    std::string presentMode{"uncapped"};
+    /**
+     * Frame rate limit for uncapped presents; 0 renders as fast as possible (--max-fps).
+     */
+    float maxFps{0.0f};
+    /**
+     * Frames the CPU may run ahead of the GPU (--frames-in-flight).
+     */
+    int framesInFlight{2};
+    /**
+     * Loads and stores linked programs in the shader binary cache (false compiles every program).
+     */
+    bool shaderCache{true};
+    /**
+     * GPU frame budget for dynamic resolution in milliseconds; 0 renders at full resolution.
+     */
+    float gpuBudgetMs{0.0f};
+    /**
+     * Scene file to stream; empty uses the built-in room grid.
+     */
+    std::string scenePath;
+    /**
+     * Built-in scene size in rooms along X and Z.
+     */
+    int sceneRoomsX{1};
+    int sceneRoomsZ{1};
+    /**
+     * Built-in scene ground tiles per room edge.
+     */
+    int sceneGroundTiles{1};
+    /**
+     * Built-in scene dynamic crates per room (--actors).
+     */
+    int sceneActors{0};
+    /**
+     * Built-in scene stores repeated meshes once and draws them instanced.
+     */
+    bool sceneInstancing{true};
+    /**
+     * Writes the built-in scene with the first run's lights to this path before measuring.
+     */
+    std::string exportScenePath;
+    /**
+     * Simulation step per frame in seconds.
+     */
+    float timestep{1.0f / 60.0f};
+    /**
+     * Path of the JSON report.
+     */
+    std::string outputPath{"bench_results.json"};
+};
+
+/**
+ * Parses benchmark command-line options.
+ * @param argc Argument count.
+ * @param argv Argument values.
+ * @param outConfig Receives the parsed configuration.
+ * @return true if arguments were valid and a benchmark was requested.
+ */
+bool parseBenchmarkArgs(int argc, char** argv, BenchmarkConfig& outConfig);
+
+/**
+ * Runs the RenderEngine benchmark sweep and writes the JSON report.
+ * @param config Sweep configuration.
+ * @return true when every run completed and the report was written.
+ */
+bool runRenderBenchmark(const BenchmarkConfig& config);
+
+}  // namespace bench
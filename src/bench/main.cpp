@@ -0,0 +1,33 @@
+#define SDL_MAIN_HANDLED
+
+#include <SDL.h>
+
+#include "RenderBenchmark.hpp"
+#include <spdlog/spdlog.h>
+
+int main(int argc, char** argv) {
+    spdlog::set_pattern("[%H:%M:%S.%e] [%^%l%$] %v");
+    spdlog::set_level(spdlog::level::info);
+
+    bench::BenchmarkConfig config{};
+    if (!bench::parseBenchmarkArgs(argc, argv, config)) {
+        return 1;
+    }
+
+    SDL_SetMainReady();
+    if (SDL_Init(SDL_INIT_VIDEO) != 0) {
+        spdlog::error("SDL2 not available: {}", SDL_GetError());
+        return 2;
+    }
+    if (SDL_GL_LoadLibrary(nullptr) != 0) {
+        spdlog::error("OpenGL not available: {}", SDL_GetError());
+        SDL_Quit();
+        return 2;
+    }
+
+    const bool ok = bench::runRenderBenchmark(config);
+
+    SDL_GL_UnloadLibrary();
+    SDL_Quit();
+    return ok ? 0 : 3;
+}
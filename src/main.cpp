@@ -3,6 +3,7 @@
 #include <SDL.h>
 #include <SDL_opengl.h>
 
+#include <cstdlib>
 #include <string_view>
 
 #include "render/RenderEngine.hpp"
@@ -13,12 +14,25 @@
 
 int main(int argc, char** argv) {
     bool runRenderTest = false;
+    render::RenderEngine::SceneConfig sceneConfig{};
+    render::RenderEngine::Options options{};
     for (int i = 1; i < argc; ++i) {
         std::string_view arg{argv[i]};
         if ((arg == "--test" || arg == "-t") && i + 1 < argc) {
             if (std::string_view{argv[i + 1]} == "RenderEngine") {
                 runRenderTest = true;
             }
+        } else if (arg == "--scene" && i + 1 < argc) {
+            sceneConfig.path = argv[i + 1];
+        } else if (arg == "--present" && i + 1 < argc) {
+            const std::string_view mode{argv[i + 1]};
+            options.pacing.mode = mode == "adaptive" ? render::FramePacer::Mode::Adaptive
+                : mode == "uncapped"                 ? render::FramePacer::Mode::Uncapped
+                                                     : render::FramePacer::Mode::Vsync;
+        } else if (arg == "--max-fps" && i + 1 < argc) {
+            options.pacing.maxFps = std::strtof(argv[i + 1], nullptr);
+        } else if (arg == "--frames-in-flight" && i + 1 < argc) {
+            options.pacing.maxFramesInFlight = std::atoi(argv[i + 1]);
         }
     }
 
@@ -83,7 +97,8 @@ int main(int argc, char** argv) {
     }
 
     if (runRenderTest && glAvailable) {
-        render::RenderEngine engine(1280, 720);
+        render::RenderEngine engine(1280, 720, "AlKanzar - Render Preview", options);
+        engine.setSceneConfig(sceneConfig);
         engine.run();
     }
 
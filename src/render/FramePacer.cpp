@@ -0,0 +1,150 @@
+#include "FramePacer.hpp"
+
+#include <SDL.h>
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+#include <spdlog/spdlog.h>
+
+#include "FrameProfiler.hpp"
+
+namespace {
+
+/**
+ * The limiter stops sleeping this far ahead of the deadline and spins the rest; OS sleeps
+ * overshoot by up to about a scheduler tick.
+ */
+constexpr std::chrono::microseconds kLimiterSpinMargin{1500};
+
+/**
+ * Blocking fence waits re-check in slices this long (ns) so a lost context cannot hang the loop.
+ */
+constexpr GLuint64 kFenceWaitSliceNs = 100000000;
+
+float millisecondsBetween(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end) {
+    return std::chrono::duration<float, std::milli>(end - start).count();
+}
+
+}  // namespace
+
+namespace render {
+
+FramePacer::~FramePacer() {
+    destroy();
+}
+
+void FramePacer::configure(const Settings& settings, FrameProfiler* profiler) {
+    destroy();
+    settings_ = settings;
+    settings_.maxFps = std::max(settings_.maxFps, 0.0f);
+    settings_.maxFramesInFlight = std::clamp(settings_.maxFramesInFlight, 1, kMaxFramesInFlight);
+    profiler_ = profiler;
+
+    mode_ = settings_.mode;
+    if (mode_ == Mode::Adaptive && SDL_GL_SetSwapInterval(-1) != 0) {
+        spdlog::warn("FramePacer: adaptive vsync unavailable ({}), using vsync", SDL_GetError());
+        mode_ = Mode::Vsync;
+    }
+    if (mode_ != Mode::Adaptive) {
+        SDL_GL_SetSwapInterval(mode_ == Mode::Vsync ? 1 : 0);
+    }
+    nextFrame_ = Clock::now();
+}
+
+void FramePacer::destroy() {
+    while (inFlightCount_ > 0) {
+        // Dropped without waiting; the samples would only measure teardown.
+        InFlight& frame = inFlight_[static_cast<size_t>(oldest_)];
+        glDeleteSync(frame.fence);
+        frame.fence = nullptr;
+        oldest_ = (oldest_ + 1) % kMaxFramesInFlight;
+        inFlightCount_--;
+    }
+    oldest_ = 0;
+    presents_ = 0;
+    lastIntervalMs_ = 0.0f;
+}
+
+void FramePacer::waitForFrame() {
+    const Clock::time_point start = Clock::now();
+    // Polled on both sides of the limiter so the sleep does not count toward frame latency.
+    while (inFlightCount_ > 0 && retireOldest(false)) {
+    }
+    limitFrameRate();
+    while (inFlightCount_ > 0 && retireOldest(false)) {
+    }
+    while (inFlightCount_ >= settings_.maxFramesInFlight) {
+        retireOldest(true);
+    }
+    inputTime_ = Clock::now();
+    lastWaitMs_ = millisecondsBetween(start, inputTime_);
+}
+
+void FramePacer::endFrame() {
+    // A caller that skipped waitForFrame() still may not exceed the ring.
+    if (inFlightCount_ == kMaxFramesInFlight) {
+        retireOldest(true);
+    }
+    InFlight& frame = inFlight_[static_cast<size_t>((oldest_ + inFlightCount_) % kMaxFramesInFlight)];
+    frame.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    frame.inputTime = inputTime_;
+    inFlightCount_++;
+
+    const Clock::time_point now = Clock::now();
+    if (presents_ > 0) {
+        const float intervalMs = millisecondsBetween(lastPresent_, now);
+        if (presents_ > 1 && profiler_) {
+            profiler_->recordJitter(std::abs(intervalMs - lastIntervalMs_));
+        }
+        lastIntervalMs_ = intervalMs;
+    }
+    lastPresent_ = now;
+    presents_++;
+}
+
+bool FramePacer::retireOldest(bool block) {
+    InFlight& frame = inFlight_[static_cast<size_t>(oldest_)];
+    GLenum result = glClientWaitSync(frame.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+    if (block) {
+        while (result == GL_TIMEOUT_EXPIRED) {
+            result = glClientWaitSync(frame.fence, GL_SYNC_FLUSH_COMMANDS_BIT, kFenceWaitSliceNs);
+        }
+        if (result == GL_WAIT_FAILED) {
+            spdlog::warn("FramePacer: fence wait failed");
+        }
+    } else if (result == GL_TIMEOUT_EXPIRED) {
+        return false;
+    }
+    // Polled completions are seen at the next frame boundary, so latency is an upper bound there.
+    if (profiler_ && result != GL_WAIT_FAILED) {
+        profiler_->recordLatency(millisecondsBetween(frame.inputTime, Clock::now()));
+    }
+    glDeleteSync(frame.fence);
+    frame.fence = nullptr;
+    oldest_ = (oldest_ + 1) % kMaxFramesInFlight;
+    inFlightCount_--;
+    return true;
+}
+
+void FramePacer::limitFrameRate() {
+    if (mode_ != Mode::Uncapped || settings_.maxFps <= 0.0f) {
+        return;
+    }
+    const auto period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / settings_.maxFps));
+    const Clock::time_point now = Clock::now();
+    // A frame that ran a whole period late restarts the schedule instead of bursting to catch up.
+    if (now - nextFrame_ > period) {
+        nextFrame_ = now;
+    }
+    if (nextFrame_ - now > kLimiterSpinMargin) {
+        std::this_thread::sleep_for(nextFrame_ - now - kLimiterSpinMargin);
+    }
+    while (Clock::now() < nextFrame_) {
+        std::this_thread::yield();
+    }
+    nextFrame_ += period;
+}
+
+}  // namespace render
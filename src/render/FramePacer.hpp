@@ -0,0 +1,154 @@
+#ifndef GL_GLEXT_PROTOTYPES
+#define GL_GLEXT_PROTOTYPES
+#endif
+#pragma once
+
+#include <SDL_opengl.h>
+
+#include <array>
+#include <chrono>
+
+namespace render {
+
+class FrameProfiler;
+
+/**
+ * Controls when frames start and how they are presented. Picks the swap interval, limits the
+ * frame rate with a sleep-then-spin wait when presents are uncapped, and fences every frame so
+ * the CPU never runs more than a fixed number of frames ahead of the GPU. The caller samples
+ * input right after waitForFrame() returns, so the frame is built from the freshest input the
+ * throttling allows.
+ */
+class FramePacer {
+public:
+    /**
+     * Upper bound on frames in flight; StreamingBuffer rings have no more regions than this.
+     */
+    static constexpr int kMaxFramesInFlight = 3;
+
+    /**
+     * How buffer swaps relate to the display refresh.
+     */
+    enum class Mode : int {
+        /**
+         * Swaps wait for vertical blank (swap interval 1).
+         */
+        Vsync = 0,
+        /**
+         * Late swaps tear instead of waiting a whole refresh (swap interval -1); falls back to
+         * Vsync where the driver lacks adaptive sync.
+         */
+        Adaptive = 1,
+        /**
+         * Swaps never wait (swap interval 0); Settings::maxFps limits the rate instead.
+         */
+        Uncapped = 2,
+    };
+
+    /**
+     * Pacing configuration.
+     */
+    struct Settings {
+        Mode mode{Mode::Vsync};
+        /**
+         * Frame rate limit for Uncapped; 0 renders as fast as possible.
+         */
+        float maxFps{0.0f};
+        /**
+         * Frames the CPU may submit before waiting for the oldest one to finish on the GPU.
+         */
+        int maxFramesInFlight{2};
+    };
+
+    /**
+     * Creates an idle pacer without touching GL state.
+     */
+    FramePacer() = default;
+    /**
+     * Releases outstanding fences.
+     */
+    ~FramePacer();
+
+    /**
+     * Non-copyable to avoid double-deleting fences.
+     */
+    FramePacer(const FramePacer&) = delete;
+    /**
+     * Non-copyable assignment to avoid double-deleting fences.
+     */
+    FramePacer& operator=(const FramePacer&) = delete;
+
+    /**
+     * Applies the settings; sets the swap interval, so a context must be current.
+     * @param settings Mode, frame rate limit and frames-in-flight cap.
+     * @param profiler Receives latency and jitter samples; may be nullptr.
+     */
+    void configure(const Settings& settings, FrameProfiler* profiler);
+    /**
+     * Deletes outstanding fences and forgets the timing history.
+     */
+    void destroy();
+
+    /**
+     * Blocks until the next frame may start: the frame rate limit has elapsed and fewer than
+     * maxFramesInFlight frames are still running on the GPU. Marks the input sample time.
+     */
+    void waitForFrame();
+    /**
+     * Fences the submitted frame and records its present timing; call right after the swap.
+     */
+    void endFrame();
+
+    /**
+     * Returns the mode in effect (Adaptive may have fallen back to Vsync).
+     */
+    Mode mode() const { return mode_; }
+    /**
+     * Returns the applied settings.
+     */
+    const Settings& settings() const { return settings_; }
+    /**
+     * Returns the CPU time the last waitForFrame() spent throttled, in milliseconds.
+     */
+    float lastWaitMs() const { return lastWaitMs_; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * A submitted frame still running on the GPU.
+     */
+    struct InFlight {
+        GLsync fence{nullptr};
+        Clock::time_point inputTime{};
+    };
+
+    /**
+     * Retires the oldest frame if its fence signaled, or unconditionally after waiting on it.
+     * @param block Waits for the fence instead of polling it.
+     * @return true if a frame was retired.
+     */
+    bool retireOldest(bool block);
+    /**
+     * Sleeps, then spins, until the frame rate limit allows the next frame.
+     */
+    void limitFrameRate();
+
+    Settings settings_{};
+    Mode mode_{Mode::Vsync};
+    FrameProfiler* profiler_{nullptr};
+    std::array<InFlight, kMaxFramesInFlight> inFlight_{};
+    int oldest_{0};
+    int inFlightCount_{0};
+    Clock::time_point inputTime_{};
+    Clock::time_point nextFrame_{};
+    Clock::time_point lastPresent_{};
+    float lastIntervalMs_{0.0f};
+    float lastWaitMs_{0.0f};
+    /**
+     * Presents seen since configure(); jitter needs two intervals, so three presents.
+     */
+    int presents_{0};
+};
+
+}  // namespace render
@@ -0,0 +1,354 @@
+#include "FrameProfiler.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+#include <spdlog/spdlog.h>
+
+namespace {
+
+constexpr float kOverlayMargin = 12.0f;
+constexpr float kOverlayRowHeight = 14.0f;
+constexpr float kOverlayBarWidth = 320.0f;
+constexpr float kOverlayBudgetMs = 16.667f;
+
+constexpr float kPassColors[8][3] = {
+    {0.90f, 0.35f, 0.30f},
+    {0.95f, 0.65f, 0.25f},
+    {0.90f, 0.85f, 0.30f},
+    {0.45f, 0.80f, 0.35f},
+    {0.30f, 0.75f, 0.80f},
+    {0.35f, 0.50f, 0.95f},
+    {0.70f, 0.45f, 0.90f},
+    {0.90f, 0.45f, 0.70f},
+};
+
+float millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+}  // namespace
+
+namespace render {
+
+void FrameProfiler::History::push(float value) {
+    values[static_cast<size_t>(next)] = value;
+    next = (next + 1) % kHistorySize;
+    count = std::min(count + 1, kHistorySize);
+}
+
+void FrameProfiler::History::stats(float& outMin, float& outAvg, float& outMax) const {
+    if (count == 0) {
+        outMin = 0.0f;
+        outAvg = 0.0f;
+        outMax = 0.0f;
+        return;
+    }
+    float minValue = std::numeric_limits<float>::max();
+    float maxValue = 0.0f;
+    float sum = 0.0f;
+    for (int i = 0; i < count; ++i) {
+        const float value = values[static_cast<size_t>(i)];
+        minValue = std::min(minValue, value);
+        maxValue = std::max(maxValue, value);
+        sum += value;
+    }
+    outMin = minValue;
+    outAvg = sum / static_cast<float>(count);
+    outMax = maxValue;
+}
+
+std::array<int, FrameProfiler::kHistogramBuckets> FrameProfiler::History::histogram() const {
+    std::array<int, kHistogramBuckets> buckets{};
+    for (int i = 0; i < count; ++i) {
+        const int bucket = static_cast<int>(values[static_cast<size_t>(i)] / kHistogramBucketMs);
+        buckets[static_cast<size_t>(std::clamp(bucket, 0, kHistogramBuckets - 1))]++;
+    }
+    return buckets;
+}
+
+FrameProfiler::~FrameProfiler() {
+    destroy();
+}
+
+bool FrameProfiler::init(std::vector<std::string> passNames, const std::string& shaderRoot) {
+    destroy();
+
+    passes_.resize(passNames.size());
+    for (size_t i = 0; i < passNames.size(); ++i) {
+        Pass& pass = passes_[i];
+        pass.name = std::move(passNames[i]);
+        glGenQueries(kQueryLatency, pass.queries.data());
+    }
+
+    const std::string overlayVertex = shaderRoot + "profiler_overlay.vert";
+    const std::string overlayFragment = shaderRoot + "profiler_overlay.frag";
+    if (!overlayShader_.buildFromFiles(overlayVertex, overlayFragment)) {
+        spdlog::error("FrameProfiler: failed to build overlay shader");
+        return false;
+    }
+    overlayRectLocation_ = overlayShader_.uniformLocation("uRect");
+    overlayColorLocation_ = overlayShader_.uniformLocation("uColor");
+    glGenVertexArrays(1, &overlayVao_);
+
+    lastReport_ = Clock::now();
+    return true;
+}
+
+bool FrameProfiler::reloadChanged() {
+    if (overlayShader_.id() == 0 || !overlayShader_.sourcesChanged() || !overlayShader_.reload()) {
+        return false;
+    }
+    overlayRectLocation_ = overlayShader_.uniformLocation("uRect");
+    overlayColorLocation_ = overlayShader_.uniformLocation("uColor");
+    return true;
+}
+
+void FrameProfiler::destroy() {
+    for (Pass& pass : passes_) {
+        if (pass.queries[0] != 0) {
+            glDeleteQueries(kQueryLatency, pass.queries.data());
+        }
+    }
+    passes_.clear();
+    if (overlayVao_ != 0) {
+        glDeleteVertexArrays(1, &overlayVao_);
+        overlayVao_ = 0;
+    }
+    activePass_ = -1;
+}
+
+bool FrameProfiler::collect(int slot) {
+    // The first ring of queries covers start-up work and may read back uninitialised results.
+    const bool warmedUp = frameIndex_ > 2 * kQueryLatency;
+    bool complete = true;
+    for (Pass& pass : passes_) {
+        if (!pass.issued[static_cast<size_t>(slot)]) {
+            continue;
+        }
+        pass.issued[static_cast<size_t>(slot)] = false;
+        const GLuint query = pass.queries[static_cast<size_t>(slot)];
+        GLint available = 0;
+        glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available == 0) {
+            // Still in flight after kQueryLatency frames; drop the sample rather than stall.
+            complete = false;
+            continue;
+        }
+        GLuint64 elapsedNs = 0;
+        glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsedNs);
+        const float elapsedMs = static_cast<float>(static_cast<double>(elapsedNs) * 1.0e-6);
+        // The GPU cannot have spent longer on a pass than the wall time since it was issued.
+        if (!warmedUp || elapsedMs > millisecondsSince(pass.issuedAt[static_cast<size_t>(slot)])) {
+            complete = false;
+            continue;
+        }
+        pass.gpuLatest = elapsedMs;
+        pass.gpu.push(elapsedMs);
+    }
+    return complete;
+}
+
+void FrameProfiler::beginFrame() {
+    if (passes_.empty()) {
+        return;
+    }
+    frameIndex_++;
+    slot_ = frameIndex_ % kQueryLatency;
+    const bool complete = collect(slot_);
+
+    float gpuTotal = 0.0f;
+    for (Pass& pass : passes_) {
+        pass.issued[static_cast<size_t>(slot_)] = false;
+        pass.cpuAccum = 0.0f;
+        pass.touched = false;
+        gpuTotal += pass.gpuLatest;
+        pass.gpuLatest = 0.0f;
+    }
+    // A frame with a pass missing would look cheaper than it was, so only whole frames count.
+    latestFrameGpu_ = 0.0f;
+    if (complete && frameIndex_ > 2 * kQueryLatency) {
+        frameGpu_.push(gpuTotal);
+        latestFrameGpu_ = gpuTotal;
+    }
+    frameStart_ = Clock::now();
+}
+
+void FrameProfiler::endFrame() {
+    if (passes_.empty()) {
+        return;
+    }
+    for (Pass& pass : passes_) {
+        if (pass.touched) {
+            pass.cpu.push(pass.cpuAccum);
+        }
+    }
+    frameCpu_.push(millisecondsSince(frameStart_));
+
+    if (reportInterval_ > 0.0f) {
+        const float sinceReport = std::chrono::duration<float>(Clock::now() - lastReport_).count();
+        if (sinceReport >= reportInterval_) {
+            report();
+            lastReport_ = Clock::now();
+        }
+    }
+}
+
+void FrameProfiler::beginPass(int pass) {
+    if (pass < 0 || pass >= passCount()) {
+        return;
+    }
+    if (activePass_ >= 0) {
+        spdlog::warn("FrameProfiler: pass '{}' started while '{}' is active", passName(pass), passName(activePass_));
+        return;
+    }
+    Pass& entry = passes_[static_cast<size_t>(pass)];
+    glBeginQuery(GL_TIME_ELAPSED, entry.queries[static_cast<size_t>(slot_)]);
+    entry.cpuStart = Clock::now();
+    if (!entry.issued[static_cast<size_t>(slot_)]) {
+        entry.issuedAt[static_cast<size_t>(slot_)] = entry.cpuStart;
+    }
+    activePass_ = pass;
+}
+
+void FrameProfiler::endPass(int pass) {
+    if (pass != activePass_) {
+        return;
+    }
+    Pass& entry = passes_[static_cast<size_t>(pass)];
+    glEndQuery(GL_TIME_ELAPSED);
+    entry.cpuAccum += millisecondsSince(entry.cpuStart);
+    entry.issued[static_cast<size_t>(slot_)] = true;
+    entry.touched = true;
+    activePass_ = -1;
+}
+
+void FrameProfiler::reset() {
+    for (Pass& pass : passes_) {
+        pass.gpu = History{};
+        pass.cpu = History{};
+    }
+    frameGpu_ = History{};
+    frameCpu_ = History{};
+    latency_ = History{};
+    jitter_ = History{};
+}
+
+FrameProfiler::PassStats FrameProfiler::passStats(int pass) const {
+    PassStats stats{};
+    if (pass < 0 || pass >= passCount()) {
+        return stats;
+    }
+    const Pass& entry = passes_[static_cast<size_t>(pass)];
+    entry.gpu.stats(stats.gpuMin, stats.gpuAvg, stats.gpuMax);
+    entry.cpu.stats(stats.cpuMin, stats.cpuAvg, stats.cpuMax);
+    stats.samples = entry.gpu.count;
+    return stats;
+}
+
+FrameProfiler::PassStats FrameProfiler::frameStats() const {
+    PassStats stats{};
+    frameGpu_.stats(stats.gpuMin, stats.gpuAvg, stats.gpuMax);
+    frameCpu_.stats(stats.cpuMin, stats.cpuAvg, stats.cpuMax);
+    stats.samples = frameGpu_.count;
+    return stats;
+}
+
+FrameProfiler::PacingStats FrameProfiler::pacingStats() const {
+    PacingStats stats{};
+    float jitterMin = 0.0f;
+    latency_.stats(stats.latencyMin, stats.latencyAvg, stats.latencyMax);
+    jitter_.stats(jitterMin, stats.jitterAvg, stats.jitterMax);
+    stats.latencyHistogram = latency_.histogram();
+    stats.jitterHistogram = jitter_.histogram();
+    stats.samples = latency_.count;
+    return stats;
+}
+
+void FrameProfiler::report() const {
+    const PassStats frame = frameStats();
+    spdlog::info(
+        "FrameProfiler: frame gpu {:.3f}/{:.3f}/{:.3f} ms cpu {:.3f}/{:.3f}/{:.3f} ms (min/avg/max over {} frames)",
+        frame.gpuMin, frame.gpuAvg, frame.gpuMax,
+        frame.cpuMin, frame.cpuAvg, frame.cpuMax,
+        frame.samples
+    );
+    const PacingStats pacing = pacingStats();
+    if (pacing.samples > 0) {
+        spdlog::info(
+            "FrameProfiler: latency {:.3f}/{:.3f}/{:.3f} ms jitter avg {:.3f} max {:.3f} ms",
+            pacing.latencyMin, pacing.latencyAvg, pacing.latencyMax,
+            pacing.jitterAvg, pacing.jitterMax
+        );
+    }
+    for (int i = 0; i < passCount(); ++i) {
+        const PassStats stats = passStats(i);
+        if (stats.samples == 0) {
+            continue;
+        }
+        spdlog::info(
+            "FrameProfiler:   {:<18} gpu {:.3f}/{:.3f}/{:.3f} ms cpu {:.3f}/{:.3f}/{:.3f} ms",
+            passName(i),
+            stats.gpuMin, stats.gpuAvg, stats.gpuMax,
+            stats.cpuMin, stats.cpuAvg, stats.cpuMax
+        );
+    }
+}
+
+void FrameProfiler::drawRect(float x, float y, float w, float h, float r, float g, float b, float a, int width, int height) const {
+    // Convert a top-left pixel rectangle into NDC (x0, y0, x1, y1).
+    const float x0 = x / static_cast<float>(width) * 2.0f - 1.0f;
+    const float x1 = (x + w) / static_cast<float>(width) * 2.0f - 1.0f;
+    const float y0 = 1.0f - (y + h) / static_cast<float>(height) * 2.0f;
+    const float y1 = 1.0f - y / static_cast<float>(height) * 2.0f;
+    glUniform4f(overlayRectLocation_, x0, y0, x1, y1);
+    glUniform4f(overlayColorLocation_, r, g, b, a);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+}
+
+void FrameProfiler::drawOverlay(int width, int height) const {
+    if (!overlayVisible_ || overlayShader_.id() == 0 || width <= 0 || height <= 0) {
+        return;
+    }
+
+    glDisable(GL_DEPTH_TEST);
+    glDepthMask(GL_FALSE);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    overlayShader_.use();
+    glBindVertexArray(overlayVao_);
+
+    const float msToPixels = kOverlayBarWidth / kOverlayBudgetMs;
+    const int rows = passCount() + 1;
+    const float panelHeight = static_cast<float>(rows) * kOverlayRowHeight + 8.0f;
+    drawRect(kOverlayMargin - 4.0f, kOverlayMargin - 4.0f, kOverlayBarWidth + 8.0f, panelHeight,
+             0.0f, 0.0f, 0.0f, 0.6f, width, height);
+
+    auto drawRow = [&](int row, const PassStats& stats, const float* color) {
+        const float y = kOverlayMargin + static_cast<float>(row) * kOverlayRowHeight;
+        const float gpuWidth = std::min(stats.gpuAvg * msToPixels, kOverlayBarWidth);
+        const float cpuWidth = std::min(stats.cpuAvg * msToPixels, kOverlayBarWidth);
+        const float maxX = std::min(stats.gpuMax * msToPixels, kOverlayBarWidth);
+        drawRect(kOverlayMargin, y, gpuWidth, kOverlayRowHeight - 6.0f, color[0], color[1], color[2], 0.9f, width, height);
+        drawRect(kOverlayMargin, y + kOverlayRowHeight - 5.0f, cpuWidth, 2.0f, 0.8f, 0.8f, 0.8f, 0.9f, width, height);
+        drawRect(kOverlayMargin + maxX, y, 2.0f, kOverlayRowHeight - 6.0f, 1.0f, 1.0f, 1.0f, 0.9f, width, height);
+    };
+
+    for (int i = 0; i < passCount(); ++i) {
+        drawRow(i, passStats(i), kPassColors[i % 8]);
+    }
+    const float frameColor[3] = {0.85f, 0.85f, 0.85f};
+    drawRow(passCount(), frameStats(), frameColor);
+
+    // Frame budget marker (60 Hz).
+    drawRect(kOverlayMargin + kOverlayBarWidth - 1.0f, kOverlayMargin - 4.0f, 1.0f, panelHeight,
+             1.0f, 0.2f, 0.2f, 0.9f, width, height);
+
+    glBindVertexArray(0);
+    glDisable(GL_BLEND);
+    glDepthMask(GL_TRUE);
+}
+
+}  // namespace render
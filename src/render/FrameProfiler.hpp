@@ -0,0 +1,266 @@
+#ifndef GL_GLEXT_PROTOTYPES
+#define GL_GLEXT_PROTOTYPES
+#endif
+#pragma once
+
+#include <SDL_opengl.h>
+
+#include <array>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "ShaderProgram.hpp"
+
+namespace render {
+
+/**
+ * Measures per-pass GPU and CPU time with non-blocking timer queries.
+ * Passes are identified by index and must not nest (GL_TIME_ELAPSED queries cannot overlap).
+ */
+class FrameProfiler {
+public:
+    /**
+     * Number of frames a query set stays in flight before its results are read back.
+     */
+    static constexpr int kQueryLatency = 3;
+    /**
+     * Number of frames kept for rolling statistics.
+     */
+    static constexpr int kHistorySize = 120;
+    /**
+     * Buckets of the pacing histograms; the last one collects every sample above the range.
+     */
+    static constexpr int kHistogramBuckets = 32;
+    /**
+     * Width of one pacing histogram bucket, in milliseconds.
+     */
+    static constexpr float kHistogramBucketMs = 2.0f;
+
+    /**
+     * Rolling min/avg/max timings for a single pass, in milliseconds.
+     */
+    struct PassStats {
+        float gpuMin{0.0f};
+        float gpuAvg{0.0f};
+        float gpuMax{0.0f};
+        float cpuMin{0.0f};
+        float cpuAvg{0.0f};
+        float cpuMax{0.0f};
+        int samples{0};
+    };
+
+    /**
+     * Rolling frame pacing statistics, in milliseconds (see FramePacer).
+     */
+    struct PacingStats {
+        float latencyMin{0.0f};
+        float latencyAvg{0.0f};
+        float latencyMax{0.0f};
+        float jitterAvg{0.0f};
+        float jitterMax{0.0f};
+        /**
+         * Sample counts per kHistogramBucketMs bucket over the same window as the averages.
+         */
+        std::array<int, kHistogramBuckets> latencyHistogram{};
+        std::array<int, kHistogramBuckets> jitterHistogram{};
+        int samples{0};
+    };
+
+    /**
+     * Creates an empty profiler without allocating GL objects.
+     */
+    FrameProfiler() = default;
+    /**
+     * Releases timer queries if created.
+     */
+    ~FrameProfiler();
+
+    /**
+     * Non-copyable to avoid double-deleting GL query objects.
+     */
+    FrameProfiler(const FrameProfiler&) = delete;
+    /**
+     * Non-copyable assignment to avoid double-deleting GL query objects.
+     */
+    FrameProfiler& operator=(const FrameProfiler&) = delete;
+
+    /**
+     * Allocates timer queries for the given passes and builds the overlay shader.
+     * @param passNames Display name for each pass index.
+     * @param shaderRoot Directory containing the overlay shaders.
+     * @return true if queries and overlay shader are ready.
+     */
+    bool init(std::vector<std::string> passNames, const std::string& shaderRoot);
+    /**
+     * Releases timer queries and overlay resources.
+     */
+    void destroy();
+    /**
+     * Rebuilds the overlay shader if its source files changed.
+     * @return true if the program was replaced.
+     */
+    bool reloadChanged();
+
+    /**
+     * Collects finished query results from older frames and starts a new frame.
+     */
+    void beginFrame();
+    /**
+     * Closes the frame's CPU timing and emits a log report when the interval elapsed.
+     */
+    void endFrame();
+    /**
+     * Starts GPU and CPU timing for a pass.
+     * @param pass Pass index passed to init.
+     */
+    void beginPass(int pass);
+    /**
+     * Stops GPU and CPU timing for a pass.
+     * @param pass Pass index passed to init.
+     */
+    void endPass(int pass);
+
+    /**
+     * Records the input-to-GPU-completion latency of a finished frame.
+     */
+    void recordLatency(float ms) { latency_.push(ms); }
+    /**
+     * Records how far a present interval strayed from the one before it.
+     */
+    void recordJitter(float ms) { jitter_.push(ms); }
+
+    /**
+     * Clears all rolling statistics (for example after a warm-up period).
+     */
+    void reset();
+
+    /**
+     * Computes rolling statistics for a pass.
+     * @param pass Pass index passed to init.
+     * @return Rolling GPU/CPU min/avg/max in milliseconds.
+     */
+    PassStats passStats(int pass) const;
+    /**
+     * Computes rolling statistics for whole frames (GPU is the sum of all passes).
+     */
+    PassStats frameStats() const;
+    /**
+     * Computes rolling latency and jitter statistics with their histograms.
+     */
+    PacingStats pacingStats() const;
+    /**
+     * Returns the GPU time of the frame collected by the last beginFrame, or 0 when its queries
+     * had not all landed with plausible results.
+     */
+    float latestFrameGpuMs() const { return latestFrameGpu_; }
+    /**
+     * Returns the number of registered passes.
+     */
+    int passCount() const { return static_cast<int>(passes_.size()); }
+    /**
+     * Returns the display name of a pass.
+     * @param pass Pass index passed to init.
+     */
+    const std::string& passName(int pass) const { return passes_[static_cast<size_t>(pass)].name; }
+
+    /**
+     * Sets how often rolling statistics are logged.
+     * @param seconds Report interval; 0 disables logging.
+     */
+    void setReportInterval(float seconds) { reportInterval_ = seconds; }
+    /**
+     * Toggles the on-screen timing overlay.
+     */
+    void toggleOverlay() { overlayVisible_ = !overlayVisible_; }
+    /**
+     * Returns true when the on-screen overlay is shown.
+     */
+    bool overlayVisible() const { return overlayVisible_; }
+    /**
+     * Draws per-pass timing bars into the currently bound framebuffer.
+     * @param width Framebuffer width in pixels.
+     * @param height Framebuffer height in pixels.
+     */
+    void drawOverlay(int width, int height) const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * Fixed-size ring of frame samples.
+     */
+    struct History {
+        std::array<float, kHistorySize> values{};
+        int count{0};
+        int next{0};
+
+        /**
+         * Appends a sample, overwriting the oldest once full.
+         */
+        void push(float value);
+        /**
+         * Computes min/avg/max over the stored samples (zeros when empty).
+         */
+        void stats(float& outMin, float& outAvg, float& outMax) const;
+        /**
+         * Counts the stored samples per kHistogramBucketMs bucket.
+         */
+        std::array<int, kHistogramBuckets> histogram() const;
+    };
+
+    /**
+     * Query objects and rolling history for one pass.
+     */
+    struct Pass {
+        std::string name;
+        std::array<GLuint, kQueryLatency> queries{};
+        std::array<bool, kQueryLatency> issued{};
+        /**
+         * When each slot's query was first begun; bounds the GPU time it can report.
+         */
+        std::array<Clock::time_point, kQueryLatency> issuedAt{};
+        Clock::time_point cpuStart{};
+        float cpuAccum{0.0f};
+        float gpuLatest{0.0f};
+        bool touched{false};
+        History gpu;
+        History cpu;
+    };
+
+    /**
+     * Reads back query results for a slot without stalling, dropping warm-up and implausible ones.
+     * @param slot Query slot to collect.
+     * @return true when every pass issued in the slot produced a sample.
+     */
+    bool collect(int slot);
+    /**
+     * Logs rolling statistics for every pass.
+     */
+    void report() const;
+    /**
+     * Draws a solid rectangle in pixel coordinates.
+     */
+    void drawRect(float x, float y, float w, float h, float r, float g, float b, float a, int width, int height) const;
+
+    std::vector<Pass> passes_;
+    History frameGpu_;
+    History frameCpu_;
+    History latency_;
+    History jitter_;
+    float latestFrameGpu_{0.0f};
+    Clock::time_point frameStart_{};
+    Clock::time_point lastReport_{};
+    float reportInterval_{5.0f};
+    int frameIndex_{0};
+    int slot_{0};
+    int activePass_{-1};
+    bool overlayVisible_{false};
+
+    ShaderProgram overlayShader_;
+    GLint overlayRectLocation_{-1};
+    GLint overlayColorLocation_{-1};
+    GLuint overlayVao_{0};
+};
+
+}  // namespace render
@@ -0,0 +1,44 @@
+#include "Frustum.hpp"
+
+#include <glm/glm.hpp>
+
+namespace render {
+
+Frustum::Frustum(const glm::mat4& viewProj) {
+    // Gribb/Hartmann: rows of the matrix combine into the clip planes.
+    const glm::vec4 row0(viewProj[0][0], viewProj[1][0], viewProj[2][0], viewProj[3][0]);
+    const glm::vec4 row1(viewProj[0][1], viewProj[1][1], viewProj[2][1], viewProj[3][1]);
+    const glm::vec4 row2(viewProj[0][2], viewProj[1][2], viewProj[2][2], viewProj[3][2]);
+    const glm::vec4 row3(viewProj[0][3], viewProj[1][3], viewProj[2][3], viewProj[3][3]);
+
+    planes_[0] = row3 + row0;
+    planes_[1] = row3 - row0;
+    planes_[2] = row3 + row1;
+    planes_[3] = row3 - row1;
+    planes_[4] = row3 + row2;
+    planes_[5] = row3 - row2;
+
+    for (glm::vec4& plane : planes_) {
+        const float length = glm::length(glm::vec3(plane));
+        if (length > 0.0f) {
+            plane /= length;
+        }
+    }
+}
+
+bool Frustum::intersects(const Aabb& box) const {
+    for (const glm::vec4& plane : planes_) {
+        // Corner furthest along the plane normal.
+        const glm::vec3 positive(
+            plane.x >= 0.0f ? box.max.x : box.min.x,
+            plane.y >= 0.0f ? box.max.y : box.min.y,
+            plane.z >= 0.0f ? box.max.z : box.min.z
+        );
+        if (glm::dot(glm::vec3(plane), positive) + plane.w < 0.0f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace render
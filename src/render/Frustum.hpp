@@ -0,0 +1,56 @@
+#pragma once
+
+#include <array>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+namespace render {
+
+/**
+ * Axis-aligned bounding box.
+ */
+struct Aabb {
+    /**
+     * Minimum corner.
+     */
+    glm::vec3 min{0.0f};
+    /**
+     * Maximum corner.
+     */
+    glm::vec3 max{0.0f};
+
+    /**
+     * Returns true when min <= max on every axis.
+     */
+    bool valid() const { return min.x <= max.x && min.y <= max.y && min.z <= max.z; }
+};
+
+/**
+ * Six clip planes extracted from a view-projection matrix (GL clip space, -w..w).
+ */
+class Frustum {
+public:
+    /**
+     * Creates a frustum that accepts everything.
+     */
+    Frustum() = default;
+    /**
+     * Extracts normalized planes from a view-projection matrix.
+     * @param viewProj Matrix mapping world space to clip space.
+     */
+    explicit Frustum(const glm::mat4& viewProj);
+
+    /**
+     * Tests a box against all planes (conservative: may accept boxes just outside corners).
+     * @param box World-space box.
+     * @return true if the box is at least partially inside.
+     */
+    bool intersects(const Aabb& box) const;
+
+private:
+    std::array<glm::vec4, 6> planes_{};
+};
+
+}  // namespace render
@@ -0,0 +1,43 @@
+#include "GlFunctions.hpp"
+
+#include <SDL.h>
+
+namespace {
+
+template <typename Fn>
+void resolve(Fn& outFn, const char* name) {
+    outFn = reinterpret_cast<Fn>(SDL_GL_GetProcAddress(name));
+}
+
+bool atLeast(int major, int minor, int wantMajor, int wantMinor) {
+    return major > wantMajor || (major == wantMajor && minor >= wantMinor);
+}
+
+}  // namespace
+
+namespace render {
+
+void GlFunctions::load(int major, int minor) {
+    *this = GlFunctions{};
+    // Some drivers hand out non-null stubs for unsupported functions, so gate on the version.
+    if (atLeast(major, minor, 4, 2)) {
+        resolve(memoryBarrier, "glMemoryBarrier");
+        resolve(bindImageTexture, "glBindImageTexture");
+        resolve(drawElementsInstancedBaseVertexBaseInstance, "glDrawElementsInstancedBaseVertexBaseInstance");
+    }
+    if (atLeast(major, minor, 4, 3)) {
+        resolve(dispatchCompute, "glDispatchCompute");
+        resolve(multiDrawElementsIndirect, "glMultiDrawElementsIndirect");
+    }
+    if (atLeast(major, minor, 4, 4) || SDL_GL_ExtensionSupported("GL_ARB_buffer_storage")) {
+        resolve(bufferStorage, "glBufferStorage");
+    }
+    // Both extensions define the same completion query; only the entry point name differs.
+    if (SDL_GL_ExtensionSupported("GL_KHR_parallel_shader_compile")) {
+        resolve(maxShaderCompilerThreads, "glMaxShaderCompilerThreadsKHR");
+    } else if (SDL_GL_ExtensionSupported("GL_ARB_parallel_shader_compile")) {
+        resolve(maxShaderCompilerThreads, "glMaxShaderCompilerThreadsARB");
+    }
+}
+
+}  // namespace render
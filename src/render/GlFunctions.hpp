@@ -0,0 +1,61 @@
+#ifndef GL_GLEXT_PROTOTYPES
+#define GL_GLEXT_PROTOTYPES
+#endif
+#pragma once
+
+#include <SDL_opengl.h>
+
+namespace render {
+
+/**
+ * GL entry points newer than the 4.1 core profile, resolved at runtime.
+ * macOS stops at 4.1 and does not export these symbols, so they cannot be linked directly.
+ */
+struct GlFunctions {
+    /**
+     * glDispatchCompute (GL 4.3).
+     */
+    PFNGLDISPATCHCOMPUTEPROC dispatchCompute{nullptr};
+    /**
+     * glMemoryBarrier (GL 4.2).
+     */
+    PFNGLMEMORYBARRIERPROC memoryBarrier{nullptr};
+    /**
+     * glBindImageTexture (GL 4.2).
+     */
+    PFNGLBINDIMAGETEXTUREPROC bindImageTexture{nullptr};
+    /**
+     * glDrawElementsInstancedBaseVertexBaseInstance (GL 4.2).
+     */
+    PFNGLDRAWELEMENTSINSTANCEDBASEVERTEXBASEINSTANCEPROC drawElementsInstancedBaseVertexBaseInstance{nullptr};
+    /**
+     * glMultiDrawElementsIndirect (GL 4.3).
+     */
+    PFNGLMULTIDRAWELEMENTSINDIRECTPROC multiDrawElementsIndirect{nullptr};
+    /**
+     * glBufferStorage (GL 4.4 or ARB_buffer_storage).
+     */
+    PFNGLBUFFERSTORAGEPROC bufferStorage{nullptr};
+    /**
+     * glMaxShaderCompilerThreadsKHR (KHR_parallel_shader_compile, or the ARB variant).
+     * When set, compile and link run on driver threads and GL_COMPLETION_STATUS_KHR can be polled.
+     */
+    PFNGLMAXSHADERCOMPILERTHREADSKHRPROC maxShaderCompilerThreads{nullptr};
+
+    /**
+     * Resolves entry points for the current context; missing ones stay null.
+     * @param major Context major version.
+     * @param minor Context minor version.
+     */
+    void load(int major, int minor);
+    /**
+     * Returns true when compute dispatch and image load/store are available.
+     */
+    bool hasCompute() const { return dispatchCompute && memoryBarrier && bindImageTexture; }
+    /**
+     * Returns true when immutable storage (and therefore persistent mapping) is available.
+     */
+    bool hasBufferStorage() const { return bufferStorage != nullptr; }
+};
+
+}  // namespace render
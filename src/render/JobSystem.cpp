@@ -0,0 +1,138 @@
+#include "JobSystem.hpp"
+
+namespace {
+
+// Index of the calling worker's queue, valid while tWorkerPool matches the pool.
+thread_local const render::JobSystem* tWorkerPool = nullptr;
+thread_local size_t tWorkerIndex = 0;
+
+}  // namespace
+
+namespace render {
+
+JobSystem::~JobSystem() {
+    stop();
+}
+
+void JobSystem::start(int workerCount) {
+    if (!workers_.empty()) {
+        return;
+    }
+    if (workerCount <= 0) {
+        workerCount = static_cast<int>(std::thread::hardware_concurrency()) - 1;
+    }
+    if (workerCount <= 0) {
+        return;
+    }
+    stopping_.store(false, std::memory_order_relaxed);
+    queues_.clear();
+    for (int i = 0; i <= workerCount; ++i) {
+        queues_.push_back(std::make_unique<Queue>());
+    }
+    workers_.reserve(static_cast<size_t>(workerCount));
+    for (int i = 0; i < workerCount; ++i) {
+        workers_.emplace_back(&JobSystem::workerLoop, this, static_cast<size_t>(i));
+    }
+}
+
+void JobSystem::stop() {
+    if (workers_.empty()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex_);
+        stopping_.store(true, std::memory_order_relaxed);
+    }
+    wake_.notify_all();
+    for (std::thread& worker : workers_) {
+        worker.join();
+    }
+    workers_.clear();
+    queues_.clear();
+    queued_.store(0, std::memory_order_relaxed);
+}
+
+void JobSystem::submit(JobFn fn, void* context, int begin, int end, Counter& counter) {
+    const Job job{fn, context, begin, end, &counter};
+    counter.pending_.fetch_add(1, std::memory_order_relaxed);
+    if (workers_.empty()) {
+        execute(job);
+        return;
+    }
+    Queue& queue = *queues_[localQueue()];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.jobs.push_back(job);
+    }
+    queued_.fetch_add(1, std::memory_order_release);
+    // Taking the lock orders this push against a worker that just found nothing and is about to sleep.
+    { std::lock_guard<std::mutex> lock(wakeMutex_); }
+    wake_.notify_one();
+}
+
+void JobSystem::wait(Counter& counter) {
+    const size_t index = localQueue();
+    while (!counter.done()) {
+        Job job{};
+        if (!queues_.empty() && take(index, job)) {
+            execute(job);
+        } else {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void JobSystem::workerLoop(size_t index) {
+    tWorkerPool = this;
+    tWorkerIndex = index;
+    while (true) {
+        Job job{};
+        if (take(index, job)) {
+            execute(job);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(wakeMutex_);
+        wake_.wait(lock, [this] {
+            return stopping_.load(std::memory_order_relaxed) || queued_.load(std::memory_order_acquire) > 0;
+        });
+        if (stopping_.load(std::memory_order_relaxed)) {
+            return;
+        }
+    }
+}
+
+bool JobSystem::take(size_t index, Job& outJob) {
+    {
+        Queue& own = *queues_[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.jobs.empty()) {
+            outJob = own.jobs.back();
+            own.jobs.pop_back();
+            queued_.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    const size_t queueCount = queues_.size();
+    for (size_t offset = 1; offset < queueCount; ++offset) {
+        Queue& victim = *queues_[(index + offset) % queueCount];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.jobs.empty()) {
+            outJob = victim.jobs.front();
+            victim.jobs.pop_front();
+            queued_.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+void JobSystem::execute(const Job& job) {
+    job.fn(job.context, job.begin, job.end);
+    job.counter->pending_.fetch_sub(1, std::memory_order_release);
+}
+
+size_t JobSystem::localQueue() const {
+    return tWorkerPool == this ? tWorkerIndex : queues_.size() - 1;
+}
+
+}  // namespace render
@@ -0,0 +1,166 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace render {
+
+/**
+ * Work-stealing thread pool for CPU-side frame work.
+ * Every worker owns a job deque: it pops its newest job and, when empty, steals the oldest job
+ * of another queue. Threads outside the pool push to a shared queue and run jobs while they wait
+ * on a counter, so waiting never leaves the caller idle.
+ */
+class JobSystem {
+public:
+    /**
+     * Counts the unfinished jobs of one submission; done() once every job has run.
+     */
+    class Counter {
+    public:
+        /**
+         * Returns true when no job counted here is pending.
+         */
+        bool done() const { return pending_.load(std::memory_order_acquire) == 0; }
+
+    private:
+        friend class JobSystem;
+        std::atomic<int> pending_{0};
+    };
+
+    /**
+     * Job entry point; context belongs to the submitter and must outlive the job.
+     */
+    using JobFn = void (*)(void* context, int begin, int end);
+
+    /**
+     * Creates a pool without threads; jobs run inline until start is called.
+     */
+    JobSystem() = default;
+    /**
+     * Stops and joins the workers.
+     */
+    ~JobSystem();
+
+    /**
+     * Non-copyable because workers hold a pointer to the pool.
+     */
+    JobSystem(const JobSystem&) = delete;
+    /**
+     * Non-copyable assignment because workers hold a pointer to the pool.
+     */
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    /**
+     * Starts the worker threads (no-op if already running).
+     * @param workerCount Number of workers; 0 uses one fewer than the hardware threads.
+     */
+    void start(int workerCount = 0);
+    /**
+     * Joins the workers; every counter must have been waited on first.
+     */
+    void stop();
+    /**
+     * Returns the number of worker threads (0 when jobs run inline).
+     */
+    int workerCount() const { return static_cast<int>(workers_.size()); }
+
+    /**
+     * Queues one job, or runs it immediately when there are no workers.
+     * @param fn Entry point.
+     * @param context Argument handed to fn.
+     * @param begin First index handed to fn.
+     * @param end One past the last index handed to fn.
+     * @param counter Counter incremented now and decremented when the job finishes.
+     */
+    void submit(JobFn fn, void* context, int begin, int end, Counter& counter);
+    /**
+     * Runs queued jobs on the calling thread until the counter reaches zero.
+     */
+    void wait(Counter& counter);
+
+    /**
+     * Splits [0, count) into chunks of grain indices and runs body(begin, end) on each, the first
+     * chunk on the calling thread. Returns once every chunk has run.
+     * @param count Number of indices.
+     * @param grain Indices per job (at least 1).
+     * @param body Callable taking (int begin, int end); called concurrently.
+     */
+    template <typename Fn>
+    void parallelFor(int count, int grain, const Fn& body) {
+        if (count <= 0) {
+            return;
+        }
+        grain = std::max(grain, 1);
+        if (workers_.empty() || count <= grain) {
+            body(0, count);
+            return;
+        }
+        const JobFn trampoline = [](void* context, int begin, int end) {
+            (*static_cast<const Fn*>(context))(begin, end);
+        };
+        Counter counter;
+        void* context = const_cast<Fn*>(&body);
+        for (int begin = grain; begin < count; begin += grain) {
+            submit(trampoline, context, begin, std::min(begin + grain, count), counter);
+        }
+        body(0, grain);
+        wait(counter);
+    }
+
+private:
+    /**
+     * One queued call.
+     */
+    struct Job {
+        JobFn fn{nullptr};
+        void* context{nullptr};
+        int begin{0};
+        int end{0};
+        Counter* counter{nullptr};
+    };
+
+    /**
+     * Job deque with its lock; the owner uses the back, thieves the front.
+     */
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+    };
+
+    /**
+     * Worker thread body.
+     */
+    void workerLoop(size_t index);
+    /**
+     * Takes a job from queue index (newest first) or steals the oldest job of another queue.
+     * @return true if outJob was filled.
+     */
+    bool take(size_t index, Job& outJob);
+    /**
+     * Runs a job and signals its counter.
+     */
+    static void execute(const Job& job);
+    /**
+     * Returns the queue the calling thread pushes to.
+     */
+    size_t localQueue() const;
+
+    /**
+     * One queue per worker, followed by the shared queue for outside threads.
+     */
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::thread> workers_;
+    std::mutex wakeMutex_;
+    std::condition_variable wake_;
+    std::atomic<int> queued_{0};
+    std::atomic<bool> stopping_{false};
+};
+
+}  // namespace render
@@ -0,0 +1,368 @@
+#include "LightStore.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include <glm/glm.hpp>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define ALKANZAR_LIGHT_SIMD_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define ALKANZAR_LIGHT_SIMD_SSE2 1
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define ALKANZAR_LIGHT_SIMD_NEON 1
+#endif
+
+namespace {
+
+// Orbit and bob amplitudes per light type.
+constexpr float kPointOrbit = 0.55f;
+constexpr float kPointBob = 0.35f;
+constexpr float kSpotOrbit = 2.25f;
+constexpr float kSpotBob = 2.15f;
+
+constexpr float kPi = 3.14159265358979f;
+constexpr float kHalfPi = 1.57079632679490f;
+constexpr float kInvTwoPi = 0.159154943091895f;
+// 2*pi split so k * kTwoPiHigh is exact for the multiples that occur (Cody-Waite reduction).
+constexpr float kTwoPiHigh = 6.28125f;
+constexpr float kTwoPiLow = 0.00193530717958647f;
+constexpr float kMinLengthSquared = 1e-12f;
+// Covers the polynomial sine and cosine overshooting 1 by a rounding error.
+constexpr float kReachMargin = 1e-3f;
+
+/**
+ * Eight floats in the widest registers available; every operation works lane-wise.
+ */
+struct Float8 {
+#if defined(ALKANZAR_LIGHT_SIMD_AVX2)
+    __m256 v;
+#elif defined(ALKANZAR_LIGHT_SIMD_SSE2)
+    __m128 lo;
+    __m128 hi;
+#elif defined(ALKANZAR_LIGHT_SIMD_NEON)
+    float32x4_t lo;
+    float32x4_t hi;
+#else
+    float lane[render::LightStore::kLaneCount];
+#endif
+};
+
+#if defined(ALKANZAR_LIGHT_SIMD_AVX2)
+
+inline Float8 load(const float* p) { return {_mm256_loadu_ps(p)}; }
+inline void store(float* p, Float8 a) { _mm256_storeu_ps(p, a.v); }
+inline Float8 splat(float s) { return {_mm256_set1_ps(s)}; }
+inline Float8 add(Float8 a, Float8 b) { return {_mm256_add_ps(a.v, b.v)}; }
+inline Float8 sub(Float8 a, Float8 b) { return {_mm256_sub_ps(a.v, b.v)}; }
+inline Float8 mul(Float8 a, Float8 b) { return {_mm256_mul_ps(a.v, b.v)}; }
+inline Float8 div(Float8 a, Float8 b) { return {_mm256_div_ps(a.v, b.v)}; }
+#if defined(__FMA__)
+inline Float8 madd(Float8 a, Float8 b, Float8 c) { return {_mm256_fmadd_ps(a.v, b.v, c.v)}; }
+#else
+inline Float8 madd(Float8 a, Float8 b, Float8 c) { return add(mul(a, b), c); }
+#endif
+inline Float8 min(Float8 a, Float8 b) { return {_mm256_min_ps(a.v, b.v)}; }
+inline Float8 max(Float8 a, Float8 b) { return {_mm256_max_ps(a.v, b.v)}; }
+inline Float8 sqrt(Float8 a) { return {_mm256_sqrt_ps(a.v)}; }
+inline Float8 roundNearest(Float8 a) { return {_mm256_round_ps(a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC)}; }
+inline int lessEqualBits(Float8 a, Float8 b) { return _mm256_movemask_ps(_mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ)); }
+
+#elif defined(ALKANZAR_LIGHT_SIMD_SSE2)
+
+inline Float8 load(const float* p) { return {_mm_loadu_ps(p), _mm_loadu_ps(p + 4)}; }
+inline void store(float* p, Float8 a) {
+    _mm_storeu_ps(p, a.lo);
+    _mm_storeu_ps(p + 4, a.hi);
+}
+inline Float8 splat(float s) { return {_mm_set1_ps(s), _mm_set1_ps(s)}; }
+inline Float8 add(Float8 a, Float8 b) { return {_mm_add_ps(a.lo, b.lo), _mm_add_ps(a.hi, b.hi)}; }
+inline Float8 sub(Float8 a, Float8 b) { return {_mm_sub_ps(a.lo, b.lo), _mm_sub_ps(a.hi, b.hi)}; }
+inline Float8 mul(Float8 a, Float8 b) { return {_mm_mul_ps(a.lo, b.lo), _mm_mul_ps(a.hi, b.hi)}; }
+inline Float8 div(Float8 a, Float8 b) { return {_mm_div_ps(a.lo, b.lo), _mm_div_ps(a.hi, b.hi)}; }
+inline Float8 madd(Float8 a, Float8 b, Float8 c) { return add(mul(a, b), c); }
+inline Float8 min(Float8 a, Float8 b) { return {_mm_min_ps(a.lo, b.lo), _mm_min_ps(a.hi, b.hi)}; }
+inline Float8 max(Float8 a, Float8 b) { return {_mm_max_ps(a.lo, b.lo), _mm_max_ps(a.hi, b.hi)}; }
+inline Float8 sqrt(Float8 a) { return {_mm_sqrt_ps(a.lo), _mm_sqrt_ps(a.hi)}; }
+// Converts with the default round-to-nearest mode; the reduced phases stay far below 2^31.
+inline Float8 roundNearest(Float8 a) {
+    return {_mm_cvtepi32_ps(_mm_cvtps_epi32(a.lo)), _mm_cvtepi32_ps(_mm_cvtps_epi32(a.hi))};
+}
+inline int lessEqualBits(Float8 a, Float8 b) {
+    return _mm_movemask_ps(_mm_cmple_ps(a.lo, b.lo)) | (_mm_movemask_ps(_mm_cmple_ps(a.hi, b.hi)) << 4);
+}
+
+#elif defined(ALKANZAR_LIGHT_SIMD_NEON)
+
+inline Float8 load(const float* p) { return {vld1q_f32(p), vld1q_f32(p + 4)}; }
+inline void store(float* p, Float8 a) {
+    vst1q_f32(p, a.lo);
+    vst1q_f32(p + 4, a.hi);
+}
+inline Float8 splat(float s) { return {vdupq_n_f32(s), vdupq_n_f32(s)}; }
+inline Float8 add(Float8 a, Float8 b) { return {vaddq_f32(a.lo, b.lo), vaddq_f32(a.hi, b.hi)}; }
+inline Float8 sub(Float8 a, Float8 b) { return {vsubq_f32(a.lo, b.lo), vsubq_f32(a.hi, b.hi)}; }
+inline Float8 mul(Float8 a, Float8 b) { return {vmulq_f32(a.lo, b.lo), vmulq_f32(a.hi, b.hi)}; }
+inline Float8 div(Float8 a, Float8 b) { return {vdivq_f32(a.lo, b.lo), vdivq_f32(a.hi, b.hi)}; }
+inline Float8 madd(Float8 a, Float8 b, Float8 c) { return {vfmaq_f32(c.lo, a.lo, b.lo), vfmaq_f32(c.hi, a.hi, b.hi)}; }
+inline Float8 min(Float8 a, Float8 b) { return {vminq_f32(a.lo, b.lo), vminq_f32(a.hi, b.hi)}; }
+inline Float8 max(Float8 a, Float8 b) { return {vmaxq_f32(a.lo, b.lo), vmaxq_f32(a.hi, b.hi)}; }
+inline Float8 sqrt(Float8 a) { return {vsqrtq_f32(a.lo), vsqrtq_f32(a.hi)}; }
+inline Float8 roundNearest(Float8 a) { return {vrndnq_f32(a.lo), vrndnq_f32(a.hi)}; }
+inline int lessEqualBits(Float8 a, Float8 b) {
+    uint32_t lanes[render::LightStore::kLaneCount];
+    vst1q_u32(lanes, vcleq_f32(a.lo, b.lo));
+    vst1q_u32(lanes + 4, vcleq_f32(a.hi, b.hi));
+    int bits = 0;
+    for (int i = 0; i < render::LightStore::kLaneCount; ++i) {
+        bits |= (lanes[i] != 0 ? 1 : 0) << i;
+    }
+    return bits;
+}
+
+#else
+
+template <typename Op>
+inline Float8 lanewise(Float8 a, Float8 b, Op op) {
+    Float8 r{};
+    for (int i = 0; i < render::LightStore::kLaneCount; ++i) {
+        r.lane[i] = op(a.lane[i], b.lane[i]);
+    }
+    return r;
+}
+inline Float8 load(const float* p) {
+    Float8 r{};
+    std::copy(p, p + render::LightStore::kLaneCount, r.lane);
+    return r;
+}
+inline void store(float* p, Float8 a) { std::copy(a.lane, a.lane + render::LightStore::kLaneCount, p); }
+inline Float8 splat(float s) {
+    Float8 r{};
+    std::fill(r.lane, r.lane + render::LightStore::kLaneCount, s);
+    return r;
+}
+inline Float8 add(Float8 a, Float8 b) { return lanewise(a, b, [](float x, float y) { return x + y; }); }
+inline Float8 sub(Float8 a, Float8 b) { return lanewise(a, b, [](float x, float y) { return x - y; }); }
+inline Float8 mul(Float8 a, Float8 b) { return lanewise(a, b, [](float x, float y) { return x * y; }); }
+inline Float8 div(Float8 a, Float8 b) { return lanewise(a, b, [](float x, float y) { return x / y; }); }
+inline Float8 madd(Float8 a, Float8 b, Float8 c) { return add(mul(a, b), c); }
+inline Float8 min(Float8 a, Float8 b) { return lanewise(a, b, [](float x, float y) { return std::min(x, y); }); }
+inline Float8 max(Float8 a, Float8 b) { return lanewise(a, b, [](float x, float y) { return std::max(x, y); }); }
+inline Float8 sqrt(Float8 a) { return lanewise(a, a, [](float x, float) { return std::sqrt(x); }); }
+inline Float8 roundNearest(Float8 a) { return lanewise(a, a, [](float x, float) { return std::nearbyint(x); }); }
+inline int lessEqualBits(Float8 a, Float8 b) {
+    int bits = 0;
+    for (int i = 0; i < render::LightStore::kLaneCount; ++i) {
+        bits |= (a.lane[i] <= b.lane[i] ? 1 : 0) << i;
+    }
+    return bits;
+}
+
+#endif
+
+/**
+ * sin(x): reduce to [-pi, pi], fold into [-pi/2, pi/2], then a degree-11 odd polynomial
+ * (absolute error below 1e-6 over the folded range).
+ */
+inline Float8 sin8(Float8 x) {
+    const Float8 k = roundNearest(mul(x, splat(kInvTwoPi)));
+    Float8 y = madd(k, splat(-kTwoPiHigh), x);
+    y = madd(k, splat(-kTwoPiLow), y);
+    y = min(y, sub(splat(kPi), y));
+    y = max(y, sub(splat(-kPi), y));
+    const Float8 y2 = mul(y, y);
+    Float8 p = splat(-2.5052108e-8f);
+    p = madd(p, y2, splat(2.7557319e-6f));
+    p = madd(p, y2, splat(-1.9841270e-4f));
+    p = madd(p, y2, splat(8.3333333e-3f));
+    p = madd(p, y2, splat(-1.6666667e-1f));
+    p = madd(p, y2, splat(1.0f));
+    return mul(p, y);
+}
+
+inline Float8 cos8(Float8 x) {
+    return sin8(add(x, splat(kHalfPi)));
+}
+
+/**
+ * Returns scale / length(x, y, z), with the length clamped away from zero.
+ */
+inline Float8 scaledInverseLength(Float8 x, Float8 y, Float8 z, Float8 scale) {
+    const Float8 lengthSquared = madd(x, x, madd(y, y, mul(z, z)));
+    return div(scale, sqrt(max(lengthSquared, splat(kMinLengthSquared))));
+}
+
+}  // namespace
+
+namespace render {
+
+void LightStore::assign(const std::vector<LightInstance>& lights) {
+    count_ = static_cast<int>(lights.size());
+    sourceIndex_.clear();
+    sourceIndex_.reserve(lights.size());
+    for (int i = 0; i < count_; ++i) {
+        sourceIndex_.push_back(i);
+    }
+    std::stable_partition(sourceIndex_.begin(), sourceIndex_.end(), [&](int index) {
+        return lights[static_cast<size_t>(index)].type == LightType::Point;
+    });
+    pointCount_ = static_cast<int>(std::count_if(lights.begin(), lights.end(), [](const LightInstance& light) {
+        return light.type == LightType::Point;
+    }));
+
+    const size_t padded = static_cast<size_t>((count_ + kLaneCount - 1) / kLaneCount * kLaneCount);
+    for (std::vector<float>* column :
+         {&baseX_, &baseY_, &baseZ_, &targetX_, &targetY_, &targetZ_, &phase_, &orbit_, &bob_, &radius_, &spot_}) {
+        column->assign(padded, 0.0f);
+    }
+    templates_.assign(static_cast<size_t>(count_), GpuLight{});
+    shadowCasters_.clear();
+
+    for (int i = 0; i < count_; ++i) {
+        const size_t slot = static_cast<size_t>(i);
+        const LightInstance& light = lights[static_cast<size_t>(sourceIndex_[slot])];
+        const bool spot = light.type == LightType::Spot;
+        baseX_[slot] = light.basePosition.x;
+        baseY_[slot] = light.basePosition.y;
+        baseZ_[slot] = light.basePosition.z;
+        targetX_[slot] = light.target.x;
+        targetY_[slot] = light.target.y;
+        targetZ_[slot] = light.target.z;
+        phase_[slot] = light.phase;
+        orbit_[slot] = spot ? kSpotOrbit : kPointOrbit;
+        bob_[slot] = spot ? kSpotBob : kPointBob;
+        radius_[slot] = light.radius;
+        spot_[slot] = spot ? 1.0f : 0.0f;
+
+        GpuLight& gpu = templates_[slot];
+        gpu.colorIntensity = glm::vec4(light.color, light.intensity);
+        if (spot) {
+            const float inner = std::cos(glm::radians(light.innerAngle));
+            const float outer = std::cos(glm::radians(light.outerAngle));
+            const float tanOuter = std::tan(glm::radians(light.outerAngle));
+            gpu.spotParams = glm::vec4(inner, outer, light.radius, tanOuter);
+        } else {
+            gpu.spotParams = glm::vec4(0.0f);
+        }
+        gpu.shadowInfo = glm::vec4(0.0f, 0.0f, light.shadowBiasMin, light.shadowBiasSlope);
+        if (light.castsShadow) {
+            shadowCasters_.push_back(i);
+        }
+    }
+}
+
+Aabb LightStore::reachBounds(int index) const {
+    const size_t slot = static_cast<size_t>(index);
+    const glm::vec3 base(baseX_[slot], baseY_[slot], baseZ_[slot]);
+    const float horizontal = orbit_[slot] + radius_[slot] + kReachMargin;
+    const glm::vec3 reach(horizontal, bob_[slot] + radius_[slot] + kReachMargin, horizontal);
+    return Aabb{base - reach, base + reach};
+}
+
+void LightStore::animate(
+    float time,
+    const glm::mat4& view,
+    float nearPlane,
+    int begin,
+    int end,
+    AnimatedLight* outAnimated,
+    GpuLight* outGpu
+) const {
+    end = std::min(end, count_);
+    const Float8 t = splat(time);
+    const Float8 nearZ = splat(nearPlane);
+    const Float8 zero = splat(0.0f);
+    // View matrix rows (glm is column-major: view[column][row]).
+    Float8 m[3][4];
+    for (int row = 0; row < 3; ++row) {
+        for (int column = 0; column < 4; ++column) {
+            m[row][column] = splat(view[column][row]);
+        }
+    }
+
+    enum Column { PosX, PosY, PosZ, DirX, DirY, DirZ, ViewX, ViewY, ViewZ, ViewDirX, ViewDirY, ViewDirZ, ColumnCount };
+    alignas(32) float lanes[ColumnCount][kLaneCount];
+
+    for (int base = begin; base < end; base += kLaneCount) {
+        const size_t at = static_cast<size_t>(base);
+        const Float8 phase = add(load(&phase_[at]), t);
+        const Float8 orbit = load(&orbit_[at]);
+        const Float8 bob = load(&bob_[at]);
+        const Float8 spot = load(&spot_[at]);
+        const Float8 px = madd(orbit, cos8(mul(phase, splat(0.7f))), load(&baseX_[at]));
+        const Float8 py = madd(bob, sin8(mul(phase, splat(1.3f))), load(&baseY_[at]));
+        const Float8 pz = madd(orbit, sin8(mul(phase, splat(0.9f))), load(&baseZ_[at]));
+
+        // Spots aim at their target; the spot factor leaves point lights with a zero direction.
+        Float8 dx = sub(load(&targetX_[at]), px);
+        Float8 dy = sub(load(&targetY_[at]), py);
+        Float8 dz = sub(load(&targetZ_[at]), pz);
+        const Float8 inverseLength = scaledInverseLength(dx, dy, dz, spot);
+        dx = mul(dx, inverseLength);
+        dy = mul(dy, inverseLength);
+        dz = mul(dz, inverseLength);
+
+        const Float8 vx = madd(m[0][0], px, madd(m[0][1], py, madd(m[0][2], pz, m[0][3])));
+        const Float8 vy = madd(m[1][0], px, madd(m[1][1], py, madd(m[1][2], pz, m[1][3])));
+        const Float8 vz = madd(m[2][0], px, madd(m[2][1], py, madd(m[2][2], pz, m[2][3])));
+        Float8 wx = madd(m[0][0], dx, madd(m[0][1], dy, mul(m[0][2], dz)));
+        Float8 wy = madd(m[1][0], dx, madd(m[1][1], dy, mul(m[1][2], dz)));
+        Float8 wz = madd(m[2][0], dx, madd(m[2][1], dy, mul(m[2][2], dz)));
+        const Float8 inverseViewLength = scaledInverseLength(wx, wy, wz, spot);
+        wx = mul(wx, inverseViewLength);
+        wy = mul(wy, inverseViewLength);
+        wz = mul(wz, inverseViewLength);
+
+        // Orthographic camera: a volume loses its front faces once it reaches the near plane.
+        const int crossing = lessEqualBits(sub(sub(zero, vz), load(&radius_[at])), nearZ);
+
+        store(lanes[PosX], px);
+        store(lanes[PosY], py);
+        store(lanes[PosZ], pz);
+        store(lanes[DirX], dx);
+        store(lanes[DirY], dy);
+        store(lanes[DirZ], dz);
+        store(lanes[ViewX], vx);
+        store(lanes[ViewY], vy);
+        store(lanes[ViewZ], vz);
+        store(lanes[ViewDirX], wx);
+        store(lanes[ViewDirY], wy);
+        store(lanes[ViewDirZ], wz);
+
+        const int laneCount = std::min(kLaneCount, end - base);
+        for (int lane = 0; lane < laneCount; ++lane) {
+            const size_t index = at + static_cast<size_t>(lane);
+            AnimatedLight& animated = outAnimated[index];
+            animated.position = glm::vec3(lanes[PosX][lane], lanes[PosY][lane], lanes[PosZ][lane]);
+            animated.direction = glm::vec3(lanes[DirX][lane], lanes[DirY][lane], lanes[DirZ][lane]);
+            animated.crossesNearPlane = (crossing & (1 << lane)) != 0;
+
+            GpuLight gpu = templates_[index];
+            gpu.positionRadius = glm::vec4(lanes[ViewX][lane], lanes[ViewY][lane], lanes[ViewZ][lane], radius_[index]);
+            gpu.directionType = glm::vec4(
+                lanes[ViewDirX][lane],
+                lanes[ViewDirY][lane],
+                lanes[ViewDirZ][lane],
+                spot_[index] > 0.0f ? static_cast<float>(LightType::Spot) : static_cast<float>(LightType::Point)
+            );
+            outGpu[index] = gpu;
+        }
+    }
+}
+
+const char* LightStore::simdName() {
+#if defined(ALKANZAR_LIGHT_SIMD_AVX2)
+    return "avx2";
+#elif defined(ALKANZAR_LIGHT_SIMD_SSE2)
+    return "sse2";
+#elif defined(ALKANZAR_LIGHT_SIMD_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+}  // namespace render
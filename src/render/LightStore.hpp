@@ -0,0 +1,153 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include "Frustum.hpp"
+
+namespace render {
+
+enum class LightType : uint32_t {
+    Point = 0,
+    Spot = 1,
+};
+
+/**
+ * Authored description of one orbiting light.
+ */
+struct LightInstance {
+    glm::vec3 basePosition;
+    float radius;
+    glm::vec3 color;
+    float intensity;
+    glm::vec3 target;
+    float innerAngle;
+    float outerAngle;
+    LightType type;
+    float phase;
+    bool castsShadow{false};
+    float shadowBiasMin{0.0f};
+    float shadowBiasSlope{0.0f};
+    float shadowImportance{1.0f};
+};
+
+/**
+ * One light buffer record (five RGBA32F texels per light, view space).
+ */
+struct GpuLight {
+    glm::vec4 positionRadius;
+    glm::vec4 colorIntensity;
+    glm::vec4 directionType;
+    glm::vec4 spotParams;
+    glm::vec4 shadowInfo;
+};
+
+/**
+ * World-space state of a light after animation.
+ */
+struct AnimatedLight {
+    glm::vec3 position;
+    glm::vec3 direction;
+    /**
+     * The light volume reaches the camera near plane.
+     */
+    bool crossesNearPlane;
+};
+
+/**
+ * Structure-of-arrays copy of the light list, sorted by type once when assigned (points first),
+ * with the per-light constants of the GPU record precomputed. animate() updates eight lights
+ * per step with AVX2, SSE2 or NEON, or a scalar loop when none is available.
+ */
+class LightStore {
+public:
+    /**
+     * Lights processed per SIMD step; animate ranges start on a multiple of this.
+     */
+    static constexpr int kLaneCount = 8;
+
+    /**
+     * Replaces the stored lights.
+     * @param lights Lights in authoring order; store indices are sorted by type.
+     */
+    void assign(const std::vector<LightInstance>& lights);
+
+    /**
+     * Returns the number of stored lights.
+     */
+    int size() const { return count_; }
+    /**
+     * Returns the number of point lights; they occupy store indices [0, pointCount()).
+     */
+    int pointCount() const { return pointCount_; }
+    /**
+     * Returns the authoring index of a stored light.
+     */
+    int sourceIndex(int index) const { return sourceIndex_[static_cast<size_t>(index)]; }
+    /**
+     * Returns the store indices of lights that request shadows.
+     */
+    const std::vector<int>& shadowCasters() const { return shadowCasters_; }
+    /**
+     * Returns the box a light can reach at any animation time: its orbit and bob swept by its radius.
+     * @param index Store index.
+     */
+    Aabb reachBounds(int index) const;
+
+    /**
+     * Animates a range of lights and writes their GPU records (shadow slots left unset).
+     * Safe to call concurrently on disjoint ranges.
+     * @param time Animation time in seconds.
+     * @param view Camera view matrix.
+     * @param nearPlane Camera near plane distance.
+     * @param begin First store index (multiple of kLaneCount).
+     * @param end One past the last store index.
+     * @param outAnimated Receives world-space state, indexed by store index.
+     * @param outGpu Receives GPU records, indexed by store index.
+     */
+    void animate(
+        float time,
+        const glm::mat4& view,
+        float nearPlane,
+        int begin,
+        int end,
+        AnimatedLight* outAnimated,
+        GpuLight* outGpu
+    ) const;
+
+    /**
+     * Returns the instruction set animate() was built for ("avx2", "sse2", "neon" or "scalar").
+     */
+    static const char* simdName();
+
+private:
+    int count_{0};
+    int pointCount_{0};
+    std::vector<int> sourceIndex_;
+    std::vector<int> shadowCasters_;
+    // Animation inputs, padded with zeros to a multiple of kLaneCount.
+    std::vector<float> baseX_;
+    std::vector<float> baseY_;
+    std::vector<float> baseZ_;
+    std::vector<float> targetX_;
+    std::vector<float> targetY_;
+    std::vector<float> targetZ_;
+    std::vector<float> phase_;
+    std::vector<float> orbit_;
+    std::vector<float> bob_;
+    std::vector<float> radius_;
+    /**
+     * 1 for spot lights, 0 for point lights; scales the direction so points keep a zero one.
+     */
+    std::vector<float> spot_;
+    /**
+     * GPU records with the constant fields filled (color, spot cone, shadow bias).
+     */
+    std::vector<GpuLight> templates_;
+};
+
+}  // namespace render
@@ -1,7 +1,43 @@
 #include "MeshBuffer.hpp"
 
+#include <glm/glm.hpp>
 #include <spdlog/spdlog.h>
 
+namespace {
+
+uint64_t nextRevision() {
+    static uint64_t revision = 0;
+    return ++revision;
+}
+
+/**
+ * Returns the world bounds of a box placed by each instance transform.
+ */
+render::Aabb instanceBounds(const render::Aabb& local, const render::MeshPool::Instance* instances, GLuint count) {
+    render::Aabb bounds{};
+    for (GLuint i = 0; i < count; ++i) {
+        const render::MeshPool::Instance& instance = instances[i];
+        for (int corner = 0; corner < 8; ++corner) {
+            const glm::vec4 point(
+                (corner & 1) ? local.max.x : local.min.x,
+                (corner & 2) ? local.max.y : local.min.y,
+                (corner & 4) ? local.max.z : local.min.z,
+                1.0f
+            );
+            const glm::vec3 world(
+                glm::dot(instance.transform[0], point),
+                glm::dot(instance.transform[1], point),
+                glm::dot(instance.transform[2], point)
+            );
+            bounds.min = i == 0 && corner == 0 ? world : glm::min(bounds.min, world);
+            bounds.max = i == 0 && corner == 0 ? world : glm::max(bounds.max, world);
+        }
+    }
+    return bounds;
+}
+
+}  // namespace
+
 namespace render {
 
 MeshBuffer::~MeshBuffer() {
@@ -9,22 +45,16 @@ MeshBuffer::~MeshBuffer() {
 }
 
 void MeshBuffer::destroy() {
-    if (ebo_ != 0) {
-        glDeleteBuffers(1, &ebo_);
-        ebo_ = 0;
+    if (pool_) {
+        pool_->release(allocation_);
+        pool_ = nullptr;
     }
-    if (vbo_ != 0) {
-        glDeleteBuffers(1, &vbo_);
-        vbo_ = 0;
-    }
-    if (vao_ != 0) {
-        glDeleteVertexArrays(1, &vao_);
-        vao_ = 0;
-    }
-    indexCount_ = 0;
+    allocation_ = MeshPool::Allocation{};
+    bounds_ = Aabb{};
+    revision_ = nextRevision();
 }
 
-bool MeshBuffer::upload(const std::vector<float>& vertices, const std::vector<unsigned int>& indices) {
+bool MeshBuffer::upload(MeshPool& pool, const std::vector<float>& vertices, const std::vector<unsigned int>& indices) {
     destroy();
 
     if (vertices.empty() || indices.empty()) {
@@ -32,32 +62,35 @@ bool MeshBuffer::upload(const std::vector<float>& vertices, const std::vector<un
         return false;
     }
 
-    glGenVertexArrays(1, &vao_);
-    glGenBuffers(1, &vbo_);
-    glGenBuffers(1, &ebo_);
-
-    glBindVertexArray(vao_);
-
-    glBindBuffer(GL_ARRAY_BUFFER, vbo_);
-    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(vertices.size() * sizeof(float)), vertices.data(), GL_STATIC_DRAW);
-
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo_);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(indices.size() * sizeof(unsigned int)), indices.data(), GL_STATIC_DRAW);
-
-    constexpr GLsizei stride = static_cast<GLsizei>(9 * sizeof(float));
-    // Position
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(0));
-    // Normal
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(3 * sizeof(float)));
-    // Color
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(6 * sizeof(float)));
+    // Mesh vertices are already in world space, so the position bounds are the world bounds.
+    Aabb bounds{};
+    bounds.min = glm::vec3(vertices[0], vertices[1], vertices[2]);
+    bounds.max = bounds.min;
+    for (size_t i = 9; i + 2 < vertices.size(); i += 9) {
+        const glm::vec3 position(vertices[i], vertices[i + 1], vertices[i + 2]);
+        bounds.min = glm::min(bounds.min, position);
+        bounds.max = glm::max(bounds.max, position);
+    }
+    if (!pool.allocate(vertices, indices, bounds, allocation_)) {
+        return false;
+    }
+    pool_ = &pool;
+    bounds_ = bounds;
+    revision_ = nextRevision();
+    return true;
+}
 
-    glBindVertexArray(0);
+bool MeshBuffer::upload(MeshPool& pool, const MeshPool::EncodedMesh& mesh, const Aabb& bounds) {
+    destroy();
 
-    indexCount_ = static_cast<GLsizei>(indices.size());
+    if (!pool.allocate(mesh, bounds, allocation_)) {
+        return false;
+    }
+    pool_ = &pool;
+    bounds_ = mesh.instances
+        ? instanceBounds(bounds, static_cast<const MeshPool::Instance*>(mesh.instances), mesh.instanceCount)
+        : bounds;
+    revision_ = nextRevision();
     return true;
 }
 
@@ -65,18 +98,23 @@ void MeshBuffer::draw() const {
     if (!valid()) {
         return;
     }
-    glBindVertexArray(vao_);
-    glDrawElements(GL_TRIANGLES, indexCount_, GL_UNSIGNED_INT, nullptr);
-    glBindVertexArray(0);
+    pool_->queue(allocation_);
+    pool_->flush();
 }
 
 void MeshBuffer::drawInstanced(GLsizei instanceCount) const {
     if (!valid() || instanceCount <= 0) {
         return;
     }
-    glBindVertexArray(vao_);
-    glDrawElementsInstanced(GL_TRIANGLES, indexCount_, GL_UNSIGNED_INT, nullptr, instanceCount);
-    glBindVertexArray(0);
+    pool_->queue(allocation_, static_cast<GLuint>(instanceCount));
+    pool_->flush();
+}
+
+void MeshBuffer::queue() const {
+    if (!valid()) {
+        return;
+    }
+    pool_->queue(allocation_);
 }
 
 }  // namespace render
@@ -5,63 +5,119 @@
 
 #include <SDL_opengl.h>
 
+#include <cstdint>
 #include <vector>
 
+#include "Frustum.hpp"
+#include "MeshPool.hpp"
+
 namespace render {
 
+/**
+ * Handle to one mesh stored in a MeshPool.
+ */
 class MeshBuffer {
 public:
     /**
-     * Creates an empty mesh buffer wrapper without allocating GL objects.
+     * Creates an empty handle without reserving pool space.
      */
     MeshBuffer() = default;
     /**
-     * Releases VAO/VBO/EBO resources if created.
+     * Returns the mesh's ranges to its pool.
      */
     ~MeshBuffer();
 
     /**
-     * Non-copyable to avoid double-deleting GL buffers.
+     * Non-copyable to avoid releasing the same pool ranges twice.
      */
     MeshBuffer(const MeshBuffer&) = delete;
     /**
-     * Non-copyable assignment to avoid double-deleting GL buffers.
+     * Non-copyable assignment to avoid releasing the same pool ranges twice.
      */
     MeshBuffer& operator=(const MeshBuffer&) = delete;
 
     /**
-     * Uploads vertex and index data and configures vertex attributes.
-     * Expects 9 floats per vertex: position (3), normal (3), color (3).
+     * Copies vertex and index data into a pool, replacing any previous contents.
+     * Expects 9 floats per vertex: position (3), normal (3), color (3); the pool re-encodes
+     * them into its vertex layout.
+     * @param pool Pool to allocate from; must outlive this handle's draws.
      * @param vertices Interleaved vertex data.
      * @param indices Triangle indices.
      * @return true on success, false if input is empty or upload fails.
      */
-    bool upload(const std::vector<float>& vertices, const std::vector<unsigned int>& indices);
+    bool upload(MeshPool& pool, const std::vector<float>& vertices, const std::vector<unsigned int>& indices);
+    /**
+     * Uploads a mesh already encoded in the pool's layout, replacing any previous contents.
+     * @param pool Pool to allocate from; must outlive this handle's draws.
+     * @param mesh Encoded streams, indices and instances, read directly by the upload.
+     * @param bounds Position bounds the streams were quantized against, before instance transforms.
+     * @return true on success.
+     */
+    bool upload(MeshPool& pool, const MeshPool::EncodedMesh& mesh, const Aabb& bounds);
     /**
-     * Draws the indexed mesh if the buffer is valid.
+     * Draws every stored instance of the mesh if the buffer is valid.
      */
     void draw() const;
     /**
-     * Draws the indexed mesh with instancing if valid and count > 0.
+     * Draws the indexed mesh instanceCount times if valid and count > 0, for shaders that fetch
+     * their per-instance data by gl_InstanceID instead of reading the stored instances.
      * @param instanceCount Number of instances to render.
      */
     void drawInstanced(GLsizei instanceCount) const;
     /**
-     * Checks whether GPU buffers and index data are available.
-     * @return true if VAO/VBO/EBO are created and index count is non-zero.
+     * Adds every stored instance to its pool's pending batch; pool()->flush() issues it.
+     */
+    void queue() const;
+    /**
+     * Returns the owning pool, or nullptr before upload.
+     */
+    MeshPool* pool() const { return pool_; }
+    /**
+     * Returns the mesh's location in its pool.
+     */
+    const MeshPool::Allocation& allocation() const { return allocation_; }
+    /**
+     * Returns the pool VAO (0 before upload).
+     */
+    GLuint vao() const { return pool_ ? pool_->vao() : 0; }
+    /**
+     * Checks whether the mesh holds index data in a live pool.
+     * @return true if uploaded and the pool's buffers exist.
+     */
+    bool valid() const { return pool_ && pool_->vao() != 0 && allocation_.indexCount > 0; }
+    /**
+     * Returns the world-space bounds of every instance.
+     */
+    const Aabb& bounds() const { return bounds_; }
+    /**
+     * Returns the number of stored instances (1 for meshes uploaded from float vertices).
+     */
+    GLuint instanceCount() const { return allocation_.instanceCount; }
+    /**
+     * Returns a process-unique id for the current contents; changes on every upload/destroy.
+     */
+    uint64_t revision() const { return revision_; }
+    /**
+     * Marks the mesh as moving/deforming so shadow caches keep it out of static layers.
+     * @param dynamic true for meshes expected to change between frames.
+     */
+    void setDynamic(bool dynamic) { dynamic_ = dynamic; }
+    /**
+     * Returns true if the mesh was marked dynamic.
      */
-    bool valid() const { return vao_ != 0 && vbo_ != 0 && ebo_ != 0 && indexCount_ > 0; }
+    bool dynamic() const { return dynamic_; }
 
 private:
     /**
-     * Deletes GL buffers and resets internal state.
+     * Releases the pool ranges and resets internal state.
      */
     void destroy();
 
-    GLuint vao_{0};
-    GLuint vbo_{0};
-    GLuint ebo_{0};
-    GLsizei indexCount_{0};
+    MeshPool* pool_{nullptr};
+    MeshPool::Allocation allocation_{};
+    Aabb bounds_{};
+    uint64_t revision_{0};
+    bool dynamic_{false};
 };
 
 }  // namespace render
@@ -0,0 +1,549 @@
+#include "MeshPool.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#include <glm/vec4.hpp>
+#include <spdlog/spdlog.h>
+
+namespace {
+
+constexpr GLsizeiptr kInitialIndirectBytes = 4096;
+constexpr GLuint kInitialSlots = 64;
+/**
+ * Scale and offset per mesh.
+ */
+constexpr GLsizei kDequantStride = static_cast<GLsizei>(2 * sizeof(glm::vec4));
+constexpr GLsizei kInstanceStride = static_cast<GLsizei>(sizeof(render::MeshPool::Instance));
+// The color follows the transform rows both in the record and in the attribute locations.
+static_assert(sizeof(render::MeshPool::Instance) == 4 * sizeof(glm::vec4));
+static_assert(render::VertexLayout::kInstanceColorLocation == render::VertexLayout::kInstanceTransformLocation + 3);
+/**
+ * Divisor larger than any instance count, so every instance of a draw reads its base-instance slot.
+ */
+constexpr GLuint kDequantDivisor = 1u << 30;
+
+/**
+ * Replaces buffer with a larger one holding the first copyBytes of the old contents.
+ */
+void resizeBuffer(GLuint& buffer, GLsizeiptr copyBytes, GLsizeiptr newBytes) {
+    GLuint resized = 0;
+    glGenBuffers(1, &resized);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, resized);
+    glBufferData(GL_COPY_WRITE_BUFFER, newBytes, nullptr, GL_STATIC_DRAW);
+    if (buffer != 0) {
+        if (copyBytes > 0) {
+            glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, copyBytes);
+            glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        }
+        glDeleteBuffers(1, &buffer);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    buffer = resized;
+}
+
+/**
+ * Uploads bytes at offset; goes through the copy target so no VAO element binding is touched.
+ */
+void writeBuffer(GLuint buffer, GLintptr offset, GLsizeiptr size, const void* data) {
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, offset, size, data);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+}  // namespace
+
+namespace render {
+
+MeshPool::~MeshPool() {
+    destroy();
+}
+
+bool MeshPool::init(const GlFunctions& gl, const VertexLayout& layout, GLuint vertexCapacity, GLuint indexCapacity) {
+    if (vao_ != 0) {
+        return true;
+    }
+    layout_ = layout;
+    multiDrawElementsIndirect_ = gl.multiDrawElementsIndirect;
+    drawElementsBaseInstance_ = gl.drawElementsInstancedBaseVertexBaseInstance;
+    if (multiDrawElementsIndirect_ && !indirectStream_.init(GL_DRAW_INDIRECT_BUFFER, kInitialIndirectBytes, gl)) {
+        spdlog::warn("MeshPool: indirect stream unavailable, using per-mesh base-vertex draws");
+        multiDrawElementsIndirect_ = nullptr;
+    }
+    glGenVertexArrays(1, &vao_);
+    glGenVertexArrays(1, &positionVao_);
+    if (vao_ == 0 || positionVao_ == 0) {
+        spdlog::error("MeshPool: failed to create vertex arrays");
+        destroy();
+        return false;
+    }
+    growVertices(std::max(vertexCapacity, 1u));
+    growIndices(std::max(indexCapacity, 1u));
+    growSlots(kInitialSlots);
+    configureVertexArrays();
+    return true;
+}
+
+void MeshPool::destroy() {
+    indirectStream_.destroy();
+    for (GLuint& buffer : vertexBuffers_) {
+        if (buffer != 0) {
+            glDeleteBuffers(1, &buffer);
+            buffer = 0;
+        }
+    }
+    if (ebo_ != 0) {
+        glDeleteBuffers(1, &ebo_);
+        ebo_ = 0;
+    }
+    if (dequantBuffer_ != 0) {
+        glDeleteBuffers(1, &dequantBuffer_);
+        dequantBuffer_ = 0;
+    }
+    if (instanceBuffer_ != 0) {
+        glDeleteBuffers(1, &instanceBuffer_);
+        instanceBuffer_ = 0;
+    }
+    if (positionVao_ != 0) {
+        glDeleteVertexArrays(1, &positionVao_);
+        positionVao_ = 0;
+    }
+    if (vao_ != 0) {
+        glDeleteVertexArrays(1, &vao_);
+        vao_ = 0;
+    }
+    vertexCapacity_ = 0;
+    indexCapacity_ = 0;
+    slotCapacity_ = 0;
+    vertexUsed_ = 0;
+    indexUsed_ = 0;
+    freeVertices_.clear();
+    freeIndices_.clear();
+    freeSlots_.clear();
+    pending_.clear();
+    multiDrawElementsIndirect_ = nullptr;
+    drawElementsBaseInstance_ = nullptr;
+    indirectFrameBytes_ = 0;
+    indirectPeakBytes_ = 0;
+    frameOpen_ = false;
+}
+
+bool MeshPool::allocate(
+    const std::vector<float>& vertices,
+    const std::vector<unsigned int>& indices,
+    const Aabb& bounds,
+    Allocation& outAllocation
+) {
+    outAllocation = Allocation{};
+    if (vertices.empty() || indices.empty() || vertices.size() % 9 != 0) {
+        spdlog::error("MeshPool: empty or malformed vertex/index data");
+        return false;
+    }
+    const GLuint vertexCount = static_cast<GLuint>(vertices.size() / 9);
+
+    // Encode into staging copies of both streams, then upload each stream's range once.
+    glm::vec4 dequant[2];
+    layout_.dequantization(bounds, dequant[0], dequant[1]);
+    std::array<std::vector<uint8_t>, VertexLayout::kStreamCount> encoded;
+    for (int stream = 0; stream < VertexLayout::kStreamCount; ++stream) {
+        encoded[static_cast<size_t>(stream)].resize(static_cast<size_t>(vertexCount) * layout_.strides[static_cast<size_t>(stream)]);
+    }
+    const size_t positionStride = static_cast<size_t>(layout_.strides[VertexLayout::kPositionStream]);
+    const size_t surfaceStride = static_cast<size_t>(layout_.strides[VertexLayout::kSurfaceStream]);
+    for (GLuint v = 0; v < vertexCount; ++v) {
+        layout_.encode(
+            vertices.data() + static_cast<size_t>(v) * 9,
+            dequant[0],
+            dequant[1],
+            encoded[VertexLayout::kPositionStream].data() + v * positionStride,
+            encoded[VertexLayout::kSurfaceStream].data() + v * surfaceStride
+        );
+    }
+
+    EncodedMesh mesh{};
+    mesh.positions = encoded[VertexLayout::kPositionStream].data();
+    mesh.surface = encoded[VertexLayout::kSurfaceStream].data();
+    mesh.indices = indices.data();
+    mesh.vertexCount = vertexCount;
+    mesh.indexCount = static_cast<GLuint>(indices.size());
+    return allocate(mesh, bounds, outAllocation);
+}
+
+bool MeshPool::allocate(const EncodedMesh& mesh, const Aabb& bounds, Allocation& outAllocation) {
+    outAllocation = Allocation{};
+    if (vao_ == 0) {
+        spdlog::error("MeshPool: allocate before init");
+        return false;
+    }
+    if (mesh.vertexCount == 0 || mesh.indexCount == 0 || !mesh.positions || !mesh.surface || !mesh.indices ||
+        (mesh.instances && mesh.instanceCount == 0)) {
+        spdlog::error("MeshPool: empty or malformed vertex/index data");
+        return false;
+    }
+    const GLuint vertexCount = mesh.vertexCount;
+    const GLuint indexCount = mesh.indexCount;
+    const GLuint instanceCount = mesh.instances ? mesh.instanceCount : 1;
+
+    GLuint vertexOffset = 0;
+    GLuint indexOffset = 0;
+    bool resized = false;
+    if (!takeRange(freeVertices_, vertexCount, vertexOffset)) {
+        growVertices(std::max(vertexCapacity_ * 2, vertexCapacity_ + vertexCount));
+        takeRange(freeVertices_, vertexCount, vertexOffset);
+        resized = true;
+    }
+    if (!takeRange(freeIndices_, indexCount, indexOffset)) {
+        growIndices(std::max(indexCapacity_ * 2, indexCapacity_ + indexCount));
+        takeRange(freeIndices_, indexCount, indexOffset);
+        resized = true;
+    }
+    GLuint slot = 0;
+    if (!takeRange(freeSlots_, instanceCount, slot)) {
+        growSlots(std::max(slotCapacity_ * 2, slotCapacity_ + instanceCount));
+        takeRange(freeSlots_, instanceCount, slot);
+        resized = true;
+    }
+    if (resized) {
+        configureVertexArrays();
+    }
+
+    glm::vec4 dequant[2];
+    layout_.dequantization(bounds, dequant[0], dequant[1]);
+    writeBuffer(dequantBuffer_, static_cast<GLintptr>(slot) * kDequantStride, kDequantStride, dequant);
+    const Instance identity{};
+    writeBuffer(
+        instanceBuffer_,
+        static_cast<GLintptr>(slot) * kInstanceStride,
+        static_cast<GLsizeiptr>(instanceCount) * kInstanceStride,
+        mesh.instances ? mesh.instances : &identity
+    );
+
+    const std::array<const void*, VertexLayout::kStreamCount> streams{mesh.positions, mesh.surface};
+    for (int stream = 0; stream < VertexLayout::kStreamCount; ++stream) {
+        const GLsizei stride = layout_.strides[static_cast<size_t>(stream)];
+        writeBuffer(
+            vertexBuffers_[static_cast<size_t>(stream)],
+            static_cast<GLintptr>(vertexOffset) * stride,
+            static_cast<GLsizeiptr>(vertexCount) * stride,
+            streams[static_cast<size_t>(stream)]
+        );
+    }
+    writeBuffer(
+        ebo_,
+        static_cast<GLintptr>(indexOffset * sizeof(GLuint)),
+        static_cast<GLsizeiptr>(indexCount * sizeof(GLuint)),
+        mesh.indices
+    );
+
+    outAllocation.baseVertex = static_cast<GLint>(vertexOffset);
+    outAllocation.vertexCount = vertexCount;
+    outAllocation.firstIndex = indexOffset;
+    outAllocation.indexCount = indexCount;
+    outAllocation.slot = slot;
+    outAllocation.instanceCount = instanceCount;
+    vertexUsed_ += vertexCount;
+    indexUsed_ += indexCount;
+    return true;
+}
+
+void MeshPool::release(const Allocation& allocation) {
+    // Meshes may outlive the pool's GL objects during shutdown; nothing left to return to.
+    if (vao_ == 0 || allocation.indexCount == 0) {
+        return;
+    }
+    returnRange(freeVertices_, static_cast<GLuint>(allocation.baseVertex), allocation.vertexCount);
+    returnRange(freeIndices_, allocation.firstIndex, allocation.indexCount);
+    returnRange(freeSlots_, allocation.slot, allocation.instanceCount);
+    vertexUsed_ -= allocation.vertexCount;
+    indexUsed_ -= allocation.indexCount;
+}
+
+void MeshPool::beginFrame() {
+    if (frameOpen_) {
+        endFrame();
+    }
+    frameStats_ = Stats{};
+    indirectFrameBytes_ = 0;
+    if (multiDrawElementsIndirect_) {
+        // Size the region for the busiest frame so far; overflowing batches fall back to base-vertex draws.
+        indirectStream_.beginFrame(indirectPeakBytes_);
+    }
+    frameOpen_ = true;
+}
+
+void MeshPool::endFrame() {
+    if (!frameOpen_) {
+        return;
+    }
+    if (multiDrawElementsIndirect_) {
+        indirectStream_.endFrame();
+    }
+    indirectPeakBytes_ = std::max(indirectPeakBytes_, indirectFrameBytes_);
+    frameStats_.vertexCapacity = vertexCapacity_;
+    frameStats_.vertexUsed = vertexUsed_;
+    frameStats_.indexCapacity = indexCapacity_;
+    frameStats_.indexUsed = indexUsed_;
+    frameStats_.vertexSize = layout_.vertexSize();
+    stats_ = frameStats_;
+    frameOpen_ = false;
+}
+
+void MeshPool::queue(const Allocation& allocation, GLuint instanceCount) {
+    if (allocation.indexCount == 0 || instanceCount == 0) {
+        return;
+    }
+    pending_.push_back(command(allocation, instanceCount));
+    frameStats_.instances += static_cast<int>(instanceCount);
+}
+
+void MeshPool::drawIndirect(GLuint buffer, GLintptr offset, GLsizei drawCount, Streams streams) {
+    if (vao_ == 0 || !multiDrawElementsIndirect_ || drawCount <= 0) {
+        return;
+    }
+    glBindVertexArray(streams == Streams::PositionOnly ? positionVao_ : vao_);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, buffer);
+    multiDrawElementsIndirect_(GL_TRIANGLES, GL_UNSIGNED_INT, reinterpret_cast<const void*>(offset), drawCount, 0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    glBindVertexArray(0);
+    frameStats_.batches++;
+    frameStats_.commands += drawCount;
+    frameStats_.drawCalls++;
+}
+
+int MeshPool::flush(Streams streams) {
+    if (pending_.empty()) {
+        return 0;
+    }
+    if (vao_ == 0) {
+        pending_.clear();
+        return 0;
+    }
+    glBindVertexArray(streams == Streams::PositionOnly ? positionVao_ : vao_);
+    int drawCalls = 0;
+    GLintptr indirectOffset = 0;
+    if (pending_.size() > 1 && writeIndirect(indirectOffset)) {
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectStream_.id());
+        multiDrawElementsIndirect_(
+            GL_TRIANGLES,
+            GL_UNSIGNED_INT,
+            reinterpret_cast<const void*>(indirectOffset),
+            static_cast<GLsizei>(pending_.size()),
+            0
+        );
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        drawCalls = 1;
+    } else {
+        for (const DrawCommand& command : pending_) {
+            void* firstIndex = reinterpret_cast<void*>(static_cast<uintptr_t>(command.firstIndex) * sizeof(GLuint));
+            if (drawElementsBaseInstance_) {
+                drawElementsBaseInstance_(
+                    GL_TRIANGLES,
+                    static_cast<GLsizei>(command.count),
+                    GL_UNSIGNED_INT,
+                    firstIndex,
+                    static_cast<GLsizei>(command.instanceCount),
+                    command.baseVertex,
+                    command.baseInstance
+                );
+            } else {
+                bindSlotAttributes(command.baseInstance);
+                glDrawElementsInstancedBaseVertex(
+                    GL_TRIANGLES,
+                    static_cast<GLsizei>(command.count),
+                    GL_UNSIGNED_INT,
+                    firstIndex,
+                    static_cast<GLsizei>(command.instanceCount),
+                    command.baseVertex
+                );
+            }
+            drawCalls++;
+        }
+    }
+    glBindVertexArray(0);
+    frameStats_.batches++;
+    frameStats_.commands += static_cast<int>(pending_.size());
+    frameStats_.drawCalls += drawCalls;
+    pending_.clear();
+    return drawCalls;
+}
+
+bool MeshPool::writeIndirect(GLintptr& outOffset) {
+    if (!multiDrawElementsIndirect_ || !frameOpen_) {
+        return false;
+    }
+    const GLsizeiptr bytes = static_cast<GLsizeiptr>(pending_.size() * sizeof(DrawCommand));
+    indirectFrameBytes_ += bytes + indirectStream_.alignment();
+    if (!indirectStream_.fits(bytes)) {
+        return false;
+    }
+    void* mapped = indirectStream_.map(bytes, outOffset);
+    if (!mapped) {
+        return false;
+    }
+    std::memcpy(mapped, pending_.data(), static_cast<size_t>(bytes));
+    indirectStream_.unmap();
+    return true;
+}
+
+void MeshPool::growVertices(GLuint vertexCapacity) {
+    for (int stream = 0; stream < VertexLayout::kStreamCount; ++stream) {
+        const GLsizeiptr stride = layout_.strides[static_cast<size_t>(stream)];
+        resizeBuffer(
+            vertexBuffers_[static_cast<size_t>(stream)],
+            static_cast<GLsizeiptr>(vertexCapacity_) * stride,
+            static_cast<GLsizeiptr>(vertexCapacity) * stride
+        );
+    }
+    returnRange(freeVertices_, vertexCapacity_, vertexCapacity - vertexCapacity_);
+    vertexCapacity_ = vertexCapacity;
+}
+
+void MeshPool::growIndices(GLuint indexCapacity) {
+    resizeBuffer(
+        ebo_,
+        static_cast<GLsizeiptr>(indexCapacity_ * sizeof(GLuint)),
+        static_cast<GLsizeiptr>(indexCapacity * sizeof(GLuint))
+    );
+    returnRange(freeIndices_, indexCapacity_, indexCapacity - indexCapacity_);
+    indexCapacity_ = indexCapacity;
+}
+
+void MeshPool::growSlots(GLuint slotCapacity) {
+    resizeBuffer(
+        dequantBuffer_,
+        static_cast<GLsizeiptr>(slotCapacity_) * kDequantStride,
+        static_cast<GLsizeiptr>(slotCapacity) * kDequantStride
+    );
+    resizeBuffer(
+        instanceBuffer_,
+        static_cast<GLsizeiptr>(slotCapacity_) * kInstanceStride,
+        static_cast<GLsizeiptr>(slotCapacity) * kInstanceStride
+    );
+    returnRange(freeSlots_, slotCapacity_, slotCapacity - slotCapacity_);
+    slotCapacity_ = slotCapacity;
+}
+
+void MeshPool::configureVertexArrays() {
+    for (GLuint vertexArray : {vao_, positionVao_}) {
+        const bool positionOnly = vertexArray == positionVao_;
+        glBindVertexArray(vertexArray);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo_);
+        for (const VertexAttribute& attribute : layout_.attributes) {
+            if (positionOnly && attribute.stream != VertexLayout::kPositionStream) {
+                continue;
+            }
+            glBindBuffer(GL_ARRAY_BUFFER, vertexBuffers_[static_cast<size_t>(attribute.stream)]);
+            glEnableVertexAttribArray(attribute.location);
+            glVertexAttribPointer(
+                attribute.location,
+                attribute.components,
+                attribute.type,
+                attribute.normalized,
+                layout_.strides[static_cast<size_t>(attribute.stream)],
+                reinterpret_cast<void*>(static_cast<uintptr_t>(attribute.offset))
+            );
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, dequantBuffer_);
+        for (GLuint location : {VertexLayout::kPositionScaleLocation, VertexLayout::kPositionOffsetLocation}) {
+            const GLuint offset = location == VertexLayout::kPositionScaleLocation ? 0u : static_cast<GLuint>(sizeof(glm::vec4));
+            glEnableVertexAttribArray(location);
+            glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, kDequantStride, reinterpret_cast<void*>(static_cast<uintptr_t>(offset)));
+            glVertexAttribDivisor(location, kDequantDivisor);
+        }
+        // Depth-only shaders place instances but never read their color.
+        glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer_);
+        const GLuint instanceLocations = positionOnly ? 3u : 4u;
+        for (GLuint row = 0; row < instanceLocations; ++row) {
+            const GLuint location = VertexLayout::kInstanceTransformLocation + row;
+            glEnableVertexAttribArray(location);
+            glVertexAttribPointer(
+                location,
+                4,
+                GL_FLOAT,
+                GL_FALSE,
+                kInstanceStride,
+                reinterpret_cast<void*>(static_cast<uintptr_t>(row * sizeof(glm::vec4)))
+            );
+            glVertexAttribDivisor(location, 1);
+        }
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void MeshPool::bindSlotAttributes(GLuint slot) const {
+    const uintptr_t base = static_cast<uintptr_t>(slot) * kDequantStride;
+    glBindBuffer(GL_ARRAY_BUFFER, dequantBuffer_);
+    glVertexAttribPointer(
+        VertexLayout::kPositionScaleLocation,
+        4,
+        GL_FLOAT,
+        GL_FALSE,
+        kDequantStride,
+        reinterpret_cast<void*>(base)
+    );
+    glVertexAttribPointer(
+        VertexLayout::kPositionOffsetLocation,
+        4,
+        GL_FLOAT,
+        GL_FALSE,
+        kDequantStride,
+        reinterpret_cast<void*>(base + sizeof(glm::vec4))
+    );
+    const uintptr_t instanceBase = static_cast<uintptr_t>(slot) * kInstanceStride;
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer_);
+    for (GLuint row = 0; row < 4; ++row) {
+        glVertexAttribPointer(
+            VertexLayout::kInstanceTransformLocation + row,
+            4,
+            GL_FLOAT,
+            GL_FALSE,
+            kInstanceStride,
+            reinterpret_cast<void*>(instanceBase + row * sizeof(glm::vec4))
+        );
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+bool MeshPool::takeRange(std::vector<FreeRange>& ranges, GLuint size, GLuint& outOffset) {
+    for (auto it = ranges.begin(); it != ranges.end(); ++it) {
+        if (it->size < size) {
+            continue;
+        }
+        outOffset = it->offset;
+        it->offset += size;
+        it->size -= size;
+        if (it->size == 0) {
+            ranges.erase(it);
+        }
+        return true;
+    }
+    return false;
+}
+
+void MeshPool::returnRange(std::vector<FreeRange>& ranges, GLuint offset, GLuint size) {
+    if (size == 0) {
+        return;
+    }
+    auto it = std::lower_bound(ranges.begin(), ranges.end(), offset, [](const FreeRange& range, GLuint value) {
+        return range.offset < value;
+    });
+    it = ranges.insert(it, FreeRange{offset, size});
+    // Merge with the following span, then with the preceding one.
+    const auto next = it + 1;
+    if (next != ranges.end() && it->offset + it->size == next->offset) {
+        it->size += next->size;
+        ranges.erase(next);
+    }
+    if (it != ranges.begin()) {
+        const auto previous = it - 1;
+        if (previous->offset + previous->size == it->offset) {
+            previous->size += it->size;
+            ranges.erase(it);
+        }
+    }
+}
+
+}  // namespace render
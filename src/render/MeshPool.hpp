@@ -0,0 +1,338 @@
+#ifndef GL_GLEXT_PROTOTYPES
+#define GL_GLEXT_PROTOTYPES
+#endif
+#pragma once
+
+#include <SDL_opengl.h>
+
+#include <array>
+#include <vector>
+
+#include <glm/vec4.hpp>
+
+#include "GlFunctions.hpp"
+#include "StreamingBuffer.hpp"
+#include "VertexLayout.hpp"
+
+namespace render {
+
+/**
+ * Shared vertex/index storage for many meshes behind a single VAO.
+ * Meshes are sub-allocated from one set of vertex streams and one index buffer through first-fit
+ * free lists; the buffers grow by copying when a mesh does not fit. Each mesh also owns a run of
+ * slots, one per stored instance: the first holds its dequantization entry, and every slot holds
+ * one Instance record. Both are fetched as instanced attributes through the draw's base instance,
+ * so instance i of a draw reads record slot + i.
+ * Queued draws are submitted as a single glMultiDrawElementsIndirect on GL 4.3, or as
+ * glDrawElements*BaseVertex calls otherwise.
+ */
+class MeshPool {
+public:
+    /**
+     * Location of one mesh inside the pool buffers.
+     */
+    struct Allocation {
+        GLint baseVertex{0};
+        GLuint vertexCount{0};
+        GLuint firstIndex{0};
+        GLuint indexCount{0};
+        /**
+         * First slot (dequantization entry and first instance record), passed to shaders as the
+         * base instance.
+         */
+        GLuint slot{0};
+        /**
+         * Instance records stored from slot onward.
+         */
+        GLuint instanceCount{1};
+    };
+
+    /**
+     * One instance record. Shaders transform mesh positions by the rows and multiply the vertex
+     * colors by the color; normals use the 3x3 part, so the transform must be rigid or uniformly
+     * scaled.
+     */
+    struct Instance {
+        /**
+         * Rows of the 3x4 model-to-world matrix.
+         */
+        glm::vec4 transform[3]{{1.0f, 0.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 1.0f, 0.0f}};
+        glm::vec4 color{1.0f};
+    };
+
+    /**
+     * Mesh data already encoded in the pool's vertex layout (e.g. read from a mapped scene file).
+     */
+    struct EncodedMesh {
+        /**
+         * vertexCount * layout().strides[kPositionStream] bytes.
+         */
+        const void* positions{nullptr};
+        /**
+         * vertexCount * layout().strides[kSurfaceStream] bytes.
+         */
+        const void* surface{nullptr};
+        /**
+         * Triangle indices relative to the mesh's first vertex.
+         */
+        const GLuint* indices{nullptr};
+        /**
+         * instanceCount Instance records; nullptr stores one identity instance.
+         */
+        const void* instances{nullptr};
+        GLuint vertexCount{0};
+        GLuint indexCount{0};
+        GLuint instanceCount{0};
+    };
+
+    /**
+     * Layout of one glMultiDrawElementsIndirect command.
+     */
+    struct DrawCommand {
+        GLuint count{0};
+        GLuint instanceCount{0};
+        GLuint firstIndex{0};
+        GLint baseVertex{0};
+        GLuint baseInstance{0};
+    };
+
+    /**
+     * Vertex streams a flush binds.
+     */
+    enum class Streams {
+        /**
+         * Positions, normals and colors.
+         */
+        All,
+        /**
+         * Positions only, for depth-only passes.
+         */
+        PositionOnly,
+    };
+
+    /**
+     * Submission counters for the last completed frame.
+     */
+    struct Stats {
+        /**
+         * Number of flush calls that drew something.
+         */
+        int batches{0};
+        /**
+         * Number of mesh draws queued across all batches.
+         */
+        int commands{0};
+        /**
+         * Number of GL draw calls issued for them.
+         */
+        int drawCalls{0};
+        /**
+         * Number of instances the queued draws render.
+         */
+        int instances{0};
+        GLuint vertexCapacity{0};
+        GLuint vertexUsed{0};
+        GLuint indexCapacity{0};
+        GLuint indexUsed{0};
+        /**
+         * Bytes per vertex across all streams.
+         */
+        GLsizei vertexSize{0};
+    };
+
+    /**
+     * Creates an empty pool without allocating GL objects.
+     */
+    MeshPool() = default;
+    /**
+     * Releases the buffers and VAO if created.
+     */
+    ~MeshPool();
+
+    /**
+     * Non-copyable to avoid double-deleting GL buffers.
+     */
+    MeshPool(const MeshPool&) = delete;
+    /**
+     * Non-copyable assignment to avoid double-deleting GL buffers.
+     */
+    MeshPool& operator=(const MeshPool&) = delete;
+
+    /**
+     * Creates the shared buffers and VAOs.
+     * @param gl Runtime-resolved GL entry points (multi-draw indirect is optional).
+     * @param layout Vertex storage layout for every mesh in the pool.
+     * @param vertexCapacity Initial vertex capacity.
+     * @param indexCapacity Initial index capacity.
+     * @return true if the buffers were created.
+     */
+    bool init(const GlFunctions& gl, const VertexLayout& layout, GLuint vertexCapacity, GLuint indexCapacity);
+    /**
+     * Releases the buffers, VAO and indirect stream; outstanding allocations become invalid.
+     */
+    void destroy();
+
+    /**
+     * Encodes a mesh with one identity instance into the pool layout, growing the buffers if needed.
+     * Expects 9 floats per vertex: position (3), normal (3), color (3).
+     * @param vertices Interleaved vertex data.
+     * @param indices Triangle indices relative to the mesh's first vertex.
+     * @param bounds Position bounds, used to quantize compact positions.
+     * @param outAllocation Receives the mesh location.
+     * @return true on success.
+     */
+    bool allocate(
+        const std::vector<float>& vertices,
+        const std::vector<unsigned int>& indices,
+        const Aabb& bounds,
+        Allocation& outAllocation
+    );
+    /**
+     * Uploads a mesh that is already in the pool layout straight from its source bytes.
+     * @param mesh Encoded streams, indices and instance records.
+     * @param bounds Position bounds the streams were quantized against (before instance transforms).
+     * @param outAllocation Receives the mesh location.
+     * @return true on success.
+     */
+    bool allocate(const EncodedMesh& mesh, const Aabb& bounds, Allocation& outAllocation);
+    /**
+     * Returns a mesh's ranges to the free lists.
+     */
+    void release(const Allocation& allocation);
+
+    /**
+     * Opens the per-frame region of the indirect command stream.
+     */
+    void beginFrame();
+    /**
+     * Fences the indirect command region and publishes the frame's stats.
+     */
+    void endFrame();
+
+    /**
+     * Adds a draw of every stored instance to the pending batch.
+     * @param allocation Mesh to draw.
+     */
+    void queue(const Allocation& allocation) { queue(allocation, allocation.instanceCount); }
+    /**
+     * Adds a draw to the pending batch. Instance records past allocation.instanceCount are
+     * undefined, so larger counts are for shaders that index their own data by gl_InstanceID.
+     * @param allocation Mesh to draw.
+     * @param instanceCount Number of instances.
+     */
+    void queue(const Allocation& allocation, GLuint instanceCount);
+    /**
+     * Draws every pending draw with the pool VAO bound and clears the batch.
+     * @param streams Vertex streams the bound shader reads.
+     * @return Number of GL draw calls issued.
+     */
+    int flush(Streams streams = Streams::All);
+    /**
+     * Draws commands that live in a GPU-written buffer (requires multiDrawIndirect()).
+     * @param buffer Buffer holding DrawCommand records.
+     * @param offset Byte offset of the first command.
+     * @param drawCount Number of commands.
+     * @param streams Vertex streams the bound shader reads.
+     */
+    void drawIndirect(GLuint buffer, GLintptr offset, GLsizei drawCount, Streams streams = Streams::All);
+    /**
+     * Returns the indirect command that draws every instance of an allocation.
+     */
+    static DrawCommand command(const Allocation& allocation) { return command(allocation, allocation.instanceCount); }
+    /**
+     * Returns the indirect command that draws an allocation instanceCount times.
+     */
+    static DrawCommand command(const Allocation& allocation, GLuint instanceCount) {
+        return DrawCommand{allocation.indexCount, instanceCount, allocation.firstIndex, allocation.baseVertex, allocation.slot};
+    }
+
+    /**
+     * Returns the shared VAO, or 0 if not created.
+     */
+    GLuint vao() const { return vao_; }
+    /**
+     * Returns the vertex storage layout.
+     */
+    const VertexLayout& layout() const { return layout_; }
+    /**
+     * Returns true when batches are submitted with glMultiDrawElementsIndirect.
+     */
+    bool multiDrawIndirect() const { return multiDrawElementsIndirect_ != nullptr; }
+    /**
+     * Returns the submission counters of the last completed frame.
+     */
+    const Stats& stats() const { return stats_; }
+
+private:
+    /**
+     * Free span of vertices or indices, kept sorted by offset.
+     */
+    struct FreeRange {
+        GLuint offset{0};
+        GLuint size{0};
+    };
+
+    /**
+     * Reallocates the vertex streams for vertexCapacity vertices, preserving their contents.
+     */
+    void growVertices(GLuint vertexCapacity);
+    /**
+     * Reallocates the index buffer for indexCapacity indices, preserving its contents.
+     */
+    void growIndices(GLuint indexCapacity);
+    /**
+     * Reallocates the dequantization and instance buffers for slotCapacity slots, preserving their
+     * contents.
+     */
+    void growSlots(GLuint slotCapacity);
+    /**
+     * Points both VAOs' attributes and element buffer at the current buffers.
+     */
+    void configureVertexArrays();
+    /**
+     * Re-points the dequantization and instance attributes at one slot (GL 4.1 fallback without
+     * base instance).
+     */
+    void bindSlotAttributes(GLuint slot) const;
+    /**
+     * Writes the pending draws into the indirect stream.
+     * @param outOffset Receives the byte offset of the commands.
+     * @return true if the commands were written.
+     */
+    bool writeIndirect(GLintptr& outOffset);
+    /**
+     * Takes a first-fit span from a free list.
+     */
+    static bool takeRange(std::vector<FreeRange>& ranges, GLuint size, GLuint& outOffset);
+    /**
+     * Returns a span to a free list, merging it with its neighbours.
+     */
+    static void returnRange(std::vector<FreeRange>& ranges, GLuint offset, GLuint size);
+
+    VertexLayout layout_{};
+    GLuint vao_{0};
+    GLuint positionVao_{0};
+    std::array<GLuint, VertexLayout::kStreamCount> vertexBuffers_{};
+    GLuint ebo_{0};
+    GLuint dequantBuffer_{0};
+    GLuint instanceBuffer_{0};
+    GLuint vertexCapacity_{0};
+    GLuint indexCapacity_{0};
+    GLuint slotCapacity_{0};
+    std::vector<FreeRange> freeSlots_;
+    GLuint vertexUsed_{0};
+    GLuint indexUsed_{0};
+    std::vector<FreeRange> freeVertices_;
+    std::vector<FreeRange> freeIndices_;
+    PFNGLMULTIDRAWELEMENTSINDIRECTPROC multiDrawElementsIndirect_{nullptr};
+    PFNGLDRAWELEMENTSINSTANCEDBASEVERTEXBASEINSTANCEPROC drawElementsBaseInstance_{nullptr};
+    StreamingBuffer indirectStream_;
+    GLsizeiptr indirectFrameBytes_{0};
+    GLsizeiptr indirectPeakBytes_{0};
+    bool frameOpen_{false};
+    std::vector<DrawCommand> pending_;
+    Stats frameStats_{};
+    Stats stats_{};
+};
+
+}  // namespace render
@@ -0,0 +1,303 @@
+#include "OcclusionCuller.hpp"
+
+#include <algorithm>
+#include <array>
+
+#include <glm/gtc/type_ptr.hpp>
+#include <spdlog/spdlog.h>
+
+namespace {
+
+constexpr GLuint kBuildGroupSize = 8;
+constexpr GLuint kCullGroupSize = 64;
+constexpr GLuint kCandidateBinding = 0;
+constexpr GLuint kCommandBinding = 1;
+constexpr GLuint kCounterBinding = 2;
+constexpr GLuint kVisibleLightBinding = 3;
+
+GLuint groupsFor(int count, GLuint groupSize) {
+    return (static_cast<GLuint>(std::max(count, 0)) + groupSize - 1) / groupSize;
+}
+
+}  // namespace
+
+namespace render {
+
+OcclusionCuller::~OcclusionCuller() {
+    destroy();
+}
+
+bool OcclusionCuller::init(const GlFunctions& gl, const std::string& shaderRoot) {
+    if (ready_) {
+        return true;
+    }
+    gl_ = gl;
+    if (!gl_.hasCompute() || !gl_.multiDrawElementsIndirect) {
+        return false;
+    }
+    if (!buildShader_.buildComputeFromFile(shaderRoot + "hiz_build.comp") ||
+        !meshCullShader_.buildComputeFromFile(shaderRoot + "occlusion_cull_meshes.comp") ||
+        !lightCullShader_.buildComputeFromFile(shaderRoot + "occlusion_cull_lights.comp")) {
+        spdlog::warn("OcclusionCuller: failed to build culling shaders");
+        destroy();
+        return false;
+    }
+
+    queryUniformLocations();
+
+    glGenBuffers(1, &counter_);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, counter_);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint), nullptr, GL_DYNAMIC_DRAW);
+    glGenBuffers(1, &lightCommands_);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, lightCommands_);
+    glBufferData(
+        GL_SHADER_STORAGE_BUFFER,
+        static_cast<GLsizeiptr>(kMaxLightGroups * sizeof(MeshPool::DrawCommand)),
+        nullptr,
+        GL_DYNAMIC_DRAW
+    );
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    glGenTextures(1, &visibleLightTexture_);
+    ready_ = true;
+    return true;
+}
+
+bool OcclusionCuller::reloadChanged() {
+    if (!ready_) {
+        return false;
+    }
+    ShaderProgram* const programs[] = {&buildShader_, &meshCullShader_, &lightCullShader_};
+    bool reloaded = false;
+    for (ShaderProgram* program : programs) {
+        if (program->sourcesChanged()) {
+            reloaded = program->reload() || reloaded;
+        }
+    }
+    if (reloaded) {
+        queryUniformLocations();
+    }
+    return reloaded;
+}
+
+void OcclusionCuller::queryUniformLocations() {
+    buildSourceLocation_ = buildShader_.uniformLocation("uSource");
+    buildSourceLevelLocation_ = buildShader_.uniformLocation("uSourceLevel");
+    buildSourceSizeLocation_ = buildShader_.uniformLocation("uSourceSize");
+    buildDestSizeLocation_ = buildShader_.uniformLocation("uDestSize");
+    meshViewProjLocation_ = meshCullShader_.uniformLocation("uViewProj");
+    meshCandidateCountLocation_ = meshCullShader_.uniformLocation("uCandidateCount");
+    meshHiZLocation_ = meshCullShader_.uniformLocation("uHiZ");
+    meshDepthSizeLocation_ = meshCullShader_.uniformLocation("uDepthSize");
+    meshLevelsLocation_ = meshCullShader_.uniformLocation("uHiZLevels");
+    lightBufferLocation_ = lightCullShader_.uniformLocation("uLightBuffer");
+    lightTexelOffsetLocation_ = lightCullShader_.uniformLocation("uLightTexelOffset");
+    lightProjLocation_ = lightCullShader_.uniformLocation("uProj");
+    lightFirstLocation_ = lightCullShader_.uniformLocation("uFirstLight");
+    lightCountLocation_ = lightCullShader_.uniformLocation("uLightCount");
+    lightIsSpotLocation_ = lightCullShader_.uniformLocation("uIsSpot");
+    lightGroupLocation_ = lightCullShader_.uniformLocation("uGroup");
+    lightHiZLocation_ = lightCullShader_.uniformLocation("uHiZ");
+    lightDepthSizeLocation_ = lightCullShader_.uniformLocation("uDepthSize");
+    lightLevelsLocation_ = lightCullShader_.uniformLocation("uHiZLevels");
+}
+
+void OcclusionCuller::destroy() {
+    for (GLuint* buffer : {&candidates_, &meshCommands_, &counter_, &lightCommands_, &visibleLights_}) {
+        if (*buffer != 0) {
+            glDeleteBuffers(1, buffer);
+            *buffer = 0;
+        }
+    }
+    if (visibleLightTexture_ != 0) {
+        glDeleteTextures(1, &visibleLightTexture_);
+        visibleLightTexture_ = 0;
+    }
+    if (hiZ_ != 0) {
+        glDeleteTextures(1, &hiZ_);
+        hiZ_ = 0;
+    }
+    candidatesCapacity_ = 0;
+    meshCommandsCapacity_ = 0;
+    visibleLightsCapacity_ = 0;
+    depthWidth_ = 0;
+    depthHeight_ = 0;
+    pyramidWidth_ = 0;
+    pyramidHeight_ = 0;
+    levels_ = 0;
+    ready_ = false;
+}
+
+void OcclusionCuller::ensurePyramid(int width, int height) {
+    depthWidth_ = width;
+    depthHeight_ = height;
+    if (hiZ_ != 0 && width <= pyramidWidth_ && height <= pyramidHeight_) {
+        return;
+    }
+    if (hiZ_ != 0) {
+        glDeleteTextures(1, &hiZ_);
+    }
+    pyramidWidth_ = std::max(width, pyramidWidth_);
+    pyramidHeight_ = std::max(height, pyramidHeight_);
+    int levelWidth = std::max(pyramidWidth_ / 2, 1);
+    int levelHeight = std::max(pyramidHeight_ / 2, 1);
+    levels_ = 0;
+    glGenTextures(1, &hiZ_);
+    glBindTexture(GL_TEXTURE_2D, hiZ_);
+    while (true) {
+        glTexImage2D(GL_TEXTURE_2D, levels_, GL_R32F, levelWidth, levelHeight, 0, GL_RED, GL_FLOAT, nullptr);
+        levels_++;
+        if (levelWidth == 1 && levelHeight == 1) {
+            break;
+        }
+        levelWidth = std::max(levelWidth / 2, 1);
+        levelHeight = std::max(levelHeight / 2, 1);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels_ - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void OcclusionCuller::buildPyramid(GLuint depthTexture, int width, int height) {
+    if (!ready_ || depthTexture == 0 || width <= 0 || height <= 0) {
+        return;
+    }
+    ensurePyramid(width, height);
+
+    buildShader_.use();
+    glUniform1i(buildSourceLocation_, 0);
+    glActiveTexture(GL_TEXTURE0);
+    int sourceWidth = width;
+    int sourceHeight = height;
+    for (int level = 0; level < levels_; ++level) {
+        const int destWidth = std::max(sourceWidth / 2, 1);
+        const int destHeight = std::max(sourceHeight / 2, 1);
+        // Level 0 reduces the depth texture itself; later levels read the previous level.
+        glBindTexture(GL_TEXTURE_2D, level == 0 ? depthTexture : hiZ_);
+        glUniform1i(buildSourceLevelLocation_, level == 0 ? 0 : level - 1);
+        glUniform2i(buildSourceSizeLocation_, sourceWidth, sourceHeight);
+        glUniform2i(buildDestSizeLocation_, destWidth, destHeight);
+        gl_.bindImageTexture(0, hiZ_, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+        gl_.dispatchCompute(groupsFor(destWidth, kBuildGroupSize), groupsFor(destHeight, kBuildGroupSize), 1);
+        gl_.memoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+        sourceWidth = destWidth;
+        sourceHeight = destHeight;
+    }
+    gl_.bindImageTexture(0, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void OcclusionCuller::bindPyramid(GLint hiZLocation, GLint depthSizeLocation, GLint levelsLocation) const {
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, hiZ_);
+    glUniform1i(hiZLocation, 0);
+    glUniform2i(depthSizeLocation, depthWidth_, depthHeight_);
+    glUniform1i(levelsLocation, levels_);
+}
+
+void OcclusionCuller::ensureBufferSize(GLuint& buffer, GLsizeiptr& capacity, GLsizeiptr bytes) {
+    if (buffer != 0 && capacity >= bytes) {
+        return;
+    }
+    if (buffer == 0) {
+        glGenBuffers(1, &buffer);
+    }
+    capacity = std::max(bytes, capacity * 2);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, capacity, nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+GLsizei OcclusionCuller::cullMeshes(const std::vector<MeshCandidate>& candidates, const glm::mat4& viewProj) {
+    if (!ready_ || hiZ_ == 0 || candidates.empty()) {
+        return 0;
+    }
+    candidateStaging_.resize(candidates.size());
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        GpuCandidate& staged = candidateStaging_[i];
+        staged.boundsMin = glm::vec4(candidates[i].bounds.min, 1.0f);
+        staged.boundsMax = glm::vec4(candidates[i].bounds.max, 1.0f);
+        staged.command = candidates[i].command;
+    }
+    const GLsizeiptr candidateBytes = static_cast<GLsizeiptr>(candidateStaging_.size() * sizeof(GpuCandidate));
+    const GLsizeiptr commandBytes = static_cast<GLsizeiptr>(candidates.size() * sizeof(MeshPool::DrawCommand));
+    ensureBufferSize(candidates_, candidatesCapacity_, candidateBytes);
+    ensureBufferSize(meshCommands_, meshCommandsCapacity_, commandBytes);
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, candidates_);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, candidateBytes, candidateStaging_.data());
+    // Zeroed commands draw nothing, so the tail past the visible count can stay in the draw range.
+    const std::vector<MeshPool::DrawCommand> cleared(candidates.size());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, meshCommands_);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, commandBytes, cleared.data());
+    const GLuint zero = 0;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, counter_);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(GLuint), &zero);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    meshCullShader_.use();
+    bindPyramid(meshHiZLocation_, meshDepthSizeLocation_, meshLevelsLocation_);
+    glUniformMatrix4fv(meshViewProjLocation_, 1, GL_FALSE, glm::value_ptr(viewProj));
+    glUniform1i(meshCandidateCountLocation_, static_cast<GLint>(candidates.size()));
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kCandidateBinding, candidates_);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kCommandBinding, meshCommands_);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kCounterBinding, counter_);
+    gl_.dispatchCompute(groupsFor(static_cast<int>(candidates.size()), kCullGroupSize), 1, 1);
+    gl_.memoryBarrier(GL_COMMAND_BARRIER_BIT);
+    return static_cast<GLsizei>(candidates.size());
+}
+
+void OcclusionCuller::cullLights(
+    const LightGroup* groups,
+    int groupCount,
+    GLuint lightBufferTexture,
+    int lightTexelOffset,
+    const glm::mat4& projection,
+    int lightCount
+) {
+    groupCount = std::min(groupCount, kMaxLightGroups);
+    if (!ready_ || hiZ_ == 0 || groupCount <= 0 || lightCount <= 0) {
+        return;
+    }
+    ensureBufferSize(visibleLights_, visibleLightsCapacity_, static_cast<GLsizeiptr>(lightCount * sizeof(GLuint)));
+    glBindTexture(GL_TEXTURE_BUFFER, visibleLightTexture_);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_R32UI, visibleLights_);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+
+    // Instance counts start at zero; the cull pass counts each group's visible lights into them.
+    std::array<MeshPool::DrawCommand, kMaxLightGroups> commands{};
+    for (int g = 0; g < groupCount; ++g) {
+        commands[static_cast<size_t>(g)] = groups[g].command;
+        commands[static_cast<size_t>(g)].instanceCount = 0;
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, lightCommands_);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, static_cast<GLsizeiptr>(sizeof(commands)), commands.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    lightCullShader_.use();
+    bindPyramid(lightHiZLocation_, lightDepthSizeLocation_, lightLevelsLocation_);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_BUFFER, lightBufferTexture);
+    glUniform1i(lightBufferLocation_, 1);
+    glUniform1i(lightTexelOffsetLocation_, lightTexelOffset);
+    glUniformMatrix4fv(lightProjLocation_, 1, GL_FALSE, glm::value_ptr(projection));
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kCommandBinding, lightCommands_);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kVisibleLightBinding, visibleLights_);
+    for (int g = 0; g < groupCount; ++g) {
+        const LightGroup& group = groups[g];
+        if (group.count <= 0) {
+            continue;
+        }
+        glUniform1i(lightFirstLocation_, group.firstLight);
+        glUniform1i(lightCountLocation_, group.count);
+        glUniform1i(lightIsSpotLocation_, group.spot ? 1 : 0);
+        glUniform1i(lightGroupLocation_, g);
+        gl_.dispatchCompute(groupsFor(group.count, kCullGroupSize), 1, 1);
+    }
+    gl_.memoryBarrier(GL_COMMAND_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+}  // namespace render
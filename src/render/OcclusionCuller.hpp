@@ -0,0 +1,223 @@
+#ifndef GL_GLEXT_PROTOTYPES
+#define GL_GLEXT_PROTOTYPES
+#endif
+#pragma once
+
+#include <SDL_opengl.h>
+
+#include <string>
+#include <vector>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec4.hpp>
+
+#include "Frustum.hpp"
+#include "GlFunctions.hpp"
+#include "MeshPool.hpp"
+#include "ShaderProgram.hpp"
+
+namespace render {
+
+/**
+ * GPU occlusion culling against a hierarchical depth (Hi-Z) pyramid (GL 4.3 compute).
+ * The pyramid keeps the farthest depth per texel, built from a depth texture by repeated 2x2
+ * reductions. Mesh bounds are tested in a compute pass that writes a compacted indirect draw
+ * buffer; light volume groups are tested into a visible-light list plus one indirect command each.
+ */
+class OcclusionCuller {
+public:
+    /**
+     * Maximum number of light volume groups culled per frame.
+     */
+    static constexpr int kMaxLightGroups = 4;
+
+    /**
+     * One mesh draw to test against the pyramid.
+     */
+    struct MeshCandidate {
+        /**
+         * World-space bounds.
+         */
+        Aabb bounds{};
+        MeshPool::DrawCommand command{};
+    };
+
+    /**
+     * Contiguous range of lights drawn with one instanced volume mesh.
+     */
+    struct LightGroup {
+        int firstLight{0};
+        int count{0};
+        bool spot{false};
+        /**
+         * Volume mesh command; its instance count is replaced by the visible count.
+         */
+        MeshPool::DrawCommand command{};
+    };
+
+    /**
+     * Creates an uninitialized culler without allocating GL objects.
+     */
+    OcclusionCuller() = default;
+    /**
+     * Releases textures and buffers if created; programs release themselves.
+     */
+    ~OcclusionCuller();
+
+    /**
+     * Non-copyable to avoid double-deleting GL resources.
+     */
+    OcclusionCuller(const OcclusionCuller&) = delete;
+    /**
+     * Non-copyable assignment to avoid double-deleting GL resources.
+     */
+    OcclusionCuller& operator=(const OcclusionCuller&) = delete;
+
+    /**
+     * Builds the compute programs if compute and multi-draw indirect are available.
+     * @param gl Runtime-resolved GL entry points.
+     * @param shaderRoot Directory containing the shader files.
+     * @return true if the culler is usable.
+     */
+    bool init(const GlFunctions& gl, const std::string& shaderRoot);
+    /**
+     * Releases the pyramid, buffers and light list texture.
+     */
+    void destroy();
+    /**
+     * Rebuilds the compute programs whose source files changed and queries their uniforms again.
+     * @return true if any program was replaced.
+     */
+    bool reloadChanged();
+    /**
+     * Returns true once init succeeded.
+     */
+    bool ready() const { return ready_; }
+
+    /**
+     * Rebuilds the pyramid from the rendered region of a depth texture.
+     * @param depthTexture Depth texture to reduce (not bound for drawing while this runs).
+     * @param width Width of the region at the texture origin that holds this frame's depth.
+     * @param height Height of that region.
+     */
+    void buildPyramid(GLuint depthTexture, int width, int height);
+    /**
+     * Culls mesh draws against the last pyramid into meshCommandBuffer().
+     * Visible commands are packed at the front; the tail is left as zero-instance commands.
+     * @param candidates Draws to test.
+     * @param viewProj World to clip transform used to build the pyramid's depth.
+     * @return Number of commands to submit from meshCommandBuffer().
+     */
+    GLsizei cullMeshes(const std::vector<MeshCandidate>& candidates, const glm::mat4& viewProj);
+    /**
+     * Culls light volume groups against the last pyramid.
+     * Group g's command lands at lightCommandBuffer() offset g * sizeof(DrawCommand) and indexes the
+     * visible-light list from firstLight.
+     * @param groups Groups to test (at most kMaxLightGroups).
+     * @param groupCount Number of groups.
+     * @param lightBufferTexture Light buffer texture (five texels per light, view space).
+     * @param lightTexelOffset First texel of this frame's lights.
+     * @param projection View to clip transform.
+     * @param lightCount Total lights in the buffer, sizing the visible-light list.
+     */
+    void cullLights(
+        const LightGroup* groups,
+        int groupCount,
+        GLuint lightBufferTexture,
+        int lightTexelOffset,
+        const glm::mat4& projection,
+        int lightCount
+    );
+
+    /**
+     * Returns the compacted mesh command buffer.
+     */
+    GLuint meshCommandBuffer() const { return meshCommands_; }
+    /**
+     * Returns the per-group light volume command buffer.
+     */
+    GLuint lightCommandBuffer() const { return lightCommands_; }
+    /**
+     * Returns the R32UI buffer texture over the visible-light list.
+     */
+    GLuint visibleLightTexture() const { return visibleLightTexture_; }
+
+private:
+    /**
+     * std430 layout of one mesh candidate (matches occlusion_cull_meshes.comp).
+     */
+    struct GpuCandidate {
+        glm::vec4 boundsMin{0.0f};
+        glm::vec4 boundsMax{0.0f};
+        MeshPool::DrawCommand command{};
+        GLuint padding[3]{};
+    };
+
+    /**
+     * Queries the uniform locations of the compute programs (after init and every reload).
+     */
+    void queryUniformLocations();
+    /**
+     * Allocates the pyramid for a depth region, reusing the current one while the region fits,
+     * so a shrinking dynamic-resolution region never reallocates.
+     */
+    void ensurePyramid(int width, int height);
+    /**
+     * Binds the pyramid and its uniforms for a cull program.
+     */
+    void bindPyramid(GLint hiZLocation, GLint depthSizeLocation, GLint levelsLocation) const;
+    /**
+     * Grows a buffer to at least bytes, discarding its contents.
+     */
+    static void ensureBufferSize(GLuint& buffer, GLsizeiptr& capacity, GLsizeiptr bytes);
+
+    GlFunctions gl_{};
+    bool ready_{false};
+    ShaderProgram buildShader_;
+    ShaderProgram meshCullShader_;
+    ShaderProgram lightCullShader_;
+    GLint buildSourceLocation_{-1};
+    GLint buildSourceLevelLocation_{-1};
+    GLint buildSourceSizeLocation_{-1};
+    GLint buildDestSizeLocation_{-1};
+    GLint meshViewProjLocation_{-1};
+    GLint meshCandidateCountLocation_{-1};
+    GLint meshHiZLocation_{-1};
+    GLint meshDepthSizeLocation_{-1};
+    GLint meshLevelsLocation_{-1};
+    GLint lightBufferLocation_{-1};
+    GLint lightTexelOffsetLocation_{-1};
+    GLint lightProjLocation_{-1};
+    GLint lightFirstLocation_{-1};
+    GLint lightCountLocation_{-1};
+    GLint lightIsSpotLocation_{-1};
+    GLint lightGroupLocation_{-1};
+    GLint lightHiZLocation_{-1};
+    GLint lightDepthSizeLocation_{-1};
+    GLint lightLevelsLocation_{-1};
+
+    GLuint hiZ_{0};
+    /**
+     * Depth region the pyramid was last built from.
+     */
+    int depthWidth_{0};
+    int depthHeight_{0};
+    /**
+     * Depth size the pyramid texture is allocated for.
+     */
+    int pyramidWidth_{0};
+    int pyramidHeight_{0};
+    int levels_{0};
+    GLuint candidates_{0};
+    GLsizeiptr candidatesCapacity_{0};
+    GLuint meshCommands_{0};
+    GLsizeiptr meshCommandsCapacity_{0};
+    GLuint counter_{0};
+    GLuint lightCommands_{0};
+    GLuint visibleLights_{0};
+    GLsizeiptr visibleLightsCapacity_{0};
+    GLuint visibleLightTexture_{0};
+    std::vector<GpuCandidate> candidateStaging_;
+};
+
+}  // namespace render
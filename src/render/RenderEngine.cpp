@@ -3,6 +3,8 @@
 #include <algorithm>
 #include <array>
 #include <cmath>
+#include <cstring>
+#include <iterator>
 #include <utility>
 #include <vector>
 
@@ -12,6 +14,8 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <spdlog/spdlog.h>
 
+#include "SceneBuilder.hpp"
+
 namespace {
 constexpr float kIsoAngleX = 35.264f;  // atan(sqrt(1/2)) in degrees
 constexpr float kIsoAngleY = 45.0f;
@@ -20,6 +24,38 @@ constexpr float kMinZoom = 0.2f;
 constexpr float kMaxZoom = 5.0f;
 constexpr float kNearPlane = 1.0f;
 constexpr float kFarPlane = 100.0f;
+constexpr GLuint kMeshPoolVertices = 16384;
+constexpr GLuint kMeshPoolIndices = 49152;
+constexpr int kLightTileSize = 16;  // Must match local_size in deferred_tiled.comp.
+constexpr float kMaxSnapshotSkew = 0.004f;  // Seconds a predicted wall-clock snapshot may be off, at most.
+const glm::vec3 kDirLightWorld(-0.3f, -1.0f, -0.4f);
+constexpr float kRoomSpacing = 10.0f;  // Built-in rooms tile the ground; also the chunk size.
+constexpr float kStreamMargin = 4.0f;  // World units loaded beyond the view; released past twice this.
+constexpr size_t kStreamBytesPerFrame = size_t{8} << 20;
+constexpr Uint32 kShaderPollMs = 500;  // How often run() checks the shader files for edits.
+constexpr float kTargetSlack = 0.25f;  // Extra size per axis when deferred targets are reallocated.
+constexpr int kTargetAlignment = 64;  // Reallocated deferred target sizes round up to this.
+constexpr float kTargetShrinkArea = 0.5f;  // Reallocate once the slack size is below this share of the targets.
+constexpr float kLightGridCellSize = 16.0f;  // Wider than a built-in spot light's reach, so lights stay in cells.
+// Light grid flags: every light has the first; shadow casters add the bit of their type.
+constexpr uint32_t kLightReachFlag = 1u << 0;
+constexpr uint32_t kPointShadowFlag = 1u << 1;
+constexpr uint32_t kSpotShadowFlag = 1u << 2;
+constexpr int kShadowCandidatesPerSlot = 4;  // Visible casters per shadow slot that may request one.
+
+constexpr const char* kFramePassNames[] = {
+    "LightUpdate",
+    "ShadowDirectional",
+    "ShadowSpot",
+    "ShadowPoint",
+    "GBuffer",
+    "Occlusion",
+    "DirectionalLight",
+    "LightVolumes",
+    "TiledLighting",
+    "Composite",
+    "Forward",
+};
 
 struct Vertex {
     float px, py, pz;
@@ -35,6 +71,131 @@ void addQuad(const std::array<Vertex, 4>& verts, std::vector<float>& outVerts, s
     outIndices.insert(outIndices.end(), {base, base + 1, base + 2, base, base + 2, base + 3});
 }
 
+/**
+ * Returns the center of a built-in room; the grid is centered on the origin.
+ */
+glm::vec3 roomCenter(int room, int roomsX, int roomsZ) {
+    const int x = room % roomsX;
+    const int z = room / roomsX;
+    return glm::vec3(
+        (static_cast<float>(x) - 0.5f * static_cast<float>(roomsX - 1)) * kRoomSpacing,
+        0.0f,
+        (static_cast<float>(z) - 0.5f * static_cast<float>(roomsZ - 1)) * kRoomSpacing
+    );
+}
+
+/**
+ * Adds the demo room (ground and two walls) centered on a point; the ground is tiles x tiles
+ * separate tile meshes.
+ */
+bool addDemoRoom(render::SceneBuilder& builder, const glm::vec3& center, int tiles) {
+    const auto offsetQuad = [&center](std::array<Vertex, 4> quad) {
+        for (Vertex& v : quad) {
+            v.px += center.x;
+            v.py += center.y;
+            v.pz += center.z;
+        }
+        return quad;
+    };
+
+    const float g = 5.0f;
+    const float tileSize = 2.0f * g / static_cast<float>(tiles);
+    for (int tz = 0; tz < tiles; ++tz) {
+        for (int tx = 0; tx < tiles; ++tx) {
+            const float x0 = -g + static_cast<float>(tx) * tileSize;
+            const float z0 = -g + static_cast<float>(tz) * tileSize;
+            const float x1 = tx + 1 == tiles ? g : x0 + tileSize;
+            const float z1 = tz + 1 == tiles ? g : z0 + tileSize;
+            const std::array<Vertex, 4> groundQuad{{
+                {x0, 0.0f, z0, 0.0f, 1.0f, 0.0f, 0.18f, 0.36f, 0.20f},
+                {x1, 0.0f, z0, 0.0f, 1.0f, 0.0f, 0.18f, 0.36f, 0.20f},
+                {x1, 0.0f, z1, 0.0f, 1.0f, 0.0f, 0.18f, 0.36f, 0.20f},
+                {x0, 0.0f, z1, 0.0f, 1.0f, 0.0f, 0.18f, 0.36f, 0.20f},
+            }};
+            std::vector<float> groundVerts;
+            std::vector<unsigned int> groundIdx;
+            addQuad(offsetQuad(groundQuad), groundVerts, groundIdx);
+            if (!builder.addMesh(std::move(groundVerts), std::move(groundIdx), render::RenderLayer::Ground)) {
+                return false;
+            }
+        }
+    }
+
+    std::vector<float> wallVerts;
+    std::vector<unsigned int> wallIdx;
+    const float wallHeight = 2.5f;
+    const float wallOffset = 3.0f;
+    const float wallLength = 5.0f;
+
+    // The vertical walls must be defined in a counter‑clockwise order from the
+    // camera’s point of view in our isometric projection.  When we flipped the
+    // Y‑rotation to +45° the original vertex order resulted in a clockwise
+    // winding for the walls, so they were culled as back faces.  Reordering
+    // the vertices here restores a CCW winding without disabling face
+    // culling.  The normals remain the same; we still want wallA facing +X
+    // and wallB facing −X.
+
+    // Wall A (x = -wallOffset) ordered: bottom‑near, bottom‑far, top‑far, top‑near
+    const std::array<Vertex, 4> wallAQuad{{
+        {-wallOffset, 0.0f, -wallLength, 1.0f, 0.0f, 0.0f, 0.70f, 0.25f, 0.25f},   // bottom near
+        {-wallOffset, 0.0f,  wallLength, 1.0f, 0.0f, 0.0f, 0.70f, 0.25f, 0.25f},   // bottom far
+        {-wallOffset, wallHeight,  wallLength, 1.0f, 0.0f, 0.0f, 0.70f, 0.25f, 0.25f}, // top far
+        {-wallOffset, wallHeight, -wallLength, 1.0f, 0.0f, 0.0f, 0.70f, 0.25f, 0.25f}, // top near
+    }};
+    addQuad(offsetQuad(wallAQuad), wallVerts, wallIdx);
+
+    // Wall B (x = +wallOffset) ordered similarly
+    const std::array<Vertex, 4> wallBQuad{{
+        { wallOffset, 0.0f, -wallLength, -1.0f, 0.0f, 0.0f, 0.25f, 0.45f, 0.70f},   // bottom near
+        { wallOffset, 0.0f,  wallLength, -1.0f, 0.0f, 0.0f, 0.25f, 0.45f, 0.70f},   // bottom far
+        { wallOffset, wallHeight,  wallLength, -1.0f, 0.0f, 0.0f, 0.25f, 0.45f, 0.70f}, // top far
+        { wallOffset, wallHeight, -wallLength, -1.0f, 0.0f, 0.0f, 0.25f, 0.45f, 0.70f}, // top near
+    }};
+    std::vector<float> wallBVerts;
+    std::vector<unsigned int> wallBIdx;
+    addQuad(offsetQuad(wallBQuad), wallBVerts, wallBIdx);
+
+    // The walls are the scene's occluders: they fill depth before the rest of the G-buffer is culled.
+    constexpr uint32_t kWallPasses =
+        render::RenderQueue::kShadowPass | render::RenderQueue::kOccluderPass | render::RenderQueue::kForwardPass;
+    return builder.addMesh(std::move(wallVerts), std::move(wallIdx), render::RenderLayer::Geometry, kWallPasses) &&
+           builder.addMesh(std::move(wallBVerts), std::move(wallBIdx), render::RenderLayer::Geometry, kWallPasses);
+}
+
+/**
+ * Adds count crates on a ring between the walls of the room centered on a point, in the Actors layer.
+ */
+bool addDemoActors(render::SceneBuilder& builder, const glm::vec3& center, int count) {
+    const float half = 0.35f;
+    const float ringRadius = 1.6f;
+    for (int i = 0; i < count; ++i) {
+        const float angle = 6.2831853f * static_cast<float>(i) / static_cast<float>(count);
+        const glm::vec3 crate = center + glm::vec3(ringRadius * std::cos(angle), half, ringRadius * std::sin(angle));
+        std::vector<float> verts;
+        std::vector<unsigned int> indices;
+        // Five faces (the ground hides the bottom), each counter-clockwise seen from outside.
+        const std::array<glm::vec3, 5> normals{{
+            {1.0f, 0.0f, 0.0f}, {-1.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 1.0f}, {0.0f, 0.0f, -1.0f}, {0.0f, 1.0f, 0.0f},
+        }};
+        for (const glm::vec3& n : normals) {
+            const glm::vec3 up = n.y != 0.0f ? glm::vec3(0.0f, 0.0f, -1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+            const glm::vec3 right = glm::cross(up, n);
+            const glm::vec3 face = crate + n * half;
+            std::array<Vertex, 4> quad{};
+            const std::array<glm::vec2, 4> corners{{{-1.0f, -1.0f}, {1.0f, -1.0f}, {1.0f, 1.0f}, {-1.0f, 1.0f}}};
+            for (size_t c = 0; c < corners.size(); ++c) {
+                const glm::vec3 p = face + right * (corners[c].x * half) + up * (corners[c].y * half);
+                quad[c] = {p.x, p.y, p.z, n.x, n.y, n.z, 0.80f, 0.55f, 0.25f};
+            }
+            addQuad(quad, verts, indices);
+        }
+        if (!builder.addMesh(std::move(verts), std::move(indices), render::RenderLayer::Actors)) {
+            return false;
+        }
+    }
+    return true;
+}
+
 void pushVertex(const Vertex& v, std::vector<float>& outVerts) {
     outVerts.insert(outVerts.end(), {v.px, v.py, v.pz, v.nx, v.ny, v.nz, v.r, v.g, v.b});
 }
@@ -79,7 +240,8 @@ void buildSphereMesh(int stacks, int slices, std::vector<float>& outVerts, std::
             unsigned int b = static_cast<unsigned int>((stack + 1) * stride + slice);
             unsigned int c = static_cast<unsigned int>((stack + 1) * stride + slice + 1);
             unsigned int d = static_cast<unsigned int>(stack * stride + slice + 1);
-            outIndices.insert(outIndices.end(), {a, b, c, a, c, d});
+            // Counter-clockwise seen from outside, so GL_BACK culling keeps the camera-facing half.
+            outIndices.insert(outIndices.end(), {a, c, b, a, d, c});
         }
     }
 }
@@ -147,15 +309,26 @@ void buildConeMesh(int slices, std::vector<float>& outVerts, std::vector<unsigne
     }
 }
 
-std::string shaderRootPath() {
-    char* basePath = SDL_GetBasePath();
-    if (!basePath) {
+/**
+ * Returns the executable's directory with a trailing separator, or "build/" when unknown.
+ */
+std::string basePath() {
+    char* path = SDL_GetBasePath();
+    if (!path) {
         spdlog::warn("RenderEngine: SDL_GetBasePath failed: {}", SDL_GetError());
-        return "build/shaders/";
+        return "build/";
     }
-    std::string root = std::string(basePath) + "shaders/";
-    SDL_free(basePath);
-    return root;
+    std::string base(path);
+    SDL_free(path);
+    return base;
+}
+
+std::string shaderRootPath() {
+    return basePath() + "shaders/";
+}
+
+std::string shaderCachePath() {
+    return basePath() + "shader_cache/";
 }
 
 }  // namespace
@@ -163,13 +336,30 @@ std::string shaderRootPath() {
 namespace render {
 
 RenderEngine::RenderEngine(int width, int height, std::string title)
+    : RenderEngine(width, height, std::move(title), Options{}) {}
+
+RenderEngine::RenderEngine(int width, int height, std::string title, Options options)
     : width_(width),
       height_(height),
-      title_(std::move(title)) {}
+      title_(std::move(title)),
+      options_(options) {}
 
 RenderEngine::~RenderEngine() {
+    finishFrameSnapshot();
+    jobs_.stop();
+    profiler_.destroy();
+    framePacer_.destroy();
+    lightStream_.destroy();
+    uniformStream_.destroy();
+    destroyOutputTarget();
     destroyDeferredResources();
+    renderTargets_.destroy();
     shadowSystem_.destroy();
+    occlusionCuller_.destroy();
+    resetMeshGrid();
+    sceneStreamer_.reset(nullptr, nullptr);
+    meshPool_.destroy();
+    ShaderProgram::setCache(nullptr);
     if (glContext_) {
         SDL_GL_DeleteContext(glContext_);
         glContext_ = nullptr;
@@ -191,13 +381,16 @@ bool RenderEngine::init() {
     SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
     SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 24);
 
+    const Uint32 windowFlags = options_.headless
+        ? SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN
+        : SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE;
     window_ = SDL_CreateWindow(
         title_.c_str(),
         SDL_WINDOWPOS_CENTERED,
         SDL_WINDOWPOS_CENTERED,
         width_,
         height_,
-        SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE
+        windowFlags
     );
 
     if (!window_) {
@@ -214,7 +407,7 @@ bool RenderEngine::init() {
     }
 
     SDL_GL_MakeCurrent(window_, glContext_);
-    SDL_GL_SetSwapInterval(1);
+    framePacer_.configure(options_.pacing, &profiler_);
 
     glEnable(GL_DEPTH_TEST);
     glDepthFunc(GL_LEQUAL);
@@ -223,6 +416,7 @@ bool RenderEngine::init() {
     glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
     glClearColor(0.10f, 0.10f, 0.12f, 1.0f);
 
+    jobs_.start(options_.workerThreads);
     detectLightingCapabilities();
     updateProjection();
     buildScene();
@@ -237,14 +431,103 @@ void RenderEngine::run() {
     spdlog::info("RenderEngine: starting main loop");
     bool running = true;
     while (running) {
+        framePacer_.waitForFrame();
         SDL_Event event;
         while (SDL_PollEvent(&event) != 0) {
             handleEvent(event, running);
         }
 
-        renderScene();
+        const Uint32 now = SDL_GetTicks();
+        if (now - lastShaderPoll_ >= kShaderPollMs) {
+            lastShaderPoll_ = now;
+            reloadChangedShaders();
+        }
+
+        renderFrame();
+    }
+}
+
+void RenderEngine::renderFrame() {
+    previousSimulationTime_ = simulationTime_;
+    if (fixedTimestep_ > 0.0f) {
+        simulationTime_ += fixedTimestep_;
+    } else {
+        simulationTime_ = static_cast<float>(SDL_GetTicks()) * 0.001f;
+    }
+
+    renderScene();
+    if (!options_.headless) {
         SDL_GL_SwapWindow(window_);
     }
+    framePacer_.endFrame();
+}
+
+void RenderEngine::resize(int width, int height) {
+    if (width <= 0 || height <= 0) {
+        return;
+    }
+    width_ = width;
+    height_ = height;
+    if (window_ && !options_.headless) {
+        SDL_SetWindowSize(window_, width, height);
+    }
+    updateProjection();
+}
+
+void RenderEngine::setFixedTimestep(float seconds) {
+    fixedTimestep_ = std::max(seconds, 0.0f);
+    simulationTime_ = 0.0f;
+}
+
+void RenderEngine::setCameraPan(float x, float y) {
+    panX_ = x;
+    panY_ = y;
+    updateProjection();
+}
+
+void RenderEngine::setLightConfig(const LightConfig& config) {
+    lightConfig_ = config;
+    lightConfig_.pointLights = std::max(lightConfig_.pointLights, 0);
+    lightConfig_.spotLights = std::max(lightConfig_.spotLights, 0);
+    if (sceneReady_) {
+        buildLights();
+    }
+}
+
+void RenderEngine::setSceneConfig(const SceneConfig& config) {
+    sceneConfig_ = config;
+    sceneConfig_.roomsX = std::max(sceneConfig_.roomsX, 1);
+    sceneConfig_.roomsZ = std::max(sceneConfig_.roomsZ, 1);
+    sceneConfig_.groundTiles = std::max(sceneConfig_.groundTiles, 1);
+    sceneConfig_.actors = std::max(sceneConfig_.actors, 0);
+    if (sceneReady_) {
+        sceneReady_ = loadScene();
+    }
+}
+
+bool RenderEngine::exportScene(const std::string& path) const {
+    if (!sceneConfig_.path.empty()) {
+        spdlog::error("RenderEngine: only the built-in scene can be exported");
+        return false;
+    }
+    std::vector<uint8_t> bytes;
+    return buildBuiltinScene(true, bytes) && SceneAsset::write(path, bytes);
+}
+
+void RenderEngine::waitForGpu() const {
+    glFinish();
+}
+
+const char* RenderEngine::rendererPathName() const {
+    switch (rendererPath_) {
+        case RendererPath::Deferred41:
+            return "deferred41";
+        case RendererPath::Tiled43:
+            return "tiled43";
+        case RendererPath::SimpleForward:
+        default:
+            return "forward";
+    }
 }
 
 void RenderEngine::handleEvent(const SDL_Event& event, bool& running) {
@@ -290,6 +573,9 @@ void RenderEngine::handleEvent(const SDL_Event& event, bool& running) {
                 case SDLK_RIGHTBRACKET:
                     shadowDebugCascade_ = std::min(shadowSystem_.directionalCascadeCount() - 1, shadowDebugCascade_ + 1);
                     break;
+                case SDLK_p:
+                    profiler_.toggleOverlay();
+                    break;
                 default:
                     break;
             }
@@ -359,9 +645,10 @@ void RenderEngine::updateProjection() {
 
     view_ = t * rx * ry;
 
-    if (rendererPath_ == RendererPath::Deferred41) {
+    if (isDeferredPath()) {
         ensureDeferredResources();
     }
+    ensureOutputTarget();
 }
 
 void RenderEngine::detectLightingCapabilities() {
@@ -369,8 +656,12 @@ void RenderEngine::detectLightingCapabilities() {
     GLint minor = 0;
     glGetIntegerv(GL_MAJOR_VERSION, &major);
     glGetIntegerv(GL_MINOR_VERSION, &minor);
+    gl_.load(major, minor);
 
-    if (major > 4 || (major == 4 && minor >= 1)) {
+    if (options_.tiledLighting && gl_.hasCompute()) {
+        rendererPath_ = RendererPath::Tiled43;
+        spdlog::info("RenderEngine: using tiled deferred path (GL 4.3 compute)");
+    } else if (major > 4 || (major == 4 && minor >= 1)) {
         rendererPath_ = RendererPath::Deferred41;
         spdlog::info("RenderEngine: using deferred path (GL 4.1 compatible)");
     } else {
@@ -379,204 +670,497 @@ void RenderEngine::detectLightingCapabilities() {
     }
 }
 
-void RenderEngine::drawLayer(RenderLayer layer, std::initializer_list<const MeshBuffer*> meshes) const {
-    // Ground doesn't write depth so vertical geometry isn't occluded in isometric view.
-    const GLboolean depthWrite = layer == RenderLayer::Ground ? GL_FALSE : GL_TRUE;
-    glDepthMask(depthWrite);
-    for (const MeshBuffer* mesh : meshes) {
-        mesh->draw();
+void RenderEngine::buildRenderQueue(
+    RenderQueue& queue,
+    const glm::mat4& view,
+    const glm::mat4& viewProj,
+    std::vector<int>& scratch
+) const {
+    queue.clear();
+    queue.setDepthRange(kNearPlane, kFarPlane);
+    // Shadow passes query the grid for their own casters, so the camera's queue holds only what it sees.
+    meshGrid_.query(&viewProj, 1, ~0u, scratch);
+    // Submitted in streamer order, so sort ties break the same way however the grid is laid out.
+    std::sort(scratch.begin(), scratch.end(), [&](int a, int b) {
+        return gridMeshInfo_[static_cast<size_t>(a)].order < gridMeshInfo_[static_cast<size_t>(b)].order;
+    });
+    for (const int handle : scratch) {
+        const MeshBuffer& mesh = *gridMeshes_[static_cast<size_t>(handle)];
+        const Aabb& bounds = mesh.bounds();
+        const glm::vec4 center(0.5f * (bounds.min + bounds.max), 1.0f);
+        RenderQueue::DrawItem item{};
+        item.mesh = &mesh;
+        item.layer = gridMeshInfo_[static_cast<size_t>(handle)].layer;
+        item.passMask = meshGrid_.flags(handle);
+        item.viewDepth = -(view * center).z;
+        queue.submit(item);
+    }
+    queue.sort();
+}
+
+void RenderEngine::indexLights() {
+    lightGrid_ = SpatialGrid(kLightGridCellSize);
+    // Reach bounds cover the whole animation, so lights never move in the grid.
+    for (int i = 0; i < lightStore_.size(); ++i) {
+        const LightInstance& light = lights_[static_cast<size_t>(lightStore_.sourceIndex(i))];
+        uint32_t flags = kLightReachFlag;
+        if (light.castsShadow) {
+            flags |= light.type == LightType::Spot ? kSpotShadowFlag : kPointShadowFlag;
+        }
+        lightGrid_.insert(lightStore_.reachBounds(i), flags);
+    }
+}
+
+void RenderEngine::syncMeshGrid() {
+    if (gridSynced_ && gridSceneRevision_ == sceneStreamer_.revision()) {
+        return;
+    }
+    gridSynced_ = true;
+    gridSceneRevision_ = sceneStreamer_.revision();
+    gridSyncStamp_++;
+    gridStaticCasters_ = 0;
+    gridDynamicCasters_ = 0;
+
+    // Only meshes that arrived, left or changed touch the grid. A new mesh may reuse a released
+    // one's address, so known meshes are refit whenever their bounds or passes differ.
+    const std::vector<SceneStreamer::SceneMesh>& meshes = sceneStreamer_.meshes();
+    for (size_t i = 0; i < meshes.size(); ++i) {
+        const SceneStreamer::SceneMesh& mesh = meshes[i];
+        const Aabb& bounds = mesh.mesh->bounds();
+        const auto [found, inserted] = gridHandles_.try_emplace(mesh.mesh, -1);
+        if (inserted) {
+            found->second = meshGrid_.insert(bounds, mesh.passMask);
+            const size_t handle = static_cast<size_t>(found->second);
+            if (handle >= gridMeshes_.size()) {
+                gridMeshes_.resize(handle + 1, nullptr);
+                gridMeshInfo_.resize(handle + 1);
+            }
+        } else {
+            const Aabb& indexed = meshGrid_.bounds(found->second);
+            if (indexed.min != bounds.min || indexed.max != bounds.max || meshGrid_.flags(found->second) != mesh.passMask) {
+                meshGrid_.update(found->second, bounds, mesh.passMask);
+            }
+        }
+        const size_t handle = static_cast<size_t>(found->second);
+        gridMeshes_[handle] = mesh.mesh;
+        GridMesh& info = gridMeshInfo_[handle];
+        info.layer = mesh.layer;
+        info.order = static_cast<int>(i);
+        info.syncStamp = gridSyncStamp_;
+        if ((mesh.passMask & RenderQueue::kShadowPass) != 0) {
+            (mesh.mesh->dynamic() ? gridDynamicCasters_ : gridStaticCasters_)++;
+        }
     }
+    for (auto it = gridHandles_.begin(); it != gridHandles_.end();) {
+        const size_t handle = static_cast<size_t>(it->second);
+        if (gridMeshInfo_[handle].syncStamp == gridSyncStamp_) {
+            ++it;
+            continue;
+        }
+        meshGrid_.remove(it->second);
+        gridMeshes_[handle] = nullptr;
+        it = gridHandles_.erase(it);
+    }
+}
+
+void RenderEngine::resetMeshGrid() {
+    meshGrid_ = SpatialGrid(kRoomSpacing);
+    gridHandles_.clear();
+    gridMeshes_.clear();
+    gridMeshInfo_.clear();
+    gridSynced_ = false;
+    gridStaticCasters_ = 0;
+    gridDynamicCasters_ = 0;
 }
 
 void RenderEngine::buildLights() {
+    finishFrameSnapshot();
+    lightRevision_++;
     lights_.clear();
 
-    constexpr int kPointLights = 32;
-    constexpr int kSpotLights = 8;
+    if (sceneAsset_.lightCount() > 0) {
+        lights_.reserve(static_cast<size_t>(sceneAsset_.lightCount()));
+        for (int i = 0; i < sceneAsset_.lightCount(); ++i) {
+            lights_.push_back(sceneAsset_.light(i));
+        }
+        lightStore_.assign(lights_);
+        indexLights();
+        return;
+    }
+
+    // Generated lights are dealt round-robin into the built-in rooms.
+    const int roomCount = sceneConfig_.roomsX * sceneConfig_.roomsZ;
+    const auto room = [&](int i) { return roomCenter(i % roomCount, sceneConfig_.roomsX, sceneConfig_.roomsZ); };
+    const int pointLights = lightConfig_.pointLights;
+    const int spotLights = lightConfig_.spotLights;
     constexpr float kTwoPi = 6.283185307f;
 
-    for (int i = 0; i < kPointLights; ++i) {
-        const float angle = kTwoPi * static_cast<float>(i) / static_cast<float>(kPointLights);
+    for (int i = 0; i < pointLights; ++i) {
+        const float angle = kTwoPi * static_cast<float>(i) / static_cast<float>(pointLights);
         const float r = 0.4f + 0.6f * static_cast<float>(std::sin(angle));
         const float g = 0.4f + 0.6f * static_cast<float>(std::sin(angle + 2.1f));
         const float b = 0.4f + 0.6f * static_cast<float>(std::sin(angle + 4.2f));
 
         LightInstance light{};
-        light.basePosition = glm::vec3(std::cos(angle) * 4.5f, 1.2f, std::sin(angle) * 4.5f);
+        light.basePosition = room(i) + glm::vec3(std::cos(angle) * 4.5f, 1.2f, std::sin(angle) * 4.5f);
         light.radius = 6.0f;
         light.color = glm::vec3(r, g, b);
         light.intensity = 1.0f;
-        light.target = glm::vec3(0.0f);
+        light.target = room(i);
         light.innerAngle = 0.0f;
         light.outerAngle = 0.0f;
         light.type = LightType::Point;
         light.phase = angle;
-        light.castsShadow = (i == 0);
+        light.castsShadow = i < lightConfig_.pointShadowCasters;
         light.shadowBiasMin = 0.0015f;
         light.shadowBiasSlope = 0.0045f;
         lights_.push_back(light);
     }
 
-    for (int i = 0; i < kSpotLights; ++i) {
-        const float angle = kTwoPi * static_cast<float>(i) / static_cast<float>(kSpotLights);
+    for (int i = 0; i < spotLights; ++i) {
+        const float angle = kTwoPi * static_cast<float>(i) / static_cast<float>(spotLights);
         LightInstance light{};
-        light.basePosition = glm::vec3(std::cos(angle) * 2.5f, 4.0f, std::sin(angle) * 2.5f);
+        light.basePosition = room(i) + glm::vec3(std::cos(angle) * 2.5f, 4.0f, std::sin(angle) * 2.5f);
         light.radius = 8.0f;
         light.color = glm::vec3(0.55f, 0.70f, 0.95f);
         light.intensity = 1.4f;
-        light.target = glm::vec3(0.0f, 0.0f, 0.0f);
+        light.target = room(i);
         light.innerAngle = 15.0f;
         light.outerAngle = 25.0f;
         light.type = LightType::Spot;
         light.phase = angle;
-        light.castsShadow = (i == 0);
+        light.castsShadow = i < lightConfig_.spotShadowCasters;
         light.shadowBiasMin = 0.0012f;
         light.shadowBiasSlope = 0.004f;
         lights_.push_back(light);
     }
 
-    gpuLights_.resize(lights_.size());
+    lightStore_.assign(lights_);
+    indexLights();
 }
 
-void RenderEngine::updateLights() {
-    if (rendererPath_ != RendererPath::Deferred41) {
+void RenderEngine::fillFrameSnapshot(FrameSnapshot& snapshot) {
+    const glm::mat4 viewProj = snapshot.projection * snapshot.view;
+    buildRenderQueue(snapshot.renderQueue, snapshot.view, viewProj, snapshot.gridHandles);
+    snapshot.valid = true;
+    snapshot.pointCount = 0;
+    snapshot.pointInsideCount = 0;
+    snapshot.spotCount = 0;
+    snapshot.spotInsideCount = 0;
+    snapshot.fitCasterCount = 0;
+    snapshot.lightUpdateMs = 0.0f;
+    snapshot.gpuOrder.clear();
+    snapshot.visibleLights.clear();
+    snapshot.shadowCandidates.clear();
+    if (!snapshot.deferred) {
+        snapshot.lights.clear();
+        snapshot.gpuLights.clear();
         return;
     }
-    shadowSystem_.beginFrame();
-    if (lights_.empty()) {
-        lightCount_ = 0;
-        pointLightCount_ = 0;
-        spotLightCount_ = 0;
-        return;
+    snapshot.receiverBounds.clear();
+    snapshot.casterBounds.clear();
+    for (size_t i = 0; i < snapshot.renderQueue.size(); ++i) {
+        const RenderQueue::DrawItem& item = snapshot.renderQueue.sortedItem(i);
+        if ((item.passMask & RenderQueue::kGBufferPass) != 0) {
+            snapshot.receiverBounds.push_back(item.mesh->bounds());
+        }
+    }
+    // Casters outside the view still shadow it, so they come from the light's side of the view.
+    const glm::mat4 casterVolume =
+        ShadowSystem::directionalCasterVolume(snapshot.view, snapshot.projection, kDirLightWorld);
+    meshGrid_.query(&casterVolume, 1, RenderQueue::kShadowPass, snapshot.gridHandles);
+    for (const int handle : snapshot.gridHandles) {
+        snapshot.casterBounds.push_back(meshGrid_.bounds(handle));
     }
+    snapshot.fitCasterCount = static_cast<int>(snapshot.casterBounds.size());
+    const ShadowSystem::FitBounds fitBounds{
+        snapshot.receiverBounds.data(),
+        static_cast<int>(snapshot.receiverBounds.size()),
+        snapshot.casterBounds.data(),
+        static_cast<int>(snapshot.casterBounds.size()),
+    };
+    shadowSystem_.fitDirectional(
+        snapshot.view,
+        snapshot.projection,
+        kDirLightWorld,
+        kNearPlane,
+        kFarPlane,
+        fitBounds,
+        snapshot.cascades
+    );
 
-    const float time = static_cast<float>(SDL_GetTicks()) * 0.001f;
-    const glm::mat4 invView = glm::inverse(view_);
-    gpuLights_.clear();
-    gpuLights_.reserve(lights_.size());
-    pointLightCount_ = 0;
-    spotLightCount_ = 0;
-    cameraInsideLightVolume_ = false;
-
-    auto appendLight = [&](const LightInstance& light) {
-        glm::vec3 position = light.basePosition;
-        const float phase = light.phase + time;
-        const float orbitScale = light.type == LightType::Spot ? 2.25f : 0.55f;
-        const float bobScale = light.type == LightType::Spot ? 2.15f : 0.35f;
-
-        position.x += orbitScale * std::cos(phase * 0.7f);
-        position.z += orbitScale * std::sin(phase * 0.9f);
-        position.y += bobScale * std::sin(phase * 1.3f);
-
-        glm::vec3 direction(0.0f);
-        if (light.type == LightType::Spot) {
-            direction = glm::normalize(light.target - position);
+    // A light whose reach misses the view lights no visible pixel: it is not animated, uploaded
+    // or given a shadow.
+    lightGrid_.query(&viewProj, 1, kLightReachFlag, snapshot.visibleLights);
+    snapshot.lightBlocks.clear();
+    for (const int index : snapshot.visibleLights) {
+        const int block = index / LightStore::kLaneCount;
+        if (snapshot.lightBlocks.empty() || snapshot.lightBlocks.back() != block) {
+            snapshot.lightBlocks.push_back(block);
         }
+    }
 
-        const glm::vec3 viewPos = glm::vec3(view_ * glm::vec4(position, 1.0f));
-        if (glm::length(viewPos) < light.radius) {
-            cameraInsideLightVolume_ = true;
-        }
-        glm::vec3 viewDir(0.0f);
-        if (light.type == LightType::Spot) {
-            viewDir = glm::normalize(glm::mat3(view_) * direction);
+    const float time = snapshot.animated ? snapshot.time : 0.0f;
+    const int lightCount = lightStore_.size();
+    snapshot.lights.resize(static_cast<size_t>(lightCount));
+    snapshot.gpuLights.resize(static_cast<size_t>(lightCount));
+    constexpr int kBlocksPerJob = 64;
+    const uint64_t animateStart = SDL_GetPerformanceCounter();
+    const std::vector<int>& blocks = snapshot.lightBlocks;
+    jobs_.parallelFor(static_cast<int>(blocks.size()), kBlocksPerJob, [&](int first, int last) {
+        // Lanes animate together, so whole blocks are animated; consecutive ones in one call.
+        for (int i = first; i < last;) {
+            int next = i + 1;
+            while (next < last && blocks[static_cast<size_t>(next)] == blocks[static_cast<size_t>(next - 1)] + 1) {
+                ++next;
+            }
+            const int begin = blocks[static_cast<size_t>(i)] * LightStore::kLaneCount;
+            const int end = std::min((blocks[static_cast<size_t>(next - 1)] + 1) * LightStore::kLaneCount, lightCount);
+            lightStore_.animate(
+                time,
+                snapshot.view,
+                kNearPlane,
+                begin,
+                end,
+                snapshot.lights.data(),
+                snapshot.gpuLights.data()
+            );
+            i = next;
         }
+    });
+    snapshot.lightUpdateMs = static_cast<float>(
+        static_cast<double>(SDL_GetPerformanceCounter() - animateStart) * 1000.0 /
+        static_cast<double>(SDL_GetPerformanceFrequency())
+    );
 
-        int shadowType = 0;
-        int shadowIndex = -1;
-        if (light.castsShadow) {
-            if (light.type == LightType::Spot) {
-                ShadowSystem::SpotShadowDesc desc{
-                    position,
-                    direction,
-                    light.radius,
-                    light.outerAngle,
-                    light.shadowBiasMin,
-                    light.shadowBiasSlope
-                };
-                shadowIndex = shadowSystem_.registerSpotShadow(desc, invView);
-                if (shadowIndex >= 0) {
-                    shadowType = 1;
-                }
+    // The store is sorted by type, so one pass per type splits it into [volumes clear of the
+    // near plane][volumes crossing it], keeping both groups contiguous for instanced drawing.
+    snapshot.gpuOrder.reserve(snapshot.visibleLights.size());
+    std::vector<int> crossing;
+    using Iterator = std::vector<int>::const_iterator;
+    auto appendType = [&](Iterator first, Iterator last, int& outCount, int& outInsideCount) {
+        crossing.clear();
+        for (Iterator it = first; it != last; ++it) {
+            if (snapshot.lights[static_cast<size_t>(*it)].crossesNearPlane) {
+                crossing.push_back(*it);
             } else {
-                ShadowSystem::PointShadowDesc desc{
-                    position,
-                    light.radius,
-                    light.shadowBiasMin,
-                    light.shadowBiasSlope
-                };
-                shadowIndex = shadowSystem_.registerPointShadow(desc);
-                if (shadowIndex >= 0) {
-                    shadowType = 2;
-                }
+                snapshot.gpuOrder.push_back(*it);
             }
         }
-        if (shadowType == 0) {
-            shadowIndex = 0;
-        }
-
-        GpuLight gpu{};
-        gpu.positionRadius = glm::vec4(viewPos, light.radius);
-        gpu.colorIntensity = glm::vec4(light.color, light.intensity);
-        gpu.directionType = glm::vec4(viewDir, static_cast<float>(light.type));
-        gpu.shadowInfo = glm::vec4(
-            static_cast<float>(shadowType),
-            static_cast<float>(shadowIndex),
-            light.shadowBiasMin,
-            light.shadowBiasSlope
-        );
-
-        if (light.type == LightType::Spot) {
-            const float inner = std::cos(glm::radians(light.innerAngle));
-            const float outer = std::cos(glm::radians(light.outerAngle));
-            const float tanOuter = std::tan(glm::radians(light.outerAngle));
-            gpu.spotParams = glm::vec4(inner, outer, light.radius, tanOuter);
-        } else {
-            gpu.spotParams = glm::vec4(0.0f);
-        }
-
-        gpuLights_.push_back(gpu);
+        snapshot.gpuOrder.insert(snapshot.gpuOrder.end(), crossing.begin(), crossing.end());
+        outCount = static_cast<int>(last - first);
+        outInsideCount = static_cast<int>(crossing.size());
+    };
+    const std::vector<int>& visible = snapshot.visibleLights;
+    const Iterator firstSpot = std::lower_bound(visible.cbegin(), visible.cend(), lightStore_.pointCount());
+    appendType(visible.cbegin(), firstSpot, snapshot.pointCount, snapshot.pointInsideCount);
+    appendType(firstSpot, visible.cend(), snapshot.spotCount, snapshot.spotInsideCount);
+
+    // The visible casters nearest the eye compete for each type's slots; ShadowSystem ranks them.
+    const glm::vec3 eye(glm::inverse(snapshot.view)[3]);
+    auto addCandidates = [&](uint32_t flag, int slots) {
+        lightGrid_.nearest(eye, slots * kShadowCandidatesPerSlot, flag, &viewProj, snapshot.gridHandles);
+        std::vector<int>& candidates = snapshot.shadowCandidates;
+        candidates.insert(candidates.end(), snapshot.gridHandles.begin(), snapshot.gridHandles.end());
     };
+    addCandidates(kPointShadowFlag, ShadowSystem::kMaxPointShadows);
+    addCandidates(kSpotShadowFlag, ShadowSystem::kMaxSpotShadows);
+    std::sort(snapshot.shadowCandidates.begin(), snapshot.shadowCandidates.end());
+}
 
-    for (const auto& light : lights_) {
-        if (light.type == LightType::Point) {
-            appendLight(light);
-            pointLightCount_++;
-        }
+void RenderEngine::acquireFrameSnapshot() {
+    jobs_.wait(snapshotJob_);
+    // No job is running, so chunks can stream in and out; a changed set makes the snapshot stale.
+    streamScene(kStreamBytesPerFrame);
+    syncMeshGrid();
+    // A fixed timestep must render exactly its own time. Wall-clock frames take the predicted one
+    // while it is within half a frame, so a hitch rebuilds instead of showing a stale time.
+    const float maxSkew = std::min(0.5f * std::max(simulationTime_ - previousSimulationTime_, 0.0f), kMaxSnapshotSkew);
+    const bool timeMatches = fixedTimestep_ > 0.0f
+        ? nextSnapshot_.time == simulationTime_
+        : std::abs(nextSnapshot_.time - simulationTime_) <= maxSkew;
+    const bool stale = !nextSnapshot_.valid ||
+                       !timeMatches ||
+                       nextSnapshot_.view != view_ ||
+                       nextSnapshot_.projection != projection_ ||
+                       nextSnapshot_.lightRevision != lightRevision_ ||
+                       nextSnapshot_.sceneRevision != sceneStreamer_.revision() ||
+                       nextSnapshot_.animated != lightConfig_.animated ||
+                       nextSnapshot_.deferred != isDeferredPath();
+    auto setInputs = [this](FrameSnapshot& snapshot, float time) {
+        snapshot.time = time;
+        snapshot.view = view_;
+        snapshot.projection = projection_;
+        snapshot.lightRevision = lightRevision_;
+        snapshot.sceneRevision = sceneStreamer_.revision();
+        snapshot.animated = lightConfig_.animated;
+        snapshot.deferred = isDeferredPath();
+    };
+    if (stale) {
+        setInputs(nextSnapshot_, simulationTime_);
+        fillFrameSnapshot(nextSnapshot_);
     }
 
-    for (const auto& light : lights_) {
-        if (light.type == LightType::Spot) {
-            appendLight(light);
-            spotLightCount_++;
-        }
+    std::swap(renderQueue_, nextSnapshot_.renderQueue);
+    std::swap(frameLights_, nextSnapshot_.lights);
+    std::swap(frameGpuLights_, nextSnapshot_.gpuLights);
+    std::swap(frameGpuOrder_, nextSnapshot_.gpuOrder);
+    std::swap(frameShadowCandidates_, nextSnapshot_.shadowCandidates);
+    frameCascades_ = nextSnapshot_.cascades;
+    pointLightCount_ = nextSnapshot_.pointCount;
+    pointInsideCount_ = nextSnapshot_.pointInsideCount;
+    spotLightCount_ = nextSnapshot_.spotCount;
+    spotInsideCount_ = nextSnapshot_.spotInsideCount;
+    lightUpdateMs_ = nextSnapshot_.lightUpdateMs;
+    cullingStats_.meshGrid = meshGrid_.stats();
+    cullingStats_.lightGrid = lightGrid_.stats();
+    cullingStats_.visibleMeshes = static_cast<int>(renderQueue_.size());
+    cullingStats_.visibleLights = pointLightCount_ + spotLightCount_;
+    cullingStats_.shadowCandidates = static_cast<int>(frameShadowCandidates_.size());
+    cullingStats_.fitCasters = nextSnapshot_.fitCasterCount;
+    nextSnapshot_.valid = false;
+
+    if (!options_.pipelinedFrames || jobs_.workerCount() == 0) {
+        return;
     }
+    const float frameDelta = fixedTimestep_ > 0.0f ? fixedTimestep_ : simulationTime_ - previousSimulationTime_;
+    setInputs(nextSnapshot_, simulationTime_ + std::max(frameDelta, 0.0f));
+    const JobSystem::JobFn fillNext = [](void* context, int, int) {
+        auto* engine = static_cast<RenderEngine*>(context);
+        engine->fillFrameSnapshot(engine->nextSnapshot_);
+    };
+    jobs_.submit(fillNext, this, 0, 0, snapshotJob_);
+}
 
-    lightCount_ = static_cast<int>(gpuLights_.size());
+void RenderEngine::finishFrameSnapshot() {
+    jobs_.wait(snapshotJob_);
+    nextSnapshot_.valid = false;
+}
 
-    if (lightsTbo_ == 0) {
-        glGenBuffers(1, &lightsTbo_);
+void RenderEngine::updateLights() {
+    if (!isDeferredPath()) {
+        return;
     }
-    if (lightsTboTex_ == 0) {
-        glGenTextures(1, &lightsTboTex_);
+    shadowSystem_.beginFrame();
+    lightBatches_.fill({});
+    if (lights_.empty() || frameLights_.size() != static_cast<size_t>(lightStore_.size())) {
+        shadowSystem_.resolveShadows(glm::inverse(view_));
+        lightCount_ = 0;
+        pointLightCount_ = 0;
+        spotLightCount_ = 0;
+        pointInsideCount_ = 0;
+        spotInsideCount_ = 0;
+        return;
     }
 
-    const GLsizeiptr bufferSize = static_cast<GLsizeiptr>(gpuLights_.size() * sizeof(GpuLight));
-    if (bufferSize == 0) {
-        lightTboSize_ = 0;
+    const GLsizeiptr bufferSize = static_cast<GLsizeiptr>(frameLights_.size() * sizeof(GpuLight));
+    if (lightStream_.id() == 0 && !lightStream_.init(GL_TEXTURE_BUFFER, bufferSize, gl_)) {
+        lightCount_ = 0;
+        return;
+    }
+    lightStream_.beginFrame(bufferSize);
+    GLintptr lightOffset = 0;
+    auto* mapped = static_cast<GpuLight*>(lightStream_.map(bufferSize, lightOffset));
+    if (!mapped) {
+        lightCount_ = 0;
         return;
     }
 
-    glBindBuffer(GL_TEXTURE_BUFFER, lightsTbo_);
-    if (bufferSize != lightTboSize_) {
-        glBufferData(GL_TEXTURE_BUFFER, bufferSize, gpuLights_.data(), GL_DYNAMIC_DRAW);
-        lightTboSize_ = bufferSize;
-    } else {
-        glBufferSubData(GL_TEXTURE_BUFFER, 0, bufferSize, gpuLights_.data());
+    const glm::mat4 invView = glm::inverse(view_);
+
+    // Queue every shadow request first, so ShadowSystem can rank all candidates before any
+    // shadow slot is written into the light buffer. ShadowSystem stays on the render thread.
+    shadowRequests_.assign(frameLights_.size(), -1);
+    for (const int index : frameShadowCandidates_) {
+        const int source = lightStore_.sourceIndex(index);
+        const LightInstance& light = lights_[static_cast<size_t>(source)];
+        const AnimatedLight& frame = frameLights_[static_cast<size_t>(index)];
+        int& request = shadowRequests_[static_cast<size_t>(index)];
+        if (light.type == LightType::Spot) {
+            ShadowSystem::SpotShadowDesc desc{
+                source,
+                frame.position,
+                frame.direction,
+                light.radius,
+                light.outerAngle,
+                light.shadowBiasMin,
+                light.shadowBiasSlope,
+                light.shadowImportance
+            };
+            request = shadowSystem_.requestSpotShadow(desc);
+        } else {
+            ShadowSystem::PointShadowDesc desc{
+                source,
+                frame.position,
+                light.radius,
+                light.shadowBiasMin,
+                light.shadowBiasSlope,
+                light.shadowImportance
+            };
+            request = shadowSystem_.requestPointShadow(desc);
+        }
+    }
+    shadowSystem_.resolveShadows(invView);
+
+    // Each block of frameGpuOrder_ is written as [lights with a shadow slot][lights without], so
+    // every batch draws through one volume permutation.
+    const int blockSizes[] = {
+        pointLightCount_ - pointInsideCount_,
+        pointInsideCount_,
+        spotLightCount_ - spotInsideCount_,
+        spotInsideCount_,
+    };
+    int writtenLights = 0;
+    int cullGroup = 0;
+    auto order = frameGpuOrder_.begin();
+    for (int block = 0; block < 4; ++block) {
+        const bool spot = block >= 2;
+        const bool inside = (block & 1) != 0;
+        unshadowedLights_.clear();
+        const int shadowedFirst = writtenLights;
+        for (int i = 0; i < blockSizes[block]; ++i, ++order) {
+            const int index = *order;
+            GpuLight gpu = frameGpuLights_[static_cast<size_t>(index)];
+            const int request = shadowRequests_[static_cast<size_t>(index)];
+            const int shadowIndex = request < 0 ? -1
+                : spot ? shadowSystem_.spotShadowSlot(request) : shadowSystem_.pointShadowSlot(request);
+            if (shadowIndex < 0) {
+                unshadowedLights_.push_back(gpu);
+                continue;
+            }
+            gpu.shadowInfo.x = spot ? 1.0f : 2.0f;
+            gpu.shadowInfo.y = static_cast<float>(shadowIndex);
+            // Written straight into the mapped ring region (write-combined; never read back).
+            mapped[writtenLights++] = gpu;
+        }
+        const int unshadowedFirst = writtenLights;
+        for (const GpuLight& gpu : unshadowedLights_) {
+            mapped[writtenLights++] = gpu;
+        }
+        LightBatch& shadowed = lightBatches_[static_cast<size_t>(block * 2)];
+        LightBatch& unshadowed = lightBatches_[static_cast<size_t>(block * 2 + 1)];
+        shadowed = {shadowedFirst, unshadowedFirst - shadowedFirst, spot, true, inside};
+        unshadowed = {unshadowedFirst, writtenLights - unshadowedFirst, spot, false, inside};
+        // Only volumes clear of the near plane are culled; the ones crossing it cover the camera anyway.
+        if (!inside) {
+            shadowed.cullGroup = cullGroup++;
+            unshadowed.cullGroup = cullGroup++;
+        }
     }
 
-    glBindTexture(GL_TEXTURE_BUFFER, lightsTboTex_);
-    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, lightsTbo_);
+    lightStream_.unmap();
+    lightCount_ = writtenLights;
+    lightTexelOffset_ = static_cast<int>(lightOffset / static_cast<GLintptr>(sizeof(glm::vec4)));
+
+    if (lightsTboTex_ == 0) {
+        glGenTextures(1, &lightsTboTex_);
+    }
+    // The texture views the whole ring; shaders add lightTexelOffset_ to reach this frame's region.
+    if (lightStreamRevision_ != lightStream_.revision()) {
+        glBindTexture(GL_TEXTURE_BUFFER, lightsTboTex_);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, lightStream_.id());
+        lightStreamRevision_ = lightStream_.revision();
+    }
 }
 
 bool RenderEngine::buildVolumeMeshes() {
@@ -588,90 +1172,71 @@ bool RenderEngine::buildVolumeMeshes() {
     std::vector<unsigned int> coneIdx;
     buildConeMesh(24, coneVerts, coneIdx);
 
-    const bool sphereReady = lightSphere_.upload(sphereVerts, sphereIdx);
-    const bool coneReady = lightCone_.upload(coneVerts, coneIdx);
+    const bool sphereReady = lightSphere_.upload(meshPool_, sphereVerts, sphereIdx);
+    const bool coneReady = lightCone_.upload(meshPool_, coneVerts, coneIdx);
     return sphereReady && coneReady;
 }
 
 void RenderEngine::ensureDeferredResources() {
-    if (rendererPath_ != RendererPath::Deferred41) {
+    if (!isDeferredPath()) {
         return;
     }
     if (width_ <= 0 || height_ <= 0) {
         return;
     }
-    if (width_ == deferredWidth_ && height_ == deferredHeight_ && gbufferFbo_ != 0 && lightFbo_ != 0) {
+    const auto slackSize = [](int size) {
+        const int padded = size + static_cast<int>(static_cast<float>(size) * kTargetSlack);
+        return (padded + kTargetAlignment - 1) / kTargetAlignment * kTargetAlignment;
+    };
+    // Smaller outputs render into a corner of the targets (see renderWidth_); only outgrowing
+    // them, or shrinking until a fresh allocation would be much smaller, reallocates.
+    const bool fits = width_ <= deferredWidth_ && height_ <= deferredHeight_;
+    const bool oversized = static_cast<float>(slackSize(width_)) * static_cast<float>(slackSize(height_)) <
+        kTargetShrinkArea * static_cast<float>(deferredWidth_) * static_cast<float>(deferredHeight_);
+    if (fits && !oversized && gbufferFbo_ != 0 && lightFbo_ != 0) {
         return;
     }
 
+    // The first allocation is exact; once the output starts changing size it gets slack so a
+    // window drag does not reallocate on every event.
+    const bool resized = gbufferFbo_ != 0;
     destroyDeferredResources();
+    deferredWidth_ = resized ? slackSize(width_) : width_;
+    deferredHeight_ = resized ? slackSize(height_) : height_;
 
-    deferredWidth_ = width_;
-    deferredHeight_ = height_;
-
-    glGenTextures(1, &gbufferAlbedo_);
-    glBindTexture(GL_TEXTURE_2D, gbufferAlbedo_);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width_, height_, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-
-    glGenTextures(1, &gbufferNormal_);
-    glBindTexture(GL_TEXTURE_2D, gbufferNormal_);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width_, height_, 0, GL_RGBA, GL_FLOAT, nullptr);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-
-    glGenTextures(1, &gbufferDepthColor_);
-    glBindTexture(GL_TEXTURE_2D, gbufferDepthColor_);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, width_, height_, 0, GL_RED, GL_FLOAT, nullptr);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-
-    glGenTextures(1, &gbufferDepth_);
-    glBindTexture(GL_TEXTURE_2D, gbufferDepth_);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH24_STENCIL8, width_, height_, 0, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, nullptr);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_NONE);
-    glTexParameteri(GL_TEXTURE_2D, GL_DEPTH_STENCIL_TEXTURE_MODE, GL_DEPTH_COMPONENT);
+    gbufferAlbedo_ = renderTargets_.acquire({GL_RGBA8, deferredWidth_, deferredHeight_});
+    // Octahedral view-space normal in RG and roughness in B: 4 bytes instead of RGBA16F's 8.
+    gbufferNormal_ = renderTargets_.acquire({GL_RGB10_A2, deferredWidth_, deferredHeight_});
+    gbufferDepth_ = renderTargets_.acquire({GL_DEPTH24_STENCIL8, deferredWidth_, deferredHeight_});
 
     glGenFramebuffers(1, &gbufferFbo_);
     glBindFramebuffer(GL_FRAMEBUFFER, gbufferFbo_);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, gbufferAlbedo_, 0);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, gbufferNormal_, 0);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, gbufferDepthColor_, 0);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, gbufferDepth_, 0);
-    const GLenum gbufferAttachments[3] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2};
-    glDrawBuffers(3, gbufferAttachments);
+    const GLenum gbufferAttachments[2] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+    glDrawBuffers(2, gbufferAttachments);
     if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
         spdlog::error("RenderEngine: gbuffer framebuffer is incomplete");
     }
 
-    glGenTextures(1, &lightColor_);
-    glBindTexture(GL_TEXTURE_2D, lightColor_);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width_, height_, 0, GL_RGBA, GL_FLOAT, nullptr);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    lightColor_ = renderTargets_.acquire({GL_RGBA16F, deferredWidth_, deferredHeight_, GL_LINEAR});
 
+    // The lighting passes sample gbufferDepth_, so it is never attached here: shadowInfo_ goes to
+    // color 1 and lightDepth_ to the depth attachment only in the frames that use them.
     glGenFramebuffers(1, &lightFbo_);
     glBindFramebuffer(GL_FRAMEBUFFER, lightFbo_);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, lightColor_, 0);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, gbufferDepth_, 0);
     glDrawBuffer(GL_COLOR_ATTACHMENT0);
     if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
         spdlog::error("RenderEngine: light framebuffer is incomplete");
     }
 
+    // The half-resolution targets are transient; beginHalfResLocalLights attaches them per frame.
+    if (options_.halfResLightVolumes && rendererPath_ == RendererPath::Deferred41) {
+        glGenFramebuffers(1, &localLightFbo_);
+    }
+
     if (fullscreenVao_ == 0) {
         glGenVertexArrays(1, &fullscreenVao_);
     }
@@ -692,34 +1257,24 @@ void RenderEngine::destroyDeferredResources() {
         glDeleteFramebuffers(1, &lightFbo_);
         lightFbo_ = 0;
     }
-    if (gbufferAlbedo_ != 0) {
-        glDeleteTextures(1, &gbufferAlbedo_);
-        gbufferAlbedo_ = 0;
-    }
-    if (gbufferNormal_ != 0) {
-        glDeleteTextures(1, &gbufferNormal_);
-        gbufferNormal_ = 0;
-    }
-    if (gbufferDepthColor_ != 0) {
-        glDeleteTextures(1, &gbufferDepthColor_);
-        gbufferDepthColor_ = 0;
-    }
-    if (gbufferDepth_ != 0) {
-        glDeleteTextures(1, &gbufferDepth_);
-        gbufferDepth_ = 0;
-    }
-    if (lightColor_ != 0) {
-        glDeleteTextures(1, &lightColor_);
-        lightColor_ = 0;
+    if (localLightFbo_ != 0) {
+        glDeleteFramebuffers(1, &localLightFbo_);
+        localLightFbo_ = 0;
     }
+    // Back to the pool, which frees them unless a target of the same size is acquired soon.
+    renderTargets_.release(gbufferAlbedo_);
+    renderTargets_.release(gbufferNormal_);
+    renderTargets_.release(gbufferDepth_);
+    renderTargets_.release(lightColor_);
+    renderTargets_.release(shadowInfo_);
+    renderTargets_.release(lightDepth_);
+    renderTargets_.release(localLightColor_);
+    renderTargets_.release(localLightDepth_);
     if (lightsTboTex_ != 0) {
         glDeleteTextures(1, &lightsTboTex_);
         lightsTboTex_ = 0;
     }
-    if (lightsTbo_ != 0) {
-        glDeleteBuffers(1, &lightsTbo_);
-        lightsTbo_ = 0;
-    }
+    lightStreamRevision_ = 0;
     if (fullscreenVao_ != 0) {
         glDeleteVertexArrays(1, &fullscreenVao_);
         fullscreenVao_ = 0;
@@ -727,57 +1282,140 @@ void RenderEngine::destroyDeferredResources() {
 
     deferredWidth_ = 0;
     deferredHeight_ = 0;
-    lightTboSize_ = 0;
+}
+
+void RenderEngine::ensureOutputTarget() {
+    if (!options_.headless || !glContext_) {
+        return;
+    }
+    if (width_ <= 0 || height_ <= 0) {
+        return;
+    }
+    if (width_ == outputWidth_ && height_ == outputHeight_ && outputFbo_ != 0) {
+        return;
+    }
+
+    destroyOutputTarget();
+
+    outputWidth_ = width_;
+    outputHeight_ = height_;
+
+    glGenTextures(1, &outputColor_);
+    glBindTexture(GL_TEXTURE_2D, outputColor_);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width_, height_, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    glGenRenderbuffers(1, &outputDepth_);
+    glBindRenderbuffer(GL_RENDERBUFFER, outputDepth_);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width_, height_);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &outputFbo_);
+    glBindFramebuffer(GL_FRAMEBUFFER, outputFbo_);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, outputColor_, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, outputDepth_);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        spdlog::error("RenderEngine: output framebuffer is incomplete");
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void RenderEngine::destroyOutputTarget() {
+    if (!glContext_) {
+        return;
+    }
+    if (outputFbo_ != 0) {
+        glDeleteFramebuffers(1, &outputFbo_);
+        outputFbo_ = 0;
+    }
+    if (outputColor_ != 0) {
+        glDeleteTextures(1, &outputColor_);
+        outputColor_ = 0;
+    }
+    if (outputDepth_ != 0) {
+        glDeleteRenderbuffers(1, &outputDepth_);
+        outputDepth_ = 0;
+    }
+    outputWidth_ = 0;
+    outputHeight_ = 0;
 }
 
 void RenderEngine::renderDeferredScene() {
-    if (rendererPath_ != RendererPath::Deferred41) {
+    if (!isDeferredPath()) {
         return;
     }
     if (gbufferFbo_ == 0 || lightFbo_ == 0) {
         return;
     }
 
+    updateRenderScale();
+    beginPass(FramePass::LightUpdate);
+    shadowSystem_.setCasters(ShadowSystem::CasterIndex{&meshGrid_, &gridMeshes_, gridStaticCasters_, gridDynamicCasters_});
     updateLights();
+    endPass(FramePass::LightUpdate);
 
-    const glm::mat4 mvp = projection_ * view_;
-    const glm::vec3 dirLightWorld(-0.3f, -1.0f, -0.4f);
-    const glm::vec3 dirLightView = glm::normalize(glm::mat3(view_) * dirLightWorld);
+    const glm::vec3 dirLightView = glm::normalize(glm::mat3(view_) * kDirLightWorld);
     const glm::mat4 invView = glm::inverse(view_);
 
-    shadowSystem_.updateDirectional(view_, projection_, dirLightWorld, kNearPlane, kFarPlane);
+    shadowSystem_.setDirectional(frameCascades_);
     shadowDebugCascade_ = std::clamp(shadowDebugCascade_, 0, shadowSystem_.directionalCascadeCount() - 1);
-    shadowSystem_.renderDirectionalShadows({&ground_, &wallA_, &wallB_});
-    shadowSystem_.renderSpotShadows({&ground_, &wallA_, &wallB_});
-    shadowSystem_.renderPointShadows({&ground_, &wallA_, &wallB_});
-
+    beginPass(FramePass::ShadowDirectional);
+    shadowSystem_.renderDirectionalShadows();
+    endPass(FramePass::ShadowDirectional);
+    beginPass(FramePass::ShadowSpot);
+    shadowSystem_.renderSpotShadows();
+    endPass(FramePass::ShadowSpot);
+    beginPass(FramePass::ShadowPoint);
+    shadowSystem_.renderPointShadows();
+    endPass(FramePass::ShadowPoint);
+    writeFrameUniforms(invView, dirLightView);
+
+    beginPass(FramePass::GBuffer);
     glBindFramebuffer(GL_FRAMEBUFFER, gbufferFbo_);
-    glViewport(0, 0, width_, height_);
+    glViewport(0, 0, renderWidth_, renderHeight_);
     glEnable(GL_DEPTH_TEST);
     glDepthMask(GL_TRUE);
     glDisable(GL_BLEND);
     const GLfloat clearAlbedo[4] = {0.0f, 0.0f, 0.0f, 0.0f};
     const GLfloat clearNormal[4] = {0.0f, 0.0f, 0.0f, 0.0f};
-    const GLfloat clearDepth[4] = {1.0f, 0.0f, 0.0f, 0.0f};
     glClearBufferfv(GL_COLOR, 0, clearAlbedo);
     glClearBufferfv(GL_COLOR, 1, clearNormal);
-    glClearBufferfv(GL_COLOR, 2, clearDepth);
     glClearBufferfi(GL_DEPTH_STENCIL, 0, 1.0f, 0);
 
     deferredGeometryShader_.use();
-    glUniformMatrix4fv(gbufferMvpLocation_, 1, GL_FALSE, glm::value_ptr(mvp));
-    glUniformMatrix4fv(gbufferViewLocation_, 1, GL_FALSE, glm::value_ptr(view_));
     glUniform1f(gbufferMetallicLocation_, 0.0f);
     glUniform1f(gbufferRoughnessLocation_, 0.6f);
 
-    glDepthMask(GL_FALSE);
-    ground_.draw();
-    glDepthMask(GL_TRUE);
-    wallA_.draw();
-    wallB_.draw();
+    // The ground never occludes the walls, but lighting now reads its depth from the depth
+    // attachment: walls tag the stencil, then the ground fills the untagged pixels with depth on.
+    glEnable(GL_STENCIL_TEST);
+    glStencilMask(0xFF);
+    glStencilFunc(GL_ALWAYS, 1, 0xFF);
+    glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
+    const auto noMaterial = [](uint16_t) {};
+    const uint32_t sceneLayers = RenderQueue::layerBit(RenderLayer::Geometry) | RenderQueue::layerBit(RenderLayer::Actors);
+    renderQueue_.replay(RenderQueue::kOccluderPass, sceneLayers, [](RenderLayer) {}, noMaterial);
+    drawCulledGeometry(sceneLayers);
+    glStencilFunc(GL_NOTEQUAL, 1, 0xFF);
+    glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+    glDepthFunc(GL_ALWAYS);
+    // Ground tiles behind the walls only reach stencil-rejected pixels, so the Hi-Z cull drops them.
+    drawCulledGeometry(RenderQueue::layerBit(RenderLayer::Ground));
+    glDepthFunc(GL_LEQUAL);
+    glDisable(GL_STENCIL_TEST);
+    endPass(FramePass::GBuffer);
+
+    beginPass(FramePass::Occlusion);
+    buildDepthPyramid();
+    cullLightVolumes();
+    endPass(FramePass::Occlusion);
 
+    beginPass(FramePass::DirectionalLight);
     glBindFramebuffer(GL_FRAMEBUFFER, lightFbo_);
-    glViewport(0, 0, width_, height_);
+    glViewport(0, 0, renderWidth_, renderHeight_);
     glDisable(GL_DEPTH_TEST);
     glDepthMask(GL_FALSE);
     glDisable(GL_BLEND);
@@ -785,136 +1423,52 @@ void RenderEngine::renderDeferredScene() {
     glClear(GL_COLOR_BUFFER_BIT);
 
     deferredDirLightShader_.use();
-    glUniformMatrix4fv(deferredInvProjLocation_, 1, GL_FALSE, glm::value_ptr(invProjection_));
-    glUniform3fv(deferredDirLightDirLocation_, 1, glm::value_ptr(dirLightView));
-    glUniform3f(deferredDirLightColorLocation_, 1.0f, 1.0f, 1.0f);
-    glUniform1f(deferredDirLightIntensityLocation_, 0.7f);
-    glUniform3f(deferredAmbientLocation_, 0.06f, 0.06f, 0.07f);
-    glUniformMatrix4fv(
-        deferredShadowMatrixLocation_,
-        shadowSystem_.directionalCascadeCount(),
-        GL_FALSE,
-        glm::value_ptr(shadowSystem_.directionalMatrices().front())
-    );
-    glUniform1fv(
-        deferredCascadeSplitsLocation_,
-        shadowSystem_.directionalCascadeCount(),
-        shadowSystem_.directionalSplits().data()
-    );
-    glUniform1i(deferredCascadeCountLocation_, shadowSystem_.directionalCascadeCount());
-    glUniform2f(
-        deferredShadowTexelSizeLocation_,
-        shadowSystem_.directionalTexelSize().x,
-        shadowSystem_.directionalTexelSize().y
-    );
-    glUniform1f(deferredShadowBiasMinLocation_, shadowSystem_.directionalBiasMin());
-    glUniform1f(deferredShadowBiasSlopeLocation_, shadowSystem_.directionalBiasSlope());
-    glUniform1i(deferredShadowPcfRadiusLocation_, shadowSystem_.directionalPcfRadius());
-
     glActiveTexture(GL_TEXTURE0 + 0);
     glBindTexture(GL_TEXTURE_2D, gbufferAlbedo_);
     glActiveTexture(GL_TEXTURE0 + 1);
     glBindTexture(GL_TEXTURE_2D, gbufferNormal_);
     glActiveTexture(GL_TEXTURE0 + 2);
-    glBindTexture(GL_TEXTURE_2D, gbufferDepthColor_);
+    glBindTexture(GL_TEXTURE_2D, gbufferDepth_);
     glActiveTexture(GL_TEXTURE0 + 3);
     glBindTexture(GL_TEXTURE_2D_ARRAY, shadowSystem_.directionalShadowMap());
 
+    // The shadow factor target is only filled for the views that read it.
+    const GLenum dirLightBuffers[2] = {
+        GL_COLOR_ATTACHMENT0,
+        static_cast<GLenum>(shadowInfoNeeded() ? GL_COLOR_ATTACHMENT1 : GL_NONE),
+    };
+    if (shadowInfoNeeded()) {
+        shadowInfo_ = renderTargets_.acquire({GL_RG8, deferredWidth_, deferredHeight_});
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, shadowInfo_, 0);
+    }
+    glDrawBuffers(2, dirLightBuffers);
     glBindVertexArray(fullscreenVao_);
     glDrawArrays(GL_TRIANGLES, 0, 3);
     glBindVertexArray(0);
+    glDrawBuffer(GL_COLOR_ATTACHMENT0);
+    if (shadowInfo_ != 0) {
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, 0, 0);
+    }
+    endPass(FramePass::DirectionalLight);
 
-    if (lightCount_ > 0) {
-        glEnable(GL_DEPTH_TEST);
-        glDepthMask(GL_FALSE);
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_ONE, GL_ONE);
-        glEnable(GL_CULL_FACE);
-        glCullFace(cameraInsideLightVolume_ ? GL_FRONT : GL_BACK);
-
-        deferredVolumeShader_.use();
-        glUniformMatrix4fv(volumeProjLocation_, 1, GL_FALSE, glm::value_ptr(projection_));
-        glUniformMatrix4fv(volumeInvProjLocation_, 1, GL_FALSE, glm::value_ptr(invProjection_));
-        glUniform2f(volumeScreenSizeLocation_, static_cast<float>(width_), static_cast<float>(height_));
-        glUniformMatrix4fv(volumeInvViewLocation_, 1, GL_FALSE, glm::value_ptr(invView));
-        glUniformMatrix4fv(
-            volumeSpotShadowMatrixLocation_,
-            shadowSystem_.spotShadowCount(),
-            GL_FALSE,
-            glm::value_ptr(shadowSystem_.spotShadowMatrices().front())
-        );
-        glUniform1i(volumeSpotShadowCountLocation_, shadowSystem_.spotShadowCount());
-        glUniform2f(
-            volumeSpotShadowTexelSizeLocation_,
-            shadowSystem_.spotTexelSize().x,
-            shadowSystem_.spotTexelSize().y
-        );
-        glUniform1i(volumeSpotShadowPcfRadiusLocation_, shadowSystem_.spotPcfRadius());
-        glUniform1i(volumePointShadowCountLocation_, shadowSystem_.pointShadowCount());
-        glUniform1f(volumePointShadowDiskRadiusLocation_, shadowSystem_.pointShadowDiskRadius());
-        glUniform1i(volumePointShadowPcfRadiusLocation_, shadowSystem_.pointPcfRadius());
-
-        glActiveTexture(GL_TEXTURE0 + 0);
-        glBindTexture(GL_TEXTURE_2D, gbufferAlbedo_);
-        glActiveTexture(GL_TEXTURE0 + 1);
-        glBindTexture(GL_TEXTURE_2D, gbufferNormal_);
-        glActiveTexture(GL_TEXTURE0 + 2);
-        glBindTexture(GL_TEXTURE_2D, gbufferDepthColor_);
-        glActiveTexture(GL_TEXTURE0 + 3);
-        glBindTexture(GL_TEXTURE_BUFFER, lightsTboTex_);
-        glActiveTexture(GL_TEXTURE0 + 4);
-        glBindTexture(GL_TEXTURE_2D_ARRAY, shadowSystem_.spotShadowMap());
-        glActiveTexture(GL_TEXTURE0 + 5);
-        glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, shadowSystem_.pointShadowMap());
-
-        if (pointLightCount_ > 0) {
-            glUniform1i(volumeIsSpotLocation_, 0);
-            glUniform1i(volumeLightOffsetLocation_, 0);
-            lightSphere_.drawInstanced(pointLightCount_);
-        }
-        if (spotLightCount_ > 0) {
-            glUniform1i(volumeIsSpotLocation_, 1);
-            glUniform1i(volumeLightOffsetLocation_, pointLightCount_);
-            lightCone_.drawInstanced(spotLightCount_);
-        }
-
-        glDisable(GL_BLEND);
-        glDepthMask(GL_TRUE);
-        glCullFace(GL_BACK);
+    if (rendererPath_ == RendererPath::Tiled43) {
+        beginPass(FramePass::TiledLighting);
+        renderTiledLighting();
+        endPass(FramePass::TiledLighting);
+    } else {
+        beginPass(FramePass::LightVolumes);
+        renderLightVolumes();
+        endPass(FramePass::LightVolumes);
     }
 
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    beginPass(FramePass::Composite);
+    glBindFramebuffer(GL_FRAMEBUFFER, outputFramebuffer());
     glViewport(0, 0, width_, height_);
     glDisable(GL_DEPTH_TEST);
     glDepthMask(GL_FALSE);
     glDisable(GL_BLEND);
 
-    deferredCompositeShader_.use();
-    glUniform1i(compositeDebugModeLocation_, static_cast<int>(debugView_));
-    glUniformMatrix4fv(
-        compositeShadowMatrixLocation_,
-        shadowSystem_.directionalCascadeCount(),
-        GL_FALSE,
-        glm::value_ptr(shadowSystem_.directionalMatrices().front())
-    );
-    glUniform1fv(
-        compositeCascadeSplitsLocation_,
-        shadowSystem_.directionalCascadeCount(),
-        shadowSystem_.directionalSplits().data()
-    );
-    glUniform1i(compositeCascadeCountLocation_, shadowSystem_.directionalCascadeCount());
-    glUniform2f(
-        compositeShadowTexelSizeLocation_,
-        shadowSystem_.directionalTexelSize().x,
-        shadowSystem_.directionalTexelSize().y
-    );
-    glUniform1i(compositeShadowPcfRadiusLocation_, shadowSystem_.directionalPcfRadius());
-    glUniformMatrix4fv(compositeInvProjLocation_, 1, GL_FALSE, glm::value_ptr(invProjection_));
-    glUniform3fv(compositeDirLightDirLocation_, 1, glm::value_ptr(dirLightView));
-    glUniform1f(compositeShadowBiasMinLocation_, shadowSystem_.directionalBiasMin());
-    glUniform1f(compositeShadowBiasSlopeLocation_, shadowSystem_.directionalBiasSlope());
-    glUniform1i(compositeShadowDebugCascadeLocation_, shadowDebugCascade_);
-
+    compositeShader().use();
     glActiveTexture(GL_TEXTURE0 + 0);
     glBindTexture(GL_TEXTURE_2D, lightColor_);
     glActiveTexture(GL_TEXTURE0 + 1);
@@ -922,19 +1476,417 @@ void RenderEngine::renderDeferredScene() {
     glActiveTexture(GL_TEXTURE0 + 2);
     glBindTexture(GL_TEXTURE_2D, gbufferNormal_);
     glActiveTexture(GL_TEXTURE0 + 3);
-    glBindTexture(GL_TEXTURE_2D, gbufferDepthColor_);
-    glActiveTexture(GL_TEXTURE0 + 4);
-    glBindTexture(GL_TEXTURE_2D_ARRAY, shadowSystem_.directionalShadowMap());
+    glBindTexture(GL_TEXTURE_2D, gbufferDepth_);
+    if (shadowInfoNeeded()) {
+        glActiveTexture(GL_TEXTURE0 + 4);
+        glBindTexture(GL_TEXTURE_2D, shadowInfo_);
+    }
+    if (debugView_ == DebugView::ShadowMap) {
+        glActiveTexture(GL_TEXTURE0 + 7);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, shadowSystem_.directionalShadowMap());
+        glBindSampler(7, shadowSystem_.directionalDepthSampler());
+    }
+    if (halfResLocalLights()) {
+        glActiveTexture(GL_TEXTURE0 + 5);
+        glBindTexture(GL_TEXTURE_2D, localLightColor_);
+        glActiveTexture(GL_TEXTURE0 + 6);
+        glBindTexture(GL_TEXTURE_2D, localLightDepth_);
+    }
 
     glBindVertexArray(fullscreenVao_);
     glDrawArrays(GL_TRIANGLES, 0, 3);
     glBindVertexArray(0);
+    glBindSampler(7, 0);
+    endPass(FramePass::Composite);
+    releaseTransientTargets();
+
+    lightStream_.endFrame();
+    uniformStream_.endFrame();
+    glDepthMask(GL_TRUE);
+}
+
+void RenderEngine::releaseTransientTargets() {
+    if (lightDepth_ != 0) {
+        glBindFramebuffer(GL_FRAMEBUFFER, lightFbo_);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, 0, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, outputFramebuffer());
+    }
+    if (localLightColor_ != 0) {
+        // Detached so the pool can actually free them once they go idle.
+        glBindFramebuffer(GL_FRAMEBUFFER, localLightFbo_);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, 0, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, outputFramebuffer());
+    }
+    renderTargets_.release(localLightColor_);
+    renderTargets_.release(localLightDepth_);
+    renderTargets_.release(lightDepth_);
+    renderTargets_.release(shadowInfo_);
+    renderTargets_.endFrame();
+}
+
+void RenderEngine::updateRenderScale() {
+    if (options_.dynamicResolution) {
+        resolutionScaler_.update(profiler_.latestFrameGpuMs());
+    }
+    renderScale_ = options_.dynamicResolution ? resolutionScaler_.scale() : 1.0f;
+    // Projection is unchanged, so the region keeps the output's aspect ratio up to rounding.
+    renderWidth_ = std::clamp(static_cast<int>(std::lround(static_cast<float>(width_) * renderScale_)), 1, deferredWidth_);
+    renderHeight_ = std::clamp(static_cast<int>(std::lround(static_cast<float>(height_) * renderScale_)), 1, deferredHeight_);
+}
+
+void RenderEngine::writeFrameUniforms(const glm::mat4& invView, const glm::vec3& dirLightView) {
+    constexpr GLsizeiptr kFrameSize = sizeof(FrameUniforms);
+    constexpr GLsizeiptr kShadowSize = sizeof(ShadowUniforms);
+    // The second block starts on GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, which is at most 256 bytes.
+    constexpr GLsizeiptr kRegionSize = kFrameSize + kShadowSize + 256;
+    if (uniformStream_.id() == 0 && !uniformStream_.init(GL_UNIFORM_BUFFER, kRegionSize, gl_)) {
+        spdlog::error("RenderEngine: failed to create the frame uniform buffer");
+        return;
+    }
+
+    FrameUniforms frame{};
+    frame.view = view_;
+    frame.proj = projection_;
+    frame.viewProj = projection_ * view_;
+    frame.invProj = invProjection_;
+    frame.invView = invView;
+    frame.dirLightDir = dirLightView;
+    frame.dirLightIntensity = 0.7f;
+    frame.dirLightColor = glm::vec3(1.0f, 1.0f, 1.0f);
+    frame.lightTexelOffset = lightTexelOffset_;
+    frame.ambient = glm::vec3(0.06f, 0.06f, 0.07f);
+    frame.lightCount = lightCount_;
+    frame.screenSize = glm::vec2(static_cast<float>(renderWidth_), static_cast<float>(renderHeight_));
+    frame.debugMode = static_cast<int32_t>(debugView_);
+    frame.shadowDebugCascade = shadowDebugCascade_;
+    const glm::vec2 targetSize(static_cast<float>(deferredWidth_), static_cast<float>(deferredHeight_));
+    frame.uvScale = frame.screenSize / targetSize;
+    frame.uvMax = (frame.screenSize - 0.5f) / targetSize;
+
+    ShadowUniforms shadow{};
+    const int cascadeCount = shadowSystem_.directionalCascadeCount();
+    for (int i = 0; i < cascadeCount; ++i) {
+        shadow.cascadeMatrices[i] = shadowSystem_.directionalMatrices()[static_cast<size_t>(i)];
+        shadow.cascadeSplits[i] = shadowSystem_.directionalSplits()[static_cast<size_t>(i)];
+    }
+    std::copy_n(shadowSystem_.spotShadowMatrices().begin(), shadowSystem_.spotShadowCount(), shadow.spotMatrices);
+    std::copy_n(shadowSystem_.spotShadowRects().begin(), shadowSystem_.spotShadowCount(), shadow.spotRects);
+    std::copy_n(shadowSystem_.pointShadowLights().begin(), shadowSystem_.pointShadowCount(), shadow.pointLights);
+    shadow.cascadeTexelSize = shadowSystem_.directionalTexelSize();
+    shadow.cascadeBiasMin = shadowSystem_.directionalBiasMin();
+    shadow.cascadeBiasSlope = shadowSystem_.directionalBiasSlope();
+    shadow.spotTexelSize = shadowSystem_.spotTexelSize();
+    shadow.pointDiskRadius = shadowSystem_.pointShadowDiskRadius();
+    shadow.cascadeCount = cascadeCount;
+    shadow.cascadePcfRadius = shadowSystem_.directionalPcfRadius();
+    shadow.spotCount = shadowSystem_.spotShadowCount();
+    shadow.spotPcfRadius = shadowSystem_.spotPcfRadius();
+    shadow.pointCount = shadowSystem_.pointShadowCount();
+    shadow.pointPcfRadius = shadowSystem_.pointPcfRadius();
+    shadow.filter = static_cast<int32_t>(shadowSystem_.filter());
+
+    // Built on the stack and copied whole: the mapped range may be write-combined.
+    uniformStream_.beginFrame();
+    GLintptr frameOffset = 0;
+    void* frameDst = uniformStream_.map(kFrameSize, frameOffset);
+    if (frameDst) {
+        std::memcpy(frameDst, &frame, sizeof(frame));
+    }
+    GLintptr shadowOffset = 0;
+    void* shadowDst = uniformStream_.map(kShadowSize, shadowOffset);
+    if (shadowDst) {
+        std::memcpy(shadowDst, &shadow, sizeof(shadow));
+    }
+    uniformStream_.unmap();
+    if (!frameDst || !shadowDst) {
+        return;
+    }
+    uniformStream_.bindRange(kFrameUniformBinding, frameOffset, kFrameSize);
+    uniformStream_.bindRange(kShadowUniformBinding, shadowOffset, kShadowSize);
+}
+
+void RenderEngine::beginHalfResLocalLights() {
+    // Sized from the allocation rather than this frame's region, so dynamic resolution keeps
+    // getting the same pooled targets back.
+    const int localWidth = (deferredWidth_ + 1) / 2;
+    const int localHeight = (deferredHeight_ + 1) / 2;
+    localLightColor_ = renderTargets_.acquire({GL_RGBA16F, localWidth, localHeight});
+    // Stencil is kept for the stencil-masked volume path.
+    localLightDepth_ = renderTargets_.acquire({GL_DEPTH24_STENCIL8, localWidth, localHeight});
+    glBindFramebuffer(GL_FRAMEBUFFER, localLightFbo_);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, localLightColor_, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, localLightDepth_, 0);
+    glDrawBuffer(GL_COLOR_ATTACHMENT0);
+    glViewport(0, 0, (renderWidth_ + 1) / 2, (renderHeight_ + 1) / 2);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
 
+    depthDownsampleShader_.use();
+    glActiveTexture(GL_TEXTURE0 + 2);
+    glBindTexture(GL_TEXTURE_2D, gbufferDepth_);
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_ALWAYS);
     glDepthMask(GL_TRUE);
+    glBindVertexArray(fullscreenVao_);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+    glDepthFunc(GL_LEQUAL);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+}
+
+void RenderEngine::attachLightDepth() {
+    lightDepth_ = renderTargets_.acquire({GL_DEPTH24_STENCIL8, deferredWidth_, deferredHeight_});
+    glBindFramebuffer(GL_FRAMEBUFFER, lightFbo_);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, lightDepth_, 0);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, gbufferFbo_);
+    glBlitFramebuffer(
+        0,
+        0,
+        renderWidth_,
+        renderHeight_,
+        0,
+        0,
+        renderWidth_,
+        renderHeight_,
+        GL_DEPTH_BUFFER_BIT,
+        GL_NEAREST
+    );
+    glBindFramebuffer(GL_FRAMEBUFFER, lightFbo_);
+}
+
+void RenderEngine::renderLightVolumes() {
+    // Cleared even without lights: the composite pass reads the target every frame.
+    if (halfResLocalLights()) {
+        beginHalfResLocalLights();
+    }
+    if (lightCount_ <= 0) {
+        return;
+    }
+    if (!halfResLocalLights()) {
+        attachLightDepth();
+    }
+
+    glActiveTexture(GL_TEXTURE0 + 0);
+    glBindTexture(GL_TEXTURE_2D, gbufferAlbedo_);
+    glActiveTexture(GL_TEXTURE0 + 1);
+    glBindTexture(GL_TEXTURE_2D, gbufferNormal_);
+    glActiveTexture(GL_TEXTURE0 + 2);
+    glBindTexture(GL_TEXTURE_2D, gbufferDepth_);
+    glActiveTexture(GL_TEXTURE0 + 3);
+    glBindTexture(GL_TEXTURE_BUFFER, lightsTboTex_);
+    glActiveTexture(GL_TEXTURE0 + 4);
+    glBindTexture(GL_TEXTURE_2D, shadowSystem_.spotShadowMap());
+    glActiveTexture(GL_TEXTURE0 + 5);
+    glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, shadowSystem_.pointShadowMap());
+    glActiveTexture(GL_TEXTURE0 + 6);
+    glBindTexture(GL_TEXTURE_BUFFER, lightVolumesCulled_ ? occlusionCuller_.visibleLightTexture() : 0);
+
+    glEnable(GL_DEPTH_TEST);
+    glDepthMask(GL_FALSE);
+    glBlendFunc(GL_ONE, GL_ONE);
+    if (options_.stencilLightVolumes && volumeStencilShader_.id() != 0) {
+        drawStencilLightVolumes();
+    } else {
+        drawLightVolumeGroups();
+    }
+
+    glDisable(GL_BLEND);
+    glDepthMask(GL_TRUE);
+    glDepthFunc(GL_LEQUAL);
+    glCullFace(GL_BACK);
+}
+
+void RenderEngine::drawLightVolumeGroups() {
+    glEnable(GL_BLEND);
+    glEnable(GL_CULL_FACE);
+    for (const LightBatch& batch : lightBatches_) {
+        const VolumeProgram& volume = volumeProgram(batch.spot, batch.shadowed);
+        if (batch.count <= 0 || volume.program == nullptr) {
+            continue;
+        }
+        if (batch.inside) {
+            // Volumes crossing the near plane lose their front faces, so use back faces lying behind
+            // the geometry.
+            glCullFace(GL_FRONT);
+            glDepthFunc(GL_GEQUAL);
+        } else {
+            // Front faces in front of the geometry bound the lit pixels of volumes clear of the near plane.
+            glCullFace(GL_BACK);
+            glDepthFunc(GL_LEQUAL);
+        }
+        const MeshBuffer& mesh = batch.spot ? lightCone_ : lightSphere_;
+        volume.program->use();
+        glUniform1i(volume.lightOffsetLocation, batch.first);
+        if (lightVolumesCulled_ && batch.cullGroup >= 0) {
+            // The culler wrote this batch's instance count and visible-light list on the GPU.
+            glUniform1i(volume.useVisibleLightsLocation, 1);
+            mesh.pool()->drawIndirect(
+                occlusionCuller_.lightCommandBuffer(),
+                static_cast<GLintptr>(batch.cullGroup) * static_cast<GLintptr>(sizeof(MeshPool::DrawCommand)),
+                1
+            );
+            glUniform1i(volume.useVisibleLightsLocation, 0);
+            continue;
+        }
+        mesh.drawInstanced(batch.count);
+    }
+}
+
+void RenderEngine::drawCulledGeometry(uint32_t layerMask) {
+    const auto noMaterial = [](uint16_t) {};
+    meshCandidates_.clear();
+    for (size_t i = 0; i < renderQueue_.size(); ++i) {
+        const RenderQueue::DrawItem& item = renderQueue_.sortedItem(i);
+        if ((item.passMask & RenderQueue::kGBufferPass) == 0 ||
+            (RenderQueue::layerBit(item.layer) & layerMask) == 0 ||
+            !item.mesh->valid() ||
+            item.mesh->pool() != &meshPool_) {
+            continue;
+        }
+        meshCandidates_.push_back({item.mesh->bounds(), MeshPool::command(item.mesh->allocation())});
+    }
+    // The pyramid holds the previous frame's finished depth, which only stands in for this one's
+    // while nothing that shaped it changed.
+    const glm::mat4 viewProj = projection_ * view_;
+    const bool pyramidMatches = hiZValid_ && hiZViewProj_ == viewProj && hiZWidth_ == renderWidth_ &&
+                                hiZHeight_ == renderHeight_ && hiZSceneRevision_ == sceneStreamer_.revision();
+    if (!occlusionCuller_.ready() || meshCandidates_.empty() || !pyramidMatches) {
+        renderQueue_.replay(RenderQueue::kGBufferPass, layerMask, [](RenderLayer) {}, noMaterial);
+        return;
+    }
+
+    const GLsizei drawCount = occlusionCuller_.cullMeshes(meshCandidates_, viewProj);
+    deferredGeometryShader_.use();
+    meshPool_.drawIndirect(occlusionCuller_.meshCommandBuffer(), 0, drawCount);
+}
+
+void RenderEngine::buildDepthPyramid() {
+    hiZValid_ = false;
+    if (!occlusionCuller_.ready()) {
+        return;
+    }
+    occlusionCuller_.buildPyramid(gbufferDepth_, renderWidth_, renderHeight_);
+    hiZValid_ = true;
+    hiZViewProj_ = projection_ * view_;
+    hiZWidth_ = renderWidth_;
+    hiZHeight_ = renderHeight_;
+    hiZSceneRevision_ = sceneStreamer_.revision();
+}
+
+void RenderEngine::cullLightVolumes() {
+    lightVolumesCulled_ = false;
+    const bool stencilVolumes = options_.stencilLightVolumes && volumeStencilShader_.id() != 0;
+    if (!occlusionCuller_.ready() || rendererPath_ != RendererPath::Deferred41 || stencilVolumes ||
+        lightCount_ <= 0 || !lightSphere_.valid() || !lightCone_.valid()) {
+        return;
+    }
+    std::array<OcclusionCuller::LightGroup, OcclusionCuller::kMaxLightGroups> groups{};
+    int groupCount = 0;
+    for (const LightBatch& batch : lightBatches_) {
+        if (batch.cullGroup < 0) {
+            continue;
+        }
+        const MeshBuffer& mesh = batch.spot ? lightCone_ : lightSphere_;
+        groups[static_cast<size_t>(batch.cullGroup)] = {batch.first, batch.count, batch.spot, MeshPool::command(mesh.allocation(), 0)};
+        groupCount = std::max(groupCount, batch.cullGroup + 1);
+    }
+    occlusionCuller_.cullLights(
+        groups.data(),
+        groupCount,
+        lightsTboTex_,
+        lightTexelOffset_,
+        projection_,
+        lightCount_
+    );
+    lightVolumesCulled_ = true;
+}
+
+void RenderEngine::drawStencilLightVolumes() {
+    volumeStencilShader_.use();
+
+    // Marks go to the volume target's own depth (lightDepth_ or localLightDepth_), never to the
+    // gbufferDepth_ the shading pass samples; every light leaves the stencil at zero again.
+    glEnable(GL_STENCIL_TEST);
+    glStencilMask(0xFF);
+    glClear(GL_STENCIL_BUFFER_BIT);
+
+    auto drawLight = [this](const MeshBuffer& mesh, const VolumeProgram& volume, int isSpot, int lightIndex) {
+        // Mark (z-fail): faces behind the geometry count back +1 / front -1, so only pixels whose
+        // geometry lies inside the volume end non-zero. Works with the camera inside the volume.
+        volumeStencilShader_.use();
+        glUniform1i(volumeStencilIsSpotLocation_, isSpot);
+        glUniform1i(volumeStencilLightOffsetLocation_, lightIndex);
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        glDisable(GL_BLEND);
+        glDisable(GL_CULL_FACE);
+        glEnable(GL_DEPTH_TEST);
+        glStencilFunc(GL_ALWAYS, 0, 0xFF);
+        glStencilOpSeparate(GL_BACK, GL_KEEP, GL_INCR_WRAP, GL_KEEP);
+        glStencilOpSeparate(GL_FRONT, GL_KEEP, GL_DECR_WRAP, GL_KEEP);
+        mesh.drawInstanced(1);
+
+        // Shade: back faces cover the whole footprint; passing pixels reset their mark.
+        volume.program->use();
+        glUniform1i(volume.lightOffsetLocation, lightIndex);
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        glEnable(GL_BLEND);
+        glEnable(GL_CULL_FACE);
+        glCullFace(GL_FRONT);
+        glDisable(GL_DEPTH_TEST);
+        glStencilFunc(GL_NOTEQUAL, 0, 0xFF);
+        glStencilOp(GL_KEEP, GL_KEEP, GL_ZERO);
+        mesh.drawInstanced(1);
+    };
+    for (const LightBatch& batch : lightBatches_) {
+        const VolumeProgram& volume = volumeProgram(batch.spot, batch.shadowed);
+        if (volume.program == nullptr) {
+            continue;
+        }
+        for (int i = 0; i < batch.count; ++i) {
+            drawLight(batch.spot ? lightCone_ : lightSphere_, volume, batch.spot ? 1 : 0, batch.first + i);
+        }
+    }
+
+    glStencilFunc(GL_ALWAYS, 0, 0xFF);
+    glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+    glDisable(GL_STENCIL_TEST);
+    glEnable(GL_DEPTH_TEST);
+}
+
+void RenderEngine::renderTiledLighting() {
+    if (lightCount_ <= 0 || tiledLightingShader_.id() == 0) {
+        return;
+    }
+
+    tiledLightingShader_.use();
+    glActiveTexture(GL_TEXTURE0 + 0);
+    glBindTexture(GL_TEXTURE_2D, gbufferAlbedo_);
+    glActiveTexture(GL_TEXTURE0 + 1);
+    glBindTexture(GL_TEXTURE_2D, gbufferNormal_);
+    glActiveTexture(GL_TEXTURE0 + 2);
+    glBindTexture(GL_TEXTURE_2D, gbufferDepth_);
+    glActiveTexture(GL_TEXTURE0 + 3);
+    glBindTexture(GL_TEXTURE_BUFFER, lightsTboTex_);
+    glActiveTexture(GL_TEXTURE0 + 4);
+    glBindTexture(GL_TEXTURE_2D, shadowSystem_.spotShadowMap());
+    glActiveTexture(GL_TEXTURE0 + 5);
+    glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, shadowSystem_.pointShadowMap());
+    gl_.bindImageTexture(0, lightColor_, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA16F);
+
+    const GLuint groupsX = static_cast<GLuint>((renderWidth_ + kLightTileSize - 1) / kLightTileSize);
+    const GLuint groupsY = static_cast<GLuint>((renderHeight_ + kLightTileSize - 1) / kLightTileSize);
+    gl_.dispatchCompute(groupsX, groupsY, 1);
+
+    // The composite pass samples the light target as a texture.
+    gl_.memoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    gl_.bindImageTexture(0, 0, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA16F);
 }
 
 void RenderEngine::renderSimpleScene() {
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    beginPass(FramePass::Forward);
+    glBindFramebuffer(GL_FRAMEBUFFER, outputFramebuffer());
     glViewport(0, 0, width_, height_);
     glDepthMask(GL_TRUE);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -944,26 +1896,62 @@ void RenderEngine::renderSimpleScene() {
     glUniformMatrix4fv(simpleMvpLocation_, 1, GL_FALSE, glm::value_ptr(mvp));
     glUniform3f(simpleLightDirLocation_, -0.3f, -1.0f, -0.4f);
 
-    drawLayer(RenderLayer::Ground, {&ground_});
-    drawLayer(RenderLayer::Geometry, {&wallA_, &wallB_});
-    drawLayer(RenderLayer::Actors, {});
+    renderQueue_.replay(
+        RenderQueue::kForwardPass,
+        RenderQueue::kAllLayers,
+        [](RenderLayer layer) {
+            // Ground doesn't write depth so vertical geometry isn't occluded in isometric view.
+            glDepthMask(layer == RenderLayer::Ground ? GL_FALSE : GL_TRUE);
+        },
+        [](uint16_t) {}
+    );
+    glDepthMask(GL_TRUE);
+    endPass(FramePass::Forward);
 }
 
 void RenderEngine::renderScene() {
     if (!sceneReady_) {
         return;
     }
-    if (rendererPath_ == RendererPath::Deferred41) {
+    profiler_.beginFrame();
+    meshPool_.beginFrame();
+    acquireFrameSnapshot();
+    if (isDeferredPath()) {
         renderDeferredScene();
     } else {
         renderSimpleScene();
     }
+    meshPool_.endFrame();
+    glBindFramebuffer(GL_FRAMEBUFFER, outputFramebuffer());
+    glViewport(0, 0, width_, height_);
+    profiler_.drawOverlay(width_, height_);
+    profiler_.endFrame();
 }
 
 void RenderEngine::buildScene() {
     bool shadersReady = false;
     bool volumeReady = true;
     const std::string shaderRoot = shaderRootPath();
+    const uint64_t shaderStart = SDL_GetPerformanceCounter();
+    shaderCache_.init(gl_, options_.shaderCache ? shaderCachePath() : std::string{});
+    ShaderProgram::setCache(&shaderCache_);
+
+    // A scene file is stored in one layout, so it decides the pool's.
+    VertexLayout::Format format = options_.compactVertices ? VertexLayout::Format::Compact : VertexLayout::Format::Standard;
+    if (!sceneConfig_.path.empty()) {
+        SceneAsset probe;
+        if (probe.open(sceneConfig_.path)) {
+            format = probe.vertexFormat();
+        }
+    }
+    if (!meshPool_.init(gl_, VertexLayout::forFormat(format), kMeshPoolVertices, kMeshPoolIndices)) {
+        spdlog::error("RenderEngine: failed to create mesh pool");
+        sceneReady_ = false;
+        return;
+    }
+    if (meshPool_.multiDrawIndirect()) {
+        spdlog::info("RenderEngine: mesh pool submits batches with multi-draw indirect");
+    }
 
     if (rendererPath_ == RendererPath::SimpleForward) {
         const std::string simpleVertexShader = shaderRoot + "simple.vert";
@@ -975,171 +1963,368 @@ void RenderEngine::buildScene() {
             return;
         }
 
-        simpleMvpLocation_ = simpleShader_.uniformLocation("uMVP");
-        simpleLightDirLocation_ = simpleShader_.uniformLocation("uLightDir");
+        bindShaderUniforms();
         shadersReady = simpleShader_.id() != 0;
-    } else if (rendererPath_ == RendererPath::Deferred41) {
+    } else if (isDeferredPath()) {
         const std::string gbufferVertexShader = shaderRoot + "deferred_gbuffer.vert";
         const std::string gbufferFragmentShader = shaderRoot + "deferred_gbuffer.frag";
         const std::string fullscreenVertexShader = shaderRoot + "fullscreen_tri.vert";
         const std::string dirLightFragmentShader = shaderRoot + "deferred_dir_light.frag";
         const std::string volumeVertexShader = shaderRoot + "deferred_volume.vert";
         const std::string volumeFragmentShader = shaderRoot + "deferred_volume.frag";
+        const std::string volumeStencilFragmentShader = shaderRoot + "deferred_volume_stencil.frag";
         const std::string compositeFragmentShader = shaderRoot + "deferred_composite.frag";
+        const std::string tiledComputeShader = shaderRoot + "deferred_tiled.comp";
+        const std::string depthDownsampleFragmentShader = shaderRoot + "deferred_depth_downsample.frag";
+
+        // The volume permutation keys carry the shadow filter, so it is set before they start.
+        shadowSystem_.setFilter(options_.shadowFilter);
+        shadowSystem_.setCascadeSchedule(options_.cascadeSchedule);
+        shadowSystem_.setCascadeFit(options_.cascadeFit);
+        shadowSystem_.setStaticCascadeCache(options_.staticCascadeCache);
+        shadowSystem_.setDirectionalResolution(options_.directionalShadowSize);
+
+        // Every lighting program is submitted before any link status is read, so a driver with
+        // parallel compilation builds them while the shadow system and culler build theirs.
+        deferredGeometryShader_.startFromFiles(gbufferVertexShader, gbufferFragmentShader);
+        deferredDirLightShader_.startFromFiles(fullscreenVertexShader, dirLightFragmentShader);
+        volumePermutations_.setSources(volumeVertexShader, volumeFragmentShader);
+        for (const bool spot : {false, true}) {
+            volumePermutations_.start(volumeKey(spot, true));
+            volumePermutations_.start(volumeKey(spot, false));
+        }
+        if (options_.stencilLightVolumes) {
+            volumeStencilShader_.startFromFiles(volumeVertexShader, volumeStencilFragmentShader);
+        }
+        deferredCompositeShaders_[0].setDefines("#define DEBUG_VIEW 0\n");
+        deferredCompositeShaders_[0].startFromFiles(fullscreenVertexShader, compositeFragmentShader);
+        if (options_.halfResLightVolumes) {
+            depthDownsampleShader_.startFromFiles(fullscreenVertexShader, depthDownsampleFragmentShader);
+        }
+        if (rendererPath_ == RendererPath::Tiled43) {
+            tiledLightingShader_.startComputeFromFile(tiledComputeShader);
+        }
 
-        if (!deferredGeometryShader_.buildFromFiles(gbufferVertexShader, gbufferFragmentShader)) {
+        if (!shadowSystem_.init(shaderRoot, options_.layeredShadows)) {
+            spdlog::error("RenderEngine: failed to init shadow system");
+            sceneReady_ = false;
+            return;
+        }
+        if (options_.occlusionCulling && occlusionCuller_.init(gl_, shaderRoot)) {
+            spdlog::info("RenderEngine: Hi-Z occlusion culling enabled");
+        }
+
+        if (!deferredGeometryShader_.finish()) {
             spdlog::error("RenderEngine: failed to build deferred geometry shaders");
             sceneReady_ = false;
             return;
         }
 
-        if (!deferredDirLightShader_.buildFromFiles(fullscreenVertexShader, dirLightFragmentShader)) {
+        if (!deferredDirLightShader_.finish()) {
             spdlog::error("RenderEngine: failed to build deferred directional shader");
             sceneReady_ = false;
             return;
         }
 
-        if (!deferredVolumeShader_.buildFromFiles(volumeVertexShader, volumeFragmentShader)) {
+        if (!volumePermutations_.finish()) {
             spdlog::error("RenderEngine: failed to build deferred volume shaders");
             sceneReady_ = false;
             return;
         }
 
-        if (!deferredCompositeShader_.buildFromFiles(fullscreenVertexShader, compositeFragmentShader)) {
+        if (options_.stencilLightVolumes && !volumeStencilShader_.finish()) {
+            spdlog::warn("RenderEngine: light volume stencil shader unavailable, drawing unmasked volumes");
+        }
+
+        if (!deferredCompositeShaders_[0].finish()) {
             spdlog::error("RenderEngine: failed to build deferred composite shader");
             sceneReady_ = false;
             return;
         }
 
-        gbufferMvpLocation_ = deferredGeometryShader_.uniformLocation("uMVP");
-        gbufferViewLocation_ = deferredGeometryShader_.uniformLocation("uView");
-        gbufferMetallicLocation_ = deferredGeometryShader_.uniformLocation("uMetallic");
-        gbufferRoughnessLocation_ = deferredGeometryShader_.uniformLocation("uRoughness");
-        deferredInvProjLocation_ = deferredDirLightShader_.uniformLocation("uInvProj");
-        deferredDirLightDirLocation_ = deferredDirLightShader_.uniformLocation("uDirLightDir");
-        deferredDirLightColorLocation_ = deferredDirLightShader_.uniformLocation("uDirLightColor");
-        deferredDirLightIntensityLocation_ = deferredDirLightShader_.uniformLocation("uDirLightIntensity");
-        deferredAmbientLocation_ = deferredDirLightShader_.uniformLocation("uAmbient");
-        volumeProjLocation_ = deferredVolumeShader_.uniformLocation("uProj");
-        volumeInvProjLocation_ = deferredVolumeShader_.uniformLocation("uInvProj");
-        volumeScreenSizeLocation_ = deferredVolumeShader_.uniformLocation("uScreenSize");
-        volumeLightOffsetLocation_ = deferredVolumeShader_.uniformLocation("uLightOffset");
-        volumeIsSpotLocation_ = deferredVolumeShader_.uniformLocation("uIsSpot");
-        compositeDebugModeLocation_ = deferredCompositeShader_.uniformLocation("uDebugMode");
-        volumeInvViewLocation_ = deferredVolumeShader_.uniformLocation("uInvView");
-        volumeSpotShadowMatrixLocation_ = deferredVolumeShader_.uniformLocation("uSpotShadowMatrices[0]");
-        volumeSpotShadowCountLocation_ = deferredVolumeShader_.uniformLocation("uSpotShadowCount");
-        volumeSpotShadowTexelSizeLocation_ = deferredVolumeShader_.uniformLocation("uSpotShadowTexelSize");
-        volumeSpotShadowPcfRadiusLocation_ = deferredVolumeShader_.uniformLocation("uSpotShadowPcfRadius");
-        volumePointShadowCountLocation_ = deferredVolumeShader_.uniformLocation("uPointShadowCount");
-        volumePointShadowDiskRadiusLocation_ = deferredVolumeShader_.uniformLocation("uPointShadowDiskRadius");
-        volumePointShadowPcfRadiusLocation_ = deferredVolumeShader_.uniformLocation("uPointShadowPcfRadius");
-        deferredShadowMapLocation_ = deferredDirLightShader_.uniformLocation("uShadowMap");
-        deferredShadowMatrixLocation_ = deferredDirLightShader_.uniformLocation("uShadowMatrices[0]");
-        deferredCascadeSplitsLocation_ = deferredDirLightShader_.uniformLocation("uCascadeSplits[0]");
-        deferredCascadeCountLocation_ = deferredDirLightShader_.uniformLocation("uCascadeCount");
-        deferredShadowTexelSizeLocation_ = deferredDirLightShader_.uniformLocation("uShadowTexelSize");
-        deferredShadowBiasMinLocation_ = deferredDirLightShader_.uniformLocation("uShadowBiasMin");
-        deferredShadowBiasSlopeLocation_ = deferredDirLightShader_.uniformLocation("uShadowBiasSlope");
-        deferredShadowPcfRadiusLocation_ = deferredDirLightShader_.uniformLocation("uShadowPcfRadius");
-        compositeShadowMapLocation_ = deferredCompositeShader_.uniformLocation("uShadowMap");
-        compositeShadowMatrixLocation_ = deferredCompositeShader_.uniformLocation("uShadowMatrices[0]");
-        compositeCascadeSplitsLocation_ = deferredCompositeShader_.uniformLocation("uCascadeSplits[0]");
-        compositeCascadeCountLocation_ = deferredCompositeShader_.uniformLocation("uCascadeCount");
-        compositeShadowTexelSizeLocation_ = deferredCompositeShader_.uniformLocation("uShadowTexelSize");
-        compositeShadowPcfRadiusLocation_ = deferredCompositeShader_.uniformLocation("uShadowPcfRadius");
-        compositeInvProjLocation_ = deferredCompositeShader_.uniformLocation("uInvProj");
-        compositeShadowBiasMinLocation_ = deferredCompositeShader_.uniformLocation("uShadowBiasMin");
-        compositeShadowBiasSlopeLocation_ = deferredCompositeShader_.uniformLocation("uShadowBiasSlope");
-        compositeShadowDebugCascadeLocation_ = deferredCompositeShader_.uniformLocation("uShadowDebugCascade");
-        compositeDirLightDirLocation_ = deferredCompositeShader_.uniformLocation("uDirLightDir");
-
-        deferredDirLightShader_.use();
-        glUniform1i(deferredDirLightShader_.uniformLocation("uGAlbedoMetal"), 0);
-        glUniform1i(deferredDirLightShader_.uniformLocation("uGNormalRough"), 1);
-        glUniform1i(deferredDirLightShader_.uniformLocation("uDepth"), 2);
-        glUniform1i(deferredShadowMapLocation_, 3);
-
-        deferredVolumeShader_.use();
-        glUniform1i(deferredVolumeShader_.uniformLocation("uGAlbedoMetal"), 0);
-        glUniform1i(deferredVolumeShader_.uniformLocation("uGNormalRough"), 1);
-        glUniform1i(deferredVolumeShader_.uniformLocation("uDepth"), 2);
-        glUniform1i(deferredVolumeShader_.uniformLocation("uLightBuffer"), 3);
-        glUniform1i(deferredVolumeShader_.uniformLocation("uSpotShadowMap"), 4);
-        glUniform1i(deferredVolumeShader_.uniformLocation("uPointShadowMap"), 5);
-
-        deferredCompositeShader_.use();
-        glUniform1i(deferredCompositeShader_.uniformLocation("uLightBuffer"), 0);
-        glUniform1i(deferredCompositeShader_.uniformLocation("uGAlbedoMetal"), 1);
-        glUniform1i(deferredCompositeShader_.uniformLocation("uGNormalRough"), 2);
-        glUniform1i(deferredCompositeShader_.uniformLocation("uDepth"), 3);
-        glUniform1i(compositeShadowMapLocation_, 4);
-
-        if (!shadowSystem_.init(shaderRoot)) {
-            spdlog::error("RenderEngine: failed to init shadow system");
-            sceneReady_ = false;
-            return;
+        if (options_.halfResLightVolumes && !depthDownsampleShader_.finish()) {
+            spdlog::warn("RenderEngine: depth downsample shader unavailable, shading light volumes at full resolution");
         }
 
-        buildLights();
+        if (rendererPath_ == RendererPath::Tiled43 && !tiledLightingShader_.finish()) {
+            spdlog::warn("RenderEngine: tiled lighting shader unavailable, falling back to light volumes");
+            rendererPath_ = RendererPath::Deferred41;
+        }
+
+        bindShaderUniforms();
+
         volumeReady = buildVolumeMeshes();
 
         shadersReady = deferredGeometryShader_.id() != 0 &&
                        deferredDirLightShader_.id() != 0 &&
-                       deferredVolumeShader_.id() != 0 &&
-                       deferredCompositeShader_.id() != 0;
+                       volumePermutations_.programs().size() == volumePrograms_.size() &&
+                       deferredCompositeShaders_[0].id() != 0;
     }
 
-    std::vector<float> groundVerts;
-    std::vector<unsigned int> groundIdx;
-    const float g = 5.0f;
-    const std::array<Vertex, 4> groundQuad{{
-        {-g, 0.0f, -g, 0.0f, 1.0f, 0.0f, 0.18f, 0.36f, 0.20f},
-        {g, 0.0f, -g, 0.0f, 1.0f, 0.0f, 0.18f, 0.36f, 0.20f},
-        {g, 0.0f, g, 0.0f, 1.0f, 0.0f, 0.18f, 0.36f, 0.20f},
-        {-g, 0.0f, g, 0.0f, 1.0f, 0.0f, 0.18f, 0.36f, 0.20f},
-    }};
-    addQuad(groundQuad, groundVerts, groundIdx);
+    static_assert(std::size(kFramePassNames) == static_cast<size_t>(FramePass::Count));
+    std::vector<std::string> passNames(std::begin(kFramePassNames), std::end(kFramePassNames));
+    if (!profiler_.init(std::move(passNames), shaderRoot)) {
+        spdlog::warn("RenderEngine: profiler overlay unavailable");
+    }
+    ResolutionScaler::Settings scaling{};
+    scaling.budgetMs = options_.gpuBudgetMs;
+    scaling.minScale = options_.minRenderScale;
+    resolutionScaler_.configure(scaling);
+    shaderBuildMs_ = static_cast<float>(
+        static_cast<double>(SDL_GetPerformanceCounter() - shaderStart) * 1000.0 /
+        static_cast<double>(SDL_GetPerformanceFrequency())
+    );
+    spdlog::info(
+        "RenderEngine: shaders ready in {:.2f} ms ({} from cache, {} compiled)",
+        shaderBuildMs_,
+        shaderCache_.stats().hits,
+        shaderCache_.stats().misses
+    );
 
-    std::vector<float> wallVerts;
-    std::vector<unsigned int> wallIdx;
-    const float wallHeight = 2.5f;
-    const float wallOffset = 3.0f;
-    const float wallLength = 5.0f;
+    sceneReady_ = shadersReady && volumeReady && loadScene();
+}
 
-    // The vertical walls must be defined in a counter‑clockwise order from the
-    // camera’s point of view in our isometric projection.  When we flipped the
-    // Y‑rotation to +45° the original vertex order resulted in a clockwise
-    // winding for the walls, so they were culled as back faces.  Reordering
-    // the vertices here restores a CCW winding without disabling face
-    // culling.  The normals remain the same; we still want wallA facing +X
-    // and wallB facing −X.
+void RenderEngine::bindShaderUniforms() {
+    if (rendererPath_ == RendererPath::SimpleForward) {
+        simpleMvpLocation_ = simpleShader_.uniformLocation("uMVP");
+        simpleLightDirLocation_ = simpleShader_.uniformLocation("uLightDir");
+        return;
+    }
 
-    // Wall A (x = -wallOffset) ordered: bottom‑near, bottom‑far, top‑far, top‑near
-    const std::array<Vertex, 4> wallAQuad{{
-        {-wallOffset, 0.0f, -wallLength, 1.0f, 0.0f, 0.0f, 0.70f, 0.25f, 0.25f},   // bottom near
-        {-wallOffset, 0.0f,  wallLength, 1.0f, 0.0f, 0.0f, 0.70f, 0.25f, 0.25f},   // bottom far
-        {-wallOffset, wallHeight,  wallLength, 1.0f, 0.0f, 0.0f, 0.70f, 0.25f, 0.25f}, // top far
-        {-wallOffset, wallHeight, -wallLength, 1.0f, 0.0f, 0.0f, 0.70f, 0.25f, 0.25f}, // top near
-    }};
-    addQuad(wallAQuad, wallVerts, wallIdx);
+    // Camera and shadow constants come from the shared uniform blocks written in writeFrameUniforms.
+    ShaderProgram* const framePrograms[] = {
+        &deferredGeometryShader_,
+        &deferredDirLightShader_,
+        &volumeStencilShader_,
+        &tiledLightingShader_,
+        &depthDownsampleShader_,
+    };
+    for (ShaderProgram* program : framePrograms) {
+        if (program->id() != 0) {
+            program->bindUniformBlock("FrameUniforms", kFrameUniformBinding);
+            program->bindUniformBlock("ShadowUniforms", kShadowUniformBinding);
+        }
+    }
+    for (const ShaderProgram& program : deferredCompositeShaders_) {
+        if (program.id() != 0) {
+            bindCompositeUniforms(program);
+        }
+    }
 
-    // Wall B (x = +wallOffset) ordered similarly
-    const std::array<Vertex, 4> wallBQuad{{
-        { wallOffset, 0.0f, -wallLength, -1.0f, 0.0f, 0.0f, 0.25f, 0.45f, 0.70f},   // bottom near
-        { wallOffset, 0.0f,  wallLength, -1.0f, 0.0f, 0.0f, 0.25f, 0.45f, 0.70f},   // bottom far
-        { wallOffset, wallHeight,  wallLength, -1.0f, 0.0f, 0.0f, 0.25f, 0.45f, 0.70f}, // top far
-        { wallOffset, wallHeight, -wallLength, -1.0f, 0.0f, 0.0f, 0.25f, 0.45f, 0.70f}, // top near
-    }};
-    std::vector<float> wallBVerts;
-    std::vector<unsigned int> wallBIdx;
-    addQuad(wallBQuad, wallBVerts, wallBIdx);
+    gbufferMetallicLocation_ = deferredGeometryShader_.uniformLocation("uMetallic");
+    gbufferRoughnessLocation_ = deferredGeometryShader_.uniformLocation("uRoughness");
+
+    deferredDirLightShader_.use();
+    glUniform1i(deferredDirLightShader_.uniformLocation("uGAlbedoMetal"), 0);
+    glUniform1i(deferredDirLightShader_.uniformLocation("uGNormalRough"), 1);
+    glUniform1i(deferredDirLightShader_.uniformLocation("uDepth"), 2);
+    glUniform1i(deferredDirLightShader_.uniformLocation("uShadowMap"), 3);
+
+    for (auto& [key, program] : volumePermutations_.programs()) {
+        program.bindUniformBlock("FrameUniforms", kFrameUniformBinding);
+        program.bindUniformBlock("ShadowUniforms", kShadowUniformBinding);
+        program.use();
+        glUniform1i(program.uniformLocation("uGAlbedoMetal"), 0);
+        glUniform1i(program.uniformLocation("uGNormalRough"), 1);
+        glUniform1i(program.uniformLocation("uDepth"), 2);
+        glUniform1i(program.uniformLocation("uLightBuffer"), 3);
+        glUniform1i(program.uniformLocation("uSpotShadowMap"), 4);
+        glUniform1i(program.uniformLocation("uPointShadowMap"), 5);
+        glUniform1i(program.uniformLocation("uVisibleLights"), 6);
+        glUniform1i(program.uniformLocation("uPixelStride"), halfResLocalLights() ? 2 : 1);
+    }
+    for (const bool spot : {false, true}) {
+        for (const bool shadowed : {false, true}) {
+            VolumeProgram& volume = volumePrograms_[volumeProgramIndex(spot, shadowed)];
+            volume.program = volumePermutations_.find(volumeKey(spot, shadowed));
+            volume.lightOffsetLocation = volume.program ? volume.program->uniformLocation("uLightOffset") : -1;
+            volume.useVisibleLightsLocation = volume.program ? volume.program->uniformLocation("uUseVisibleLights") : -1;
+        }
+    }
+
+    if (volumeStencilShader_.id() != 0) {
+        volumeStencilLightOffsetLocation_ = volumeStencilShader_.uniformLocation("uLightOffset");
+        volumeStencilIsSpotLocation_ = volumeStencilShader_.uniformLocation("uIsSpot");
+        volumeStencilShader_.use();
+        glUniform1i(volumeStencilShader_.uniformLocation("uLightBuffer"), 3);
+        glUniform1i(volumeStencilShader_.uniformLocation("uVisibleLights"), 6);
+    }
+
+    if (tiledLightingShader_.id() != 0) {
+        tiledLightingShader_.use();
+        glUniform1i(tiledLightingShader_.uniformLocation("uGAlbedoMetal"), 0);
+        glUniform1i(tiledLightingShader_.uniformLocation("uGNormalRough"), 1);
+        glUniform1i(tiledLightingShader_.uniformLocation("uDepth"), 2);
+        glUniform1i(tiledLightingShader_.uniformLocation("uLightBuffer"), 3);
+        glUniform1i(tiledLightingShader_.uniformLocation("uSpotShadowMap"), 4);
+        glUniform1i(tiledLightingShader_.uniformLocation("uPointShadowMap"), 5);
+    }
+
+    if (depthDownsampleShader_.id() != 0) {
+        depthDownsampleShader_.use();
+        glUniform1i(depthDownsampleShader_.uniformLocation("uDepth"), 2);
+    }
+}
 
-    sceneReady_ = shadersReady &&
-                  volumeReady &&
-                  ground_.upload(groundVerts, groundIdx) &&
-                  wallA_.upload(wallVerts, wallIdx) &&
-                  wallB_.upload(wallBVerts, wallBIdx);
+void RenderEngine::bindCompositeUniforms(const ShaderProgram& program) {
+    program.bindUniformBlock("FrameUniforms", kFrameUniformBinding);
+    program.use();
+    glUniform1i(program.uniformLocation("uLightBuffer"), 0);
+    glUniform1i(program.uniformLocation("uGAlbedoMetal"), 1);
+    glUniform1i(program.uniformLocation("uGNormalRough"), 2);
+    glUniform1i(program.uniformLocation("uDepth"), 3);
+    glUniform1i(program.uniformLocation("uShadowInfo"), 4);
+    glUniform1i(program.uniformLocation("uShadowDepth"), 7);
+    glUniform1i(program.uniformLocation("uLocalLight"), 5);
+    glUniform1i(program.uniformLocation("uLocalDepth"), 6);
+    glUniform1i(program.uniformLocation("uLocalLightStride"), halfResLocalLights() ? 2 : 0);
+}
+
+ShaderProgram& RenderEngine::compositeShader() {
+    ShaderProgram& program = deferredCompositeShaders_[static_cast<size_t>(debugView_)];
+    if (program.id() != 0 || debugView_ == DebugView::Final) {
+        return program;
+    }
+    // Debug views are rare, so their variants compile (or load from the cache) when first shown.
+    const std::string shaderRoot = shaderRootPath();
+    program.setDefines("#define DEBUG_VIEW " + std::to_string(static_cast<int>(debugView_)) + "\n");
+    program.startFromFiles(shaderRoot + "fullscreen_tri.vert", shaderRoot + "deferred_composite.frag");
+    if (!program.finish()) {
+        spdlog::warn("RenderEngine: composite shader for debug view {} unavailable, showing the final image", static_cast<int>(debugView_));
+        debugView_ = DebugView::Final;
+        return deferredCompositeShaders_[0];
+    }
+    bindCompositeUniforms(program);
+    return program;
+}
+
+std::string RenderEngine::volumeKey(bool spot, bool shadowed) const {
+    return ShaderPermutations::key({
+        {"LIGHT_SPOT", spot ? 1 : 0},
+        {"LIGHT_SHADOWED", shadowed ? 1 : 0},
+        {"SHADOW_PCF_RADIUS", spot ? shadowSystem_.spotPcfRadius() : shadowSystem_.pointPcfRadius()},
+        {"SHADOW_FILTER", static_cast<int>(shadowSystem_.filter())},
+    });
+}
+
+void RenderEngine::reloadChangedShaders() {
+    ShaderProgram* const programs[] = {
+        &simpleShader_,
+        &deferredGeometryShader_,
+        &deferredDirLightShader_,
+        &volumeStencilShader_,
+        &tiledLightingShader_,
+        &depthDownsampleShader_,
+    };
+    bool reloaded = volumePermutations_.reloadChanged();
+    for (ShaderProgram* program : programs) {
+        if (program->id() != 0 && program->sourcesChanged()) {
+            reloaded = program->reload() || reloaded;
+        }
+    }
+    for (ShaderProgram& program : deferredCompositeShaders_) {
+        if (program.id() != 0 && program.sourcesChanged()) {
+            reloaded = program.reload() || reloaded;
+        }
+    }
+    if (reloaded) {
+        bindShaderUniforms();
+    }
+    // The subsystems query their own uniforms again after a reload.
+    shadowSystem_.reloadChanged();
+    occlusionCuller_.reloadChanged();
+    profiler_.reloadChanged();
+}
+
+bool RenderEngine::loadScene() {
+    // The snapshot job reads the resident meshes.
+    finishFrameSnapshot();
+    const uint64_t start = SDL_GetPerformanceCounter();
+    resetMeshGrid();
+    sceneStreamer_.reset(nullptr, &meshPool_);
+
+    bool loaded = false;
+    if (!sceneConfig_.path.empty()) {
+        loaded = sceneAsset_.open(sceneConfig_.path);
+        if (loaded && sceneAsset_.vertexFormat() != meshPool_.layout().format) {
+            spdlog::error("RenderEngine: '{}' is stored in a different vertex layout than the mesh pool", sceneConfig_.path);
+            loaded = false;
+        }
+        if (!loaded) {
+            spdlog::warn("RenderEngine: scene '{}' unavailable, using the built-in scene", sceneConfig_.path);
+            sceneConfig_.path.clear();
+        }
+    }
+    if (!loaded) {
+        std::vector<uint8_t> bytes;
+        loaded = buildBuiltinScene(false, bytes) && sceneAsset_.adopt(std::move(bytes));
+    }
+    if (!loaded) {
+        spdlog::error("RenderEngine: failed to load a scene");
+        sceneAsset_.close();
+        return false;
+    }
+
+    // Everything in view is resident before the first frame.
+    sceneStreamer_.reset(&sceneAsset_, &meshPool_);
+    streamScene(SIZE_MAX);
+    if (isDeferredPath()) {
+        buildLights();
+    }
+    sceneLoadMs_ = static_cast<float>(
+        static_cast<double>(SDL_GetPerformanceCounter() - start) * 1000.0 /
+        static_cast<double>(SDL_GetPerformanceFrequency())
+    );
+    const SceneStreamer::Stats& stats = sceneStreamer_.stats();
+    spdlog::info(
+        "RenderEngine: scene {} ({} chunks, {} meshes, {} instances, {} KiB{}), {} chunks resident in {:.2f} ms",
+        sceneConfig_.path.empty() ? "built-in" : sceneConfig_.path,
+        sceneAsset_.chunkCount(),
+        sceneAsset_.meshCount(),
+        sceneAsset_.instanceCount(),
+        sceneAsset_.size() / 1024,
+        sceneAsset_.mapped() ? ", mapped" : "",
+        stats.residentChunks,
+        sceneLoadMs_
+    );
+    return true;
+}
+
+bool RenderEngine::buildBuiltinScene(bool withLights, std::vector<uint8_t>& outBytes) const {
+    SceneBuilder builder;
+    builder.setInstancing(sceneConfig_.instancing);
+    const int roomCount = sceneConfig_.roomsX * sceneConfig_.roomsZ;
+    for (int room = 0; room < roomCount; ++room) {
+        const glm::vec3 center = roomCenter(room, sceneConfig_.roomsX, sceneConfig_.roomsZ);
+        if (!addDemoRoom(builder, center, sceneConfig_.groundTiles) || !addDemoActors(builder, center, sceneConfig_.actors)) {
+            return false;
+        }
+    }
+    if (withLights) {
+        for (const LightInstance& light : lights_) {
+            builder.addLight(light);
+        }
+    }
+    // One chunk per room: the grid starts at the first room's corner.
+    const glm::vec3 gridOrigin = roomCenter(0, sceneConfig_.roomsX, sceneConfig_.roomsZ) - glm::vec3(0.5f * kRoomSpacing);
+    return builder.build(meshPool_.layout().format, kRoomSpacing, gridOrigin, outBytes);
+}
+
+void RenderEngine::streamScene(size_t byteBudget) {
+    const float aspect = static_cast<float>(width_) / static_cast<float>(height_ > 0 ? height_ : 1);
+    const float halfSize = kBaseOrthoSize / zoom_;
+    const auto widened = [&](float margin) {
+        const float halfWidth = halfSize * aspect + margin;
+        const float halfHeight = halfSize + margin;
+        return Frustum(glm::ortho(-halfWidth, halfWidth, -halfHeight, halfHeight, kNearPlane, kFarPlane) * view_);
+    };
+
+    // Loads are ordered by distance to the ground point under the view center.
+    const glm::mat4 invView = glm::inverse(view_);
+    const glm::vec3 eye(invView[3]);
+    const glm::vec3 forward = -glm::vec3(invView[2]);
+    const float t = std::abs(forward.y) > 1e-4f ? std::max(-eye.y / forward.y, 0.0f) : 0.0f;
+    sceneStreamer_.update(widened(kStreamMargin), widened(2.0f * kStreamMargin), eye + forward * t, byteBudget);
 }
 
 }  // namespace render
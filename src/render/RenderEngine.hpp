@@ -6,29 +6,207 @@
 #include <SDL.h>
 #include <SDL_opengl.h>
 
+#include <array>
 #include <cstdint>
-#include <initializer_list>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include <glm/mat4x4.hpp>
 #include <glm/vec3.hpp>
 #include <glm/vec4.hpp>
 
+#include "FramePacer.hpp"
+#include "FrameProfiler.hpp"
+#include "GlFunctions.hpp"
+#include "JobSystem.hpp"
+#include "LightStore.hpp"
 #include "MeshBuffer.hpp"
+#include "MeshPool.hpp"
+#include "OcclusionCuller.hpp"
+#include "RenderQueue.hpp"
+#include "RenderTargetPool.hpp"
+#include "ResolutionScaler.hpp"
+#include "SceneAsset.hpp"
+#include "SceneStreamer.hpp"
 #include "ShadowSystem.hpp"
+#include "ShaderCache.hpp"
+#include "ShaderPermutations.hpp"
 #include "ShaderProgram.hpp"
+#include "ShaderUniforms.hpp"
+#include "SpatialGrid.hpp"
+#include "StreamingBuffer.hpp"
 
 namespace render {
 
-enum class RenderLayer {
-    Ground,
-    Geometry,
-    Actors,
-};
-
 class RenderEngine {
 public:
+    /**
+     * Startup options that must be known before the window/context exist.
+     */
+    struct Options {
+        /**
+         * Swap interval, frame rate limit and frames-in-flight cap.
+         */
+        FramePacer::Settings pacing{};
+        /**
+         * Hides the window and renders the final image into an offscreen target.
+         */
+        bool headless{false};
+        /**
+         * Uses compute-based tiled light culling when GL 4.3 is available.
+         */
+        bool tiledLighting{true};
+        /**
+         * Writes every cascade/cube face of a shadow map in one geometry-shader pass.
+         */
+        bool layeredShadows{true};
+        /**
+         * Kernel shadow lookups are filtered with (hardware depth compares either way).
+         */
+        ShadowSystem::ShadowFilter shadowFilter{ShadowSystem::ShadowFilter::Pcf};
+        /**
+         * How often each directional cascade may re-render (far cascades take turns by default).
+         */
+        ShadowSystem::CascadeSchedule cascadeSchedule{};
+        /**
+         * Fits the cascades to the visible receivers (the camera is orthographic) instead of the
+         * whole view frustum.
+         */
+        ShadowSystem::CascadeFit cascadeFit{ShadowSystem::CascadeFit::Receivers};
+        /**
+         * Keeps the static casters of each directional cascade in a map of their own, so a change
+         * among the dynamic ones copies it and redraws only them.
+         */
+        bool staticCascadeCache{true};
+        /**
+         * Directional shadow map size per cascade.
+         */
+        int directionalShadowSize{1024};
+        /**
+         * Masks each light volume with a stencil mark pass before shading (one draw pair per light).
+         */
+        bool stencilLightVolumes{false};
+        /**
+         * Accumulates point/spot light volumes at half resolution and upsamples them in the
+         * composite pass with a depth- and normal-aware filter (light volume path only).
+         */
+        bool halfResLightVolumes{false};
+        /**
+         * Stores meshes with quantized positions, octahedral normals and RGBA8 colors (16 bytes/vertex).
+         */
+        bool compactVertices{true};
+        /**
+         * Culls G-buffer meshes and light volumes against a Hi-Z depth pyramid when GL 4.3 is available.
+         */
+        bool occlusionCulling{true};
+        /**
+         * Animates lights, fits cascades and builds the render queue of the next frame on worker
+         * threads while the current frame is submitted.
+         */
+        bool pipelinedFrames{true};
+        /**
+         * Job system worker threads; 0 uses one fewer than the hardware threads.
+         */
+        int workerThreads{0};
+        /**
+         * Loads linked programs from a binary cache next to the executable and stores new ones there.
+         */
+        bool shaderCache{true};
+        /**
+         * Scales the deferred internal resolution each frame to keep GPU time under gpuBudgetMs.
+         */
+        bool dynamicResolution{false};
+        /**
+         * GPU frame time dynamic resolution aims to stay under, in milliseconds.
+         */
+        float gpuBudgetMs{16.0f};
+        /**
+         * Smallest per-axis internal resolution scale.
+         */
+        float minRenderScale{0.5f};
+    };
+
+    /**
+     * Scene streamed by loadScene.
+     */
+    struct SceneConfig {
+        /**
+         * Scene file to memory-map and stream; empty selects the built-in room grid.
+         */
+        std::string path;
+        /**
+         * Built-in scene: copies of the demo room along X (one streaming chunk per room).
+         */
+        int roomsX{1};
+        /**
+         * Built-in scene: copies of the demo room along Z.
+         */
+        int roomsZ{1};
+        /**
+         * Built-in scene: each room's ground is split into groundTiles x groundTiles tile meshes.
+         */
+        int groundTiles{1};
+        /**
+         * Built-in scene: crates per room in the Actors layer, which streams in as dynamic meshes.
+         */
+        int actors{0};
+        /**
+         * Built-in scene: stores repeated meshes once and draws them instanced (SceneBuilder).
+         */
+        bool instancing{true};
+    };
+
+    /**
+     * Light set generated by buildLights when the scene stores no lights.
+     */
+    struct LightConfig {
+        /**
+         * Number of orbiting point lights.
+         */
+        int pointLights{32};
+        /**
+         * Number of orbiting spot lights.
+         */
+        int spotLights{8};
+        /**
+         * Point lights (from the first) that request shadows; ShadowSystem grants slices by priority.
+         */
+        int pointShadowCasters{4};
+        /**
+         * Spot lights (from the first) that request shadows; ShadowSystem grants atlas tiles by priority.
+         */
+        int spotShadowCasters{8};
+        /**
+         * Moves lights along their orbits; false keeps them at their base positions.
+         */
+        bool animated{true};
+    };
+
+    /**
+     * Spatial index occupancy and what the current frame's culling kept.
+     */
+    struct CullingStats {
+        SpatialGrid::Stats meshGrid{};
+        SpatialGrid::Stats lightGrid{};
+        /**
+         * Meshes queued for the camera.
+         */
+        int visibleMeshes{0};
+        /**
+         * Lights whose reach intersects the view; the rest are neither animated nor uploaded.
+         */
+        int visibleLights{0};
+        /**
+         * Visible shadow casters that requested a shadow.
+         */
+        int shadowCandidates{0};
+        /**
+         * Casters the directional cascade fit considered.
+         */
+        int fitCasters{0};
+    };
+
     /**
      * Creates a render engine with the requested window size and title.
      * @param width Initial window width in pixels.
@@ -36,6 +214,14 @@ public:
      * @param title Window title string.
      */
     RenderEngine(int width, int height, std::string title = "AlKanzar - Render Preview");
+    /**
+     * Creates a render engine with explicit startup options.
+     * @param width Initial window (or offscreen target) width in pixels.
+     * @param height Initial window (or offscreen target) height in pixels.
+     * @param title Window title string.
+     * @param options Startup options.
+     */
+    RenderEngine(int width, int height, std::string title, Options options);
     /**
      * Releases GL resources and destroys the SDL window/context.
      */
@@ -56,14 +242,119 @@ public:
      */
     bool init();
     /**
-     * Runs the main event/render loop until quit.
+     * Runs the main event/render loop until quit, rebuilding programs whose shader files change.
+     * Input is polled after the frame pacer releases the frame, right before it is built.
      */
     void run();
+    /**
+     * Advances the simulation clock, renders one frame, and presents it unless headless. Callers
+     * pacing their own loop call framePacer().waitForFrame() before it.
+     */
+    void renderFrame();
+    /**
+     * Resizes the render targets (and the window when not headless).
+     * @param width New width in pixels.
+     * @param height New height in pixels.
+     */
+    void resize(int width, int height);
+    /**
+     * Drives light animation from a fixed step instead of the wall clock.
+     * @param seconds Simulation step per frame; 0 restores wall-clock time.
+     */
+    void setFixedTimestep(float seconds);
+    /**
+     * Moves the camera to a pan offset, as mouse dragging does.
+     * @param x Horizontal pan in view units.
+     * @param y Vertical pan in view units.
+     */
+    void setCameraPan(float x, float y);
+    /**
+     * Regenerates the light list with the given counts.
+     * @param config Light and shadow caster counts.
+     */
+    void setLightConfig(const LightConfig& config);
+    /**
+     * Selects the scene; reloads it (and its lights) when already initialized. A file that
+     * cannot be used falls back to the built-in scene.
+     * @param config Scene file or built-in scene size.
+     */
+    void setSceneConfig(const SceneConfig& config);
+    /**
+     * Writes the built-in scene, with the current lights, as a scene file.
+     * @param path Destination path.
+     * @return false if a file scene is active or writing failed.
+     */
+    bool exportScene(const std::string& path) const;
+    /**
+     * Blocks until all submitted GL work has completed.
+     */
+    void waitForGpu() const;
+    /**
+     * Returns the frame profiler for reading per-pass timings.
+     */
+    FrameProfiler& profiler() { return profiler_; }
+    /**
+     * Returns the frame pacer that gates frame starts and fences submitted frames.
+     */
+    FramePacer& framePacer() { return framePacer_; }
+    /**
+     * Returns the render target pool for reading its occupancy.
+     */
+    const RenderTargetPool& renderTargets() const { return renderTargets_; }
+    /**
+     * Returns the shadow system for reading per-pass caster culling counts.
+     */
+    const ShadowSystem& shadowSystem() const { return shadowSystem_; }
+    /**
+     * Returns the shared mesh pool for reading per-frame submission counts.
+     */
+    const MeshPool& meshPool() const { return meshPool_; }
+    /**
+     * Returns the active scene asset.
+     */
+    const SceneAsset& sceneAsset() const { return sceneAsset_; }
+    /**
+     * Returns the scene streamer for reading residency counters.
+     */
+    const SceneStreamer& sceneStreamer() const { return sceneStreamer_; }
+    /**
+     * Returns the spatial index occupancy and what the current frame's culling kept.
+     */
+    const CullingStats& cullingStats() const { return cullingStats_; }
+    /**
+     * Returns the time the last scene load took, from opening the asset to its first chunks being resident.
+     */
+    float sceneLoadMs() const { return sceneLoadMs_; }
+    /**
+     * Returns the program binary cache for reading hit/miss counters.
+     */
+    const ShaderCache& shaderCache() const { return shaderCache_; }
+    /**
+     * Returns the time init spent building shader programs (with the GPU resources set up between them).
+     */
+    float shaderBuildMs() const { return shaderBuildMs_; }
+    /**
+     * Returns the number of job system worker threads (0 when frame work runs inline).
+     */
+    int workerCount() const { return jobs_.workerCount(); }
+    /**
+     * Returns the CPU time spent animating the current frame's lights, in milliseconds.
+     */
+    float lightUpdateMs() const { return lightUpdateMs_; }
+    /**
+     * Returns the per-axis scale the last deferred frame rendered its G-buffer and lighting at.
+     */
+    float renderScale() const { return renderScale_; }
+    /**
+     * Returns a short name for the active renderer path (valid after init).
+     */
+    const char* rendererPathName() const;
 
 private:
     enum class RendererPath {
         SimpleForward,
         Deferred41,
+        Tiled43,
     };
 
     enum class DebugView : int {
@@ -77,34 +368,120 @@ private:
         ShadowFactor = 7,
         ShadowCascade = 8,
     };
+    /**
+     * Number of DebugView values; the composite program has one build per view.
+     */
+    static constexpr int kDebugViewCount = 9;
 
-    enum class LightType : uint32_t {
-        Point = 0,
-        Spot = 1,
+    /**
+     * Profiled sections of a frame, in submission order.
+     */
+    enum class FramePass : int {
+        LightUpdate = 0,
+        ShadowDirectional,
+        ShadowSpot,
+        ShadowPoint,
+        GBuffer,
+        Occlusion,
+        DirectionalLight,
+        LightVolumes,
+        TiledLighting,
+        Composite,
+        Forward,
+        Count,
     };
 
-    struct LightInstance {
-        glm::vec3 basePosition;
-        float radius;
-        glm::vec3 color;
-        float intensity;
-        glm::vec3 target;
-        float innerAngle;
-        float outerAngle;
-        LightType type;
-        float phase;
-        bool castsShadow{false};
-        float shadowBiasMin{0.0f};
-        float shadowBiasSlope{0.0f};
+    /**
+     * CPU results for one frame, filled on a worker and only read by the render thread once the
+     * job finished. The inputs are copied in before the job starts.
+     */
+    struct FrameSnapshot {
+        float time{0.0f};
+        glm::mat4 view{1.0f};
+        glm::mat4 projection{1.0f};
+        uint64_t lightRevision{0};
+        uint64_t sceneRevision{0};
+        bool animated{true};
+        bool deferred{false};
+        bool valid{false};
+        /**
+         * Animated state per LightStore index.
+         */
+        std::vector<AnimatedLight> lights;
+        /**
+         * Light buffer records per LightStore index, without shadow slots.
+         */
+        std::vector<GpuLight> gpuLights;
+        /**
+         * LightStore indices of the visible lights in buffer order: [points clear][points crossing]
+         * [spots clear][spots crossing]. Only these lights are animated.
+         */
+        std::vector<int> gpuOrder;
+        /**
+         * LightStore indices, ascending, of the visible lights whose reach intersects the view.
+         */
+        std::vector<int> visibleLights;
+        /**
+         * Lane blocks (store index / LightStore::kLaneCount) holding a visible light, ascending.
+         */
+        std::vector<int> lightBlocks;
+        /**
+         * LightStore indices, ascending, of the visible shadow casters nearest the eye; only they
+         * request shadows.
+         */
+        std::vector<int> shadowCandidates;
+        /**
+         * Scratch for grid queries.
+         */
+        std::vector<int> gridHandles;
+        int fitCasterCount{0};
+        /**
+         * Bounds of the queued G-buffer and shadow-casting meshes, for the receiver cascade fit.
+         */
+        std::vector<Aabb> receiverBounds;
+        std::vector<Aabb> casterBounds;
+        int pointCount{0};
+        int pointInsideCount{0};
+        int spotCount{0};
+        int spotInsideCount{0};
+        /**
+         * Wall time of the LightStore::animate pass.
+         */
+        float lightUpdateMs{0.0f};
+        ShadowSystem::DirectionalCascades cascades{};
+        RenderQueue renderQueue;
     };
 
-    struct GpuLight {
-        glm::vec4 positionRadius;
-        glm::vec4 colorIntensity;
-        glm::vec4 directionType;
-        glm::vec4 spotParams;
-        glm::vec4 shadowInfo;
+    /**
+     * Light volume permutation with its per-draw uniform locations.
+     */
+    struct VolumeProgram {
+        ShaderProgram* program{nullptr};
+        GLint lightOffsetLocation{-1};
+        GLint useVisibleLightsLocation{-1};
+    };
+    /**
+     * Contiguous range of the light buffer drawn with one volume permutation.
+     */
+    struct LightBatch {
+        int first{0};
+        int count{0};
+        bool spot{false};
+        bool shadowed{false};
+        /**
+         * Volumes crossing the near plane, drawn with back faces behind the geometry.
+         */
+        bool inside{false};
+        /**
+         * OcclusionCuller group of the batch, or -1 when it is never culled.
+         */
+        int cullGroup{-1};
     };
+    /**
+     * Light batches in buffer order: for points clear of / crossing the near plane, then spots clear
+     * of / crossing it, the lights with a shadow slot followed by the ones without.
+     */
+    static constexpr int kLightBatchCount = 8;
 
     /**
      * Handles input/window events and updates camera controls and debug view.
@@ -125,15 +502,81 @@ private:
      */
     void renderScene();
     /**
-     * Builds shaders, meshes, and uploads scene geometry.
+     * Builds shaders and GPU resources, then loads the scene.
      */
     void buildScene();
+    /**
+     * Queries the uniform locations of the renderer path's programs and assigns their texture units.
+     */
+    void bindShaderUniforms();
+    /**
+     * Assigns the texture units of one composite program variant.
+     */
+    void bindCompositeUniforms(const ShaderProgram& program);
+    /**
+     * Returns the composite program specialized for the current debug view, building it on first
+     * use. Falls back to the final view when that build fails.
+     */
+    ShaderProgram& compositeShader();
+    /**
+     * Returns the volume permutation key for a light type and shadow state under the current
+     * shadow settings.
+     */
+    std::string volumeKey(bool spot, bool shadowed) const;
+    /**
+     * Returns the volumePrograms_ slot of a light type and shadow state.
+     */
+    static size_t volumeProgramIndex(bool spot, bool shadowed) { return (spot ? 2u : 0u) + (shadowed ? 1u : 0u); }
+    /**
+     * Returns the volume permutation lights of a type and shadow state draw with.
+     */
+    const VolumeProgram& volumeProgram(bool spot, bool shadowed) const {
+        return volumePrograms_[volumeProgramIndex(spot, shadowed)];
+    }
+    /**
+     * Rebuilds the programs whose shader files changed on disk, the engine's and those of the
+     * shadow, occlusion and profiler subsystems, then rebinds their uniforms.
+     */
+    void reloadChangedShaders();
+    /**
+     * Opens the configured scene (or builds the built-in one), streams in the chunks around the
+     * camera and rebuilds the lights.
+     * @return true when a scene is loaded.
+     */
+    bool loadScene();
+    /**
+     * Packs the built-in room grid into scene file bytes.
+     * @param withLights Stores the current lights in the scene.
+     * @param outBytes Receives the file contents.
+     * @return true on success.
+     */
+    bool buildBuiltinScene(bool withLights, std::vector<uint8_t>& outBytes) const;
+    /**
+     * Streams scene chunks around the current camera.
+     * @param byteBudget Upload budget in bytes.
+     */
+    void streamScene(size_t byteBudget);
     /**
      * Initializes the light list used by deferred rendering.
      */
     void buildLights();
     /**
-     * Animates lights, updates GPU buffers, and counts light types.
+     * Fills a snapshot from the inputs copied into it; runs on a worker when pipelined.
+     * Reads lightStore_, the light and mesh grids and the shadow configuration, all stable while a
+     * job runs.
+     */
+    void fillFrameSnapshot(FrameSnapshot& snapshot);
+    /**
+     * Waits for the pending snapshot, rebuilds it inline if its inputs went stale, moves it into
+     * this frame's state, and starts the next frame's snapshot job.
+     */
+    void acquireFrameSnapshot();
+    /**
+     * Waits for the pending snapshot job and discards its result.
+     */
+    void finishFrameSnapshot();
+    /**
+     * Requests shadows for this frame's lights and streams them into this frame's light buffer region.
      */
     void updateLights();
     /**
@@ -150,20 +593,139 @@ private:
      */
     bool buildVolumeMeshes();
     /**
-     * Renders the scene using the deferred 4.1 path.
+     * Renders the scene using the deferred 4.1 path (or the tiled 4.3 variant).
      */
     void renderDeferredScene();
+    /**
+     * Picks this frame's internal resolution (renderWidth_/renderHeight_) from the GPU time of a
+     * finished frame when dynamic resolution is on.
+     */
+    void updateRenderScale();
+    /**
+     * Writes this frame's camera and shadow constants into uniformStream_ and binds both blocks.
+     * Must run after the shadow passes and before any deferred program draws.
+     * @param invView Inverse view matrix.
+     * @param dirLightView View-space directional light direction.
+     */
+    void writeFrameUniforms(const glm::mat4& invView, const glm::vec3& dirLightView);
+    /**
+     * Accumulates point/spot lighting by rasterizing one instanced volume per light.
+     */
+    void renderLightVolumes();
+    /**
+     * Draws each light batch as one instanced group through its volume permutation.
+     */
+    void drawLightVolumeGroups();
+    /**
+     * Draws each light volume as a stencil mark pass followed by a masked shading pass.
+     */
+    void drawStencilLightVolumes();
+    /**
+     * Draws the G-buffer items that are not occluders, culled against the previous frame's Hi-Z
+     * pyramid when it still matches the camera and scene.
+     * @param layerMask RenderQueue::layerBit() mask of layers to draw.
+     */
+    void drawCulledGeometry(uint32_t layerMask);
+    /**
+     * Builds the Hi-Z pyramid once from the finished G-buffer depth.
+     */
+    void buildDepthPyramid();
+    /**
+     * Culls the instanced light volume groups against this frame's pyramid (Deferred41 only).
+     */
+    void cullLightVolumes();
+    /**
+     * Accumulates point/spot lighting into the light target with the tiled compute pass.
+     */
+    void renderTiledLighting();
+    /**
+     * Returns true when the directional pass has to write shadowInfo_ for the current debug view.
+     */
+    bool shadowInfoNeeded() const {
+        return debugView_ == DebugView::ShadowFactor || debugView_ == DebugView::ShadowCascade;
+    }
+    /**
+     * Returns true when this frame's light volumes go to the half-resolution local light target.
+     */
+    bool halfResLocalLights() const {
+        return rendererPath_ == RendererPath::Deferred41 && localLightFbo_ != 0 && depthDownsampleShader_.id() != 0;
+    }
+    /**
+     * Acquires, binds and clears the half-resolution local light target and fills its depth from
+     * the G-buffer.
+     */
+    void beginHalfResLocalLights();
+    /**
+     * Acquires lightDepth_, attaches it to the light target and copies the G-buffer depth into it,
+     * leaving the light target bound. The stencil is not copied: only the stencil-masked volumes
+     * use it, and they clear it first.
+     */
+    void attachLightDepth();
+    /**
+     * Returns the frame's transient targets (shadowInfo_, lightDepth_ and the half-resolution
+     * local light target) to the pool and ages its free list.
+     */
+    void releaseTransientTargets();
+    /**
+     * Returns true for renderer paths that use the G-buffer.
+     */
+    bool isDeferredPath() const {
+        return rendererPath_ == RendererPath::Deferred41 || rendererPath_ == RendererPath::Tiled43;
+    }
     /**
      * Renders the scene using the simple forward path.
      */
     void renderSimpleScene();
 
     /**
-     * Draws meshes for a layer with appropriate depth mask behavior.
-     * @param layer Render layer to determine depth writes.
-     * @param meshes Mesh buffers to draw.
+     * Returns the framebuffer that receives the final image.
+     */
+    GLuint outputFramebuffer() const { return options_.headless ? outputFbo_ : 0; }
+    /**
+     * Allocates or resizes the offscreen output target used in headless mode.
+     */
+    void ensureOutputTarget();
+    /**
+     * Releases the offscreen output target.
      */
-    void drawLayer(RenderLayer layer, std::initializer_list<const MeshBuffer*> meshes) const;
+    void destroyOutputTarget();
+
+    /**
+     * Submits the scene meshes inside the view to a render queue and sorts it.
+     * @param queue Queue to fill.
+     * @param view Camera view matrix used for depth ordering.
+     * @param viewProj Camera view-projection the meshes are culled against.
+     * @param scratch Receives the visible mesh grid handles.
+     */
+    void buildRenderQueue(
+        RenderQueue& queue,
+        const glm::mat4& view,
+        const glm::mat4& viewProj,
+        std::vector<int>& scratch
+    ) const;
+    /**
+     * Rebuilds lightGrid_ from lightStore_, one item per store index.
+     */
+    void indexLights();
+    /**
+     * Brings meshGrid_ up to date with the streamer's resident meshes once their set changed.
+     * Call only while no snapshot job runs.
+     */
+    void syncMeshGrid();
+    /**
+     * Empties meshGrid_ before the meshes it references go away.
+     */
+    void resetMeshGrid();
+    /**
+     * Starts profiler timing for a frame pass.
+     * @param pass Pass to time.
+     */
+    void beginPass(FramePass pass) { profiler_.beginPass(static_cast<int>(pass)); }
+    /**
+     * Stops profiler timing for a frame pass.
+     * @param pass Pass being timed.
+     */
+    void endPass(FramePass pass) { profiler_.endPass(static_cast<int>(pass)); }
 
     SDL_Window* window_{nullptr};
     SDL_GLContext glContext_{nullptr};
@@ -177,89 +739,196 @@ private:
     int lastMouseX_{0};
     int lastMouseY_{0};
     std::string title_;
+    Options options_;
+    LightConfig lightConfig_{};
+    SceneConfig sceneConfig_{};
+    float fixedTimestep_{0.0f};
+    float simulationTime_{0.0f};
+    float previousSimulationTime_{0.0f};
 
+    ShaderCache shaderCache_;
+    float shaderBuildMs_{0.0f};
+    /**
+     * SDL_GetTicks of the last shader file check in run().
+     */
+    Uint32 lastShaderPoll_{0};
     ShaderProgram simpleShader_;
     ShaderProgram deferredGeometryShader_;
     ShaderProgram deferredDirLightShader_;
-    ShaderProgram deferredVolumeShader_;
-    ShaderProgram deferredCompositeShader_;
-    MeshBuffer ground_;
-    MeshBuffer wallA_;
-    MeshBuffer wallB_;
+    /**
+     * Light volume programs specialized by light type, shadow state, PCF radius and filter.
+     */
+    ShaderPermutations volumePermutations_;
+    /**
+     * Current-settings permutation per light type and shadow state (volumeProgramIndex).
+     */
+    std::array<VolumeProgram, 4> volumePrograms_{};
+    ShaderProgram volumeStencilShader_;
+    /**
+     * Composite program per DebugView (DEBUG_VIEW define); Final is built with the scene, the
+     * debug views when first shown.
+     */
+    std::array<ShaderProgram, kDebugViewCount> deferredCompositeShaders_;
+    ShaderProgram tiledLightingShader_;
+    ShaderProgram depthDownsampleShader_;
+    MeshPool meshPool_;
+    SceneAsset sceneAsset_;
+    /**
+     * Declared after meshPool_ and sceneAsset_: resident meshes release into the pool on destruction.
+     */
+    SceneStreamer sceneStreamer_;
+    float sceneLoadMs_{0.0f};
     MeshBuffer lightSphere_;
     MeshBuffer lightCone_;
+    RenderQueue renderQueue_;
+    OcclusionCuller occlusionCuller_;
+    std::vector<OcclusionCuller::MeshCandidate> meshCandidates_;
+    /**
+     * Camera, render size and scene revision the Hi-Z pyramid was built with; the next frame's
+     * mesh cull uses it only while they still match.
+     */
+    bool hiZValid_{false};
+    glm::mat4 hiZViewProj_{1.0f};
+    int hiZWidth_{0};
+    int hiZHeight_{0};
+    uint64_t hiZSceneRevision_{0};
+    bool lightVolumesCulled_{false};
     GLint simpleMvpLocation_{-1};
     GLint simpleLightDirLocation_{-1};
-    GLint gbufferMvpLocation_{-1};
-    GLint gbufferViewLocation_{-1};
     GLint gbufferMetallicLocation_{-1};
     GLint gbufferRoughnessLocation_{-1};
-    GLint deferredInvProjLocation_{-1};
-    GLint deferredDirLightDirLocation_{-1};
-    GLint deferredDirLightColorLocation_{-1};
-    GLint deferredDirLightIntensityLocation_{-1};
-    GLint deferredAmbientLocation_{-1};
-    GLint volumeProjLocation_{-1};
-    GLint volumeInvProjLocation_{-1};
-    GLint volumeScreenSizeLocation_{-1};
-    GLint volumeLightOffsetLocation_{-1};
-    GLint volumeIsSpotLocation_{-1};
-    GLint volumeInvViewLocation_{-1};
-    GLint volumeSpotShadowMatrixLocation_{-1};
-    GLint volumeSpotShadowCountLocation_{-1};
-    GLint volumeSpotShadowTexelSizeLocation_{-1};
-    GLint volumeSpotShadowPcfRadiusLocation_{-1};
-    GLint volumePointShadowCountLocation_{-1};
-    GLint volumePointShadowDiskRadiusLocation_{-1};
-    GLint volumePointShadowPcfRadiusLocation_{-1};
-    GLint compositeDebugModeLocation_{-1};
-    GLint deferredShadowMapLocation_{-1};
-    GLint deferredShadowMatrixLocation_{-1};
-    GLint deferredCascadeSplitsLocation_{-1};
-    GLint deferredCascadeCountLocation_{-1};
-    GLint deferredShadowTexelSizeLocation_{-1};
-    GLint deferredShadowBiasMinLocation_{-1};
-    GLint deferredShadowBiasSlopeLocation_{-1};
-    GLint deferredShadowPcfRadiusLocation_{-1};
-    GLint compositeShadowMapLocation_{-1};
-    GLint compositeShadowMatrixLocation_{-1};
-    GLint compositeCascadeSplitsLocation_{-1};
-    GLint compositeCascadeCountLocation_{-1};
-    GLint compositeShadowTexelSizeLocation_{-1};
-    GLint compositeShadowPcfRadiusLocation_{-1};
-    GLint compositeInvProjLocation_{-1};
-    GLint compositeShadowBiasMinLocation_{-1};
-    GLint compositeShadowBiasSlopeLocation_{-1};
-    GLint compositeShadowDebugCascadeLocation_{-1};
-    GLint compositeDirLightDirLocation_{-1};
+    GLint volumeStencilLightOffsetLocation_{-1};
+    GLint volumeStencilIsSpotLocation_{-1};
 
     GLuint gbufferFbo_{0};
     GLuint gbufferAlbedo_{0};
     GLuint gbufferNormal_{0};
-    GLuint gbufferDepthColor_{0};
     GLuint gbufferDepth_{0};
     GLuint lightFbo_{0};
     GLuint lightColor_{0};
-    GLuint lightsTbo_{0};
+    /**
+     * RG8 shadow factor and cascade index from the directional pass; acquired from the pool only
+     * by frames that show a shadow debug view.
+     */
+    GLuint shadowInfo_{0};
+    /**
+     * Copy of the G-buffer depth the full-resolution light volumes test against, so no pass
+     * samples a texture attached to the framebuffer it draws into; transient like shadowInfo_.
+     */
+    GLuint lightDepth_{0};
+    /**
+     * Half-resolution point/spot light accumulation target (Options::halfResLightVolumes); the
+     * textures are transient and only held from the light volume pass through the composite.
+     */
+    GLuint localLightFbo_{0};
+    GLuint localLightColor_{0};
+    GLuint localLightDepth_{0};
+    StreamingBuffer lightStream_;
     GLuint lightsTboTex_{0};
+    int lightStreamRevision_{0};
+    /**
+     * Ring holding each frame's FrameUniforms and ShadowUniforms blocks.
+     */
+    StreamingBuffer uniformStream_;
+    int lightTexelOffset_{0};
     GLuint fullscreenVao_{0};
+    GLuint outputFbo_{0};
+    GLuint outputColor_{0};
+    GLuint outputDepth_{0};
+    int outputWidth_{0};
+    int outputHeight_{0};
 
+    /**
+     * Allocated size of the deferred targets; at least the output size, with slack after resizes.
+     */
     int deferredWidth_{0};
     int deferredHeight_{0};
+    /**
+     * Region of the deferred targets rendered this frame (the output size times the render
+     * scale); the passes restrict their viewports to it.
+     */
+    int renderWidth_{0};
+    int renderHeight_{0};
+    float renderScale_{1.0f};
+    ResolutionScaler resolutionScaler_;
     int lightCount_{0};
     int pointLightCount_{0};
     int spotLightCount_{0};
-    GLsizeiptr lightTboSize_{0};
+    int pointInsideCount_{0};
+    int spotInsideCount_{0};
+    float lightUpdateMs_{0.0f};
 
     RendererPath rendererPath_{RendererPath::SimpleForward};
+    GlFunctions gl_{};
     DebugView debugView_{DebugView::Final};
-    bool cameraInsideLightVolume_{false};
     int shadowDebugCascade_{0};
 
     ShadowSystem shadowSystem_{};
+    FrameProfiler profiler_;
+    FramePacer framePacer_;
+    /**
+     * Owns every deferred target texture; the framebuffers only reference them.
+     */
+    RenderTargetPool renderTargets_;
 
     std::vector<LightInstance> lights_;
-    std::vector<GpuLight> gpuLights_;
+    LightStore lightStore_;
+    std::vector<AnimatedLight> frameLights_;
+    /**
+     * Shadow request per LightStore index for this frame (-1 when none).
+     */
+    std::vector<int> shadowRequests_;
+    std::vector<GpuLight> frameGpuLights_;
+    std::vector<int> frameGpuOrder_;
+    std::array<LightBatch, kLightBatchCount> lightBatches_{};
+    /**
+     * Lights of the current frameGpuOrder_ block without a shadow slot (scratch for updateLights).
+     */
+    std::vector<GpuLight> unshadowedLights_;
+    ShadowSystem::DirectionalCascades frameCascades_{};
+    std::vector<int> frameShadowCandidates_;
+    /**
+     * Light reach bounds by LightStore index (handles equal store indices).
+     */
+    SpatialGrid lightGrid_;
+    /**
+     * Resident scene meshes, flagged with their RenderQueue pass bits; culls the camera queue,
+     * every shadow view and the cascade fit's casters.
+     */
+    SpatialGrid meshGrid_;
+    /**
+     * Mesh of each meshGrid_ handle (nullptr for free handles), as ShadowSystem reads it.
+     */
+    std::vector<const MeshBuffer*> gridMeshes_;
+    /**
+     * What meshGrid_ needs besides the bounds to queue a mesh and notice it changed.
+     */
+    struct GridMesh {
+        RenderLayer layer{RenderLayer::Geometry};
+        /**
+         * Position in SceneStreamer::meshes(); queued meshes keep the streamer's order.
+         */
+        int order{0};
+        /**
+         * Last sync that found the mesh resident.
+         */
+        uint64_t syncStamp{0};
+    };
+    std::vector<GridMesh> gridMeshInfo_;
+    std::unordered_map<const MeshBuffer*, int> gridHandles_;
+    uint64_t gridSyncStamp_{0};
+    uint64_t gridSceneRevision_{0};
+    bool gridSynced_{false};
+    int gridStaticCasters_{0};
+    int gridDynamicCasters_{0};
+    CullingStats cullingStats_{};
+    /**
+     * Bumped whenever lights_ is rebuilt, invalidating snapshots taken before.
+     */
+    uint64_t lightRevision_{0};
+    JobSystem jobs_;
+    JobSystem::Counter snapshotJob_;
+    FrameSnapshot nextSnapshot_;
 
     glm::mat4 projection_{1.0f};
     glm::mat4 invProjection_{1.0f};
@@ -0,0 +1,91 @@
+#include "RenderQueue.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace {
+
+constexpr int kRadixBits = 8;
+constexpr int kRadixBuckets = 1 << kRadixBits;
+constexpr int kRadixPasses = 64 / kRadixBits;
+
+}  // namespace
+
+namespace render {
+
+void RenderQueue::setDepthRange(float nearPlane, float farPlane) {
+    nearPlane_ = nearPlane;
+    farPlane_ = std::max(farPlane, nearPlane + 1e-3f);
+}
+
+void RenderQueue::clear() {
+    items_.clear();
+    keys_.clear();
+    order_.clear();
+    sorted_ = true;
+}
+
+void RenderQueue::submit(const DrawItem& item) {
+    if (!item.mesh) {
+        return;
+    }
+    items_.push_back(item);
+    keys_.push_back(makeKey(item));
+    order_.push_back(static_cast<uint32_t>(items_.size() - 1));
+    sorted_ = false;
+}
+
+uint64_t RenderQueue::makeKey(const DrawItem& item) const {
+    const float depth01 = std::clamp((item.viewDepth - nearPlane_) / (farPlane_ - nearPlane_), 0.0f, 1.0f);
+    const uint64_t depth = static_cast<uint64_t>(std::lround(depth01 * 65535.0f));
+    const uint64_t layer = static_cast<uint64_t>(item.layer) & 0xFu;
+    const uint64_t shader = static_cast<uint64_t>(item.shader) & 0xFFFu;
+    const uint64_t material = static_cast<uint64_t>(item.material);
+    const uint64_t vao = static_cast<uint64_t>(item.mesh->vao()) & 0xFFFFu;
+    return (layer << 60) | (shader << 48) | (material << 32) | (vao << 16) | depth;
+}
+
+void RenderQueue::sort() {
+    if (sorted_) {
+        return;
+    }
+    sorted_ = true;
+    const size_t count = keys_.size();
+    if (count < 2) {
+        return;
+    }
+
+    // One sweep builds every digit histogram; digits shared by all keys skip their pass.
+    std::array<std::array<uint32_t, kRadixBuckets>, kRadixPasses> histograms{};
+    for (uint64_t key : keys_) {
+        for (int pass = 0; pass < kRadixPasses; ++pass) {
+            histograms[pass][(key >> (pass * kRadixBits)) & (kRadixBuckets - 1)]++;
+        }
+    }
+
+    scratchKeys_.resize(count);
+    scratchOrder_.resize(count);
+    for (int pass = 0; pass < kRadixPasses; ++pass) {
+        std::array<uint32_t, kRadixBuckets>& histogram = histograms[pass];
+        const int shift = pass * kRadixBits;
+        if (histogram[(keys_[0] >> shift) & (kRadixBuckets - 1)] == count) {
+            continue;
+        }
+        uint32_t offset = 0;
+        for (uint32_t& bucket : histogram) {
+            const uint32_t bucketCount = bucket;
+            bucket = offset;
+            offset += bucketCount;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            const uint32_t slot = histogram[(keys_[i] >> shift) & (kRadixBuckets - 1)]++;
+            scratchKeys_[slot] = keys_[i];
+            scratchOrder_[slot] = order_[i];
+        }
+        keys_.swap(scratchKeys_);
+        order_.swap(scratchOrder_);
+    }
+}
+
+}  // namespace render
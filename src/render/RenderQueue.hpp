@@ -0,0 +1,153 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "MeshBuffer.hpp"
+
+namespace render {
+
+enum class RenderLayer {
+    Ground,
+    Geometry,
+    Actors,
+};
+
+/**
+ * Per-frame list of draw items, sorted once by a packed 64-bit key and replayed per pass.
+ * Key layout from the most significant bit: layer (4), shader (12), material (16), VAO (16),
+ * view depth (16, front to back). Replay batches consecutive items of one mesh pool into a
+ * single submission and only breaks the batch when the layer or material changes.
+ */
+class RenderQueue {
+public:
+    static constexpr uint32_t kShadowPass = 1u << 0;
+    static constexpr uint32_t kGBufferPass = 1u << 1;
+    static constexpr uint32_t kForwardPass = 1u << 2;
+    /**
+     * G-buffer draws that run before Hi-Z occlusion culling and feed its depth; opt-in.
+     */
+    static constexpr uint32_t kOccluderPass = 1u << 3;
+    static constexpr uint32_t kAllPasses = kShadowPass | kGBufferPass | kForwardPass;
+    static constexpr uint32_t kAllLayers = ~0u;
+
+    /**
+     * One submitted draw.
+     */
+    struct DrawItem {
+        /**
+         * Mesh to draw; must outlive the frame.
+         */
+        const MeshBuffer* mesh{nullptr};
+        RenderLayer layer{RenderLayer::Geometry};
+        /**
+         * Passes that draw this item (k*Pass bits).
+         */
+        uint32_t passMask{kAllPasses};
+        /**
+         * Program variant within a pass (0 for the pass default).
+         */
+        uint16_t shader{0};
+        /**
+         * Material id handed to the replay callback when it changes.
+         */
+        uint16_t material{0};
+        /**
+         * Distance from the camera plane, used to order draws front to back.
+         */
+        float viewDepth{0.0f};
+    };
+
+    /**
+     * Sets the depth range used to quantize viewDepth into the key.
+     */
+    void setDepthRange(float nearPlane, float farPlane);
+    /**
+     * Removes every item; keeps capacity for the next frame.
+     */
+    void clear();
+    /**
+     * Adds an item to this frame's queue (invalidates the previous sort).
+     */
+    void submit(const DrawItem& item);
+    /**
+     * Sorts the submitted items by key with an LSD radix sort.
+     */
+    void sort();
+
+    /**
+     * Returns the number of submitted items.
+     */
+    size_t size() const { return items_.size(); }
+    /**
+     * Returns the item at a position of the sorted order.
+     */
+    const DrawItem& sortedItem(size_t position) const { return items_[order_[position]]; }
+
+    /**
+     * Returns the layer's bit for replay layer masks.
+     */
+    static constexpr uint32_t layerBit(RenderLayer layer) { return 1u << static_cast<uint32_t>(layer); }
+
+    /**
+     * Draws the sorted items of one pass, one pool batch per run of equal layer/material/pool.
+     * @param pass Pass bit; items without it are skipped.
+     * @param layerMask layerBit() mask of layers to draw.
+     * @param onLayer Called with the RenderLayer before its first item.
+     * @param onMaterial Called with the material id whenever it changes.
+     * @return Number of GL draw calls issued.
+     */
+    template <typename LayerFn, typename MaterialFn>
+    int replay(uint32_t pass, uint32_t layerMask, LayerFn&& onLayer, MaterialFn&& onMaterial) const;
+
+private:
+    uint64_t makeKey(const DrawItem& item) const;
+
+    float nearPlane_{0.0f};
+    float farPlane_{1.0f};
+    bool sorted_{true};
+    std::vector<DrawItem> items_;
+    std::vector<uint64_t> keys_;
+    std::vector<uint32_t> order_;
+    std::vector<uint64_t> scratchKeys_;
+    std::vector<uint32_t> scratchOrder_;
+};
+
+template <typename LayerFn, typename MaterialFn>
+int RenderQueue::replay(uint32_t pass, uint32_t layerMask, LayerFn&& onLayer, MaterialFn&& onMaterial) const {
+    int draws = 0;
+    int currentLayer = -1;
+    int currentMaterial = -1;
+    MeshPool* pool = nullptr;
+    const auto flushPool = [&draws, &pool]() {
+        if (pool) {
+            draws += pool->flush();
+        }
+    };
+    for (uint32_t index : order_) {
+        const DrawItem& item = items_[index];
+        if ((item.passMask & pass) == 0 || (layerBit(item.layer) & layerMask) == 0 || !item.mesh->valid()) {
+            continue;
+        }
+        if (static_cast<int>(item.layer) != currentLayer) {
+            flushPool();
+            currentLayer = static_cast<int>(item.layer);
+            currentMaterial = -1;
+            onLayer(item.layer);
+        }
+        if (static_cast<int>(item.material) != currentMaterial) {
+            flushPool();
+            currentMaterial = static_cast<int>(item.material);
+            onMaterial(item.material);
+        }
+        if (item.mesh->pool() != pool) {
+            flushPool();
+            pool = item.mesh->pool();
+        }
+        item.mesh->queue();
+    }
+    flushPool();
+    return draws;
+}
+
+}  // namespace render
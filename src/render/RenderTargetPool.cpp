@@ -0,0 +1,127 @@
+#include "RenderTargetPool.hpp"
+
+#include <algorithm>
+
+#include <spdlog/spdlog.h>
+
+namespace {
+
+/**
+ * Upload format, type and texel size for each internal format the renderer targets.
+ */
+struct FormatInfo {
+    GLenum internalFormat;
+    GLenum format;
+    GLenum type;
+    size_t texelBytes;
+};
+
+constexpr FormatInfo kFormats[] = {
+    {GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, 4},
+    {GL_RGB10_A2, GL_RGBA, GL_UNSIGNED_INT_2_10_10_10_REV, 4},
+    {GL_RGBA16F, GL_RGBA, GL_FLOAT, 8},
+    {GL_RG8, GL_RG, GL_UNSIGNED_BYTE, 2},
+    {GL_R32F, GL_RED, GL_FLOAT, 4},
+    {GL_DEPTH24_STENCIL8, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, 4},
+};
+
+const FormatInfo* findFormat(GLenum internalFormat) {
+    for (const FormatInfo& info : kFormats) {
+        if (info.internalFormat == internalFormat) {
+            return &info;
+        }
+    }
+    return nullptr;
+}
+
+}  // namespace
+
+namespace render {
+
+RenderTargetPool::~RenderTargetPool() {
+    destroy();
+}
+
+GLuint RenderTargetPool::acquire(const Desc& desc) {
+    for (Entry& entry : entries_) {
+        if (!entry.inUse && entry.desc == desc) {
+            entry.inUse = true;
+            entry.idleFrames = 0;
+            stats_.inUse++;
+            stats_.reuses++;
+            return entry.texture;
+        }
+    }
+
+    const FormatInfo* info = findFormat(desc.internalFormat);
+    if (!info || desc.width <= 0 || desc.height <= 0) {
+        spdlog::error("RenderTargetPool: unsupported target 0x{:x} {}x{}", desc.internalFormat, desc.width, desc.height);
+        return 0;
+    }
+    Entry entry{};
+    entry.desc = desc;
+    entry.bytes = info->texelBytes * static_cast<size_t>(desc.width) * static_cast<size_t>(desc.height);
+    entry.inUse = true;
+    glGenTextures(1, &entry.texture);
+    glBindTexture(GL_TEXTURE_2D, entry.texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, static_cast<GLint>(desc.internalFormat), desc.width, desc.height, 0, info->format, info->type, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, static_cast<GLint>(desc.filter));
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, static_cast<GLint>(desc.filter));
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    if (info->format == GL_DEPTH_STENCIL) {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_NONE);
+        glTexParameteri(GL_TEXTURE_2D, GL_DEPTH_STENCIL_TEXTURE_MODE, GL_DEPTH_COMPONENT);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    entries_.push_back(entry);
+    stats_.textures++;
+    stats_.inUse++;
+    stats_.allocations++;
+    stats_.bytes += entry.bytes;
+    stats_.peakBytes = std::max(stats_.peakBytes, stats_.bytes);
+    return entry.texture;
+}
+
+void RenderTargetPool::release(GLuint& texture) {
+    if (texture == 0) {
+        return;
+    }
+    for (Entry& entry : entries_) {
+        if (entry.texture == texture && entry.inUse) {
+            entry.inUse = false;
+            entry.idleFrames = 0;
+            stats_.inUse--;
+            break;
+        }
+    }
+    texture = 0;
+}
+
+void RenderTargetPool::endFrame() {
+    for (size_t i = entries_.size(); i-- > 0;) {
+        Entry& entry = entries_[i];
+        if (!entry.inUse && ++entry.idleFrames > kIdleFrames) {
+            erase(i);
+        }
+    }
+}
+
+void RenderTargetPool::destroy() {
+    while (!entries_.empty()) {
+        erase(entries_.size() - 1);
+    }
+}
+
+void RenderTargetPool::erase(size_t index) {
+    Entry& entry = entries_[index];
+    glDeleteTextures(1, &entry.texture);
+    stats_.textures--;
+    stats_.inUse -= entry.inUse ? 1 : 0;
+    stats_.bytes -= entry.bytes;
+    entries_[index] = entries_.back();
+    entries_.pop_back();
+}
+
+}  // namespace render
@@ -0,0 +1,128 @@
+#ifndef GL_GLEXT_PROTOTYPES
+#define GL_GLEXT_PROTOTYPES
+#endif
+#pragma once
+
+#include <SDL_opengl.h>
+
+#include <cstddef>
+#include <vector>
+
+namespace render {
+
+/**
+ * 2D render target textures shared by key (format, size, filter). Released textures stay in a
+ * free list, so a pass that acquires after another one released can alias its memory, and the
+ * same target comes back frame after frame without reallocation. Textures nobody acquires for
+ * kIdleFrames frames are deleted.
+ */
+class RenderTargetPool {
+public:
+    /**
+     * Frames a released texture survives without being acquired again.
+     */
+    static constexpr int kIdleFrames = 8;
+
+    /**
+     * Key of a target; textures are only shared between identical descriptions.
+     */
+    struct Desc {
+        GLenum internalFormat{GL_RGBA8};
+        int width{0};
+        int height{0};
+        /**
+         * Minification and magnification filter.
+         */
+        GLenum filter{GL_NEAREST};
+
+        bool operator==(const Desc& other) const {
+            return internalFormat == other.internalFormat && width == other.width && height == other.height &&
+                filter == other.filter;
+        }
+    };
+
+    /**
+     * Pool occupancy; bytes are estimated from the texel size of each format.
+     */
+    struct Stats {
+        int textures{0};
+        int inUse{0};
+        size_t bytes{0};
+        size_t peakBytes{0};
+        /**
+         * Textures created since the pool was created.
+         */
+        int allocations{0};
+        /**
+         * Acquires served from the free list.
+         */
+        int reuses{0};
+    };
+
+    /**
+     * Creates an empty pool without allocating GL objects.
+     */
+    RenderTargetPool() = default;
+    /**
+     * Deletes every texture.
+     */
+    ~RenderTargetPool();
+
+    /**
+     * Non-copyable to avoid double-deleting GL textures.
+     */
+    RenderTargetPool(const RenderTargetPool&) = delete;
+    /**
+     * Non-copyable assignment to avoid double-deleting GL textures.
+     */
+    RenderTargetPool& operator=(const RenderTargetPool&) = delete;
+
+    /**
+     * Returns a free texture matching the description, creating one if there is none. Contents
+     * are undefined; depth formats sample depth without comparison.
+     * @param desc Format, size and filter.
+     * @return The texture, or 0 for an unsupported format.
+     */
+    GLuint acquire(const Desc& desc);
+    /**
+     * Returns a texture to the free list and clears the handle. Detach it from framebuffers first,
+     * or deleting it later will not free its memory.
+     * @param texture Texture from acquire(); 0 is ignored.
+     */
+    void release(GLuint& texture);
+    /**
+     * Ages the free textures and deletes the ones idle for kIdleFrames.
+     */
+    void endFrame();
+    /**
+     * Deletes every texture, in use or not.
+     */
+    void destroy();
+
+    /**
+     * Returns the current occupancy.
+     */
+    const Stats& stats() const { return stats_; }
+
+private:
+    /**
+     * A pooled texture.
+     */
+    struct Entry {
+        Desc desc;
+        GLuint texture{0};
+        size_t bytes{0};
+        bool inUse{false};
+        int idleFrames{0};
+    };
+
+    /**
+     * Deletes an entry's texture and removes it.
+     */
+    void erase(size_t index);
+
+    std::vector<Entry> entries_;
+    Stats stats_{};
+};
+
+}  // namespace render
@@ -0,0 +1,84 @@
+#include "ResolutionScaler.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "FrameProfiler.hpp"
+
+namespace {
+
+/**
+ * Weight of a new sample in the smoothed GPU time.
+ */
+constexpr float kSmoothing = 0.25f;
+/**
+ * Largest multiple of the smoothed time a single sample counts as. A spike still pulls the
+ * filter up, but a corrupt timer result cannot send it straight to the minimum scale.
+ */
+constexpr float kMaxSampleRatio = 4.0f;
+/**
+ * Fraction of the budget the frame must stay under before the scale steps back up. Leaves room
+ * for the larger step cost at low scales, so the controller does not oscillate.
+ */
+constexpr float kRaiseThreshold = 0.8f;
+/**
+ * Timer results arrive kQueryLatency frames late; one more frame covers the frame in flight.
+ */
+constexpr int kSettleFrames = render::FrameProfiler::kQueryLatency + 1;
+
+}  // namespace
+
+namespace render {
+
+void ResolutionScaler::configure(const Settings& settings) {
+    settings_ = settings;
+    settings_.step = std::max(settings_.step, 0.01f);
+    settings_.minScale = std::clamp(settings_.minScale, settings_.step, 1.0f);
+    reset();
+}
+
+void ResolutionScaler::reset() {
+    scale_ = 1.0f;
+    filteredMs_ = 0.0f;
+    seedCount_ = 0;
+    settleFrames_ = 0;
+}
+
+float ResolutionScaler::update(float gpuMs) {
+    if (!std::isfinite(gpuMs) || gpuMs <= 0.0f || settings_.budgetMs <= 0.0f) {
+        return scale_;
+    }
+    if (settleFrames_ > 0) {
+        --settleFrames_;
+        return scale_;
+    }
+    if (filteredMs_ <= 0.0f) {
+        seedMs_[static_cast<size_t>(seedCount_++)] = gpuMs;
+        if (seedCount_ < kSeedSamples) {
+            return scale_;
+        }
+        std::sort(seedMs_.begin(), seedMs_.end());
+        filteredMs_ = seedMs_[kSeedSamples / 2];
+        seedCount_ = 0;
+    } else {
+        filteredMs_ += (std::min(gpuMs, filteredMs_ * kMaxSampleRatio) - filteredMs_) * kSmoothing;
+    }
+
+    float next = scale_;
+    if (filteredMs_ > settings_.budgetMs) {
+        // Fill cost follows the pixel count, the square of the per-axis scale.
+        const float fit = scale_ * std::sqrt(settings_.budgetMs / filteredMs_);
+        next = std::min(std::floor(fit / settings_.step + 1.0e-3f) * settings_.step, scale_ - settings_.step);
+    } else if (filteredMs_ < settings_.budgetMs * kRaiseThreshold) {
+        next = scale_ + settings_.step;
+    }
+    next = std::clamp(next, settings_.minScale, 1.0f);
+    if (std::abs(next - scale_) > 1.0e-4f) {
+        scale_ = next;
+        filteredMs_ = 0.0f;
+        settleFrames_ = kSettleFrames;
+    }
+    return scale_;
+}
+
+}  // namespace render
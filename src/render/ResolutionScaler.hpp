@@ -0,0 +1,83 @@
+#pragma once
+
+#include <array>
+
+namespace render {
+
+/**
+ * Picks the per-axis scale of the deferred internal resolution from measured GPU frame times.
+ * Drops straight to the scale the budget allows when a frame runs over, and climbs back one step
+ * at a time once there is headroom. Each change waits until the timer queries of frames rendered
+ * at the new scale have landed, and the smoothed time restarts from the median of the first few
+ * samples at that scale, so one bad reading cannot pick the scale on its own.
+ */
+class ResolutionScaler {
+public:
+    /**
+     * Controller limits.
+     */
+    struct Settings {
+        /**
+         * GPU frame time to stay under, in milliseconds.
+         */
+        float budgetMs{16.0f};
+        /**
+         * Smallest per-axis scale.
+         */
+        float minScale{0.5f};
+        /**
+         * Scale granularity; the internal size only changes in these steps.
+         */
+        float step{0.05f};
+    };
+
+    /**
+     * Applies new limits and returns to full resolution.
+     * @param settings Budget and scale limits.
+     */
+    void configure(const Settings& settings);
+    /**
+     * Returns to full resolution and forgets the measured history.
+     */
+    void reset();
+    /**
+     * Feeds the latest GPU frame time and returns the scale for the next frame.
+     * @param gpuMs Measured GPU time of a finished frame; values <= 0 or not finite mark a
+     * missing sample and are ignored.
+     * @return Per-axis scale in [minScale, 1].
+     */
+    float update(float gpuMs);
+
+    /**
+     * Returns the current per-axis scale.
+     */
+    float scale() const { return scale_; }
+    /**
+     * Returns the controller limits.
+     */
+    const Settings& settings() const { return settings_; }
+
+private:
+    /**
+     * Valid samples whose median seeds the smoothed time at a new scale.
+     */
+    static constexpr int kSeedSamples = 3;
+
+    Settings settings_{};
+    float scale_{1.0f};
+    /**
+     * Exponentially smoothed GPU time at the current scale (0 until it is seeded).
+     */
+    float filteredMs_{0.0f};
+    /**
+     * Samples collected toward the seed.
+     */
+    std::array<float, kSeedSamples> seedMs_{};
+    int seedCount_{0};
+    /**
+     * Samples still to skip after a change; they were measured at the previous scale.
+     */
+    int settleFrames_{0};
+};
+
+}  // namespace render
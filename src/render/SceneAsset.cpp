@@ -0,0 +1,251 @@
+#include "SceneAsset.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <utility>
+
+#include <glm/glm.hpp>
+#include <spdlog/spdlog.h>
+
+#include "RenderQueue.hpp"
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr char kSceneMagic[4] = {'A', 'K', 'S', 'C'};
+
+/**
+ * Returns true when [offset, offset + bytes) lies inside a buffer of size bytes.
+ */
+bool rangeFits(uint64_t offset, uint64_t bytes, size_t size) {
+    return offset <= size && bytes <= size - offset;
+}
+
+glm::vec3 toVec3(const float* values) {
+    return glm::vec3(values[0], values[1], values[2]);
+}
+
+}  // namespace
+
+namespace render {
+
+SceneAsset::~SceneAsset() {
+    close();
+}
+
+bool SceneAsset::open(const std::string& path) {
+    close();
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        spdlog::error("SceneAsset: cannot open '{}'", path);
+        return false;
+    }
+    LARGE_INTEGER fileSize{};
+    GetFileSizeEx(file, &fileSize);
+    HANDLE mapping = fileSize.QuadPart > 0 ? CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+    void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    // The view keeps the file mapped after both handles are closed.
+    if (mapping) {
+        CloseHandle(mapping);
+    }
+    CloseHandle(file);
+    if (!view) {
+        spdlog::error("SceneAsset: cannot map '{}'", path);
+        return false;
+    }
+    size_ = static_cast<size_t>(fileSize.QuadPart);
+#else
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        spdlog::error("SceneAsset: cannot open '{}'", path);
+        return false;
+    }
+    struct stat info {};
+    void* view = nullptr;
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+        view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (view == MAP_FAILED) {
+            view = nullptr;
+        }
+    }
+    // The mapping keeps the file referenced after the descriptor is closed.
+    ::close(fd);
+    if (!view) {
+        spdlog::error("SceneAsset: cannot map '{}'", path);
+        return false;
+    }
+    size_ = static_cast<size_t>(info.st_size);
+#endif
+    mapping_ = view;
+    data_ = static_cast<const uint8_t*>(view);
+    if (!validate(path)) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool SceneAsset::adopt(std::vector<uint8_t> bytes) {
+    close();
+    owned_ = std::move(bytes);
+    if (owned_.empty()) {
+        spdlog::error("SceneAsset: empty scene data");
+        return false;
+    }
+    data_ = owned_.data();
+    size_ = owned_.size();
+    if (!validate("<memory>")) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void SceneAsset::close() {
+    if (mapping_) {
+#if defined(_WIN32)
+        UnmapViewOfFile(mapping_);
+#else
+        munmap(mapping_, size_);
+#endif
+        mapping_ = nullptr;
+    }
+    owned_.clear();
+    owned_.shrink_to_fit();
+    data_ = nullptr;
+    size_ = 0;
+}
+
+Aabb SceneAsset::bounds() const {
+    if (!loaded()) {
+        return Aabb{};
+    }
+    return Aabb{toVec3(header().boundsMin), toVec3(header().boundsMax)};
+}
+
+Aabb SceneAsset::chunkBounds(int index) const {
+    const SceneChunkRecord& record = chunk(index);
+    return Aabb{toVec3(record.boundsMin), toVec3(record.boundsMax)};
+}
+
+Aabb SceneAsset::meshBounds(int index) const {
+    const SceneMeshRecord& record = mesh(index);
+    return Aabb{toVec3(record.boundsMin), toVec3(record.boundsMax)};
+}
+
+LightInstance SceneAsset::light(int index) const {
+    const SceneLightRecord& record = this->record<SceneLightRecord>(header().lightOffset, index);
+    LightInstance light{};
+    light.basePosition = toVec3(record.basePosition);
+    light.radius = record.radius;
+    light.color = toVec3(record.color);
+    light.intensity = record.intensity;
+    light.target = toVec3(record.target);
+    light.innerAngle = record.innerAngle;
+    light.outerAngle = record.outerAngle;
+    light.type = record.type == static_cast<uint32_t>(LightType::Spot) ? LightType::Spot : LightType::Point;
+    light.phase = record.phase;
+    light.castsShadow = (record.flags & kSceneLightCastsShadow) != 0;
+    light.shadowBiasMin = record.shadowBiasMin;
+    light.shadowBiasSlope = record.shadowBiasSlope;
+    light.shadowImportance = record.shadowImportance;
+    return light;
+}
+
+void SceneAsset::evict(int chunkIndex) const {
+#if defined(_WIN32)
+    (void)chunkIndex;
+#else
+    if (!mapping_) {
+        return;
+    }
+    // Only whole pages inside the chunk's range are dropped, so neighbouring data stays resident.
+    const SceneChunkRecord& record = chunk(chunkIndex);
+    const uint64_t page = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+    const uint64_t begin = (record.dataOffset + page - 1) / page * page;
+    const uint64_t end = (record.dataOffset + record.dataSize) / page * page;
+    if (end > begin) {
+        madvise(static_cast<uint8_t*>(mapping_) + begin, static_cast<size_t>(end - begin), MADV_DONTNEED);
+    }
+#endif
+}
+
+bool SceneAsset::write(const std::string& path, const std::vector<uint8_t>& bytes) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        spdlog::error("SceneAsset: cannot open '{}' for writing", path);
+        return false;
+    }
+    out.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    if (!out) {
+        spdlog::error("SceneAsset: failed writing '{}'", path);
+        return false;
+    }
+    return true;
+}
+
+bool SceneAsset::validate(const std::string& name) const {
+    if (size_ < sizeof(SceneFileHeader) || std::memcmp(header().magic, kSceneMagic, sizeof(kSceneMagic)) != 0) {
+        spdlog::error("SceneAsset: '{}' is not a scene file", name);
+        return false;
+    }
+    const SceneFileHeader& file = header();
+    if (file.version != kSceneFileVersion) {
+        spdlog::error("SceneAsset: '{}' has version {}, expected {}", name, file.version, kSceneFileVersion);
+        return false;
+    }
+    if (file.vertexFormat > static_cast<uint32_t>(VertexLayout::Format::Compact)) {
+        spdlog::error("SceneAsset: '{}' uses unknown vertex format {}", name, file.vertexFormat);
+        return false;
+    }
+    if (file.fileSize != size_ ||
+        file.chunkOffset % 8 != 0 || file.meshOffset % 8 != 0 || file.lightOffset % 8 != 0 ||
+        file.instanceOffset % 16 != 0 ||
+        !rangeFits(file.chunkOffset, uint64_t{file.chunkCount} * sizeof(SceneChunkRecord), size_) ||
+        !rangeFits(file.meshOffset, uint64_t{file.meshCount} * sizeof(SceneMeshRecord), size_) ||
+        !rangeFits(file.lightOffset, uint64_t{file.lightCount} * sizeof(SceneLightRecord), size_) ||
+        !rangeFits(file.instanceOffset, uint64_t{file.instanceCount} * sizeof(SceneInstanceRecord), size_)) {
+        spdlog::error("SceneAsset: '{}' is truncated or has corrupt tables", name);
+        return false;
+    }
+
+    const VertexLayout layout = VertexLayout::forFormat(vertexFormat());
+    const uint64_t positionStride = static_cast<uint64_t>(layout.strides[VertexLayout::kPositionStream]);
+    const uint64_t surfaceStride = static_cast<uint64_t>(layout.strides[VertexLayout::kSurfaceStream]);
+    for (int c = 0; c < chunkCount(); ++c) {
+        const SceneChunkRecord& record = chunk(c);
+        if (uint64_t{record.firstMesh} + record.meshCount > file.meshCount ||
+            !rangeFits(record.dataOffset, record.dataSize, size_)) {
+            spdlog::error("SceneAsset: '{}' chunk {} is corrupt", name, c);
+            return false;
+        }
+    }
+    for (int m = 0; m < meshCount(); ++m) {
+        const SceneMeshRecord& record = mesh(m);
+        if (record.vertexCount == 0 || record.indexCount == 0 || record.indexCount % 3 != 0 ||
+            record.indexOffset % sizeof(uint32_t) != 0 ||
+            record.layer > static_cast<uint32_t>(RenderLayer::Actors) ||
+            record.instanceCount == 0 || uint64_t{record.firstInstance} + record.instanceCount > file.instanceCount ||
+            !rangeFits(record.positionOffset, record.vertexCount * positionStride, size_) ||
+            !rangeFits(record.surfaceOffset, record.vertexCount * surfaceStride, size_) ||
+            !rangeFits(record.indexOffset, record.indexCount * uint64_t{sizeof(uint32_t)}, size_)) {
+            spdlog::error("SceneAsset: '{}' mesh {} is corrupt", name, m);
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace render
@@ -0,0 +1,270 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Frustum.hpp"
+#include "LightStore.hpp"
+#include "VertexLayout.hpp"
+
+namespace render {
+
+/**
+ * On-disk scene layout (little-endian, every section 16-byte aligned, offsets from the file start):
+ * header, chunk table, mesh table, light array, instance array, then each chunk's vertex and index
+ * data back to back. Meshes are stored in a MeshPool vertex layout and instances in the
+ * MeshPool::Instance layout, so both upload without decoding.
+ */
+struct SceneFileHeader {
+    char magic[4];
+    uint32_t version;
+    /**
+     * VertexLayout::Format of every mesh.
+     */
+    uint32_t vertexFormat;
+    uint32_t chunkCount;
+    uint32_t meshCount;
+    uint32_t lightCount;
+    /**
+     * Edge of the XZ grid cells meshes were grouped into.
+     */
+    float chunkSize;
+    uint32_t instanceCount;
+    float boundsMin[4];
+    float boundsMax[4];
+    uint64_t chunkOffset;
+    uint64_t meshOffset;
+    uint64_t lightOffset;
+    uint64_t instanceOffset;
+    uint64_t fileSize;
+};
+
+/**
+ * Meshes streamed in and out together, with the byte range of their data.
+ */
+struct SceneChunkRecord {
+    float boundsMin[3];
+    uint32_t firstMesh;
+    float boundsMax[3];
+    uint32_t meshCount;
+    uint64_t dataOffset;
+    uint64_t dataSize;
+};
+
+/**
+ * One mesh: bounds it was quantized against (before instance transforms), stream offsets, its
+ * range of the instance array and render queue placement.
+ */
+struct SceneMeshRecord {
+    float boundsMin[3];
+    uint32_t vertexCount;
+    float boundsMax[3];
+    uint32_t indexCount;
+    uint64_t positionOffset;
+    uint64_t surfaceOffset;
+    uint64_t indexOffset;
+    /**
+     * RenderLayer value.
+     */
+    uint32_t layer;
+    /**
+     * RenderQueue pass bits.
+     */
+    uint32_t passMask;
+    uint32_t firstInstance;
+    /**
+     * At least 1; a mesh stored once has a single identity instance.
+     */
+    uint32_t instanceCount;
+};
+
+/**
+ * Packed MeshPool::Instance: rows of the 3x4 model-to-world matrix, then the color multiplier.
+ */
+struct SceneInstanceRecord {
+    float transform[12];
+    float color[4];
+};
+
+/**
+ * Packed LightInstance.
+ */
+struct SceneLightRecord {
+    float basePosition[3];
+    float radius;
+    float color[3];
+    float intensity;
+    float target[3];
+    float innerAngle;
+    float outerAngle;
+    float phase;
+    float shadowBiasMin;
+    float shadowBiasSlope;
+    float shadowImportance;
+    /**
+     * LightType value.
+     */
+    uint32_t type;
+    /**
+     * kSceneLightCastsShadow bit.
+     */
+    uint32_t flags;
+    uint32_t reserved;
+};
+
+static_assert(sizeof(SceneFileHeader) == 104);
+static_assert(sizeof(SceneChunkRecord) == 48);
+static_assert(sizeof(SceneMeshRecord) == 72);
+static_assert(sizeof(SceneLightRecord) == 80);
+static_assert(sizeof(SceneInstanceRecord) == 64);
+
+constexpr uint32_t kSceneFileVersion = 2;
+constexpr uint32_t kSceneLightCastsShadow = 1u << 0;
+
+/**
+ * Read-only view of a scene file, memory-mapped from disk or held in memory.
+ * Every table and data range is bounds-checked once when opened; afterwards the records and the
+ * mesh bytes are read in place, so uploads copy straight from the mapping.
+ */
+class SceneAsset {
+public:
+    /**
+     * Creates an empty asset.
+     */
+    SceneAsset() = default;
+    /**
+     * Unmaps the file.
+     */
+    ~SceneAsset();
+
+    /**
+     * Non-copyable because the asset owns its mapping.
+     */
+    SceneAsset(const SceneAsset&) = delete;
+    /**
+     * Non-copyable assignment because the asset owns its mapping.
+     */
+    SceneAsset& operator=(const SceneAsset&) = delete;
+
+    /**
+     * Maps a scene file read-only, replacing the current contents.
+     * @param path File path.
+     * @return true if the file was mapped and is well formed.
+     */
+    bool open(const std::string& path);
+    /**
+     * Takes ownership of scene bytes built in memory, replacing the current contents.
+     * @param bytes Scene file contents.
+     * @return true if the bytes are well formed.
+     */
+    bool adopt(std::vector<uint8_t> bytes);
+    /**
+     * Releases the mapping or owned bytes.
+     */
+    void close();
+
+    /**
+     * Returns true when a scene is open.
+     */
+    bool loaded() const { return data_ != nullptr; }
+    /**
+     * Returns true when the scene is mapped from a file.
+     */
+    bool mapped() const { return mapping_ != nullptr; }
+    /**
+     * Returns the size of the scene data in bytes.
+     */
+    size_t size() const { return size_; }
+    /**
+     * Returns the vertex layout format the meshes are stored in.
+     */
+    VertexLayout::Format vertexFormat() const { return static_cast<VertexLayout::Format>(header().vertexFormat); }
+
+    /**
+     * Returns the number of streaming chunks.
+     */
+    int chunkCount() const { return loaded() ? static_cast<int>(header().chunkCount) : 0; }
+    /**
+     * Returns the number of meshes across all chunks.
+     */
+    int meshCount() const { return loaded() ? static_cast<int>(header().meshCount) : 0; }
+    /**
+     * Returns the number of stored lights (0 lets the engine generate its own).
+     */
+    int lightCount() const { return loaded() ? static_cast<int>(header().lightCount) : 0; }
+    /**
+     * Returns the number of mesh instances across all chunks.
+     */
+    int instanceCount() const { return loaded() ? static_cast<int>(header().instanceCount) : 0; }
+    /**
+     * Returns a chunk record; its meshes are [firstMesh, firstMesh + meshCount).
+     */
+    const SceneChunkRecord& chunk(int index) const { return record<SceneChunkRecord>(header().chunkOffset, index); }
+    /**
+     * Returns a mesh record.
+     */
+    const SceneMeshRecord& mesh(int index) const { return record<SceneMeshRecord>(header().meshOffset, index); }
+    /**
+     * Returns the bounds of every mesh in the scene.
+     */
+    Aabb bounds() const;
+    /**
+     * Returns the bounds of a chunk's meshes.
+     */
+    Aabb chunkBounds(int index) const;
+    /**
+     * Returns the bounds a mesh was quantized against, before instance transforms.
+     */
+    Aabb meshBounds(int index) const;
+    /**
+     * Returns a mesh's instance records; there are mesh(index).instanceCount of them.
+     */
+    const SceneInstanceRecord* meshInstances(int index) const {
+        return &record<SceneInstanceRecord>(header().instanceOffset, static_cast<int>(mesh(index).firstInstance));
+    }
+    /**
+     * Unpacks one light record.
+     */
+    LightInstance light(int index) const;
+    /**
+     * Returns a pointer into the scene data; offsets were validated on open.
+     */
+    const uint8_t* data(uint64_t offset) const { return data_ + offset; }
+
+    /**
+     * Tells the OS a chunk's data was uploaded, so its mapped pages can be dropped from memory
+     * (re-read from the file if the chunk streams in again). No-op for in-memory scenes.
+     */
+    void evict(int chunkIndex) const;
+
+    /**
+     * Writes scene bytes to a file.
+     * @param path Destination path.
+     * @param bytes Scene file contents.
+     * @return true on success.
+     */
+    static bool write(const std::string& path, const std::vector<uint8_t>& bytes);
+
+private:
+    const SceneFileHeader& header() const { return *reinterpret_cast<const SceneFileHeader*>(data_); }
+    template <typename Record>
+    const Record& record(uint64_t tableOffset, int index) const {
+        return reinterpret_cast<const Record*>(data_ + tableOffset)[index];
+    }
+    /**
+     * Checks the header, tables and every mesh range against the data size.
+     */
+    bool validate(const std::string& name) const;
+
+    const uint8_t* data_{nullptr};
+    size_t size_{0};
+    std::vector<uint8_t> owned_;
+    /**
+     * Base address of the file mapping (nullptr for owned bytes).
+     */
+    void* mapping_{nullptr};
+};
+
+}  // namespace render
@@ -0,0 +1,326 @@
+#include "SceneBuilder.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <unordered_map>
+#include <utility>
+
+#include <glm/glm.hpp>
+#include <spdlog/spdlog.h>
+
+#include "SceneAsset.hpp"
+
+namespace {
+
+constexpr size_t kSectionAlignment = 16;
+
+size_t alignUp(size_t value) {
+    return (value + kSectionAlignment - 1) / kSectionAlignment * kSectionAlignment;
+}
+
+void storeVec3(const glm::vec3& value, float* out) {
+    out[0] = value.x;
+    out[1] = value.y;
+    out[2] = value.z;
+}
+
+/**
+ * Returns an instance record translating by offset and multiplying colors by color.
+ */
+render::SceneInstanceRecord placement(const glm::vec3& offset, const glm::vec3& color) {
+    render::SceneInstanceRecord record{};
+    record.transform[0] = 1.0f;
+    record.transform[3] = offset.x;
+    record.transform[5] = 1.0f;
+    record.transform[7] = offset.y;
+    record.transform[10] = 1.0f;
+    record.transform[11] = offset.z;
+    storeVec3(color, record.color);
+    record.color[3] = 1.0f;
+    return record;
+}
+
+/**
+ * Folds bytes into an FNV-1a hash.
+ */
+template <typename T>
+uint64_t hashBytes(const std::vector<T>& values, uint64_t hash) {
+    const auto* bytes = reinterpret_cast<const uint8_t*>(values.data());
+    for (size_t i = 0; i < values.size() * sizeof(T); ++i) {
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+/**
+ * One stored mesh of a chunk and the instances that draw it.
+ */
+struct MeshGroup {
+    /**
+     * Index of the first source mesh; supplies the indices, layer and pass mask.
+     */
+    size_t source{0};
+    /**
+     * Vertices in instance space.
+     */
+    std::vector<float> vertices;
+    /**
+     * Bounds of vertices, which the streams are quantized against.
+     */
+    render::Aabb bounds{};
+    /**
+     * Union of the instances' world bounds.
+     */
+    render::Aabb worldBounds{};
+    std::vector<render::SceneInstanceRecord> instances;
+};
+
+}  // namespace
+
+namespace render {
+
+bool SceneBuilder::addMesh(std::vector<float> vertices, std::vector<unsigned int> indices, RenderLayer layer, uint32_t passMask) {
+    if (vertices.empty() || indices.empty() || vertices.size() % 9 != 0 || indices.size() % 3 != 0) {
+        spdlog::error("SceneBuilder: empty or malformed vertex/index data");
+        return false;
+    }
+    const unsigned int vertexCount = static_cast<unsigned int>(vertices.size() / 9);
+    if (*std::max_element(indices.begin(), indices.end()) >= vertexCount) {
+        spdlog::error("SceneBuilder: index out of range");
+        return false;
+    }
+    Mesh mesh{};
+    mesh.bounds.min = glm::vec3(vertices[0], vertices[1], vertices[2]);
+    mesh.bounds.max = mesh.bounds.min;
+    for (size_t i = 9; i + 2 < vertices.size(); i += 9) {
+        const glm::vec3 position(vertices[i], vertices[i + 1], vertices[i + 2]);
+        mesh.bounds.min = glm::min(mesh.bounds.min, position);
+        mesh.bounds.max = glm::max(mesh.bounds.max, position);
+    }
+    mesh.vertices = std::move(vertices);
+    mesh.indices = std::move(indices);
+    mesh.layer = layer;
+    mesh.passMask = passMask;
+    meshes_.push_back(std::move(mesh));
+    return true;
+}
+
+void SceneBuilder::clear() {
+    meshes_.clear();
+    lights_.clear();
+}
+
+bool SceneBuilder::build(
+    VertexLayout::Format format,
+    float chunkSize,
+    const glm::vec3& gridOrigin,
+    std::vector<uint8_t>& outBytes
+) const {
+    outBytes.clear();
+    if (meshes_.empty() || !(chunkSize > 0.0f)) {
+        spdlog::error("SceneBuilder: nothing to build or invalid chunk size");
+        return false;
+    }
+    const VertexLayout layout = VertexLayout::forFormat(format);
+    const size_t positionStride = static_cast<size_t>(layout.strides[VertexLayout::kPositionStream]);
+    const size_t surfaceStride = static_cast<size_t>(layout.strides[VertexLayout::kSurfaceStream]);
+
+    // Group meshes by cell; the ordered map keeps chunk order deterministic, and each chunk keeps
+    // its meshes in the order they were added.
+    std::map<std::pair<int, int>, std::vector<size_t>> cells;
+    for (size_t m = 0; m < meshes_.size(); ++m) {
+        const glm::vec3 center = 0.5f * (meshes_[m].bounds.min + meshes_[m].bounds.max) - gridOrigin;
+        const int cellX = static_cast<int>(std::floor(center.x / chunkSize));
+        const int cellZ = static_cast<int>(std::floor(center.z / chunkSize));
+        cells[{cellZ, cellX}].push_back(m);
+    }
+
+    // Within a chunk, meshes that match in instance space share one group, ordered by first use.
+    std::vector<std::vector<MeshGroup>> chunkGroups;
+    chunkGroups.reserve(cells.size());
+    std::unordered_map<uint64_t, std::vector<size_t>> lookup;
+    size_t groupCount = 0;
+    for (const auto& [cell, members] : cells) {
+        std::vector<MeshGroup>& groups = chunkGroups.emplace_back();
+        lookup.clear();
+        for (const size_t m : members) {
+            const Mesh& mesh = meshes_[m];
+            MeshGroup local{};
+            local.source = m;
+            local.vertices = mesh.vertices;
+            local.bounds = mesh.bounds;
+            local.worldBounds = mesh.bounds;
+            if (!instancing_) {
+                local.instances.push_back(placement(glm::vec3(0.0f), glm::vec3(1.0f)));
+                groups.push_back(std::move(local));
+                continue;
+            }
+
+            // Subtraction is monotonic, so the shifted bounds are exactly those of the shifted vertices.
+            const glm::vec3 origin = mesh.bounds.min;
+            const glm::vec3 firstColor(local.vertices[6], local.vertices[7], local.vertices[8]);
+            bool flatColor = true;
+            for (size_t i = 0; i < local.vertices.size(); i += 9) {
+                local.vertices[i] -= origin.x;
+                local.vertices[i + 1] -= origin.y;
+                local.vertices[i + 2] -= origin.z;
+                flatColor = flatColor && glm::vec3(local.vertices[i + 6], local.vertices[i + 7], local.vertices[i + 8]) == firstColor;
+            }
+            local.bounds = Aabb{mesh.bounds.min - origin, mesh.bounds.max - origin};
+            glm::vec3 color(1.0f);
+            if (flatColor) {
+                // Compact vertices store 8-bit colors; round the moved color the same way.
+                color = format == VertexLayout::Format::Compact
+                    ? glm::round(glm::clamp(firstColor, 0.0f, 1.0f) * 255.0f) / 255.0f
+                    : firstColor;
+                for (size_t i = 0; i < local.vertices.size(); i += 9) {
+                    local.vertices[i + 6] = 1.0f;
+                    local.vertices[i + 7] = 1.0f;
+                    local.vertices[i + 8] = 1.0f;
+                }
+            }
+            const SceneInstanceRecord instance = placement(origin, color);
+
+            const uint64_t hash = hashBytes(
+                mesh.indices,
+                hashBytes(local.vertices, 14695981039346656037ull ^ (static_cast<uint64_t>(mesh.layer) << 32 | mesh.passMask))
+            );
+            std::vector<size_t>& candidates = lookup[hash];
+            const auto match = std::find_if(candidates.begin(), candidates.end(), [&](size_t g) {
+                const MeshGroup& group = groups[g];
+                const Mesh& source = meshes_[group.source];
+                return source.layer == mesh.layer && source.passMask == mesh.passMask &&
+                    source.indices == mesh.indices && group.vertices == local.vertices;
+            });
+            if (match != candidates.end()) {
+                MeshGroup& group = groups[*match];
+                group.instances.push_back(instance);
+                group.worldBounds.min = glm::min(group.worldBounds.min, mesh.bounds.min);
+                group.worldBounds.max = glm::max(group.worldBounds.max, mesh.bounds.max);
+                continue;
+            }
+            candidates.push_back(groups.size());
+            local.instances.push_back(instance);
+            groups.push_back(std::move(local));
+        }
+        groupCount += groups.size();
+    }
+
+    const size_t chunkOffset = alignUp(sizeof(SceneFileHeader));
+    const size_t meshOffset = alignUp(chunkOffset + cells.size() * sizeof(SceneChunkRecord));
+    const size_t lightOffset = alignUp(meshOffset + groupCount * sizeof(SceneMeshRecord));
+    const size_t instanceOffset = alignUp(lightOffset + lights_.size() * sizeof(SceneLightRecord));
+    size_t dataOffset = alignUp(instanceOffset + meshes_.size() * sizeof(SceneInstanceRecord));
+
+    std::vector<SceneChunkRecord> chunks;
+    std::vector<SceneMeshRecord> meshRecords;
+    std::vector<SceneInstanceRecord> instances;
+    std::vector<const MeshGroup*> meshOrder;
+    chunks.reserve(cells.size());
+    meshRecords.reserve(groupCount);
+    instances.reserve(meshes_.size());
+    Aabb sceneBounds{meshes_.front().bounds};
+    for (const std::vector<MeshGroup>& groups : chunkGroups) {
+        SceneChunkRecord chunk{};
+        chunk.firstMesh = static_cast<uint32_t>(meshRecords.size());
+        chunk.meshCount = static_cast<uint32_t>(groups.size());
+        chunk.dataOffset = dataOffset;
+        Aabb chunkBounds{groups.front().worldBounds};
+        for (const MeshGroup& group : groups) {
+            const Mesh& mesh = meshes_[group.source];
+            const size_t vertexCount = group.vertices.size() / 9;
+            SceneMeshRecord record{};
+            storeVec3(group.bounds.min, record.boundsMin);
+            storeVec3(group.bounds.max, record.boundsMax);
+            record.vertexCount = static_cast<uint32_t>(vertexCount);
+            record.indexCount = static_cast<uint32_t>(mesh.indices.size());
+            record.positionOffset = dataOffset;
+            dataOffset = alignUp(dataOffset + vertexCount * positionStride);
+            record.surfaceOffset = dataOffset;
+            dataOffset = alignUp(dataOffset + vertexCount * surfaceStride);
+            record.indexOffset = dataOffset;
+            dataOffset = alignUp(dataOffset + mesh.indices.size() * sizeof(uint32_t));
+            record.layer = static_cast<uint32_t>(mesh.layer);
+            record.passMask = mesh.passMask;
+            record.firstInstance = static_cast<uint32_t>(instances.size());
+            record.instanceCount = static_cast<uint32_t>(group.instances.size());
+            instances.insert(instances.end(), group.instances.begin(), group.instances.end());
+            meshRecords.push_back(record);
+            meshOrder.push_back(&group);
+            chunkBounds.min = glm::min(chunkBounds.min, group.worldBounds.min);
+            chunkBounds.max = glm::max(chunkBounds.max, group.worldBounds.max);
+        }
+        chunk.dataSize = dataOffset - chunk.dataOffset;
+        storeVec3(chunkBounds.min, chunk.boundsMin);
+        storeVec3(chunkBounds.max, chunk.boundsMax);
+        sceneBounds.min = glm::min(sceneBounds.min, chunkBounds.min);
+        sceneBounds.max = glm::max(sceneBounds.max, chunkBounds.max);
+        chunks.push_back(chunk);
+    }
+
+    outBytes.assign(dataOffset, 0);
+    SceneFileHeader header{};
+    std::memcpy(header.magic, "AKSC", sizeof(header.magic));
+    header.version = kSceneFileVersion;
+    header.vertexFormat = static_cast<uint32_t>(format);
+    header.chunkCount = static_cast<uint32_t>(chunks.size());
+    header.meshCount = static_cast<uint32_t>(meshRecords.size());
+    header.lightCount = static_cast<uint32_t>(lights_.size());
+    header.chunkSize = chunkSize;
+    header.instanceCount = static_cast<uint32_t>(instances.size());
+    storeVec3(sceneBounds.min, header.boundsMin);
+    storeVec3(sceneBounds.max, header.boundsMax);
+    header.chunkOffset = chunkOffset;
+    header.meshOffset = meshOffset;
+    header.lightOffset = lightOffset;
+    header.instanceOffset = instanceOffset;
+    header.fileSize = dataOffset;
+    std::memcpy(outBytes.data(), &header, sizeof(header));
+    std::memcpy(outBytes.data() + chunkOffset, chunks.data(), chunks.size() * sizeof(SceneChunkRecord));
+    std::memcpy(outBytes.data() + meshOffset, meshRecords.data(), meshRecords.size() * sizeof(SceneMeshRecord));
+    std::memcpy(outBytes.data() + instanceOffset, instances.data(), instances.size() * sizeof(SceneInstanceRecord));
+
+    for (size_t l = 0; l < lights_.size(); ++l) {
+        const LightInstance& light = lights_[l];
+        SceneLightRecord record{};
+        storeVec3(light.basePosition, record.basePosition);
+        record.radius = light.radius;
+        storeVec3(light.color, record.color);
+        record.intensity = light.intensity;
+        storeVec3(light.target, record.target);
+        record.innerAngle = light.innerAngle;
+        record.outerAngle = light.outerAngle;
+        record.phase = light.phase;
+        record.shadowBiasMin = light.shadowBiasMin;
+        record.shadowBiasSlope = light.shadowBiasSlope;
+        record.shadowImportance = light.shadowImportance;
+        record.type = static_cast<uint32_t>(light.type);
+        record.flags = light.castsShadow ? kSceneLightCastsShadow : 0u;
+        std::memcpy(outBytes.data() + lightOffset + l * sizeof(SceneLightRecord), &record, sizeof(record));
+    }
+
+    // Encode with the same dequantization the pool derives from the stored bounds.
+    for (size_t r = 0; r < meshRecords.size(); ++r) {
+        const SceneMeshRecord& record = meshRecords[r];
+        const MeshGroup& group = *meshOrder[r];
+        const Mesh& mesh = meshes_[group.source];
+        glm::vec4 scale{};
+        glm::vec4 offset{};
+        layout.dequantization(group.bounds, scale, offset);
+        for (size_t v = 0; v < record.vertexCount; ++v) {
+            layout.encode(
+                group.vertices.data() + v * 9,
+                scale,
+                offset,
+                outBytes.data() + record.positionOffset + v * positionStride,
+                outBytes.data() + record.surfaceOffset + v * surfaceStride
+            );
+        }
+        std::memcpy(outBytes.data() + record.indexOffset, mesh.indices.data(), mesh.indices.size() * sizeof(uint32_t));
+    }
+    return true;
+}
+
+}  // namespace render
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/vec3.hpp>
+
+#include "LightStore.hpp"
+#include "RenderQueue.hpp"
+#include "VertexLayout.hpp"
+
+namespace render {
+
+/**
+ * Collects meshes and lights and packs them into the SceneAsset file format.
+ * Meshes are grouped into chunks by the XZ grid cell holding their bounds center and encoded in
+ * the target vertex layout, so the result streams into a MeshPool without further processing.
+ * With instancing on, each mesh is stored relative to its bounds minimum with a flat vertex color
+ * moved into its instance, and meshes of a chunk that then match are stored once and drawn as
+ * instances of that copy.
+ */
+class SceneBuilder {
+public:
+    /**
+     * Adds a mesh; vertices use the MeshBuffer::upload layout (position, normal, color).
+     * @param vertices Interleaved vertex data, 9 floats per vertex.
+     * @param indices Triangle indices.
+     * @param layer Render queue layer.
+     * @param passMask RenderQueue pass bits.
+     * @return false if the data is empty or malformed.
+     */
+    bool addMesh(
+        std::vector<float> vertices,
+        std::vector<unsigned int> indices,
+        RenderLayer layer,
+        uint32_t passMask = RenderQueue::kAllPasses
+    );
+    /**
+     * Adds a light stored with the scene.
+     */
+    void addLight(const LightInstance& light) { lights_.push_back(light); }
+    /**
+     * Removes every mesh and light.
+     */
+    void clear();
+    /**
+     * Enables merging repeated meshes into instanced ones (on by default).
+     */
+    void setInstancing(bool enabled) { instancing_ = enabled; }
+
+    /**
+     * Returns the number of meshes added.
+     */
+    int meshCount() const { return static_cast<int>(meshes_.size()); }
+
+    /**
+     * Packs the meshes and lights into scene file bytes.
+     * @param format Vertex layout the meshes are encoded in.
+     * @param chunkSize Edge of the XZ cells meshes are grouped by.
+     * @param gridOrigin Corner of the cell grid (x and z are used).
+     * @param outBytes Receives the file contents.
+     * @return false if there are no meshes or chunkSize is not positive.
+     */
+    bool build(VertexLayout::Format format, float chunkSize, const glm::vec3& gridOrigin, std::vector<uint8_t>& outBytes) const;
+
+private:
+    /**
+     * Source mesh kept until build.
+     */
+    struct Mesh {
+        std::vector<float> vertices;
+        std::vector<unsigned int> indices;
+        Aabb bounds{};
+        RenderLayer layer{RenderLayer::Geometry};
+        uint32_t passMask{RenderQueue::kAllPasses};
+    };
+
+    std::vector<Mesh> meshes_;
+    std::vector<LightInstance> lights_;
+    bool instancing_{true};
+};
+
+}  // namespace render
@@ -0,0 +1,130 @@
+#include "SceneStreamer.hpp"
+
+#include <algorithm>
+#include <utility>
+
+#include <glm/glm.hpp>
+#include <spdlog/spdlog.h>
+
+namespace render {
+
+// Instance records upload straight from the scene data.
+static_assert(sizeof(SceneInstanceRecord) == sizeof(MeshPool::Instance));
+
+void SceneStreamer::reset(const SceneAsset* asset, MeshPool* pool) {
+    chunks_.clear();
+    meshes_.clear();
+    asset_ = asset && asset->loaded() ? asset : nullptr;
+    pool_ = pool;
+    const size_t chunkCount = asset_ ? static_cast<size_t>(asset_->chunkCount()) : 0;
+    chunks_.resize(chunkCount);
+    broken_.assign(chunkCount, false);
+    stats_ = Stats{};
+    ++revision_;
+}
+
+bool SceneStreamer::update(const Frustum& load, const Frustum& keep, const glm::vec3& focus, size_t byteBudget) {
+    if (!asset_ || !pool_) {
+        return false;
+    }
+    bool changed = false;
+    std::vector<std::pair<float, int>> missing;
+    for (int c = 0; c < asset_->chunkCount(); ++c) {
+        const Aabb bounds = asset_->chunkBounds(c);
+        if (chunks_[static_cast<size_t>(c)]) {
+            if (!keep.intersects(bounds)) {
+                chunks_[static_cast<size_t>(c)].reset();
+                stats_.residentChunks--;
+                stats_.residentMeshes -= static_cast<int>(asset_->chunk(c).meshCount);
+                stats_.residentBytes -= static_cast<size_t>(asset_->chunk(c).dataSize);
+                stats_.unloads++;
+                changed = true;
+            }
+        } else if (!broken_[static_cast<size_t>(c)] && load.intersects(bounds)) {
+            const glm::vec3 offset = 0.5f * (bounds.min + bounds.max) - focus;
+            missing.emplace_back(glm::dot(offset, offset), c);
+        }
+    }
+
+    std::sort(missing.begin(), missing.end());
+    size_t spent = 0;
+    for (const auto& [distance, c] : missing) {
+        const size_t bytes = static_cast<size_t>(asset_->chunk(c).dataSize);
+        if (spent > 0 && spent + bytes > byteBudget) {
+            break;
+        }
+        spent += bytes;
+        if (!loadChunk(c)) {
+            broken_[static_cast<size_t>(c)] = true;
+            continue;
+        }
+        stats_.residentChunks++;
+        stats_.residentMeshes += static_cast<int>(asset_->chunk(c).meshCount);
+        stats_.residentBytes += bytes;
+        stats_.peakResidentBytes = std::max(stats_.peakResidentBytes, stats_.residentBytes);
+        stats_.loads++;
+        changed = true;
+    }
+
+    if (changed) {
+        rebuildMeshList();
+        ++revision_;
+    }
+    return changed;
+}
+
+bool SceneStreamer::loadChunk(int index) {
+    const SceneChunkRecord& chunk = asset_->chunk(index);
+    if (chunk.meshCount == 0) {
+        return false;
+    }
+    auto meshes = std::make_unique<MeshBuffer[]>(chunk.meshCount);
+    for (uint32_t i = 0; i < chunk.meshCount; ++i) {
+        const int meshIndex = static_cast<int>(chunk.firstMesh + i);
+        const SceneMeshRecord& record = asset_->mesh(meshIndex);
+        MeshPool::EncodedMesh encoded{};
+        encoded.positions = asset_->data(record.positionOffset);
+        encoded.surface = asset_->data(record.surfaceOffset);
+        encoded.indices = reinterpret_cast<const GLuint*>(asset_->data(record.indexOffset));
+        encoded.instances = asset_->meshInstances(meshIndex);
+        encoded.vertexCount = record.vertexCount;
+        encoded.indexCount = record.indexCount;
+        encoded.instanceCount = record.instanceCount;
+        // Ranges were checked on open; index values are only read here, right before upload.
+        const GLuint maxIndex = *std::max_element(encoded.indices, encoded.indices + encoded.indexCount);
+        if (maxIndex >= record.vertexCount) {
+            spdlog::error("SceneStreamer: mesh {} indexes past its {} vertices", meshIndex, record.vertexCount);
+            return false;
+        }
+        if (!meshes[i].upload(*pool_, encoded, asset_->meshBounds(meshIndex))) {
+            spdlog::error("SceneStreamer: failed to upload mesh {}", meshIndex);
+            return false;
+        }
+        // Actors may move between frames; shadow caches keep them out of their static layers.
+        meshes[i].setDynamic(record.layer == static_cast<uint32_t>(RenderLayer::Actors));
+    }
+    chunks_[static_cast<size_t>(index)] = std::move(meshes);
+    asset_->evict(index);
+    return true;
+}
+
+void SceneStreamer::rebuildMeshList() {
+    meshes_.clear();
+    for (int c = 0; c < asset_->chunkCount(); ++c) {
+        const MeshBuffer* meshes = chunks_[static_cast<size_t>(c)].get();
+        if (!meshes) {
+            continue;
+        }
+        const SceneChunkRecord& chunk = asset_->chunk(c);
+        for (uint32_t i = 0; i < chunk.meshCount; ++i) {
+            const SceneMeshRecord& record = asset_->mesh(static_cast<int>(chunk.firstMesh + i));
+            SceneMesh mesh{};
+            mesh.mesh = &meshes[i];
+            mesh.layer = static_cast<RenderLayer>(record.layer);
+            mesh.passMask = record.passMask;
+            meshes_.push_back(mesh);
+        }
+    }
+}
+
+}  // namespace render
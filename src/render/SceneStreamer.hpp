@@ -0,0 +1,128 @@
+#ifndef GL_GLEXT_PROTOTYPES
+#define GL_GLEXT_PROTOTYPES
+#endif
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <glm/vec3.hpp>
+
+#include "Frustum.hpp"
+#include "MeshBuffer.hpp"
+#include "MeshPool.hpp"
+#include "RenderQueue.hpp"
+#include "SceneAsset.hpp"
+
+namespace render {
+
+/**
+ * Keeps the chunks of a SceneAsset near the camera resident in a MeshPool.
+ * Chunks entering the load frustum are uploaded nearest first within a per-update byte budget;
+ * chunks leaving the wider keep frustum are released, so a camera moving along a boundary does
+ * not thrash. Uploads read the mesh bytes straight from the asset (the file mapping).
+ */
+class SceneStreamer {
+public:
+    /**
+     * One resident mesh and its render queue placement.
+     */
+    struct SceneMesh {
+        const MeshBuffer* mesh{nullptr};
+        RenderLayer layer{RenderLayer::Geometry};
+        uint32_t passMask{RenderQueue::kAllPasses};
+    };
+
+    /**
+     * Residency counters.
+     */
+    struct Stats {
+        int residentChunks{0};
+        int residentMeshes{0};
+        /**
+         * Vertex and index bytes of the resident chunks.
+         */
+        size_t residentBytes{0};
+        /**
+         * Largest residentBytes seen since reset.
+         */
+        size_t peakResidentBytes{0};
+        /**
+         * Chunk uploads and releases since reset.
+         */
+        int loads{0};
+        int unloads{0};
+    };
+
+    /**
+     * Creates a streamer without a scene.
+     */
+    SceneStreamer() = default;
+
+    /**
+     * Non-copyable because resident meshes hold pool ranges.
+     */
+    SceneStreamer(const SceneStreamer&) = delete;
+    /**
+     * Non-copyable assignment because resident meshes hold pool ranges.
+     */
+    SceneStreamer& operator=(const SceneStreamer&) = delete;
+
+    /**
+     * Releases every resident chunk and starts streaming a new scene.
+     * @param asset Scene to stream (must outlive the streamer's use of it), or nullptr.
+     * @param pool Pool the meshes are uploaded into; must use the asset's vertex format.
+     */
+    void reset(const SceneAsset* asset, MeshPool* pool);
+    /**
+     * Loads and releases chunks for the current camera.
+     * @param load Chunks intersecting this frustum are loaded.
+     * @param keep Resident chunks outside this frustum are released; should contain load.
+     * @param focus World point loads are ordered by (nearest first).
+     * @param byteBudget Upload budget in bytes; at least one chunk loads when any is missing.
+     * @return true when the resident set changed.
+     */
+    bool update(const Frustum& load, const Frustum& keep, const glm::vec3& focus, size_t byteBudget);
+
+    /**
+     * Returns the resident meshes in chunk order.
+     */
+    const std::vector<SceneMesh>& meshes() const { return meshes_; }
+    /**
+     * Returns a counter bumped whenever the resident set changes.
+     */
+    uint64_t revision() const { return revision_; }
+    /**
+     * Returns the residency counters.
+     */
+    const Stats& stats() const { return stats_; }
+
+private:
+    /**
+     * Uploads one chunk's meshes.
+     * @return false if a mesh is malformed or the upload failed (the chunk stays unloaded).
+     */
+    bool loadChunk(int index);
+    /**
+     * Rebuilds meshes_ from the resident chunks.
+     */
+    void rebuildMeshList();
+
+    const SceneAsset* asset_{nullptr};
+    MeshPool* pool_{nullptr};
+    /**
+     * Uploaded meshes per chunk (empty when not resident).
+     */
+    std::vector<std::unique_ptr<MeshBuffer[]>> chunks_;
+    /**
+     * Chunks that failed to load; never retried for this scene.
+     */
+    std::vector<bool> broken_;
+    std::vector<SceneMesh> meshes_;
+    uint64_t revision_{0};
+    Stats stats_{};
+};
+
+}  // namespace render
@@ -0,0 +1,183 @@
+#include "ShaderCache.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+namespace {
+
+constexpr char kBinaryMagic[4] = {'A', 'K', 'P', 'B'};
+constexpr uint32_t kBinaryVersion = 1;
+constexpr uint64_t kFnvOffset = 1469598103934665603ull;
+constexpr uint64_t kFnvPrime = 1099511628211ull;
+
+/**
+ * Header in front of each stored binary.
+ */
+struct BinaryHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t key;
+    uint32_t format;
+    uint32_t length;
+};
+
+uint64_t hashBytes(uint64_t hash, const void* data, size_t size) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ bytes[i]) * kFnvPrime;
+    }
+    return hash;
+}
+
+uint64_t hashGlString(uint64_t hash, GLenum name) {
+    const char* value = reinterpret_cast<const char*>(glGetString(name));
+    if (value) {
+        hash = hashBytes(hash, value, std::strlen(value));
+    }
+    // Separator, so adjacent strings cannot run into each other.
+    return hashBytes(hash, "\0", 1);
+}
+
+}  // namespace
+
+namespace render {
+
+bool ShaderCache::init(const GlFunctions& gl, const std::string& directory) {
+    directory_.clear();
+    enabled_ = false;
+    parallelCompile_ = false;
+    stats_ = Stats{};
+    if (gl.maxShaderCompilerThreads) {
+        // 0xFFFFFFFF lets the driver pick its thread count.
+        gl.maxShaderCompilerThreads(0xFFFFFFFFu);
+        parallelCompile_ = true;
+        spdlog::info("ShaderCache: parallel shader compilation enabled");
+    }
+
+    driverHash_ = kFnvOffset;
+    driverHash_ = hashGlString(driverHash_, GL_VENDOR);
+    driverHash_ = hashGlString(driverHash_, GL_RENDERER);
+    driverHash_ = hashGlString(driverHash_, GL_VERSION);
+    driverHash_ = hashGlString(driverHash_, GL_SHADING_LANGUAGE_VERSION);
+
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    if (directory.empty() || formats <= 0) {
+        spdlog::info("ShaderCache: program binaries unavailable, shaders compile from source");
+        return false;
+    }
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    if (error) {
+        spdlog::warn("ShaderCache: cannot create '{}': {}", directory, error.message());
+        return false;
+    }
+    directory_ = directory;
+    enabled_ = true;
+    spdlog::info("ShaderCache: caching program binaries in {}", directory_);
+    return true;
+}
+
+uint64_t ShaderCache::key(const GLenum* types, const std::string* sources, int count) const {
+    uint64_t hash = hashBytes(kFnvOffset, &driverHash_, sizeof(driverHash_));
+    for (int i = 0; i < count; ++i) {
+        const uint32_t type = types[i];
+        const uint64_t length = sources[i].size();
+        hash = hashBytes(hash, &type, sizeof(type));
+        hash = hashBytes(hash, &length, sizeof(length));
+        hash = hashBytes(hash, sources[i].data(), sources[i].size());
+    }
+    return hash;
+}
+
+bool ShaderCache::load(uint64_t key, GLuint program) {
+    if (!enabled_) {
+        return false;
+    }
+    std::ifstream file(pathFor(key), std::ios::binary);
+    BinaryHeader header{};
+    std::vector<char> binary;
+    if (file && file.read(reinterpret_cast<char*>(&header), sizeof(header)) &&
+        std::memcmp(header.magic, kBinaryMagic, sizeof(kBinaryMagic)) == 0 &&
+        header.version == kBinaryVersion && header.key == key && header.length > 0) {
+        binary.resize(header.length);
+        if (!file.read(binary.data(), static_cast<std::streamsize>(binary.size()))) {
+            binary.clear();
+        }
+    }
+    if (binary.empty()) {
+        ++stats_.misses;
+        return false;
+    }
+
+    glProgramBinary(program, header.format, binary.data(), static_cast<GLsizei>(binary.size()));
+    GLint linked = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!linked) {
+        // Drivers may refuse binaries after an update that kept the version strings.
+        ++stats_.rejected;
+        ++stats_.misses;
+        return false;
+    }
+    ++stats_.hits;
+    return true;
+}
+
+void ShaderCache::store(uint64_t key, GLuint program) {
+    if (!enabled_) {
+        return;
+    }
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return;
+    }
+    std::vector<char> binary(static_cast<size_t>(length));
+    BinaryHeader header{};
+    GLenum format = 0;
+    GLsizei written = 0;
+    glGetProgramBinary(program, length, &written, &format, binary.data());
+    if (written <= 0) {
+        return;
+    }
+    std::memcpy(header.magic, kBinaryMagic, sizeof(kBinaryMagic));
+    header.version = kBinaryVersion;
+    header.key = key;
+    header.format = format;
+    header.length = static_cast<uint32_t>(written);
+
+    // Written beside the final name and renamed, so a crash never leaves a torn binary behind.
+    const std::string path = pathFor(key);
+    const std::string partial = path + ".tmp";
+    {
+        std::ofstream out(partial, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(binary.data(), written);
+        if (!out) {
+            spdlog::warn("ShaderCache: failed writing '{}'", partial);
+            return;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(partial, path, error);
+    if (error) {
+        spdlog::warn("ShaderCache: cannot store '{}': {}", path, error.message());
+        std::filesystem::remove(partial, error);
+        return;
+    }
+    ++stats_.stores;
+}
+
+std::string ShaderCache::pathFor(uint64_t key) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(key));
+    return (std::filesystem::path(directory_) / name).string();
+}
+
+}  // namespace render
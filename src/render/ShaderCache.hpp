@@ -0,0 +1,109 @@
+#ifndef GL_GLEXT_PROTOTYPES
+#define GL_GLEXT_PROTOTYPES
+#endif
+#pragma once
+
+#include <SDL_opengl.h>
+
+#include <cstdint>
+#include <string>
+
+#include "GlFunctions.hpp"
+
+namespace render {
+
+/**
+ * Program binary cache and compile settings shared by every ShaderProgram on the context.
+ * Linked programs are stored with glGetProgramBinary in one file per program, named by a hash of
+ * the driver identity and the stage sources, so a source edit or driver update simply misses.
+ * A binary the driver rejects is treated as a miss and overwritten by the next store.
+ */
+class ShaderCache {
+public:
+    /**
+     * Lookup counters since init.
+     */
+    struct Stats {
+        int hits{0};
+        int misses{0};
+        int stores{0};
+        /**
+         * Cached binaries the driver refused to load (counted as misses too).
+         */
+        int rejected{0};
+    };
+
+    /**
+     * Creates a disabled cache.
+     */
+    ShaderCache() = default;
+
+    /**
+     * Non-copyable because ShaderProgram keeps a pointer to the active cache.
+     */
+    ShaderCache(const ShaderCache&) = delete;
+    /**
+     * Non-copyable assignment because ShaderProgram keeps a pointer to the active cache.
+     */
+    ShaderCache& operator=(const ShaderCache&) = delete;
+
+    /**
+     * Reads the driver identity and enables parallel compilation when the driver offers it.
+     * @param gl Resolved entry points of the current context.
+     * @param directory Directory binaries are kept in (created on demand); empty disables storage.
+     * @return true when program binaries can be cached.
+     */
+    bool init(const GlFunctions& gl, const std::string& directory);
+
+    /**
+     * Returns true when program binaries are loaded and stored.
+     */
+    bool enabled() const { return enabled_; }
+    /**
+     * Returns true when compile and link run on driver threads and their completion can be polled.
+     */
+    bool parallelCompile() const { return parallelCompile_; }
+    /**
+     * Returns the cache directory.
+     */
+    const std::string& directory() const { return directory_; }
+    /**
+     * Returns the lookup counters.
+     */
+    const Stats& stats() const { return stats_; }
+
+    /**
+     * Hashes the stage sources together with the driver identity.
+     * @param types Shader stage of each source.
+     * @param sources Stage sources.
+     * @param count Number of stages.
+     */
+    uint64_t key(const GLenum* types, const std::string* sources, int count) const;
+    /**
+     * Loads a cached binary into a program object.
+     * @param key Value from key().
+     * @param program Program object without attached shaders.
+     * @return true if the program is linked from the cache.
+     */
+    bool load(uint64_t key, GLuint program);
+    /**
+     * Stores a linked program's binary; failures only log.
+     * @param key Value from key().
+     * @param program Program linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set.
+     */
+    void store(uint64_t key, GLuint program);
+
+private:
+    /**
+     * Returns the file a key's binary is kept in.
+     */
+    std::string pathFor(uint64_t key) const;
+
+    std::string directory_;
+    uint64_t driverHash_{0};
+    bool enabled_{false};
+    bool parallelCompile_{false};
+    Stats stats_{};
+};
+
+}  // namespace render
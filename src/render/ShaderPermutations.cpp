@@ -0,0 +1,64 @@
+#include "ShaderPermutations.hpp"
+
+#include <spdlog/spdlog.h>
+
+namespace render {
+
+std::string ShaderPermutations::key(std::initializer_list<Define> defines) {
+    std::string lines;
+    for (const Define& define : defines) {
+        lines += "#define ";
+        lines += define.name;
+        lines += ' ';
+        lines += std::to_string(define.value);
+        lines += '\n';
+    }
+    return lines;
+}
+
+void ShaderPermutations::setSources(const std::string& vertexPath, const std::string& fragmentPath) {
+    programs_.clear();
+    vertexPath_ = vertexPath;
+    fragmentPath_ = fragmentPath;
+}
+
+ShaderProgram& ShaderPermutations::start(const std::string& key) {
+    const auto [it, inserted] = programs_.try_emplace(key);
+    if (inserted) {
+        it->second.setDefines(key);
+        it->second.startFromFiles(vertexPath_, fragmentPath_);
+    }
+    return it->second;
+}
+
+bool ShaderPermutations::finish() {
+    bool linked = true;
+    for (auto it = programs_.begin(); it != programs_.end();) {
+        if (it->second.finish()) {
+            ++it;
+            continue;
+        }
+        // Dropped so the next start() retries instead of handing back an empty program.
+        spdlog::error("ShaderPermutations: failed to build {} with:\n{}", fragmentPath_, it->first);
+        it = programs_.erase(it);
+        linked = false;
+    }
+    return linked;
+}
+
+ShaderProgram* ShaderPermutations::find(const std::string& key) {
+    const auto it = programs_.find(key);
+    return it != programs_.end() ? &it->second : nullptr;
+}
+
+bool ShaderPermutations::reloadChanged() {
+    bool reloaded = false;
+    for (auto& [key, program] : programs_) {
+        if (program.id() != 0 && program.sourcesChanged()) {
+            reloaded = program.reload() || reloaded;
+        }
+    }
+    return reloaded;
+}
+
+}  // namespace render
@@ -0,0 +1,91 @@
+#ifndef GL_GLEXT_PROTOTYPES
+#define GL_GLEXT_PROTOTYPES
+#endif
+#pragma once
+
+#include <SDL_opengl.h>
+
+#include <initializer_list>
+#include <map>
+#include <string>
+
+#include "ShaderProgram.hpp"
+
+namespace render {
+
+/**
+ * Specialized builds of one vertex/fragment source pair. Each permutation is keyed by the define
+ * set injected after #version, so constants the shader would otherwise branch or loop on at run
+ * time fold at compile time. Every permutation is a separate program, so each one goes through
+ * the binary cache under its own key.
+ */
+class ShaderPermutations {
+public:
+    /**
+     * One preprocessor define of a permutation key.
+     */
+    struct Define {
+        const char* name;
+        int value;
+    };
+
+    ShaderPermutations() = default;
+
+    /**
+     * Non-copyable because the programs own GL objects.
+     */
+    ShaderPermutations(const ShaderPermutations&) = delete;
+    /**
+     * Non-copyable assignment because the programs own GL objects.
+     */
+    ShaderPermutations& operator=(const ShaderPermutations&) = delete;
+
+    /**
+     * Builds the permutation key (the define lines) for a define set.
+     * @param defines Defines in a fixed order; the same set must list them in the same order.
+     */
+    static std::string key(std::initializer_list<Define> defines);
+
+    /**
+     * Sets the sources every permutation is built from and drops existing permutations.
+     * @param vertexPath Path to the vertex shader file.
+     * @param fragmentPath Path to the fragment shader file.
+     */
+    void setSources(const std::string& vertexPath, const std::string& fragmentPath);
+    /**
+     * Submits a permutation without waiting for it; an existing one is returned as is.
+     * @param key Define lines from key().
+     * @return The program, linked once finish() has run (the reference dies if that fails).
+     */
+    ShaderProgram& start(const std::string& key);
+    /**
+     * Waits for every submitted permutation; the ones that fail to build are removed.
+     * @return true if all of them linked.
+     */
+    bool finish();
+    /**
+     * Returns the permutation started for a key, or nullptr if it was never started or failed.
+     */
+    ShaderProgram* find(const std::string& key);
+    /**
+     * Rebuilds the permutations whose source files changed.
+     * @return true if any program was replaced.
+     */
+    bool reloadChanged();
+    /**
+     * Deletes every permutation.
+     */
+    void clear() { programs_.clear(); }
+
+    /**
+     * Returns the permutations by key (for binding uniforms after a build or reload).
+     */
+    std::map<std::string, ShaderProgram>& programs() { return programs_; }
+
+private:
+    std::string vertexPath_;
+    std::string fragmentPath_;
+    std::map<std::string, ShaderProgram> programs_;
+};
+
+}  // namespace render
@@ -3,21 +3,31 @@
 #include <spdlog/spdlog.h>
 
 #include <fstream>
-#include <sstream>
+#include <system_error>
+#include <utility>
 #include <vector>
 
+#include "ShaderCache.hpp"
+
 namespace {
 
+render::ShaderCache* activeCache = nullptr;
+
 bool readFile(const std::string& path, std::string& out) {
-    std::ifstream file(path, std::ios::in | std::ios::binary);
+    std::ifstream file(path, std::ios::in | std::ios::binary | std::ios::ate);
     if (!file) {
         spdlog::error("ShaderProgram: unable to open shader file: {}", path);
         return false;
     }
 
-    std::ostringstream buffer;
-    buffer << file.rdbuf();
-    out = buffer.str();
+    // One sized read instead of streaming through a stringstream.
+    const std::streamoff size = file.tellg();
+    out.resize(size > 0 ? static_cast<size_t>(size) : 0);
+    file.seekg(0);
+    if (!out.empty() && !file.read(out.data(), static_cast<std::streamsize>(out.size()))) {
+        spdlog::error("ShaderProgram: unable to read shader file: {}", path);
+        return false;
+    }
     if (out.empty()) {
         spdlog::warn("ShaderProgram: shader file is empty: {}", path);
     }
@@ -25,6 +35,36 @@ bool readFile(const std::string& path, std::string& out) {
     return true;
 }
 
+// #version has to stay the first directive, so the defines go on the line after it.
+void insertDefines(std::string& source, const std::string& defines) {
+    size_t at = 0;
+    const size_t version = source.find("#version");
+    if (version != std::string::npos) {
+        const size_t lineEnd = source.find('\n', version);
+        at = lineEnd == std::string::npos ? source.size() : lineEnd + 1;
+    }
+    source.insert(at, defines);
+}
+
+std::filesystem::file_time_type modifiedTime(const std::string& path) {
+    std::error_code error;
+    const std::filesystem::file_time_type time = std::filesystem::last_write_time(path, error);
+    return error ? std::filesystem::file_time_type{} : time;
+}
+
+const char* stageName(GLenum type) {
+    switch (type) {
+        case GL_VERTEX_SHADER:
+            return "vertex";
+        case GL_GEOMETRY_SHADER:
+            return "geometry";
+        case GL_FRAGMENT_SHADER:
+            return "fragment";
+        default:
+            return "compute";
+    }
+}
+
 }  // namespace
 
 namespace render {
@@ -33,126 +73,234 @@ ShaderProgram::~ShaderProgram() {
     destroy();
 }
 
+void ShaderProgram::setCache(ShaderCache* cache) {
+    activeCache = cache;
+}
+
 void ShaderProgram::destroy() {
+    for (int i = 0; i < pendingCount_; ++i) {
+        glDeleteShader(pendingShaders_[i]);
+    }
+    pendingCount_ = 0;
     if (programId_ != 0) {
         glDeleteProgram(programId_);
         programId_ = 0;
     }
 }
 
-GLuint ShaderProgram::compile(GLenum type, const std::string& source) {
-    GLuint shader = glCreateShader(type);
-    if (shader == 0) {
-        spdlog::error("ShaderProgram: glCreateShader failed");
-        return 0;
-    }
-
-    const char* src = source.c_str();
-    glShaderSource(shader, 1, &src, nullptr);
-    glCompileShader(shader);
+void ShaderProgram::start(const GLenum* types, const std::string* sources, int count) {
+    destroy();
 
-    GLint compiled = 0;
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
-    if (!compiled) {
-        GLint logLength = 0;
-        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &logLength);
-        std::vector<char> log(static_cast<size_t>(logLength + 1), 0);
-        glGetShaderInfoLog(shader, logLength, nullptr, log.data());
-        spdlog::error("ShaderProgram: shader compile error: {}", log.data());
-        glDeleteShader(shader);
-        return 0;
+    programId_ = glCreateProgram();
+    if (programId_ == 0) {
+        spdlog::error("ShaderProgram: glCreateProgram failed");
+        return;
+    }
+    if (activeCache && activeCache->enabled()) {
+        cacheKey_ = activeCache->key(types, sources, count);
+        if (activeCache->load(cacheKey_, programId_)) {
+            return;
+        }
+        // A rejected binary can leave state behind; link into a fresh object.
+        glDeleteProgram(programId_);
+        programId_ = glCreateProgram();
+        glProgramParameteri(programId_, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
     }
 
-    return shader;
+    // Compile status is only read in finish(), so the driver is free to work on every stage
+    // (and, with parallel compilation, every program) before anyone waits.
+    for (int i = 0; i < count; ++i) {
+        const GLuint shader = glCreateShader(types[i]);
+        if (shader == 0) {
+            spdlog::error("ShaderProgram: glCreateShader failed");
+            destroy();
+            return;
+        }
+        const char* src = sources[i].c_str();
+        glShaderSource(shader, 1, &src, nullptr);
+        glCompileShader(shader);
+        glAttachShader(programId_, shader);
+        pendingShaders_[pendingCount_++] = shader;
+    }
+    glLinkProgram(programId_);
 }
 
-bool ShaderProgram::buildFromSource(const std::string& vertexSrc, const std::string& fragmentSrc) {
-    destroy();
-
-    GLuint vs = compile(GL_VERTEX_SHADER, vertexSrc);
-    GLuint fs = compile(GL_FRAGMENT_SHADER, fragmentSrc);
-    if (vs == 0 || fs == 0) {
-        if (vs != 0) glDeleteShader(vs);
-        if (fs != 0) glDeleteShader(fs);
-        return false;
+void ShaderProgram::startFromSourceFiles() {
+    GLenum types[kMaxStages]{};
+    std::string sources[kMaxStages];
+    const int count = static_cast<int>(files_.size());
+    for (int i = 0; i < count; ++i) {
+        SourceFile& file = files_[static_cast<size_t>(i)];
+        file.modified = modifiedTime(file.path);
+        types[i] = file.type;
+        if (!readFile(file.path, sources[i])) {
+            destroy();
+            return;
+        }
+        if (!defines_.empty()) {
+            insertDefines(sources[i], defines_);
+        }
     }
+    start(types, sources, count);
+}
 
-    programId_ = glCreateProgram();
-    glAttachShader(programId_, vs);
-    glAttachShader(programId_, fs);
-    glLinkProgram(programId_);
-
-    glDeleteShader(vs);
-    glDeleteShader(fs);
+bool ShaderProgram::finish() {
+    if (pendingCount_ == 0) {
+        return programId_ != 0;
+    }
 
     GLint linked = 0;
     glGetProgramiv(programId_, GL_LINK_STATUS, &linked);
     if (!linked) {
-        GLint logLength = 0;
-        glGetProgramiv(programId_, GL_INFO_LOG_LENGTH, &logLength);
-        std::vector<char> log(static_cast<size_t>(logLength + 1), 0);
-        glGetProgramInfoLog(programId_, logLength, nullptr, log.data());
-        spdlog::error("ShaderProgram: program link error: {}", log.data());
+        bool compiled = true;
+        for (int i = 0; i < pendingCount_; ++i) {
+            GLint status = 0;
+            glGetShaderiv(pendingShaders_[i], GL_COMPILE_STATUS, &status);
+            if (!status) {
+                GLint logLength = 0;
+                glGetShaderiv(pendingShaders_[i], GL_INFO_LOG_LENGTH, &logLength);
+                std::vector<char> log(static_cast<size_t>(logLength + 1), 0);
+                glGetShaderInfoLog(pendingShaders_[i], logLength, nullptr, log.data());
+                GLint type = 0;
+                glGetShaderiv(pendingShaders_[i], GL_SHADER_TYPE, &type);
+                spdlog::error("ShaderProgram: {} shader compile error: {}", stageName(static_cast<GLenum>(type)), log.data());
+                compiled = false;
+            }
+        }
+        if (compiled) {
+            GLint logLength = 0;
+            glGetProgramiv(programId_, GL_INFO_LOG_LENGTH, &logLength);
+            std::vector<char> log(static_cast<size_t>(logLength + 1), 0);
+            glGetProgramInfoLog(programId_, logLength, nullptr, log.data());
+            spdlog::error("ShaderProgram: program link error: {}", log.data());
+        }
         destroy();
         return false;
     }
 
+    for (int i = 0; i < pendingCount_; ++i) {
+        glDetachShader(programId_, pendingShaders_[i]);
+        glDeleteShader(pendingShaders_[i]);
+    }
+    pendingCount_ = 0;
+    if (activeCache) {
+        activeCache->store(cacheKey_, programId_);
+    }
     return true;
 }
 
+bool ShaderProgram::buildFromSource(const std::string& vertexSrc, const std::string& fragmentSrc) {
+    files_.clear();
+    const GLenum types[] = {GL_VERTEX_SHADER, GL_FRAGMENT_SHADER};
+    const std::string sources[] = {vertexSrc, fragmentSrc};
+    start(types, sources, 2);
+    return finish();
+}
+
 bool ShaderProgram::buildFromFiles(const std::string& vertexPath, const std::string& fragmentPath) {
-    std::string vertexSrc;
-    std::string fragmentSrc;
-    if (!readFile(vertexPath, vertexSrc) || !readFile(fragmentPath, fragmentSrc)) {
-        destroy();
+    startFromFiles(vertexPath, fragmentPath);
+    if (!finish()) {
+        spdlog::error("ShaderProgram: failed to build program from {} and {}", vertexPath, fragmentPath);
         return false;
     }
-    if (!buildFromSource(vertexSrc, fragmentSrc)) {
-        spdlog::error("ShaderProgram: failed to build program from {} and {}", vertexPath, fragmentPath);
+    return true;
+}
+
+bool ShaderProgram::buildFromSource(
+    const std::string& vertexSrc,
+    const std::string& geometrySrc,
+    const std::string& fragmentSrc
+) {
+    files_.clear();
+    const GLenum types[] = {GL_VERTEX_SHADER, GL_GEOMETRY_SHADER, GL_FRAGMENT_SHADER};
+    const std::string sources[] = {vertexSrc, geometrySrc, fragmentSrc};
+    start(types, sources, 3);
+    return finish();
+}
+
+bool ShaderProgram::buildFromFiles(
+    const std::string& vertexPath,
+    const std::string& geometryPath,
+    const std::string& fragmentPath
+) {
+    startFromFiles(vertexPath, geometryPath, fragmentPath);
+    if (!finish()) {
+        spdlog::error(
+            "ShaderProgram: failed to build program from {}, {} and {}",
+            vertexPath,
+            geometryPath,
+            fragmentPath
+        );
         return false;
     }
     return true;
 }
 
 bool ShaderProgram::buildComputeFromSource(const std::string& computeSrc) {
-    destroy();
+    files_.clear();
+    const GLenum type = GL_COMPUTE_SHADER;
+    start(&type, &computeSrc, 1);
+    return finish();
+}
 
-    GLuint cs = compile(GL_COMPUTE_SHADER, computeSrc);
-    if (cs == 0) {
+bool ShaderProgram::buildComputeFromFile(const std::string& computePath) {
+    startComputeFromFile(computePath);
+    if (!finish()) {
+        spdlog::error("ShaderProgram: failed to build compute program from {}", computePath);
         return false;
     }
+    return true;
+}
 
-    programId_ = glCreateProgram();
-    glAttachShader(programId_, cs);
-    glLinkProgram(programId_);
+void ShaderProgram::startFromFiles(const std::string& vertexPath, const std::string& fragmentPath) {
+    files_ = {SourceFile{vertexPath, GL_VERTEX_SHADER}, SourceFile{fragmentPath, GL_FRAGMENT_SHADER}};
+    startFromSourceFiles();
+}
 
-    glDeleteShader(cs);
+void ShaderProgram::startFromFiles(
+    const std::string& vertexPath,
+    const std::string& geometryPath,
+    const std::string& fragmentPath
+) {
+    files_ = {
+        SourceFile{vertexPath, GL_VERTEX_SHADER},
+        SourceFile{geometryPath, GL_GEOMETRY_SHADER},
+        SourceFile{fragmentPath, GL_FRAGMENT_SHADER},
+    };
+    startFromSourceFiles();
+}
 
-    GLint linked = 0;
-    glGetProgramiv(programId_, GL_LINK_STATUS, &linked);
-    if (!linked) {
-        GLint logLength = 0;
-        glGetProgramiv(programId_, GL_INFO_LOG_LENGTH, &logLength);
-        std::vector<char> log(static_cast<size_t>(logLength + 1), 0);
-        glGetProgramInfoLog(programId_, logLength, nullptr, log.data());
-        spdlog::error("ShaderProgram: compute program link error: {}", log.data());
-        destroy();
-        return false;
-    }
+void ShaderProgram::startComputeFromFile(const std::string& computePath) {
+    files_ = {SourceFile{computePath, GL_COMPUTE_SHADER}};
+    startFromSourceFiles();
+}
 
-    return true;
+bool ShaderProgram::sourcesChanged() const {
+    for (const SourceFile& file : files_) {
+        if (modifiedTime(file.path) != file.modified) {
+            return true;
+        }
+    }
+    return false;
 }
 
-bool ShaderProgram::buildComputeFromFile(const std::string& computePath) {
-    std::string computeSrc;
-    if (!readFile(computePath, computeSrc)) {
-        destroy();
+bool ShaderProgram::reload() {
+    if (files_.empty()) {
         return false;
     }
-    if (!buildComputeFromSource(computeSrc)) {
-        spdlog::error("ShaderProgram: failed to build compute program from {}", computePath);
+    ShaderProgram next;
+    next.files_ = files_;
+    next.defines_ = defines_;
+    next.startFromSourceFiles();
+    const bool built = next.finish();
+    // The new modification times are kept either way, so a broken edit is reported once.
+    files_ = next.files_;
+    if (!built) {
+        spdlog::warn("ShaderProgram: keeping the previous build of {}", files_.back().path);
         return false;
     }
+    std::swap(programId_, next.programId_);
+    spdlog::info("ShaderProgram: reloaded {}", files_.back().path);
     return true;
 }
 
@@ -164,4 +312,13 @@ GLint ShaderProgram::uniformLocation(const char* name) const {
     return glGetUniformLocation(programId_, name);
 }
 
+bool ShaderProgram::bindUniformBlock(const char* name, GLuint binding) const {
+    const GLuint index = glGetUniformBlockIndex(programId_, name);
+    if (index == GL_INVALID_INDEX) {
+        return false;
+    }
+    glUniformBlockBinding(programId_, index, binding);
+    return true;
+}
+
 }  // namespace render
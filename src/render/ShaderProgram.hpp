@@ -5,10 +5,22 @@
 
 #include <SDL_opengl.h>
 
+#include <cstdint>
+#include <filesystem>
 #include <string>
+#include <utility>
+#include <vector>
 
 namespace render {
 
+class ShaderCache;
+
+/**
+ * GL program built from GLSL stages, loaded from the active ShaderCache when it holds a binary for
+ * the same sources. Building can be split into start and finish: every program is submitted first
+ * and the link results are read afterwards, so a driver with parallel compilation works on all of
+ * them at once.
+ */
 class ShaderProgram {
 public:
     /**
@@ -43,6 +55,22 @@ public:
      * @return true on success, false on load/compile/link failure.
      */
     bool buildFromFiles(const std::string& vertexPath, const std::string& fragmentPath);
+    /**
+     * Compiles and links a vertex/geometry/fragment program from source strings.
+     * @param vertexSrc GLSL vertex shader source.
+     * @param geometrySrc GLSL geometry shader source.
+     * @param fragmentSrc GLSL fragment shader source.
+     * @return true on successful compile/link, false otherwise.
+     */
+    bool buildFromSource(const std::string& vertexSrc, const std::string& geometrySrc, const std::string& fragmentSrc);
+    /**
+     * Loads vertex/geometry/fragment shaders from files and builds the program.
+     * @param vertexPath Path to the vertex shader file.
+     * @param geometryPath Path to the geometry shader file.
+     * @param fragmentPath Path to the fragment shader file.
+     * @return true on success, false on load/compile/link failure.
+     */
+    bool buildFromFiles(const std::string& vertexPath, const std::string& geometryPath, const std::string& fragmentPath);
     /**
      * Compiles and links a compute program from a source string.
      * @param computeSrc GLSL compute shader source.
@@ -55,6 +83,53 @@ public:
      * @return true on success, false on load/compile/link failure.
      */
     bool buildComputeFromFile(const std::string& computePath);
+    /**
+     * Loads vertex/fragment shaders from files and submits them without waiting for the result.
+     * @param vertexPath Path to the vertex shader file.
+     * @param fragmentPath Path to the fragment shader file.
+     */
+    void startFromFiles(const std::string& vertexPath, const std::string& fragmentPath);
+    /**
+     * Loads vertex/geometry/fragment shaders from files and submits them without waiting for the result.
+     * @param vertexPath Path to the vertex shader file.
+     * @param geometryPath Path to the geometry shader file.
+     * @param fragmentPath Path to the fragment shader file.
+     */
+    void startFromFiles(const std::string& vertexPath, const std::string& geometryPath, const std::string& fragmentPath);
+    /**
+     * Loads a compute shader from file and submits it without waiting for the result.
+     * @param computePath Path to the compute shader file.
+     */
+    void startComputeFromFile(const std::string& computePath);
+    /**
+     * Sets preprocessor lines inserted after the #version directive of every stage read from
+     * files, so one source can build specialized variants. Applies to the next file build and
+     * to reloads.
+     * @param defines Complete lines, e.g. "#define DEBUG_VIEW 2\n".
+     */
+    void setDefines(std::string defines) { defines_ = std::move(defines); }
+    /**
+     * Waits for a started build, logs compile/link errors and stores the binary in the cache.
+     * @return true if the program is linked (immediately true after a cache hit).
+     */
+    bool finish();
+
+    /**
+     * Returns true when a shader file this program was built from has been modified since.
+     */
+    bool sourcesChanged() const;
+    /**
+     * Rebuilds the program from the files it was built from. The current program stays in use
+     * when the new sources fail to build; uniform locations must be queried again on success.
+     * @return true if the program was replaced.
+     */
+    bool reload();
+
+    /**
+     * Sets the cache every program looks up and stores binaries in.
+     * @param cache Cache owned by the caller for as long as programs are built, or nullptr.
+     */
+    static void setCache(ShaderCache* cache);
     /**
      * Binds this program for subsequent draw/dispatch calls.
      */
@@ -65,6 +140,13 @@ public:
      * @return Uniform location, or -1 if not found.
      */
     GLint uniformLocation(const char* name) const;
+    /**
+     * Assigns a uniform block to a uniform buffer binding point.
+     * @param name Block name in the program.
+     * @param binding Binding index the buffer range is bound to.
+     * @return false if the program has no active block of that name.
+     */
+    bool bindUniformBlock(const char* name, GLuint binding) const;
     /**
      * Returns the underlying OpenGL program id.
      * @return Program object id, or 0 if not built.
@@ -73,18 +155,50 @@ public:
 
 private:
     /**
-     * Compiles a shader stage from source.
-     * @param type GL shader type (e.g., GL_VERTEX_SHADER).
-     * @param source GLSL source.
-     * @return Shader object id, or 0 on failure.
+     * Most stages one program links (vertex, geometry, fragment).
      */
-    GLuint compile(GLenum type, const std::string& source);
+    static constexpr int kMaxStages = 3;
+
     /**
-     * Deletes the program object and resets the id.
+     * Shader file a program was built from, with the modification time it was read at.
+     */
+    struct SourceFile {
+        std::string path;
+        GLenum type{GL_VERTEX_SHADER};
+        std::filesystem::file_time_type modified{};
+    };
+
+    /**
+     * Loads the program from the cache, or compiles the stages and starts linking.
+     * @param types Shader stage of each source.
+     * @param sources GLSL sources.
+     * @param count Number of stages.
+     */
+    void start(const GLenum* types, const std::string* sources, int count);
+    /**
+     * Reads files_ (refreshing their modification times) and starts the build.
+     */
+    void startFromSourceFiles();
+    /**
+     * Deletes the program object, any shaders of an unfinished build, and resets the id.
      */
     void destroy();
 
     GLuint programId_{0};
+    /**
+     * Shaders attached for a link that finish() has not checked yet.
+     */
+    GLuint pendingShaders_[kMaxStages]{};
+    int pendingCount_{0};
+    uint64_t cacheKey_{0};
+    /**
+     * Files of the last file build (empty after building from source strings).
+     */
+    std::vector<SourceFile> files_;
+    /**
+     * Lines inserted after the #version directive of file sources.
+     */
+    std::string defines_;
 };
 
 }  // namespace render
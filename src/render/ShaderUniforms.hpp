@@ -0,0 +1,120 @@
+#ifndef GL_GLEXT_PROTOTYPES
+#define GL_GLEXT_PROTOTYPES
+#endif
+#pragma once
+
+#include <SDL_opengl.h>
+
+#include <cstddef>
+#include <cstdint>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include "ShadowSystem.hpp"
+
+namespace render {
+
+/**
+ * Uniform buffer binding of FrameUniforms.
+ */
+constexpr GLuint kFrameUniformBinding = 0;
+/**
+ * Uniform buffer binding of ShadowUniforms.
+ */
+constexpr GLuint kShadowUniformBinding = 1;
+
+/**
+ * Camera and per-frame constants shared by the deferred programs, written once per frame.
+ * Mirrors the std140 FrameUniforms block declared in the deferred shaders; every vec3 is followed
+ * by a scalar that fills its fourth slot, so the C++ layout matches without padding members.
+ */
+struct FrameUniforms {
+    glm::mat4 view;
+    glm::mat4 proj;
+    glm::mat4 viewProj;
+    glm::mat4 invProj;
+    glm::mat4 invView;
+    /**
+     * View-space direction the directional light travels.
+     */
+    glm::vec3 dirLightDir;
+    float dirLightIntensity;
+    glm::vec3 dirLightColor;
+    /**
+     * First texel of this frame's records in the light buffer.
+     */
+    int32_t lightTexelOffset;
+    glm::vec3 ambient;
+    int32_t lightCount;
+    /**
+     * Pixel size of the region the G-buffer and lighting passes render into.
+     */
+    glm::vec2 screenSize;
+    /**
+     * DebugView value read by the composite pass.
+     */
+    int32_t debugMode;
+    int32_t shadowDebugCascade;
+    /**
+     * Maps [0, 1] across the rendered region to G-buffer texture coordinates (the region covers
+     * screenSize texels at the texture origin under dynamic resolution).
+     */
+    glm::vec2 uvScale;
+    /**
+     * Texture coordinate of the last rendered texel center, so filtered reads stay in the region.
+     */
+    glm::vec2 uvMax;
+};
+
+/**
+ * Shadow map matrices and filter settings for the frame, shared by the lighting and composite
+ * programs. Mirrors the std140 ShadowUniforms block; arrays have a 16-byte stride, so the cascade
+ * splits travel as one vec4.
+ */
+struct ShadowUniforms {
+    glm::mat4 cascadeMatrices[ShadowSystem::kMaxCascades];
+    glm::mat4 spotMatrices[ShadowSystem::kMaxSpotShadows];
+    /**
+     * Atlas tile of each spot shadow (offset xy, scale zw in UV; zero scale means no shadow).
+     */
+    glm::vec4 spotRects[ShadowSystem::kMaxSpotShadows];
+    /**
+     * World position (xyz) and far plane (w) of each point shadow; w = 0 means no shadow.
+     */
+    glm::vec4 pointLights[ShadowSystem::kMaxPointShadows];
+    glm::vec4 cascadeSplits;
+    glm::vec2 cascadeTexelSize;
+    float cascadeBiasMin;
+    float cascadeBiasSlope;
+    glm::vec2 spotTexelSize;
+    float pointDiskRadius;
+    int32_t cascadeCount;
+    int32_t cascadePcfRadius;
+    int32_t spotCount;
+    int32_t spotPcfRadius;
+    int32_t pointCount;
+    int32_t pointPcfRadius;
+    /**
+     * ShadowSystem::ShadowFilter applied to every shadow lookup.
+     */
+    int32_t filter;
+    /**
+     * Rounds the size up to the block's 16-byte base alignment.
+     */
+    int32_t reserved[2];
+};
+
+static_assert(ShadowSystem::kMaxCascades == 4, "cascade splits are packed into one vec4");
+static_assert(offsetof(FrameUniforms, dirLightDir) == 320);
+static_assert(offsetof(FrameUniforms, screenSize) == 368);
+static_assert(offsetof(FrameUniforms, uvScale) == 384);
+static_assert(sizeof(FrameUniforms) == 400);
+static_assert(offsetof(ShadowUniforms, cascadeSplits) == 1600);
+static_assert(offsetof(ShadowUniforms, pointDiskRadius) == 1640);
+static_assert(offsetof(ShadowUniforms, pointPcfRadius) == 1664);
+static_assert(sizeof(ShadowUniforms) == 1680);
+
+}  // namespace render
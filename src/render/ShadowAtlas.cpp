@@ -0,0 +1,128 @@
+#include "ShadowAtlas.hpp"
+
+#include <algorithm>
+
+namespace {
+
+int nextPowerOfTwo(int value) {
+    int result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+}  // namespace
+
+namespace render {
+
+// Implicit 4-ary tree: node 0 is the whole atlas, children of n are 4n+1 .. 4n+4
+// (quadrants in x-major order), and level L starts at node (4^L - 1) / 3.
+
+void ShadowAtlas::init(int atlasSize, int minTileSize) {
+    atlasSize_ = nextPowerOfTwo(std::max(atlasSize, 1));
+    minTileSize_ = std::min(nextPowerOfTwo(std::max(minTileSize, 1)), atlasSize_);
+    levelCount_ = 1;
+    for (int size = atlasSize_; size > minTileSize_; size >>= 1) {
+        levelCount_++;
+    }
+    int nodeCount = 0;
+    for (int level = 0, width = 1; level < levelCount_; ++level, width *= 4) {
+        nodeCount += width;
+    }
+    nodes_.assign(static_cast<size_t>(nodeCount), NodeState::Free);
+    usedTexels_ = 0;
+}
+
+void ShadowAtlas::clear() {
+    std::fill(nodes_.begin(), nodes_.end(), NodeState::Free);
+    usedTexels_ = 0;
+}
+
+int ShadowAtlas::clampTileSize(int tileSize) const {
+    return std::clamp(nextPowerOfTwo(std::max(tileSize, 1)), minTileSize_, atlasSize_);
+}
+
+int ShadowAtlas::allocateNode(int node, int level, int targetLevel) {
+    NodeState& state = nodes_[static_cast<size_t>(node)];
+    if (state == NodeState::Used) {
+        return -1;
+    }
+    if (level == targetLevel) {
+        if (state != NodeState::Free) {
+            return -1;
+        }
+        state = NodeState::Used;
+        return node;
+    }
+    if (state == NodeState::Free) {
+        state = NodeState::Split;
+        for (int child = 1; child <= 4; ++child) {
+            nodes_[static_cast<size_t>(node * 4 + child)] = NodeState::Free;
+        }
+    }
+    for (int child = 1; child <= 4; ++child) {
+        const int found = allocateNode(node * 4 + child, level + 1, targetLevel);
+        if (found >= 0) {
+            return found;
+        }
+    }
+    return -1;
+}
+
+bool ShadowAtlas::allocate(int tileSize, Tile& outTile) {
+    outTile = Tile{};
+    if (nodes_.empty()) {
+        return false;
+    }
+    const int size = clampTileSize(tileSize);
+    int targetLevel = 0;
+    for (int s = atlasSize_; s > size; s >>= 1) {
+        targetLevel++;
+    }
+
+    const int node = allocateNode(0, 0, targetLevel);
+    if (node < 0) {
+        // Undo splits that produced no allocation so siblings can merge again.
+        release(Tile{});
+        return false;
+    }
+
+    // Walk back up to recover the tile origin from the quadrant indices.
+    int x = 0;
+    int y = 0;
+    int cellSize = size;
+    for (int n = node; n > 0; n = (n - 1) / 4) {
+        const int quadrant = (n - 1) % 4;
+        x += (quadrant % 2) * cellSize;
+        y += (quadrant / 2) * cellSize;
+        cellSize *= 2;
+    }
+    outTile = Tile{x, y, size, node};
+    usedTexels_ += static_cast<int64_t>(size) * size;
+    return true;
+}
+
+void ShadowAtlas::release(const Tile& tile) {
+    if (tile.node >= 0 && tile.node < static_cast<int>(nodes_.size())) {
+        nodes_[static_cast<size_t>(tile.node)] = NodeState::Free;
+        usedTexels_ -= static_cast<int64_t>(tile.size) * tile.size;
+    }
+
+    // Collapse split nodes whose four children are all free, deepest level first.
+    const int firstLeaf = static_cast<int>(nodes_.size()) - (1 << (2 * (levelCount_ - 1)));
+    for (int node = firstLeaf - 1; node >= 0; --node) {
+        if (nodes_[static_cast<size_t>(node)] != NodeState::Split) {
+            continue;
+        }
+        bool childrenFree = true;
+        for (int child = 1; child <= 4 && childrenFree; ++child) {
+            childrenFree = nodes_[static_cast<size_t>(node * 4 + child)] == NodeState::Free;
+        }
+        if (childrenFree) {
+            nodes_[static_cast<size_t>(node)] = NodeState::Free;
+        }
+    }
+}
+
+}  // namespace render
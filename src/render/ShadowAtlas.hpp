@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace render {
+
+/**
+ * Quadtree (buddy) allocator for square power-of-two tiles inside a square shadow atlas.
+ * Pure bookkeeping: owns no GL objects.
+ */
+class ShadowAtlas {
+public:
+    /**
+     * Allocated region in atlas texels; size is 0 for an empty tile.
+     */
+    struct Tile {
+        int x{0};
+        int y{0};
+        int size{0};
+        /**
+         * Node index inside the quadtree (-1 for an empty tile).
+         */
+        int node{-1};
+    };
+
+    /**
+     * Resets the allocator to a single free node.
+     * @param atlasSize Atlas width/height in texels (power of two).
+     * @param minTileSize Smallest tile handed out (power of two, <= atlasSize).
+     */
+    void init(int atlasSize, int minTileSize);
+    /**
+     * Frees every tile.
+     */
+    void clear();
+
+    /**
+     * Allocates a tile of exactly tileSize texels.
+     * @param tileSize Requested size; rounded up to a power of two and clamped to the allocator range.
+     * @param outTile Receives the allocated tile.
+     * @return true if a free tile was found.
+     */
+    bool allocate(int tileSize, Tile& outTile);
+    /**
+     * Returns a tile to the allocator and merges free siblings.
+     * @param tile Tile previously returned by allocate (empty tiles are ignored).
+     */
+    void release(const Tile& tile);
+
+    /**
+     * Rounds a size up to a power of two and clamps it to [minTileSize, atlasSize].
+     */
+    int clampTileSize(int tileSize) const;
+    /**
+     * Returns the atlas width/height in texels.
+     */
+    int atlasSize() const { return atlasSize_; }
+    /**
+     * Returns the smallest tile size.
+     */
+    int minTileSize() const { return minTileSize_; }
+    /**
+     * Returns the number of texels currently allocated.
+     */
+    int64_t usedTexels() const { return usedTexels_; }
+
+private:
+    enum class NodeState : uint8_t {
+        Free,
+        Split,
+        Used
+    };
+
+    /**
+     * Depth-first search for a free node at the given level, splitting free parents on the way.
+     * @return Node index, or -1 if none is available.
+     */
+    int allocateNode(int node, int level, int targetLevel);
+
+    int atlasSize_{0};
+    int minTileSize_{0};
+    int levelCount_{0};
+    int64_t usedTexels_{0};
+    std::vector<NodeState> nodes_;
+};
+
+}  // namespace render
@@ -3,7 +3,9 @@
 #include <algorithm>
 #include <array>
 #include <cmath>
+#include <functional>
 #include <limits>
+#include <vector>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_inverse.hpp>
@@ -34,6 +36,49 @@ std::array<glm::vec3, 8> getFrustumCornersWorldSpace(const glm::mat4& proj, cons
     return corners;
 }
 
+constexpr uint64_t kFnvOffset = 1469598103934665603ull;
+constexpr uint64_t kFnvPrime = 1099511628211ull;
+
+uint64_t hashCombine(uint64_t hash, uint64_t value) {
+    for (int byte = 0; byte < 8; ++byte) {
+        hash ^= (value >> (byte * 8)) & 0xffu;
+        hash *= kFnvPrime;
+    }
+    return hash;
+}
+
+void createCascadeArray(GLuint& texture, GLuint& fbo, int resolution, int layers) {
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    glTexImage3D(
+        GL_TEXTURE_2D_ARRAY,
+        0,
+        GL_DEPTH_COMPONENT24,
+        resolution,
+        resolution,
+        layers,
+        0,
+        GL_DEPTH_COMPONENT,
+        GL_FLOAT,
+        nullptr
+    );
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    const float border[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+    glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, border);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
 glm::vec3 stableUp(const glm::vec3& dir) {
     const glm::vec3 up(0.0f, 1.0f, 0.0f);
     if (std::abs(glm::dot(dir, up)) > 0.95f) {
@@ -42,22 +87,142 @@ glm::vec3 stableUp(const glm::vec3& dir) {
     return up;
 }
 
+/**
+ * World units the receiver fit pads each cascade's depth range by, and rounds its half extents
+ * up to; rounding keeps the texel size from changing every frame as the camera pans.
+ */
+constexpr float kReceiverZPadding = 0.5f;
+constexpr float kFitExtentStep = 0.25f;
+
+/**
+ * Light-space depth the directional caster volume reaches either way, and the world units it is
+ * widened by so casters touching the view volume's outline stay inside.
+ */
+constexpr float kCasterVolumeDepth = 1.0e4f;
+constexpr float kCasterVolumePadding = 0.5f;
+
+constexpr int kBoxEdges[12][2] = {
+    {0, 1}, {2, 3}, {4, 5}, {6, 7},
+    {0, 2}, {1, 3}, {4, 6}, {5, 7},
+    {0, 4}, {1, 5}, {2, 6}, {3, 7},
+};
+
+std::array<glm::vec3, 8> boxCorners(const glm::vec3& lo, const glm::vec3& hi) {
+    std::array<glm::vec3, 8> corners{};
+    for (int i = 0; i < 8; ++i) {
+        corners[static_cast<size_t>(i)] = glm::vec3(i & 1 ? hi.x : lo.x, i & 2 ? hi.y : lo.y, i & 4 ? hi.z : lo.z);
+    }
+    return corners;
+}
+
+glm::vec3 transformPoint(const glm::mat4& m, const glm::vec3& p) {
+    return glm::vec3(m * glm::vec4(p, 1.0f));
+}
+
+/**
+ * Appends the endpoints of the part of segment a-b inside the box [lo, hi] (Liang-Barsky).
+ */
+void appendClippedSegment(
+    const glm::vec3& a,
+    const glm::vec3& b,
+    const glm::vec3& lo,
+    const glm::vec3& hi,
+    std::vector<glm::vec3>& outPoints
+) {
+    const glm::vec3 d = b - a;
+    float t0 = 0.0f;
+    float t1 = 1.0f;
+    for (int axis = 0; axis < 3; ++axis) {
+        if (std::abs(d[axis]) < 1e-6f) {
+            if (a[axis] < lo[axis] || a[axis] > hi[axis]) {
+                return;
+            }
+            continue;
+        }
+        float tLo = (lo[axis] - a[axis]) / d[axis];
+        float tHi = (hi[axis] - a[axis]) / d[axis];
+        if (tLo > tHi) {
+            std::swap(tLo, tHi);
+        }
+        t0 = std::max(t0, tLo);
+        t1 = std::min(t1, tHi);
+        if (t0 > t1) {
+            return;
+        }
+    }
+    outPoints.push_back(a + d * t0);
+    outPoints.push_back(a + d * t1);
+}
+
+/**
+ * Appends world-space points whose bounds are the bounds of a world AABB cut by a view-space box:
+ * every vertex of the intersection lies on an edge of one box clipped against the other.
+ */
+void appendBoxIntersection(
+    const render::Aabb& world,
+    const glm::vec3& viewLo,
+    const glm::vec3& viewHi,
+    const glm::mat4& view,
+    const glm::mat4& invView,
+    std::vector<glm::vec3>& outPoints
+) {
+    const size_t first = outPoints.size();
+    std::array<glm::vec3, 8> corners = boxCorners(world.min, world.max);
+    for (glm::vec3& corner : corners) {
+        corner = transformPoint(view, corner);
+    }
+    for (const auto& edge : kBoxEdges) {
+        appendClippedSegment(corners[edge[0]], corners[edge[1]], viewLo, viewHi, outPoints);
+    }
+    for (size_t i = first; i < outPoints.size(); ++i) {
+        outPoints[i] = transformPoint(invView, outPoints[i]);
+    }
+    corners = boxCorners(viewLo, viewHi);
+    for (glm::vec3& corner : corners) {
+        corner = transformPoint(invView, corner);
+    }
+    for (const auto& edge : kBoxEdges) {
+        appendClippedSegment(corners[edge[0]], corners[edge[1]], world.min, world.max, outPoints);
+    }
+}
+
 }  // namespace
 
 namespace render {
 
-bool ShadowSystem::init(const std::string& shaderRoot) {
+static_assert(ShadowSystem::kMaxCascades <= ShadowSystem::kMaxLayersPerDraw, "cascades must fit one layered draw");
+
+bool ShadowSystem::init(const std::string& shaderRoot, bool layered) {
     dirCascadeCount_ = std::clamp(dirCascadeCount_, 1, kMaxCascades);
-    dirUpdateEvery_ = std::max(dirUpdateEvery_, 1);
-    spotUpdateEvery_ = std::max(spotUpdateEvery_, 1);
-    pointUpdateEvery_ = std::max(pointUpdateEvery_, 1);
+    dirActiveCascades_ = dirCascadeCount_;
     const std::string shadowVertex = shaderRoot + "shadow_depth.vert";
     const std::string shadowFragment = shaderRoot + "shadow_depth.frag";
     if (!shadowDepthShader_.buildFromFiles(shadowVertex, shadowFragment)) {
         spdlog::error("ShadowSystem: failed to build shadow depth shader");
         return false;
     }
-    shadowMvpLocation_ = shadowDepthShader_.uniformLocation("uLightMVP");
+
+    const std::string distanceFragment = shaderRoot + "shadow_depth_distance.frag";
+    if (!pointDistanceShader_.buildFromFiles(shadowVertex, distanceFragment)) {
+        spdlog::error("ShadowSystem: failed to build point shadow distance shader");
+        return false;
+    }
+
+    layered_ = false;
+    if (layered) {
+        const std::string layeredVertex = shaderRoot + "shadow_depth_layered.vert";
+        const std::string layeredGeometry = shaderRoot + "shadow_depth_layered.geom";
+        if (layeredDepthShader_.buildFromFiles(layeredVertex, layeredGeometry, shadowFragment) &&
+            layeredDistanceShader_.buildFromFiles(layeredVertex, layeredGeometry, distanceFragment)) {
+            layered_ = true;
+        } else {
+            spdlog::warn("ShadowSystem: layered shadow shaders unavailable, rendering one layer per pass");
+        }
+    }
+    queryUniformLocations();
+
+    spotMaxTileSize_ = std::min(spotMaxTileSize_, spotAtlasResolution_);
+    spotAtlas_.init(spotAtlasResolution_, spotMinTileSize_);
 
     ensureDirectionalResources();
     ensureSpotResources();
@@ -65,6 +230,45 @@ bool ShadowSystem::init(const std::string& shaderRoot) {
     return true;
 }
 
+bool ShadowSystem::reloadChanged() {
+    ShaderProgram* const programs[] = {
+        &shadowDepthShader_,
+        &pointDistanceShader_,
+        &layeredDepthShader_,
+        &layeredDistanceShader_,
+    };
+    bool reloaded = false;
+    for (ShaderProgram* program : programs) {
+        if (program->id() != 0 && program->sourcesChanged()) {
+            reloaded = program->reload() || reloaded;
+        }
+    }
+    if (reloaded) {
+        queryUniformLocations();
+    }
+    return reloaded;
+}
+
+void ShadowSystem::queryUniformLocations() {
+    shadowMvpLocation_ = shadowDepthShader_.uniformLocation("uLightMVP");
+    pointDistanceMvpLocation_ = pointDistanceShader_.uniformLocation("uLightMVP");
+    pointDistanceLightPosLocation_ = pointDistanceShader_.uniformLocation("uLightPos");
+    pointDistanceFarPlaneLocation_ = pointDistanceShader_.uniformLocation("uFarPlane");
+    if (!layered_) {
+        return;
+    }
+    layeredDepthMvpLocation_ = layeredDepthShader_.uniformLocation("uLayerMVP[0]");
+    layeredDepthCountLocation_ = layeredDepthShader_.uniformLocation("uLayerCount");
+    layeredDepthBaseLocation_ = layeredDepthShader_.uniformLocation("uLayerBase");
+    layeredDepthViewportStrideLocation_ = layeredDepthShader_.uniformLocation("uViewportStride");
+    layeredDistanceMvpLocation_ = layeredDistanceShader_.uniformLocation("uLayerMVP[0]");
+    layeredDistanceCountLocation_ = layeredDistanceShader_.uniformLocation("uLayerCount");
+    layeredDistanceBaseLocation_ = layeredDistanceShader_.uniformLocation("uLayerBase");
+    layeredDistanceViewportStrideLocation_ = layeredDistanceShader_.uniformLocation("uViewportStride");
+    layeredDistanceLightPosLocation_ = layeredDistanceShader_.uniformLocation("uLightPos");
+    layeredDistanceFarPlaneLocation_ = layeredDistanceShader_.uniformLocation("uFarPlane");
+}
+
 void ShadowSystem::destroy() {
     destroyResources();
 }
@@ -78,6 +282,18 @@ void ShadowSystem::destroyResources() {
         glDeleteTextures(1, &dirShadowMap_);
         dirShadowMap_ = 0;
     }
+    if (dirDepthSampler_ != 0) {
+        glDeleteSamplers(1, &dirDepthSampler_);
+        dirDepthSampler_ = 0;
+    }
+    if (dirStaticFbo_ != 0) {
+        glDeleteFramebuffers(1, &dirStaticFbo_);
+        dirStaticFbo_ = 0;
+    }
+    if (dirStaticMap_ != 0) {
+        glDeleteTextures(1, &dirStaticMap_);
+        dirStaticMap_ = 0;
+    }
     if (spotShadowFbo_ != 0) {
         glDeleteFramebuffers(1, &spotShadowFbo_);
         spotShadowFbo_ = 0;
@@ -94,42 +310,36 @@ void ShadowSystem::destroyResources() {
         glDeleteTextures(1, &pointShadowMap_);
         pointShadowMap_ = 0;
     }
+    // Cached shadow contents die with the textures.
+    spotAtlas_.clear();
+    spotSlots_.fill(SpotSlot{});
+    pointSlots_.fill(PointSlot{});
+    dirCacheValid_.fill(false);
+    dirStaticValid_.fill(false);
 }
 
 void ShadowSystem::ensureDirectionalResources() {
     if (dirShadowMap_ != 0 && dirShadowFbo_ != 0) {
         return;
     }
-
-    glGenTextures(1, &dirShadowMap_);
-    glBindTexture(GL_TEXTURE_2D_ARRAY, dirShadowMap_);
-    glTexImage3D(
-        GL_TEXTURE_2D_ARRAY,
-        0,
-        GL_DEPTH_COMPONENT24,
-        dirShadowResolution_,
-        dirShadowResolution_,
-        dirCascadeCount_,
-        0,
-        GL_DEPTH_COMPONENT,
-        GL_FLOAT,
-        nullptr
-    );
-    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_NONE);
-    const float border[4] = {1.0f, 1.0f, 1.0f, 1.0f};
-    glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, border);
-    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
-
-    glGenFramebuffers(1, &dirShadowFbo_);
-    glBindFramebuffer(GL_FRAMEBUFFER, dirShadowFbo_);
-    glDrawBuffer(GL_NONE);
-    glReadBuffer(GL_NONE);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    createCascadeArray(dirShadowMap_, dirShadowFbo_, dirShadowResolution_, dirCascadeCount_);
+    // The map compares against a reference when sampled; debug views bind this to see raw depth.
+    glGenSamplers(1, &dirDepthSampler_);
+    glSamplerParameteri(dirDepthSampler_, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glSamplerParameteri(dirDepthSampler_, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glSamplerParameteri(dirDepthSampler_, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glSamplerParameteri(dirDepthSampler_, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glSamplerParameteri(dirDepthSampler_, GL_TEXTURE_COMPARE_MODE, GL_NONE);
     dirTexelSize_ = glm::vec2(1.0f / static_cast<float>(dirShadowResolution_));
+    dirCacheValid_.fill(false);
+}
+
+void ShadowSystem::ensureStaticCascadeResources() {
+    if (dirStaticMap_ != 0 && dirStaticFbo_ != 0) {
+        return;
+    }
+    createCascadeArray(dirStaticMap_, dirStaticFbo_, dirShadowResolution_, dirCascadeCount_);
+    dirStaticValid_.fill(false);
 }
 
 void ShadowSystem::ensureSpotResources() {
@@ -138,34 +348,33 @@ void ShadowSystem::ensureSpotResources() {
     }
 
     glGenTextures(1, &spotShadowMap_);
-    glBindTexture(GL_TEXTURE_2D_ARRAY, spotShadowMap_);
-    glTexImage3D(
-        GL_TEXTURE_2D_ARRAY,
+    glBindTexture(GL_TEXTURE_2D, spotShadowMap_);
+    glTexImage2D(
+        GL_TEXTURE_2D,
         0,
         GL_DEPTH_COMPONENT24,
-        spotShadowResolution_,
-        spotShadowResolution_,
-        kMaxSpotShadows,
+        spotAtlasResolution_,
+        spotAtlasResolution_,
         0,
         GL_DEPTH_COMPONENT,
         GL_FLOAT,
         nullptr
     );
-    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_NONE);
-    const float border[4] = {1.0f, 1.0f, 1.0f, 1.0f};
-    glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, border);
-    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    glBindTexture(GL_TEXTURE_2D, 0);
 
     glGenFramebuffers(1, &spotShadowFbo_);
     glBindFramebuffer(GL_FRAMEBUFFER, spotShadowFbo_);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, spotShadowMap_, 0);
     glDrawBuffer(GL_NONE);
     glReadBuffer(GL_NONE);
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    spotTexelSize_ = glm::vec2(1.0f / static_cast<float>(spotShadowResolution_));
+    spotTexelSize_ = glm::vec2(1.0f / static_cast<float>(spotAtlasResolution_));
 }
 
 void ShadowSystem::ensurePointResources() {
@@ -192,7 +401,8 @@ void ShadowSystem::ensurePointResources() {
     glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_NONE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
     glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, 0);
 
     glGenFramebuffers(1, &pointShadowFbo_);
@@ -203,13 +413,19 @@ void ShadowSystem::ensurePointResources() {
     pointShadowDiskRadius_ = 2.5f / static_cast<float>(pointShadowResolution_);
 }
 
-void ShadowSystem::updateDirectional(
+void ShadowSystem::fitDirectional(
     const glm::mat4& view,
     const glm::mat4& proj,
     const glm::vec3& lightDirWorld,
     float nearPlane,
-    float farPlane
-) {
+    float farPlane,
+    const FitBounds& bounds,
+    DirectionalCascades& outCascades
+) const {
+    if (dirFit_ == CascadeFit::Receivers &&
+        fitDirectionalToReceivers(view, proj, lightDirWorld, nearPlane, farPlane, bounds, outCascades)) {
+        return;
+    }
     const glm::mat4 invView = glm::inverse(view);
     const std::array<glm::vec3, 8> corners = getFrustumCornersWorldSpace(proj, view);
 
@@ -220,6 +436,8 @@ void ShadowSystem::updateDirectional(
     const float ratio = maxZ / minZ;
 
     float prevSplitDist = 0.0f;
+    outCascades.invView = invView;
+    outCascades.count = dirCascadeCount_;
 
     for (int i = 0; i < dirCascadeCount_; ++i) {
         const float p = static_cast<float>(i + 1) / static_cast<float>(dirCascadeCount_);
@@ -272,47 +490,424 @@ void ShadowSystem::updateDirectional(
         const float farClip = -minCorner.z;
         const glm::mat4 lightProj = glm::ortho(minCorner.x, maxCorner.x, minCorner.y, maxCorner.y, nearClip, farClip);
 
-        dirShadowViewProj_[i] = lightProj * lightView;
-        dirShadowMatrices_[i] = dirShadowViewProj_[i] * invView;
-        dirCascadeSplits_[i] = split;
+        outCascades.viewProj[i] = lightProj * lightView;
+        outCascades.matrices[i] = outCascades.viewProj[i] * invView;
+        outCascades.splits[i] = split;
 
         prevSplitDist = splitDist;
     }
 }
 
+bool ShadowSystem::fitDirectionalToReceivers(
+    const glm::mat4& view,
+    const glm::mat4& proj,
+    const glm::vec3& lightDirWorld,
+    float nearPlane,
+    float farPlane,
+    const FitBounds& bounds,
+    DirectionalCascades& outCascades
+) const {
+    // An orthographic view volume is a box in view space.
+    const glm::mat4 invProj = glm::inverse(proj);
+    glm::vec3 viewLo(std::numeric_limits<float>::max());
+    glm::vec3 viewHi(std::numeric_limits<float>::lowest());
+    for (const glm::vec3& ndc : boxCorners(glm::vec3(-1.0f), glm::vec3(1.0f))) {
+        const glm::vec4 corner = invProj * glm::vec4(ndc, 1.0f);
+        viewLo = glm::min(viewLo, glm::vec3(corner) / corner.w);
+        viewHi = glm::max(viewHi, glm::vec3(corner) / corner.w);
+    }
+    viewLo.z = std::max(viewLo.z, -farPlane);
+    viewHi.z = std::min(viewHi.z, -nearPlane);
+
+    const glm::mat4 invView = glm::inverse(view);
+    std::vector<glm::vec3> points;
+    auto collectReceivers = [&](float nearDepth, float farDepth) {
+        points.clear();
+        const glm::vec3 lo(viewLo.x, viewLo.y, -farDepth);
+        const glm::vec3 hi(viewHi.x, viewHi.y, -nearDepth);
+        for (int i = 0; i < bounds.receiverCount; ++i) {
+            appendBoxIntersection(bounds.receivers[i], lo, hi, view, invView, points);
+        }
+    };
+    collectReceivers(-viewHi.z, -viewLo.z);
+    if (points.empty()) {
+        return false;
+    }
+
+    // Only depths with visible receivers get cascades: the view volume's depth is the camera's
+    // near/far range, most of which is empty.
+    float minDepth = std::numeric_limits<float>::max();
+    float maxDepth = std::numeric_limits<float>::lowest();
+    for (const glm::vec3& point : points) {
+        const float depth = -transformPoint(view, point).z;
+        minDepth = std::min(minDepth, depth);
+        maxDepth = std::max(maxDepth, depth);
+    }
+
+    // The light frame is fixed; translation lives in each cascade's ortho bounds, so texel
+    // snapping happens on one grid for every cascade and frame.
+    const glm::vec3 lightDir = glm::normalize(lightDirWorld);
+    const glm::mat4 lightRotation = glm::lookAt(glm::vec3(0.0f), lightDir, stableUp(lightDir));
+    auto lightBounds = [&](glm::vec3& lo, glm::vec3& hi) {
+        lo = glm::vec3(std::numeric_limits<float>::max());
+        hi = glm::vec3(std::numeric_limits<float>::lowest());
+        for (const glm::vec3& point : points) {
+            const glm::vec3 lightSpace = transformPoint(lightRotation, point);
+            lo = glm::min(lo, lightSpace);
+            hi = glm::max(hi, lightSpace);
+        }
+    };
+
+    // Texels over a uniform depth split all cover the same screen area under an orthographic
+    // camera, so one map is enough once it is sharp enough on its own (zoomed in).
+    glm::vec3 lo;
+    glm::vec3 hi;
+    lightBounds(lo, hi);
+    const float resolution = static_cast<float>(dirShadowResolution_);
+    const float singleTexel = std::max(hi.x - lo.x, hi.y - lo.y) / resolution;
+    const int count = singleTexel <= dirSingleMapMaxTexel_ ? 1 : dirCascadeCount_;
+
+    outCascades.invView = invView;
+    outCascades.count = count;
+    for (int i = 0; i < count; ++i) {
+        const float nearDepth = minDepth + (maxDepth - minDepth) * static_cast<float>(i) / static_cast<float>(count);
+        const float farDepth = minDepth + (maxDepth - minDepth) * static_cast<float>(i + 1) / static_cast<float>(count);
+        if (count > 1) {
+            collectReceivers(nearDepth, farDepth);
+            if (points.empty()) {
+                // A gap between receivers; the slab itself keeps the cascade well defined.
+                for (const glm::vec3& corner : boxCorners(glm::vec3(viewLo.x, viewLo.y, -farDepth), glm::vec3(viewHi.x, viewHi.y, -nearDepth))) {
+                    points.push_back(transformPoint(invView, corner));
+                }
+            }
+        }
+        lightBounds(lo, hi);
+
+        // Casters over the cascade's footprint may sit between the light (+z) and the receivers.
+        for (int c = 0; c < bounds.casterCount; ++c) {
+            glm::vec3 casterLo(std::numeric_limits<float>::max());
+            glm::vec3 casterHi(std::numeric_limits<float>::lowest());
+            for (const glm::vec3& corner : boxCorners(bounds.casters[c].min, bounds.casters[c].max)) {
+                const glm::vec3 lightSpace = transformPoint(lightRotation, corner);
+                casterLo = glm::min(casterLo, lightSpace);
+                casterHi = glm::max(casterHi, lightSpace);
+            }
+            if (casterLo.x <= hi.x && casterHi.x >= lo.x && casterLo.y <= hi.y && casterHi.y >= lo.y) {
+                hi.z = std::max(hi.z, casterHi.z);
+            }
+        }
+        lo.z -= kReceiverZPadding;
+        hi.z += kReceiverZPadding;
+
+        // The extra step covers the shift of snapping the center to the texel grid.
+        const glm::vec2 extent(
+            std::ceil(0.5f * (hi.x - lo.x) / kFitExtentStep) * kFitExtentStep + kFitExtentStep,
+            std::ceil(0.5f * (hi.y - lo.y) / kFitExtentStep) * kFitExtentStep + kFitExtentStep
+        );
+        const glm::vec2 texel = extent * 2.0f / resolution;
+        const glm::vec2 center = glm::floor(0.5f * (glm::vec2(lo) + glm::vec2(hi)) / texel) * texel;
+        const glm::mat4 lightProj = glm::ortho(
+            center.x - extent.x,
+            center.x + extent.x,
+            center.y - extent.y,
+            center.y + extent.y,
+            -hi.z,
+            -lo.z
+        );
+
+        outCascades.viewProj[static_cast<size_t>(i)] = lightProj * lightRotation;
+        outCascades.matrices[static_cast<size_t>(i)] = outCascades.viewProj[static_cast<size_t>(i)] * invView;
+        outCascades.splits[static_cast<size_t>(i)] = farDepth;
+    }
+    return true;
+}
+
+glm::mat4 ShadowSystem::directionalCasterVolume(
+    const glm::mat4& view,
+    const glm::mat4& proj,
+    const glm::vec3& lightDirWorld
+) {
+    const glm::vec3 lightDir = glm::normalize(lightDirWorld);
+    const glm::mat4 lightRotation = glm::lookAt(glm::vec3(0.0f), lightDir, stableUp(lightDir));
+    const glm::mat4 invViewProj = glm::inverse(proj * view);
+    glm::vec2 lo(std::numeric_limits<float>::max());
+    glm::vec2 hi(std::numeric_limits<float>::lowest());
+    for (const glm::vec3& ndc : boxCorners(glm::vec3(-1.0f), glm::vec3(1.0f))) {
+        const glm::vec4 corner = invViewProj * glm::vec4(ndc, 1.0f);
+        const glm::vec3 lightSpace = transformPoint(lightRotation, glm::vec3(corner) / corner.w);
+        lo = glm::min(lo, glm::vec2(lightSpace));
+        hi = glm::max(hi, glm::vec2(lightSpace));
+    }
+    lo -= glm::vec2(kCasterVolumePadding);
+    hi += glm::vec2(kCasterVolumePadding);
+    return glm::ortho(lo.x, hi.x, lo.y, hi.y, -kCasterVolumeDepth, kCasterVolumeDepth) * lightRotation;
+}
+
+void ShadowSystem::setDirectional(const DirectionalCascades& cascades) {
+    dirShadowViewProj_ = cascades.viewProj;
+    dirShadowMatrices_ = cascades.matrices;
+    dirCascadeSplits_ = cascades.splits;
+    dirInvView_ = cascades.invView;
+    const int count = std::clamp(cascades.count, 1, dirCascadeCount_);
+    // Layers coming back into use still hold whatever they were last fitted to.
+    for (int cascade = dirActiveCascades_; cascade < count; ++cascade) {
+        dirCacheValid_[static_cast<size_t>(cascade)] = false;
+    }
+    dirActiveCascades_ = count;
+}
+
+void ShadowSystem::setCascadeSchedule(const CascadeSchedule& schedule) {
+    dirSchedule_ = schedule;
+    for (int& every : dirSchedule_.updateEvery) {
+        every = std::max(every, 1);
+    }
+}
+
 void ShadowSystem::beginFrame() {
-    spotShadowCount_ = 0;
-    pointShadowCount_ = 0;
+    spotRequests_.clear();
+    pointRequests_.clear();
     frameIndex_++;
 }
 
-int ShadowSystem::registerSpotShadow(const SpotShadowDesc& desc, const glm::mat4& invView) {
-    if (spotShadowCount_ >= kMaxSpotShadows) {
-        return -1;
-    }
-    (void)desc.biasMin;
-    (void)desc.biasSlope;
-    const int idx = spotShadowCount_++;
+int ShadowSystem::requestSpotShadow(const SpotShadowDesc& desc) {
     const glm::vec3 dir = glm::normalize(desc.direction);
     const glm::vec3 up = stableUp(dir);
     const float farPlane = std::max(desc.radius, 0.2f);
     const glm::mat4 lightView = glm::lookAt(desc.position, desc.position + dir, up);
     const glm::mat4 lightProj = glm::perspective(glm::radians(desc.outerAngleDeg * 2.0f), 1.0f, kSpotNearPlane, farPlane);
+    spotRequests_.push_back(SpotRequest{desc, lightProj * lightView, 0.0f, -1, 0});
+    return static_cast<int>(spotRequests_.size()) - 1;
+}
+
+int ShadowSystem::requestPointShadow(const PointShadowDesc& desc) {
+    pointRequests_.push_back(PointRequest{desc, 0.0f, -1, {}, 0.0f, 0});
+    return static_cast<int>(pointRequests_.size()) - 1;
+}
 
-    spotShadowViewProj_[idx] = lightProj * lightView;
-    spotShadowMatrices_[idx] = spotShadowViewProj_[idx] * invView;
-    return idx;
+void ShadowSystem::setCasters(const CasterIndex& casters) {
+    casters_ = casters;
 }
 
-int ShadowSystem::registerPointShadow(const PointShadowDesc& desc) {
-    if (pointShadowCount_ >= kMaxPointShadows) {
+int ShadowSystem::spotShadowSlot(int request) const {
+    if (request < 0 || request >= static_cast<int>(spotRequests_.size())) {
         return -1;
     }
-    (void)desc.biasMin;
-    (void)desc.biasSlope;
-    const int idx = pointShadowCount_++;
-    const float farPlane = std::max(desc.radius, 0.2f);
-    const glm::mat4 lightProj = glm::perspective(glm::radians(90.0f), 1.0f, kPointNearPlane, farPlane);
+    return spotRequests_[static_cast<size_t>(request)].slot;
+}
+
+int ShadowSystem::pointShadowSlot(int request) const {
+    if (request < 0 || request >= static_cast<int>(pointRequests_.size())) {
+        return -1;
+    }
+    return pointRequests_[static_cast<size_t>(request)].slot;
+}
+
+void ShadowSystem::resolveShadows(const glm::mat4& invView) {
+    const glm::vec3 cameraPos(invView[3]);
+    allocationStats_ = AllocationStats{};
+    resolveSpotShadows(cameraPos, invView);
+    resolvePointShadows(cameraPos);
+}
+
+float ShadowSystem::renderUrgency(float priority, bool rendered, int lastRenderedFrame) const {
+    // Lights that never rendered go first; otherwise staleness scales priority so low-ranked
+    // lights still refresh instead of starving behind the top of the list.
+    if (!rendered) {
+        return std::numeric_limits<float>::max();
+    }
+    return priority * static_cast<float>(std::max(frameIndex_ - lastRenderedFrame, 1));
+}
+
+int ShadowSystem::spotTileSizeForPriority(float priority) const {
+    const int wanted = static_cast<int>(priority * spotTileScale_);
+    return std::min(spotAtlas_.clampTileSize(wanted), spotMaxTileSize_);
+}
+
+void ShadowSystem::resolveSpotShadows(const glm::vec3& cameraPos, const glm::mat4& invView) {
+    allocationStats_.spotRequested = static_cast<int>(spotRequests_.size());
+    // Priority approximates projected size: radius over distance, weighted by importance.
+    spotOrder_.resize(spotRequests_.size());
+    for (size_t i = 0; i < spotRequests_.size(); ++i) {
+        SpotRequest& request = spotRequests_[i];
+        const float distance = std::max(glm::length(request.desc.position - cameraPos), 0.5f);
+        request.priority = request.desc.importance * request.desc.radius / distance;
+        spotOrder_[i] = static_cast<int>(i);
+    }
+    std::stable_sort(spotOrder_.begin(), spotOrder_.end(), [this](int a, int b) {
+        return spotRequests_[static_cast<size_t>(a)].priority > spotRequests_[static_cast<size_t>(b)].priority;
+    });
+    const size_t grantCount = std::min(spotOrder_.size(), static_cast<size_t>(kMaxSpotShadows));
+
+    // Keep the slot (and tile) of every light that is still granted; free the rest.
+    std::array<bool, kMaxSpotShadows> claimed{};
+    for (size_t rank = 0; rank < grantCount; ++rank) {
+        SpotRequest& request = spotRequests_[static_cast<size_t>(spotOrder_[rank])];
+        for (int slot = 0; slot < kMaxSpotShadows; ++slot) {
+            if (spotSlots_[slot].id == request.desc.id) {
+                request.slot = slot;
+                claimed[slot] = true;
+                break;
+            }
+        }
+    }
+    for (int slot = 0; slot < kMaxSpotShadows; ++slot) {
+        if (!claimed[slot] && spotSlots_[slot].id >= 0) {
+            spotAtlas_.release(spotSlots_[slot].tile);
+            spotSlots_[slot] = SpotSlot{};
+        }
+    }
+
+    // Resize tiles whose wanted size moved by more than one step (hysteresis against flicker).
+    // The size asked for is compared, not the one granted: a tile shrunk to fit a full atlas
+    // would otherwise be reallocated and re-rendered every frame.
+    for (size_t rank = 0; rank < grantCount; ++rank) {
+        SpotRequest& request = spotRequests_[static_cast<size_t>(spotOrder_[rank])];
+        if (request.slot < 0) {
+            continue;
+        }
+        SpotSlot& slot = spotSlots_[request.slot];
+        const int wanted = spotTileSizeForPriority(request.priority);
+        if (slot.tile.size != 0 && wanted != slot.requestedSize && wanted != slot.requestedSize / 2) {
+            spotAtlas_.release(slot.tile);
+            slot.tile = ShadowAtlas::Tile{};
+            slot.rendered = false;
+        }
+    }
+
+    // New lights take a free slot; tiles are allocated highest priority first and shrink to fit.
+    for (size_t rank = 0; rank < grantCount; ++rank) {
+        SpotRequest& request = spotRequests_[static_cast<size_t>(spotOrder_[rank])];
+        if (request.slot < 0) {
+            for (int slot = 0; slot < kMaxSpotShadows; ++slot) {
+                if (!claimed[slot]) {
+                    claimed[slot] = true;
+                    request.slot = slot;
+                    spotSlots_[slot] = SpotSlot{};
+                    spotSlots_[slot].id = request.desc.id;
+                    break;
+                }
+            }
+        }
+        SpotSlot& slot = spotSlots_[request.slot];
+        if (slot.tile.size == 0) {
+            slot.requestedSize = spotTileSizeForPriority(request.priority);
+            for (int size = slot.requestedSize; size >= spotAtlas_.minTileSize(); size /= 2) {
+                if (spotAtlas_.allocate(size, slot.tile)) {
+                    break;
+                }
+            }
+            slot.rendered = false;
+        }
+    }
+
+    // Re-render changed tiles until the texel budget is spent, most urgent first.
+    spotRenderOrder_.clear();
+    for (size_t rank = 0; rank < grantCount; ++rank) {
+        SpotRequest& request = spotRequests_[static_cast<size_t>(spotOrder_[rank])];
+        SpotSlot& slot = spotSlots_[request.slot];
+        slot.renderThisFrame = false;
+        if (slot.tile.size == 0) {
+            continue;
+        }
+        request.casterSignature = casterSignature(&request.viewProj, 1, CasterFilter::All);
+        if (!slot.rendered || slot.viewProj != request.viewProj || slot.casterSignature != request.casterSignature) {
+            spotRenderOrder_.push_back(spotOrder_[rank]);
+        }
+    }
+    std::stable_sort(spotRenderOrder_.begin(), spotRenderOrder_.end(), [this](int a, int b) {
+        const SpotRequest& ra = spotRequests_[static_cast<size_t>(a)];
+        const SpotRequest& rb = spotRequests_[static_cast<size_t>(b)];
+        return renderUrgency(ra.priority, spotSlots_[ra.slot].rendered, spotSlots_[ra.slot].lastRenderedFrame) >
+               renderUrgency(rb.priority, spotSlots_[rb.slot].rendered, spotSlots_[rb.slot].lastRenderedFrame);
+    });
+    int64_t texelsRendered = 0;
+    for (int requestIndex : spotRenderOrder_) {
+        const SpotRequest& request = spotRequests_[static_cast<size_t>(requestIndex)];
+        SpotSlot& slot = spotSlots_[request.slot];
+        const int64_t texels = static_cast<int64_t>(slot.tile.size) * slot.tile.size;
+        if (texelsRendered != 0 && texelsRendered + texels > spotTexelBudget_) {
+            continue;
+        }
+        slot.viewProj = request.viewProj;
+        slot.casterSignature = request.casterSignature;
+        slot.rendered = true;
+        slot.renderThisFrame = true;
+        slot.lastRenderedFrame = frameIndex_;
+        texelsRendered += texels;
+        allocationStats_.spotRendered++;
+    }
+
+    spotShadowCount_ = 0;
+    spotShadowRects_.fill(glm::vec4(0.0f));
+    for (size_t rank = 0; rank < grantCount; ++rank) {
+        SpotRequest& request = spotRequests_[static_cast<size_t>(spotOrder_[rank])];
+        const SpotSlot& slot = spotSlots_[request.slot];
+        if (slot.tile.size == 0 || !slot.rendered) {
+            request.slot = -1;
+            continue;
+        }
+        if (!slot.renderThisFrame) {
+            // Stale tiles keep sampling with the matrix they were rendered with.
+            allocationStats_.spotCached++;
+        }
+
+        const float atlasSize = static_cast<float>(spotAtlasResolution_);
+        spotShadowMatrices_[request.slot] = slot.viewProj * invView;
+        spotShadowRects_[request.slot] = glm::vec4(
+            static_cast<float>(slot.tile.x) / atlasSize,
+            static_cast<float>(slot.tile.y) / atlasSize,
+            static_cast<float>(slot.tile.size) / atlasSize,
+            static_cast<float>(slot.tile.size) / atlasSize
+        );
+        spotShadowCount_ = std::max(spotShadowCount_, request.slot + 1);
+        allocationStats_.spotGranted++;
+    }
+}
+
+void ShadowSystem::resolvePointShadows(const glm::vec3& cameraPos) {
+    allocationStats_.pointRequested = static_cast<int>(pointRequests_.size());
+    pointOrder_.resize(pointRequests_.size());
+    for (size_t i = 0; i < pointRequests_.size(); ++i) {
+        PointRequest& request = pointRequests_[i];
+        const float distance = std::max(glm::length(request.desc.position - cameraPos), 0.5f);
+        request.priority = request.desc.importance * request.desc.radius / distance;
+        pointOrder_[i] = static_cast<int>(i);
+    }
+    std::stable_sort(pointOrder_.begin(), pointOrder_.end(), [this](int a, int b) {
+        return pointRequests_[static_cast<size_t>(a)].priority > pointRequests_[static_cast<size_t>(b)].priority;
+    });
+    const size_t grantCount = std::min(pointOrder_.size(), static_cast<size_t>(kMaxPointShadows));
+
+    std::array<bool, kMaxPointShadows> claimed{};
+    for (size_t rank = 0; rank < grantCount; ++rank) {
+        PointRequest& request = pointRequests_[static_cast<size_t>(pointOrder_[rank])];
+        for (int slot = 0; slot < kMaxPointShadows; ++slot) {
+            if (pointSlots_[slot].id == request.desc.id) {
+                request.slot = slot;
+                claimed[slot] = true;
+                break;
+            }
+        }
+    }
+    for (int slot = 0; slot < kMaxPointShadows; ++slot) {
+        if (!claimed[slot]) {
+            pointSlots_[slot] = PointSlot{};
+        }
+    }
+    for (size_t rank = 0; rank < grantCount; ++rank) {
+        PointRequest& request = pointRequests_[static_cast<size_t>(pointOrder_[rank])];
+        if (request.slot >= 0) {
+            continue;
+        }
+        for (int slot = 0; slot < kMaxPointShadows; ++slot) {
+            if (!claimed[slot]) {
+                claimed[slot] = true;
+                request.slot = slot;
+                pointSlots_[slot].id = request.desc.id;
+                break;
+            }
+        }
+    }
 
     const std::array<glm::vec3, 6> directions = {
         glm::vec3(1.0f, 0.0f, 0.0f),
@@ -331,22 +926,256 @@ int ShadowSystem::registerPointShadow(const PointShadowDesc& desc) {
         glm::vec3(0.0f, -1.0f, 0.0f)
     };
 
-    for (int face = 0; face < 6; ++face) {
-        const glm::mat4 lightView = glm::lookAt(desc.position, desc.position + directions[face], ups[face]);
-        pointShadowViewProj_[idx][face] = lightProj * lightView;
+    pointRenderOrder_.clear();
+    for (size_t rank = 0; rank < grantCount; ++rank) {
+        PointRequest& request = pointRequests_[static_cast<size_t>(pointOrder_[rank])];
+        PointSlot& slot = pointSlots_[request.slot];
+        slot.renderThisFrame = false;
+        const glm::vec3& position = request.desc.position;
+        request.farPlane = std::max(request.desc.radius, 0.2f);
+        const glm::mat4 lightProj = glm::perspective(glm::radians(90.0f), 1.0f, kPointNearPlane, request.farPlane);
+        for (int face = 0; face < 6; ++face) {
+            const glm::mat4 lightView = glm::lookAt(position, position + directions[face], ups[face]);
+            request.viewProj[face] = lightProj * lightView;
+        }
+        request.casterSignature = casterSignature(request.viewProj.data(), 6, CasterFilter::All);
+        if (!slot.rendered || slot.position != position || slot.farPlane != request.farPlane ||
+            slot.casterSignature != request.casterSignature) {
+            pointRenderOrder_.push_back(pointOrder_[rank]);
+        }
+    }
+    std::stable_sort(pointRenderOrder_.begin(), pointRenderOrder_.end(), [this](int a, int b) {
+        const PointRequest& ra = pointRequests_[static_cast<size_t>(a)];
+        const PointRequest& rb = pointRequests_[static_cast<size_t>(b)];
+        return renderUrgency(ra.priority, pointSlots_[ra.slot].rendered, pointSlots_[ra.slot].lastRenderedFrame) >
+               renderUrgency(rb.priority, pointSlots_[rb.slot].rendered, pointSlots_[rb.slot].lastRenderedFrame);
+    });
+    int facesRendered = 0;
+    for (int requestIndex : pointRenderOrder_) {
+        const PointRequest& request = pointRequests_[static_cast<size_t>(requestIndex)];
+        PointSlot& slot = pointSlots_[request.slot];
+        if (facesRendered != 0 && facesRendered + 6 > pointFaceBudget_) {
+            continue;
+        }
+        slot.viewProj = request.viewProj;
+        slot.position = request.desc.position;
+        slot.farPlane = request.farPlane;
+        slot.casterSignature = request.casterSignature;
+        slot.rendered = true;
+        slot.renderThisFrame = true;
+        slot.lastRenderedFrame = frameIndex_;
+        facesRendered += 6;
+        allocationStats_.pointRendered++;
+    }
+
+    pointShadowCount_ = 0;
+    pointShadowLights_.fill(glm::vec4(0.0f));
+    for (size_t rank = 0; rank < grantCount; ++rank) {
+        PointRequest& request = pointRequests_[static_cast<size_t>(pointOrder_[rank])];
+        const PointSlot& slot = pointSlots_[request.slot];
+        if (!slot.rendered) {
+            request.slot = -1;
+            continue;
+        }
+        if (!slot.renderThisFrame) {
+            allocationStats_.pointCached++;
+        }
+
+        pointShadowLights_[request.slot] = glm::vec4(slot.position, slot.farPlane);
+        pointShadowCount_ = std::max(pointShadowCount_, request.slot + 1);
+        allocationStats_.pointGranted++;
+    }
+}
+
+bool ShadowSystem::matchesFilter(const MeshBuffer& mesh, CasterFilter filter) {
+    switch (filter) {
+        case CasterFilter::StaticOnly:
+            return !mesh.dynamic();
+        case CasterFilter::DynamicOnly:
+            return mesh.dynamic();
+        case CasterFilter::All:
+            break;
+    }
+    return true;
+}
+
+int ShadowSystem::gatherCasters(const glm::mat4* viewProj, int count, CasterFilter filter) {
+    viewCasters_.clear();
+    if (!casters_.grid || !casters_.meshes) {
+        return 0;
+    }
+    casters_.grid->query(viewProj, count, RenderQueue::kShadowPass, casterHandles_);
+    for (const int handle : casterHandles_) {
+        const MeshBuffer* mesh = (*casters_.meshes)[static_cast<size_t>(handle)];
+        if (mesh && matchesFilter(*mesh, filter)) {
+            viewCasters_.push_back(mesh);
+        }
+    }
+    // Handles come back ascending, so the stable sort keeps the order fixed from frame to frame.
+    std::stable_sort(viewCasters_.begin(), viewCasters_.end(), [](const MeshBuffer* a, const MeshBuffer* b) {
+        return std::less<MeshPool*>()(a->pool(), b->pool());
+    });
+    const int total = filter == CasterFilter::StaticOnly ? casters_.staticCount
+        : filter == CasterFilter::DynamicOnly ? casters_.dynamicCount
+        : casters_.staticCount + casters_.dynamicCount;
+    return std::max(total - static_cast<int>(viewCasters_.size()), 0);
+}
+
+uint64_t ShadowSystem::casterSignature(const glm::mat4* viewProj, int count, CasterFilter filter) {
+    gatherCasters(viewProj, count, filter);
+    // Any caster entering, leaving or re-uploading inside the frustums changes the hash.
+    uint64_t hash = kFnvOffset;
+    for (const MeshBuffer* mesh : viewCasters_) {
+        hash = hashCombine(hash, static_cast<uint64_t>(reinterpret_cast<uintptr_t>(mesh)));
+        hash = hashCombine(hash, mesh->revision());
+    }
+    return hash;
+}
+
+void ShadowSystem::drawCasters(const glm::mat4& viewProj, CasterFilter filter, CullStats& stats) {
+    drawLayeredCasters(&viewProj, 1, filter, stats);
+}
+
+void ShadowSystem::drawLayeredCasters(
+    const glm::mat4* viewProj,
+    int layerCount,
+    CasterFilter filter,
+    CullStats& stats
+) {
+    stats.culled += gatherCasters(viewProj, layerCount, filter);
+    MeshPool* pool = nullptr;
+    for (const MeshBuffer* mesh : viewCasters_) {
+        if (mesh->pool() != pool && pool) {
+            pool->flush(MeshPool::Streams::PositionOnly);
+        }
+        pool = mesh->pool();
+        mesh->queue();
+        stats.drawn++;
     }
+    if (pool) {
+        pool->flush(MeshPool::Streams::PositionOnly);
+    }
+}
 
-    return idx;
+void ShadowSystem::copyStaticCascade(int cascade) const {
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, dirStaticFbo_);
+    glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, dirStaticMap_, 0, cascade);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, dirShadowFbo_);
+    glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, dirShadowMap_, 0, cascade);
+    glBlitFramebuffer(
+        0,
+        0,
+        dirShadowResolution_,
+        dirShadowResolution_,
+        0,
+        0,
+        dirShadowResolution_,
+        dirShadowResolution_,
+        GL_DEPTH_BUFFER_BIT,
+        GL_NEAREST
+    );
 }
 
-void ShadowSystem::renderDirectionalShadows(std::initializer_list<const MeshBuffer*> meshes) const {
-    if (dirShadowMap_ == 0 || dirShadowFbo_ == 0 || dirCascadeCount_ == 0) {
+void ShadowSystem::renderCascadeLayers(
+    GLuint map,
+    const std::array<bool, kMaxCascades>& cascades,
+    CasterFilter filter,
+    bool clear
+) {
+    // A layered attachment clears every layer, so only a full update can use the single pass.
+    const bool allCascades = std::all_of(cascades.begin(), cascades.begin() + dirActiveCascades_, [](bool render) {
+        return render;
+    });
+    if (layered_ && allCascades) {
+        glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, map, 0);
+        if (clear) {
+            glClear(GL_DEPTH_BUFFER_BIT);
+        }
+        layeredDepthShader_.use();
+        glUniformMatrix4fv(layeredDepthMvpLocation_, dirActiveCascades_, GL_FALSE, glm::value_ptr(dirShadowViewProj_[0]));
+        glUniform1i(layeredDepthCountLocation_, dirActiveCascades_);
+        glUniform1i(layeredDepthBaseLocation_, 0);
+        glUniform1i(layeredDepthViewportStrideLocation_, 0);
+        drawLayeredCasters(dirShadowViewProj_.data(), dirActiveCascades_, filter, dirCullStats_);
         return;
     }
-    if (dirUpdateEvery_ > 1 && (frameIndex_ % dirUpdateEvery_) != 0) {
+    shadowDepthShader_.use();
+    for (int cascade = 0; cascade < dirActiveCascades_; ++cascade) {
+        if (!cascades[static_cast<size_t>(cascade)]) {
+            continue;
+        }
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, map, 0, cascade);
+        if (clear) {
+            glClear(GL_DEPTH_BUFFER_BIT);
+        }
+        glUniformMatrix4fv(shadowMvpLocation_, 1, GL_FALSE, glm::value_ptr(dirShadowViewProj_[cascade]));
+        drawCasters(dirShadowViewProj_[cascade], filter, dirCullStats_);
+    }
+}
+
+void ShadowSystem::renderDirectionalShadows() {
+    if (dirShadowMap_ == 0 || dirShadowFbo_ == 0 || dirActiveCascades_ == 0) {
         return;
     }
-    glBindFramebuffer(GL_FRAMEBUFFER, dirShadowFbo_);
+    dirCullStats_ = CullStats{};
+
+    const bool hasDynamic = casters_.dynamicCount > 0;
+    const bool splitStatic = dirStaticCache_ && hasDynamic;
+    if (splitStatic) {
+        ensureStaticCascadeResources();
+    }
+
+    // A cascade re-renders when its matrix moved or a caster inside it changed; the static layer
+    // re-renders only when its own casters or the matrix changed.
+    std::array<bool, kMaxCascades> renderMain{};
+    std::array<bool, kMaxCascades> renderStatic{};
+    std::array<uint64_t, kMaxCascades> staticSignature{};
+    std::array<uint64_t, kMaxCascades> dynamicSignature{};
+    bool anyMain = false;
+    bool anyStatic = false;
+    for (int cascade = 0; cascade < dirActiveCascades_; ++cascade) {
+        const size_t c = static_cast<size_t>(cascade);
+        const bool moved = !dirCacheValid_[c] || dirCachedViewProj_[c] != dirShadowViewProj_[c];
+        if (splitStatic) {
+            staticSignature[c] = casterSignature(&dirShadowViewProj_[c], 1, CasterFilter::StaticOnly);
+            dynamicSignature[c] = casterSignature(&dirShadowViewProj_[c], 1, CasterFilter::DynamicOnly);
+            renderStatic[c] = moved || !dirStaticValid_[c] || dirStaticSignature_[c] != staticSignature[c];
+        } else {
+            staticSignature[c] = casterSignature(&dirShadowViewProj_[c], 1, CasterFilter::All);
+        }
+        renderMain[c] = moved || dirStaticSignature_[c] != staticSignature[c] ||
+                        dirDynamicSignature_[c] != dynamicSignature[c];
+        // Each cascade is offset by its index, so cascades sharing an interval alternate frames.
+        const int every = dirSchedule_.updateEvery[c];
+        const bool due = !dirCacheValid_[c] || (frameIndex_ + cascade) % every == 0 ||
+                         (dirSchedule_.invalidateOnMotion && moved);
+        if (!due) {
+            renderMain[c] = false;
+            renderStatic[c] = false;
+        }
+        anyMain = anyMain || renderMain[c];
+        anyStatic = anyStatic || renderStatic[c];
+    }
+
+    for (int cascade = 0; cascade < dirActiveCascades_; ++cascade) {
+        const size_t c = static_cast<size_t>(cascade);
+        if (renderMain[c]) {
+            allocationStats_.cascadeRendered++;
+        } else {
+            allocationStats_.cascadeCached++;
+        }
+        if (renderStatic[c]) {
+            allocationStats_.cascadeStaticRendered++;
+        }
+        // A layer left for a later frame stays in the space it was rendered in; only the camera
+        // half of its sampling matrix follows the current frame.
+        const glm::mat4& layerViewProj = renderMain[c] ? dirShadowViewProj_[c] : dirCachedViewProj_[c];
+        dirShadowMatrices_[c] = layerViewProj * dirInvView_;
+    }
+    if (!anyMain) {
+        return;
+    }
+
     glViewport(0, 0, dirShadowResolution_, dirShadowResolution_);
     glEnable(GL_DEPTH_TEST);
     glDepthMask(GL_TRUE);
@@ -355,13 +1184,33 @@ void ShadowSystem::renderDirectionalShadows(std::initializer_list<const MeshBuff
     glEnable(GL_POLYGON_OFFSET_FILL);
     glPolygonOffset(2.0f, 4.0f);
 
-    shadowDepthShader_.use();
-    for (int cascade = 0; cascade < dirCascadeCount_; ++cascade) {
-        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, dirShadowMap_, 0, cascade);
-        glClear(GL_DEPTH_BUFFER_BIT);
-        glUniformMatrix4fv(shadowMvpLocation_, 1, GL_FALSE, glm::value_ptr(dirShadowViewProj_[cascade]));
-        for (const MeshBuffer* mesh : meshes) {
-            mesh->draw();
+    if (splitStatic) {
+        if (anyStatic) {
+            glBindFramebuffer(GL_FRAMEBUFFER, dirStaticFbo_);
+            renderCascadeLayers(dirStaticMap_, renderStatic, CasterFilter::StaticOnly, true);
+        }
+        for (int cascade = 0; cascade < dirActiveCascades_; ++cascade) {
+            if (renderMain[static_cast<size_t>(cascade)]) {
+                copyStaticCascade(cascade);
+            }
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, dirShadowFbo_);
+        renderCascadeLayers(dirShadowMap_, renderMain, CasterFilter::DynamicOnly, false);
+    } else {
+        glBindFramebuffer(GL_FRAMEBUFFER, dirShadowFbo_);
+        renderCascadeLayers(dirShadowMap_, renderMain, CasterFilter::All, true);
+    }
+
+    for (int cascade = 0; cascade < dirActiveCascades_; ++cascade) {
+        const size_t c = static_cast<size_t>(cascade);
+        if (renderStatic[c]) {
+            dirStaticValid_[c] = true;
+        }
+        if (renderMain[c]) {
+            dirCacheValid_[c] = true;
+            dirCachedViewProj_[c] = dirShadowViewProj_[c];
+            dirStaticSignature_[c] = staticSignature[c];
+            dirDynamicSignature_[c] = dynamicSignature[c];
         }
     }
 
@@ -371,15 +1220,12 @@ void ShadowSystem::renderDirectionalShadows(std::initializer_list<const MeshBuff
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
-void ShadowSystem::renderSpotShadows(std::initializer_list<const MeshBuffer*> meshes) const {
-    if (spotShadowMap_ == 0 || spotShadowFbo_ == 0 || spotShadowCount_ == 0) {
-        return;
-    }
-    if (spotUpdateEvery_ > 1 && (frameIndex_ % spotUpdateEvery_) != 0) {
+void ShadowSystem::renderSpotShadows() {
+    spotCullStats_ = CullStats{};
+    if (spotShadowMap_ == 0 || spotShadowFbo_ == 0 || allocationStats_.spotRendered == 0) {
         return;
     }
     glBindFramebuffer(GL_FRAMEBUFFER, spotShadowFbo_);
-    glViewport(0, 0, spotShadowResolution_, spotShadowResolution_);
     glEnable(GL_DEPTH_TEST);
     glDepthMask(GL_TRUE);
     glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
@@ -387,13 +1233,60 @@ void ShadowSystem::renderSpotShadows(std::initializer_list<const MeshBuffer*> me
     glEnable(GL_POLYGON_OFFSET_FILL);
     glPolygonOffset(2.0f, 4.0f);
 
-    shadowDepthShader_.use();
-    for (int i = 0; i < spotShadowCount_; ++i) {
-        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, spotShadowMap_, 0, i);
-        glClear(GL_DEPTH_BUFFER_BIT);
-        glUniformMatrix4fv(shadowMvpLocation_, 1, GL_FALSE, glm::value_ptr(spotShadowViewProj_[i]));
-        for (const MeshBuffer* mesh : meshes) {
-            mesh->draw();
+    // Clear only the tiles being redrawn; cached tiles keep last frame's depth.
+    glEnable(GL_SCISSOR_TEST);
+    for (const SpotSlot& slot : spotSlots_) {
+        if (slot.renderThisFrame) {
+            glScissor(slot.tile.x, slot.tile.y, slot.tile.size, slot.tile.size);
+            glClear(GL_DEPTH_BUFFER_BIT);
+        }
+    }
+    glDisable(GL_SCISSOR_TEST);
+
+    if (layered_) {
+        // Up to kMaxLayersPerDraw tiles per draw, routed by gl_ViewportIndex.
+        layeredDepthShader_.use();
+        glUniform1i(layeredDepthBaseLocation_, 0);
+        glUniform1i(layeredDepthViewportStrideLocation_, 1);
+        std::array<glm::mat4, kMaxLayersPerDraw> batch{};
+        int batchCount = 0;
+        auto flush = [&]() {
+            if (batchCount == 0) {
+                return;
+            }
+            glUniformMatrix4fv(layeredDepthMvpLocation_, batchCount, GL_FALSE, glm::value_ptr(batch[0]));
+            glUniform1i(layeredDepthCountLocation_, batchCount);
+            drawLayeredCasters(batch.data(), batchCount, CasterFilter::All, spotCullStats_);
+            batchCount = 0;
+        };
+        for (const SpotSlot& slot : spotSlots_) {
+            if (!slot.renderThisFrame) {
+                continue;
+            }
+            const float tileSize = static_cast<float>(slot.tile.size);
+            glViewportIndexedf(
+                static_cast<GLuint>(batchCount),
+                static_cast<float>(slot.tile.x),
+                static_cast<float>(slot.tile.y),
+                tileSize,
+                tileSize
+            );
+            batch[static_cast<size_t>(batchCount++)] = slot.viewProj;
+            if (batchCount == kMaxLayersPerDraw) {
+                flush();
+            }
+        }
+        flush();
+        glUniform1i(layeredDepthViewportStrideLocation_, 0);
+    } else {
+        shadowDepthShader_.use();
+        for (const SpotSlot& slot : spotSlots_) {
+            if (!slot.renderThisFrame) {
+                continue;
+            }
+            glViewport(slot.tile.x, slot.tile.y, slot.tile.size, slot.tile.size);
+            glUniformMatrix4fv(shadowMvpLocation_, 1, GL_FALSE, glm::value_ptr(slot.viewProj));
+            drawCasters(slot.viewProj, CasterFilter::All, spotCullStats_);
         }
     }
 
@@ -403,11 +1296,9 @@ void ShadowSystem::renderSpotShadows(std::initializer_list<const MeshBuffer*> me
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
-void ShadowSystem::renderPointShadows(std::initializer_list<const MeshBuffer*> meshes) const {
-    if (pointShadowMap_ == 0 || pointShadowFbo_ == 0 || pointShadowCount_ == 0) {
-        return;
-    }
-    if (pointUpdateEvery_ > 1 && (frameIndex_ % pointUpdateEvery_) != 0) {
+void ShadowSystem::renderPointShadows() {
+    pointCullStats_ = CullStats{};
+    if (pointShadowMap_ == 0 || pointShadowFbo_ == 0 || allocationStats_.pointRendered == 0) {
         return;
     }
     glBindFramebuffer(GL_FRAMEBUFFER, pointShadowFbo_);
@@ -416,23 +1307,43 @@ void ShadowSystem::renderPointShadows(std::initializer_list<const MeshBuffer*> m
     glDepthMask(GL_TRUE);
     glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
     glDisable(GL_CULL_FACE);
-    glEnable(GL_POLYGON_OFFSET_FILL);
-    glPolygonOffset(2.0f, 4.0f);
 
-    shadowDepthShader_.use();
-    for (int i = 0; i < pointShadowCount_; ++i) {
-        for (int face = 0; face < 6; ++face) {
-            const int layer = i * 6 + face;
-            glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, pointShadowMap_, 0, layer);
-            glClear(GL_DEPTH_BUFFER_BIT);
-            glUniformMatrix4fv(shadowMvpLocation_, 1, GL_FALSE, glm::value_ptr(pointShadowViewProj_[i][face]));
-            for (const MeshBuffer* mesh : meshes) {
-                mesh->draw();
+    if (layered_) {
+        layeredDistanceShader_.use();
+        glUniform1i(layeredDistanceCountLocation_, 6);
+        glUniform1i(layeredDistanceViewportStrideLocation_, 0);
+    } else {
+        pointDistanceShader_.use();
+    }
+    for (int i = 0; i < kMaxPointShadows; ++i) {
+        const PointSlot& slot = pointSlots_[i];
+        if (!slot.renderThisFrame) {
+            continue;
+        }
+        if (layered_) {
+            // Clear only this slice's faces so cached slices survive, then draw all six at once.
+            for (int face = 0; face < 6; ++face) {
+                glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, pointShadowMap_, 0, i * 6 + face);
+                glClear(GL_DEPTH_BUFFER_BIT);
+            }
+            glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, pointShadowMap_, 0);
+            glUniformMatrix4fv(layeredDistanceMvpLocation_, 6, GL_FALSE, glm::value_ptr(slot.viewProj[0]));
+            glUniform1i(layeredDistanceBaseLocation_, i * 6);
+            glUniform3f(layeredDistanceLightPosLocation_, slot.position.x, slot.position.y, slot.position.z);
+            glUniform1f(layeredDistanceFarPlaneLocation_, slot.farPlane);
+            drawLayeredCasters(slot.viewProj.data(), 6, CasterFilter::All, pointCullStats_);
+        } else {
+            glUniform3f(pointDistanceLightPosLocation_, slot.position.x, slot.position.y, slot.position.z);
+            glUniform1f(pointDistanceFarPlaneLocation_, slot.farPlane);
+            for (int face = 0; face < 6; ++face) {
+                glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, pointShadowMap_, 0, i * 6 + face);
+                glClear(GL_DEPTH_BUFFER_BIT);
+                glUniformMatrix4fv(pointDistanceMvpLocation_, 1, GL_FALSE, glm::value_ptr(slot.viewProj[face]));
+                drawCasters(slot.viewProj[face], CasterFilter::All, pointCullStats_);
             }
         }
     }
 
-    glDisable(GL_POLYGON_OFFSET_FILL);
     glEnable(GL_CULL_FACE);
     glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
@@ -6,20 +6,28 @@
 #include <SDL_opengl.h>
 
 #include <array>
-#include <initializer_list>
+#include <cstdint>
 #include <string>
+#include <vector>
 
 #include <glm/mat4x4.hpp>
 #include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
 
+#include "Frustum.hpp"
 #include "MeshBuffer.hpp"
+#include "RenderQueue.hpp"
 #include "ShaderProgram.hpp"
+#include "ShadowAtlas.hpp"
+#include "SpatialGrid.hpp"
 
 namespace render {
 
 /**
  * Manages shadow map resources and rendering for directional/spot/point lights.
+ * Spot lights share one depth atlas; point lights share a pool of cube slices. Each frame the
+ * requested lights are ranked by priority, granted tiles/slices, and only changed ones re-render
+ * within a per-frame budget.
  */
 class ShadowSystem {
 public:
@@ -28,101 +36,343 @@ public:
      */
     static constexpr int kMaxCascades = 4;
     /**
-     * Maximum number of spot lights that can cast shadows.
+     * Maximum number of spot shadows sampled per frame (atlas tiles bound to shader slots).
      */
-    static constexpr int kMaxSpotShadows = 4;
+    static constexpr int kMaxSpotShadows = 16;
     /**
-     * Maximum number of point lights that can cast shadows.
+     * Maximum number of point shadows sampled per frame (cube array slices).
      */
-    static constexpr int kMaxPointShadows = 2;
+    static constexpr int kMaxPointShadows = 4;
+    /**
+     * Number of layers one layered draw can write (geometry shader invocations).
+     */
+    static constexpr int kMaxLayersPerDraw = 6;
+
+    /**
+     * Kernel the lighting shaders filter shadow lookups with. Every tap is a hardware depth
+     * comparison with bilinear filtering, so one tap already blends a 2x2 texel footprint.
+     * Values must match the SHADOW_FILTER_* defines in the deferred shaders.
+     */
+    enum class ShadowFilter {
+        /**
+         * (2r)^2 taps on half-texel offsets; covers the (2r+1)^2 texels of the old grid with tent
+         * weights, so radius 1 takes 4 taps instead of 9.
+         */
+        Pcf = 0,
+        /**
+         * Fixed 8-tap Poisson disk scaled to the PCF radius; softer edges, less grid banding.
+         */
+        Poisson = 1
+    };
+
+    /**
+     * How the directional cascades are fitted to the camera.
+     */
+    enum class CascadeFit {
+        /**
+         * Log/uniform splits over the whole view frustum with a fixed depth padding (perspective
+         * style; wastes most of the map under an orthographic camera).
+         */
+        ViewFrustum = 0,
+        /**
+         * Uniform splits over the depth range of the visible receivers, each cascade bounded by
+         * the receivers inside it and the casters in front of them. Needs an orthographic camera.
+         */
+        Receivers = 1
+    };
+
+    /**
+     * World-space scene bounds the receiver fit tightens the cascades against.
+     */
+    struct FitBounds {
+        /**
+         * Bounds of the meshes shadows are cast onto.
+         */
+        const Aabb* receivers{nullptr};
+        int receiverCount{0};
+        /**
+         * Bounds of the meshes that cast directional shadows.
+         */
+        const Aabb* casters{nullptr};
+        int casterCount{0};
+    };
+
+    /**
+     * Shadow casters as a spatial index: the grid items flagged RenderQueue::kShadowPass, each
+     * drawing the mesh stored under its handle.
+     */
+    struct CasterIndex {
+        const SpatialGrid* grid{nullptr};
+        /**
+         * Mesh of each grid handle; nullptr for free handles.
+         */
+        const std::vector<const MeshBuffer*>* meshes{nullptr};
+        /**
+         * Shadow casters in the grid that are not dynamic.
+         */
+        int staticCount{0};
+        /**
+         * Shadow casters in the grid marked dynamic.
+         */
+        int dynamicCount{0};
+    };
+
+    /**
+     * Caster culling results for one shadow pass (summed over its cascades, lights or faces).
+     */
+    struct CullStats {
+        int drawn{0};
+        int culled{0};
+    };
+
+    /**
+     * Per-frame request and allocation counts for spot and point shadows.
+     */
+    struct AllocationStats {
+        int spotRequested{0};
+        int spotGranted{0};
+        int spotRendered{0};
+        int spotCached{0};
+        int pointRequested{0};
+        int pointGranted{0};
+        int pointRendered{0};
+        int pointCached{0};
+        int cascadeRendered{0};
+        int cascadeCached{0};
+        int cascadeStaticRendered{0};
+    };
+
+    /**
+     * Directional cascade matrices and split distances fitted to one camera.
+     */
+    struct DirectionalCascades {
+        std::array<glm::mat4, kMaxCascades> viewProj{};
+        /**
+         * View-space to cascade clip-space matrices.
+         */
+        std::array<glm::mat4, kMaxCascades> matrices{};
+        std::array<float, kMaxCascades> splits{};
+        /**
+         * Inverse view of the camera the cascades were fitted to.
+         */
+        glm::mat4 invView{1.0f};
+        /**
+         * Cascades in use; the receiver fit drops to one when a single map is sharp enough.
+         */
+        int count{0};
+    };
+
+    /**
+     * How often each directional cascade may re-render. A cascade whose turn has not come keeps
+     * its layer and is sampled through the matrix it was rendered with.
+     */
+    struct CascadeSchedule {
+        /**
+         * Frames between re-renders per cascade (1 = whenever it changes). Cascades are phased so
+         * the far ones take their turns on different frames.
+         */
+        std::array<int, kMaxCascades> updateEvery{1, 2, 4, 4};
+        /**
+         * Re-renders a cascade out of turn as soon as its fit moves with the camera, so only
+         * caster changes wait for the schedule.
+         */
+        bool invalidateOnMotion{false};
+    };
 
     /**
      * Descriptor for a spot light shadow request.
      */
     struct SpotShadowDesc {
+        int id;
         glm::vec3 position;
         glm::vec3 direction;
         float radius;
         float outerAngleDeg;
         float biasMin;
         float biasSlope;
+        float importance;
     };
 
     /**
      * Descriptor for a point light shadow request.
      */
     struct PointShadowDesc {
+        int id;
         glm::vec3 position;
         float radius;
         float biasMin;
         float biasSlope;
+        float importance;
     };
 
     /**
      * Builds shadow shaders and allocates shadow map resources.
      * @param shaderRoot Directory containing shadow shaders.
+     * @param layered Renders all layers of a map in one pass via a geometry shader when it builds.
      * @return true if initialization succeeds.
      */
-    bool init(const std::string& shaderRoot);
+    bool init(const std::string& shaderRoot, bool layered);
     /**
      * Releases shadow map resources.
      */
     void destroy();
+    /**
+     * Rebuilds the shadow programs whose source files changed and queries their uniforms again.
+     * @return true if any program was replaced.
+     */
+    bool reloadChanged();
 
     /**
-     * Updates directional cascade matrices from the current camera and light.
+     * Fits the directional cascades without changing any state; safe to call from a worker thread
+     * once init has run.
      * @param view Camera view matrix.
      * @param proj Camera projection matrix.
      * @param lightDirWorld Directional light direction in world space.
      * @param nearPlane Camera near plane distance.
      * @param farPlane Camera far plane distance.
+     * @param bounds Receivers and casters for the receiver fit; without visible receivers the
+     * cascades cover the view frustum.
+     * @param outCascades Receives the fitted cascades.
      */
-    void updateDirectional(
+    void fitDirectional(
         const glm::mat4& view,
         const glm::mat4& proj,
         const glm::vec3& lightDirWorld,
         float nearPlane,
-        float farPlane
+        float farPlane,
+        const FitBounds& bounds,
+        DirectionalCascades& outCascades
+    ) const;
+    /**
+     * Returns a view-projection whose frustum holds every caster the receiver fit can reach: the
+     * camera's view volume as seen from the light, unbounded along the light direction. Casters
+     * outside it never extend a cascade, so the fit's caster list can be queried with it.
+     * @param view Camera view matrix.
+     * @param proj Camera projection matrix.
+     * @param lightDirWorld Directional light direction in world space.
+     */
+    static glm::mat4 directionalCasterVolume(
+        const glm::mat4& view,
+        const glm::mat4& proj,
+        const glm::vec3& lightDirWorld
     );
+    /**
+     * Uses previously fitted cascades for this frame's directional shadows.
+     */
+    void setDirectional(const DirectionalCascades& cascades);
 
     /**
-     * Resets per-frame shadow counts and schedules.
+     * Clears this frame's shadow requests and advances the update schedule.
      */
     void beginFrame();
     /**
-     * Registers a spot light shadow for this frame.
-     * @param desc Spot light descriptor.
+     * Queues a spot light shadow request for this frame.
+     * @param desc Spot light descriptor; id must be stable across frames for caching.
+     * @return Request index for spotShadowSlot.
+     */
+    int requestSpotShadow(const SpotShadowDesc& desc);
+    /**
+     * Queues a point light shadow request for this frame.
+     * @param desc Point light descriptor; id must be stable across frames for caching.
+     * @return Request index for pointShadowSlot.
+     */
+    int requestPointShadow(const PointShadowDesc& desc);
+    /**
+     * Sets the index this frame's passes query for shadow casters.
+     * @param casters Grid and meshes; both must stay unchanged until the shadows are rendered.
+     */
+    void setCasters(const CasterIndex& casters);
+    /**
+     * Ranks this frame's requests, assigns atlas tiles and cube slices, and picks what re-renders.
+     * A light re-renders only if its matrices or the casters touching its frustum changed.
      * @param invView Inverse camera view matrix.
-     * @return Shadow index or -1 if unavailable.
      */
-    int registerSpotShadow(const SpotShadowDesc& desc, const glm::mat4& invView);
+    void resolveShadows(const glm::mat4& invView);
+    /**
+     * Returns the shader slot granted to a spot request after resolveShadows, or -1.
+     */
+    int spotShadowSlot(int request) const;
+    /**
+     * Returns the cube slice granted to a point request after resolveShadows, or -1.
+     */
+    int pointShadowSlot(int request) const;
+
+    /**
+     * Renders directional cascades whose matrices or casters changed into the shadow map array.
+     */
+    void renderDirectionalShadows();
+    /**
+     * Renders spot light tiles flagged by resolveShadows into the atlas.
+     */
+    void renderSpotShadows();
+    /**
+     * Renders point light slices flagged by resolveShadows into the cubemap array.
+     */
+    void renderPointShadows();
+    /**
+     * Enables caching static casters per cascade and compositing dynamic casters on top.
+     * @param enabled true to keep a static-only cascade layer.
+     */
+    void setStaticCascadeCache(bool enabled) { dirStaticCache_ = enabled; }
+    /**
+     * Selects the kernel the PCF radii below are applied with.
+     */
+    void setFilter(ShadowFilter filter) { filter_ = filter; }
+    /**
+     * Returns the kernel the PCF radii are applied with.
+     */
+    ShadowFilter filter() const { return filter_; }
+    /**
+     * Sets how often each directional cascade may re-render.
+     */
+    void setCascadeSchedule(const CascadeSchedule& schedule);
+    /**
+     * Returns the directional cascade update schedule.
+     */
+    const CascadeSchedule& cascadeSchedule() const { return dirSchedule_; }
+    /**
+     * Selects how the directional cascades are fitted to the camera.
+     */
+    void setCascadeFit(CascadeFit fit) { dirFit_ = fit; }
+    /**
+     * Returns how the directional cascades are fitted to the camera.
+     */
+    CascadeFit cascadeFit() const { return dirFit_; }
+    /**
+     * Sets the directional shadow map size; takes effect at init.
+     */
+    void setDirectionalResolution(int resolution) { dirShadowResolution_ = resolution; }
     /**
-     * Registers a point light shadow for this frame.
-     * @param desc Point light descriptor.
-     * @return Shadow index or -1 if unavailable.
+     * Returns the directional shadow map size.
      */
-    int registerPointShadow(const PointShadowDesc& desc);
+    int directionalResolution() const { return dirShadowResolution_; }
 
     /**
-     * Renders directional cascades into the shadow map array.
-     * @param meshes Meshes to draw as shadow casters.
+     * Returns caster culling results from the last directional shadow render.
      */
-    void renderDirectionalShadows(std::initializer_list<const MeshBuffer*> meshes) const;
+    const CullStats& directionalCullStats() const { return dirCullStats_; }
     /**
-     * Renders spot light shadows into the shadow map array.
-     * @param meshes Meshes to draw as shadow casters.
+     * Returns caster culling results from the last spot shadow render.
      */
-    void renderSpotShadows(std::initializer_list<const MeshBuffer*> meshes) const;
+    const CullStats& spotCullStats() const { return spotCullStats_; }
     /**
-     * Renders point light shadows into the cubemap array.
-     * @param meshes Meshes to draw as shadow casters.
+     * Returns caster culling results from the last point shadow render.
      */
-    void renderPointShadows(std::initializer_list<const MeshBuffer*> meshes) const;
+    const CullStats& pointCullStats() const { return pointCullStats_; }
+    /**
+     * Returns request/allocation counts from the last resolveShadows.
+     */
+    const AllocationStats& allocationStats() const { return allocationStats_; }
 
     /**
-     * Returns the active directional cascade count.
+     * Returns true when shadow maps are written with layered (single-pass) rendering.
      */
-    int directionalCascadeCount() const { return dirCascadeCount_; }
+    bool layeredRendering() const { return layered_; }
+
+    /**
+     * Returns the directional cascade count in use this frame.
+     */
+    int directionalCascadeCount() const { return dirActiveCascades_; }
     /**
      * Returns view-space-to-light-space matrices for each cascade.
      */
@@ -135,6 +385,10 @@ public:
      * Returns the directional shadow map array texture id.
      */
     GLuint directionalShadowMap() const { return dirShadowMap_; }
+    /**
+     * Returns a sampler object that reads the compare-mode directional map as raw depth (debug views).
+     */
+    GLuint directionalDepthSampler() const { return dirDepthSampler_; }
     /**
      * Returns the directional shadow map texel size.
      */
@@ -153,19 +407,23 @@ public:
     int directionalPcfRadius() const { return dirPcfRadius_; }
 
     /**
-     * Returns the number of spot shadows registered this frame.
+     * Returns the number of spot shadow slots in use (highest granted slot + 1).
      */
     int spotShadowCount() const { return spotShadowCount_; }
     /**
-     * Returns view-space-to-light-space matrices for spot shadows.
+     * Returns view-space-to-light-space matrices for spot shadow slots.
      */
     const std::array<glm::mat4, kMaxSpotShadows>& spotShadowMatrices() const { return spotShadowMatrices_; }
     /**
-     * Returns the spot shadow map array texture id.
+     * Returns atlas rectangles (offset.xy, scale.zw in UV) per slot; zero scale means no shadow.
+     */
+    const std::array<glm::vec4, kMaxSpotShadows>& spotShadowRects() const { return spotShadowRects_; }
+    /**
+     * Returns the spot shadow atlas texture id (GL_TEXTURE_2D).
      */
     GLuint spotShadowMap() const { return spotShadowMap_; }
     /**
-     * Returns the spot shadow map texel size.
+     * Returns the spot shadow atlas texel size.
      */
     glm::vec2 spotTexelSize() const { return spotTexelSize_; }
     /**
@@ -174,9 +432,13 @@ public:
     int spotPcfRadius() const { return spotPcfRadius_; }
 
     /**
-     * Returns the number of point shadows registered this frame.
+     * Returns the number of point shadow slices in use (highest granted slice + 1).
      */
     int pointShadowCount() const { return pointShadowCount_; }
+    /**
+     * Returns the world position (xyz) and far plane (w) each slice was rendered with; w = 0 means no shadow.
+     */
+    const std::array<glm::vec4, kMaxPointShadows>& pointShadowLights() const { return pointShadowLights_; }
     /**
      * Returns the point shadow cubemap array texture id.
      */
@@ -191,10 +453,91 @@ public:
     int pointPcfRadius() const { return pointPcfRadius_; }
 
 private:
+    enum class CasterFilter {
+        All,
+        StaticOnly,
+        DynamicOnly
+    };
+
+    struct SpotRequest {
+        SpotShadowDesc desc;
+        glm::mat4 viewProj;
+        float priority;
+        int slot;
+        uint64_t casterSignature;
+    };
+
+    struct PointRequest {
+        PointShadowDesc desc;
+        float priority;
+        int slot;
+        std::array<glm::mat4, 6> viewProj;
+        float farPlane;
+        uint64_t casterSignature;
+    };
+
+    struct SpotSlot {
+        int id{-1};
+        ShadowAtlas::Tile tile{};
+        /**
+         * Tile size the light asked for when the tile was allocated; the atlas may grant less.
+         */
+        int requestedSize{0};
+        bool rendered{false};
+        bool renderThisFrame{false};
+        int lastRenderedFrame{0};
+        glm::mat4 viewProj{1.0f};
+        uint64_t casterSignature{0};
+    };
+
+    struct PointSlot {
+        int id{-1};
+        bool rendered{false};
+        bool renderThisFrame{false};
+        int lastRenderedFrame{0};
+        glm::vec3 position{0.0f};
+        float farPlane{0.0f};
+        std::array<glm::mat4, 6> viewProj{};
+        uint64_t casterSignature{0};
+    };
+
+    /**
+     * Fits the cascades to the receivers visible through an orthographic camera (CascadeFit::Receivers).
+     * @return false when no receiver is visible; outCascades is then left for the frustum fit.
+     */
+    bool fitDirectionalToReceivers(
+        const glm::mat4& view,
+        const glm::mat4& proj,
+        const glm::vec3& lightDirWorld,
+        float nearPlane,
+        float farPlane,
+        const FitBounds& bounds,
+        DirectionalCascades& outCascades
+    ) const;
+    /**
+     * Ranks spot requests and assigns atlas tiles, slots and re-render flags.
+     */
+    void resolveSpotShadows(const glm::vec3& cameraPos, const glm::mat4& invView);
+    /**
+     * Ranks point requests and assigns cube slices and re-render flags.
+     */
+    void resolvePointShadows(const glm::vec3& cameraPos);
+    /**
+     * Returns the atlas tile size wanted for a spot light of the given priority.
+     */
+    int spotTileSizeForPriority(float priority) const;
+    /**
+     * Orders re-render candidates: never-rendered first, then priority times frames since the last render.
+     */
+    float renderUrgency(float priority, bool rendered, int lastRenderedFrame) const;
     /**
      * Allocates directional shadow map resources.
      */
     void ensureDirectionalResources();
+    /**
+     * Allocates the static-only cascade layer used by the cascade cache.
+     */
+    void ensureStaticCascadeResources();
     /**
      * Allocates spot shadow map resources.
      */
@@ -207,29 +550,120 @@ private:
      * Releases all shadow map resources.
      */
     void destroyResources();
+    /**
+     * Queries the uniform locations of the shadow programs (after init and every reload).
+     */
+    void queryUniformLocations();
+    /**
+     * Draws the casters whose bounds intersect the light frustum.
+     * @param viewProj Light view-projection used for the current layer.
+     * @param filter Which casters to consider.
+     * @param stats Receives drawn/culled counts.
+     */
+    void drawCasters(const glm::mat4& viewProj, CasterFilter filter, CullStats& stats);
+    /**
+     * Draws the casters that intersect any frustum of a layered pass.
+     * @param viewProj Per-layer light view-projections.
+     * @param layerCount Number of entries used in viewProj.
+     * @param filter Which casters to consider.
+     * @param stats Receives drawn/culled counts (once per mesh, not per layer).
+     */
+    void drawLayeredCasters(const glm::mat4* viewProj, int layerCount, CasterFilter filter, CullStats& stats);
+    /**
+     * Hashes identity and revision of the casters touching any of the given frustums.
+     * @param viewProj Light view-projections.
+     * @param count Number of entries in viewProj.
+     * @param filter Which casters to consider.
+     * @return Signature that changes when a relevant caster moves, changes or enters/leaves.
+     */
+    uint64_t casterSignature(const glm::mat4* viewProj, int count, CasterFilter filter);
+    /**
+     * Queries the casters touching any of the given frustums into viewCasters_, grouped by pool
+     * so the draw helpers submit one batch per pool.
+     * @param viewProj Light view-projections.
+     * @param count Number of entries in viewProj.
+     * @param filter Which casters to keep.
+     * @return Number of filtered casters outside every frustum.
+     */
+    int gatherCasters(const glm::mat4* viewProj, int count, CasterFilter filter);
+    /**
+     * Returns whether a caster passes the static/dynamic filter.
+     */
+    static bool matchesFilter(const MeshBuffer& mesh, CasterFilter filter);
+    /**
+     * Draws filtered casters into the flagged cascades of a cascade array (all of them when layered).
+     * @param map Depth array attached to the bound framebuffer.
+     * @param cascades Cascades to render in per-layer mode.
+     * @param filter Static/dynamic caster filter.
+     * @param clear true to clear each cascade before drawing.
+     */
+    void renderCascadeLayers(
+        GLuint map,
+        const std::array<bool, kMaxCascades>& cascades,
+        CasterFilter filter,
+        bool clear
+    );
+    /**
+     * Copies one cascade layer from the static cache into the directional shadow map.
+     */
+    void copyStaticCascade(int cascade) const;
 
     ShaderProgram shadowDepthShader_;
     GLint shadowMvpLocation_{-1};
+    ShaderProgram pointDistanceShader_;
+    GLint pointDistanceMvpLocation_{-1};
+    GLint pointDistanceLightPosLocation_{-1};
+    GLint pointDistanceFarPlaneLocation_{-1};
+
+    bool layered_{false};
+    ShaderProgram layeredDepthShader_;
+    GLint layeredDepthMvpLocation_{-1};
+    GLint layeredDepthCountLocation_{-1};
+    GLint layeredDepthBaseLocation_{-1};
+    GLint layeredDepthViewportStrideLocation_{-1};
+    ShaderProgram layeredDistanceShader_;
+    GLint layeredDistanceMvpLocation_{-1};
+    GLint layeredDistanceCountLocation_{-1};
+    GLint layeredDistanceBaseLocation_{-1};
+    GLint layeredDistanceViewportStrideLocation_{-1};
+    GLint layeredDistanceLightPosLocation_{-1};
+    GLint layeredDistanceFarPlaneLocation_{-1};
 
     int dirCascadeCount_{3};
-    int dirShadowResolution_{2048};
+    int dirShadowResolution_{1024};
+    CascadeFit dirFit_{CascadeFit::Receivers};
+    /**
+     * Largest texel, in world units, the receiver fit accepts from a single map before it splits
+     * the view into cascades.
+     */
+    float dirSingleMapMaxTexel_{0.02f};
+    int dirActiveCascades_{0};
     float dirSplitLambda_{0.6f};
     float dirBiasMin_{0.0015f};
     float dirBiasSlope_{0.0045f};
     int dirPcfRadius_{1};
+    ShadowFilter filter_{ShadowFilter::Pcf};
     float dirZPadding_{10.0f};
     glm::vec2 dirTexelSize_{1.0f, 1.0f};
 
-    int spotShadowResolution_{1024};
+    int spotAtlasResolution_{2048};
+    int spotMinTileSize_{128};
+    int spotMaxTileSize_{1024};
+    float spotTileScale_{512.0f};
+    int64_t spotTexelBudget_{2 * 1024 * 1024};
     int spotPcfRadius_{1};
     glm::vec2 spotTexelSize_{1.0f, 1.0f};
 
     int pointShadowResolution_{512};
     int pointPcfRadius_{1};
     float pointShadowDiskRadius_{0.002f};
+    int pointFaceBudget_{12};
 
     GLuint dirShadowMap_{0};
+    GLuint dirDepthSampler_{0};
     GLuint dirShadowFbo_{0};
+    GLuint dirStaticMap_{0};
+    GLuint dirStaticFbo_{0};
     GLuint spotShadowMap_{0};
     GLuint spotShadowFbo_{0};
     GLuint pointShadowMap_{0};
@@ -238,18 +672,42 @@ private:
     std::array<glm::mat4, kMaxCascades> dirShadowViewProj_{};
     std::array<glm::mat4, kMaxCascades> dirShadowMatrices_{};
     std::array<float, kMaxCascades> dirCascadeSplits_{};
+    glm::mat4 dirInvView_{1.0f};
+    CascadeSchedule dirSchedule_{};
+    bool dirStaticCache_{true};
+    std::array<bool, kMaxCascades> dirCacheValid_{};
+    std::array<bool, kMaxCascades> dirStaticValid_{};
+    std::array<glm::mat4, kMaxCascades> dirCachedViewProj_{};
+    std::array<uint64_t, kMaxCascades> dirStaticSignature_{};
+    std::array<uint64_t, kMaxCascades> dirDynamicSignature_{};
+
+    CasterIndex casters_{};
+    std::vector<int> casterHandles_;
+    std::vector<const MeshBuffer*> viewCasters_;
 
+    ShadowAtlas spotAtlas_;
+    std::vector<SpotRequest> spotRequests_;
+    std::vector<int> spotOrder_;
+    std::vector<int> spotRenderOrder_;
+    std::array<SpotSlot, kMaxSpotShadows> spotSlots_{};
     int spotShadowCount_{0};
-    std::array<glm::mat4, kMaxSpotShadows> spotShadowViewProj_{};
     std::array<glm::mat4, kMaxSpotShadows> spotShadowMatrices_{};
+    std::array<glm::vec4, kMaxSpotShadows> spotShadowRects_{};
 
+    std::vector<PointRequest> pointRequests_;
+    std::vector<int> pointOrder_;
+    std::vector<int> pointRenderOrder_;
+    std::array<PointSlot, kMaxPointShadows> pointSlots_{};
     int pointShadowCount_{0};
-    std::array<std::array<glm::mat4, 6>, kMaxPointShadows> pointShadowViewProj_{};
+    std::array<glm::vec4, kMaxPointShadows> pointShadowLights_{};
+
+    AllocationStats allocationStats_{};
+
+    CullStats dirCullStats_{};
+    CullStats spotCullStats_{};
+    CullStats pointCullStats_{};
 
     int frameIndex_{0};
-    int dirUpdateEvery_{1};
-    int spotUpdateEvery_{1};
-    int pointUpdateEvery_{1};
 };
 
 }  // namespace render
@@ -0,0 +1,401 @@
+#include "SpatialGrid.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <functional>
+#include <limits>
+
+#include <glm/glm.hpp>
+
+namespace {
+
+constexpr float kMaxFloat = std::numeric_limits<float>::max();
+
+render::Aabb emptyBounds() {
+    return render::Aabb{glm::vec3(kMaxFloat), glm::vec3(std::numeric_limits<float>::lowest())};
+}
+
+uint64_t cellKey(int x, int z) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32) | static_cast<uint64_t>(static_cast<uint32_t>(z));
+}
+
+bool finite(const glm::vec3& v) {
+    return std::isfinite(v.x) && std::isfinite(v.y) && std::isfinite(v.z);
+}
+
+/**
+ * Returns the world box around the corners of the frusta, or an infinite one when a corner lies
+ * at infinity.
+ */
+render::Aabb frustumFootprint(const glm::mat4* viewProj, int count) {
+    render::Aabb footprint = emptyBounds();
+    for (int i = 0; i < count; ++i) {
+        const glm::mat4 inverse = glm::inverse(viewProj[i]);
+        for (int corner = 0; corner < 8; ++corner) {
+            const glm::vec4 ndc(
+                (corner & 1) != 0 ? 1.0f : -1.0f,
+                (corner & 2) != 0 ? 1.0f : -1.0f,
+                (corner & 4) != 0 ? 1.0f : -1.0f,
+                1.0f
+            );
+            const glm::vec4 world = inverse * ndc;
+            const glm::vec3 point = glm::vec3(world) / world.w;
+            if (world.w <= 0.0f || !finite(point)) {
+                return render::Aabb{glm::vec3(std::numeric_limits<float>::lowest()), glm::vec3(kMaxFloat)};
+            }
+            footprint.min = glm::min(footprint.min, point);
+            footprint.max = glm::max(footprint.max, point);
+        }
+    }
+    return footprint;
+}
+
+float boxDistance(const glm::vec3& point, const render::Aabb& box) {
+    const glm::vec3 outside = glm::max(glm::max(box.min - point, glm::vec3(0.0f)), point - box.max);
+    return glm::length(outside);
+}
+
+}  // namespace
+
+namespace render {
+
+SpatialGrid::SpatialGrid(float cellSize)
+    : cellSize_(std::max(cellSize, 1e-3f)), inverseCellSize_(1.0f / std::max(cellSize, 1e-3f)) {
+    oversized_.bounds = emptyBounds();
+}
+
+void SpatialGrid::clear() {
+    items_.clear();
+    freeHandles_.clear();
+    cells_.clear();
+    cellLookup_.clear();
+    oversized_.items.clear();
+    oversized_.bounds = emptyBounds();
+    oversized_.flags = 0;
+    minCellX_ = 0;
+    maxCellX_ = -1;
+    minCellZ_ = 0;
+    maxCellZ_ = -1;
+    itemCount_ = 0;
+}
+
+int SpatialGrid::insert(const Aabb& bounds, uint32_t flags) {
+    int handle = static_cast<int>(items_.size());
+    if (!freeHandles_.empty()) {
+        std::pop_heap(freeHandles_.begin(), freeHandles_.end(), std::greater<int>());
+        handle = freeHandles_.back();
+        freeHandles_.pop_back();
+    } else {
+        items_.emplace_back();
+    }
+    Item& item = items_[static_cast<size_t>(handle)];
+    item.bounds = bounds;
+    item.flags = flags;
+    link(handle, cellFor(bounds));
+    itemCount_++;
+    return handle;
+}
+
+void SpatialGrid::update(int handle, const Aabb& bounds, uint32_t flags) {
+    const int target = cellFor(bounds);
+    Item& item = items_[static_cast<size_t>(handle)];
+    if (target == item.cell) {
+        item.bounds = bounds;
+        item.flags = flags;
+        refit(cell(target));
+        return;
+    }
+    unlink(handle);
+    item.bounds = bounds;
+    item.flags = flags;
+    link(handle, target);
+}
+
+void SpatialGrid::remove(int handle) {
+    unlink(handle);
+    Item& item = items_[static_cast<size_t>(handle)];
+    item.cell = kOversizedCell - 1;
+    item.flags = 0;
+    freeHandles_.push_back(handle);
+    std::push_heap(freeHandles_.begin(), freeHandles_.end(), std::greater<int>());
+    itemCount_--;
+}
+
+SpatialGrid::Stats SpatialGrid::stats() const {
+    return Stats{itemCount_, static_cast<int>(cells_.size()), static_cast<int>(oversized_.items.size())};
+}
+
+bool SpatialGrid::cellRange(const Aabb& box, CellRange& outRange) const {
+    if (cells_.empty()) {
+        return false;
+    }
+    // An item reaches at most one cell past its own, so the box widens by a cell per side;
+    // clipping to the occupied cells happens in floats, before anything can overflow an int.
+    const auto axis = [&](float lo, float hi, int minCell, int maxCell, int& first, int& last) {
+        const float from = std::max(std::floor(lo * inverseCellSize_) - 1.0f, static_cast<float>(minCell));
+        const float to = std::min(std::floor(hi * inverseCellSize_) + 1.0f, static_cast<float>(maxCell));
+        if (!(from <= to)) {
+            return false;
+        }
+        first = static_cast<int>(from);
+        last = static_cast<int>(to);
+        return true;
+    };
+    return axis(box.min.x, box.max.x, minCellX_, maxCellX_, outRange.firstX, outRange.lastX) &&
+           axis(box.min.z, box.max.z, minCellZ_, maxCellZ_, outRange.firstZ, outRange.lastZ);
+}
+
+template <typename Visit>
+void SpatialGrid::forEachCell(const Aabb& box, Visit&& visit) const {
+    visit(oversized_);
+    CellRange range;
+    if (!cellRange(box, range)) {
+        return;
+    }
+    const int64_t rangeCells =
+        static_cast<int64_t>(range.lastX - range.firstX + 1) * static_cast<int64_t>(range.lastZ - range.firstZ + 1);
+    if (rangeCells >= static_cast<int64_t>(cells_.size())) {
+        for (const Cell& candidate : cells_) {
+            if (candidate.x >= range.firstX && candidate.x <= range.lastX &&
+                candidate.z >= range.firstZ && candidate.z <= range.lastZ) {
+                visit(candidate);
+            }
+        }
+        return;
+    }
+    for (int x = range.firstX; x <= range.lastX; ++x) {
+        for (int z = range.firstZ; z <= range.lastZ; ++z) {
+            const auto found = cellLookup_.find(cellKey(x, z));
+            if (found != cellLookup_.end()) {
+                visit(cells_[static_cast<size_t>(found->second)]);
+            }
+        }
+    }
+}
+
+void SpatialGrid::query(const glm::mat4* viewProj, int count, uint32_t flagMask, std::vector<int>& outHandles) const {
+    outHandles.clear();
+    count = std::min(count, kMaxQueryFrusta);
+    std::array<Frustum, kMaxQueryFrusta> frusta{};
+    for (int i = 0; i < count; ++i) {
+        frusta[static_cast<size_t>(i)] = Frustum(viewProj[i]);
+    }
+    // The frusta corners bound the cells worth visiting; the planes decide the rest.
+    const Aabb footprint = frustumFootprint(viewProj, count);
+    const auto intersects = [&](const Aabb& box) {
+        for (int i = 0; i < count; ++i) {
+            if (frusta[static_cast<size_t>(i)].intersects(box)) {
+                return true;
+            }
+        }
+        return false;
+    };
+    forEachCell(footprint, [&](const Cell& visited) {
+        if ((visited.flags & flagMask) == 0 || !intersects(visited.bounds)) {
+            return;
+        }
+        for (const int handle : visited.items) {
+            const Item& item = items_[static_cast<size_t>(handle)];
+            if ((item.flags & flagMask) != 0 && intersects(item.bounds)) {
+                outHandles.push_back(handle);
+            }
+        }
+    });
+    std::sort(outHandles.begin(), outHandles.end());
+}
+
+void SpatialGrid::query(const Aabb& box, uint32_t flagMask, std::vector<int>& outHandles) const {
+    outHandles.clear();
+    const auto overlaps = [&](const Aabb& other) {
+        return other.min.x <= box.max.x && other.max.x >= box.min.x &&
+               other.min.y <= box.max.y && other.max.y >= box.min.y &&
+               other.min.z <= box.max.z && other.max.z >= box.min.z;
+    };
+    forEachCell(box, [&](const Cell& visited) {
+        if ((visited.flags & flagMask) == 0 || !overlaps(visited.bounds)) {
+            return;
+        }
+        for (const int handle : visited.items) {
+            const Item& item = items_[static_cast<size_t>(handle)];
+            if ((item.flags & flagMask) != 0 && overlaps(item.bounds)) {
+                outHandles.push_back(handle);
+            }
+        }
+    });
+    std::sort(outHandles.begin(), outHandles.end());
+}
+
+void SpatialGrid::nearest(
+    const glm::vec3& point,
+    int count,
+    uint32_t flagMask,
+    const glm::mat4* within,
+    std::vector<int>& outHandles
+) const {
+    outHandles.clear();
+    if (count <= 0 || itemCount_ == 0) {
+        return;
+    }
+    const Frustum frustum = within ? Frustum(*within) : Frustum();
+
+    // Max-heap of the best candidates so far; ties go to the lower handle so results are stable.
+    struct Candidate {
+        float distance;
+        int handle;
+    };
+    const auto closer = [](const Candidate& a, const Candidate& b) {
+        return a.distance < b.distance || (a.distance == b.distance && a.handle < b.handle);
+    };
+    std::vector<Candidate> best;
+    best.reserve(static_cast<size_t>(count));
+    const auto full = [&]() { return best.size() == static_cast<size_t>(count); };
+    const auto consider = [&](const Cell& visited) {
+        if ((visited.flags & flagMask) == 0 || visited.items.empty()) {
+            return;
+        }
+        if (full() && boxDistance(point, visited.bounds) > best.front().distance) {
+            return;
+        }
+        if (!frustum.intersects(visited.bounds)) {
+            return;
+        }
+        for (const int handle : visited.items) {
+            const Item& item = items_[static_cast<size_t>(handle)];
+            if ((item.flags & flagMask) == 0 || !frustum.intersects(item.bounds)) {
+                continue;
+            }
+            const Candidate candidate{boxDistance(point, item.bounds), handle};
+            if (!full()) {
+                best.push_back(candidate);
+                std::push_heap(best.begin(), best.end(), closer);
+            } else if (closer(candidate, best.front())) {
+                std::pop_heap(best.begin(), best.end(), closer);
+                best.back() = candidate;
+                std::push_heap(best.begin(), best.end(), closer);
+            }
+        }
+    };
+
+    consider(oversized_);
+    const Aabb footprint = within
+        ? frustumFootprint(within, 1)
+        : Aabb{glm::vec3(std::numeric_limits<float>::lowest()), glm::vec3(kMaxFloat)};
+    CellRange range;
+    if (finite(point) && cellRange(footprint, range)) {
+        // Clamped so far-away points cannot overflow; the ring bound below stays conservative.
+        const auto centerCell = [&](float coordinate, int first, int last) {
+            const float c = std::floor(coordinate * inverseCellSize_);
+            return static_cast<int>(std::clamp(c, static_cast<float>(first - 1), static_cast<float>(last + 1)));
+        };
+        const int px = centerCell(point.x, range.firstX, range.lastX);
+        const int pz = centerCell(point.z, range.firstZ, range.lastZ);
+        const int firstRing = std::max({range.firstX - px, px - range.lastX, range.firstZ - pz, pz - range.lastZ, 0});
+        const int lastRing = std::max({px - range.firstX, range.lastX - px, pz - range.firstZ, range.lastZ - pz});
+
+        // Items of ring r or beyond lie outside the cells within r - 1, less one loose cell.
+        const auto ringDistance = [&](int ring) {
+            const float xLo = static_cast<float>(px - ring + 2) * cellSize_;
+            const float xHi = static_cast<float>(px + ring - 1) * cellSize_;
+            const float zLo = static_cast<float>(pz - ring + 2) * cellSize_;
+            const float zHi = static_cast<float>(pz + ring - 1) * cellSize_;
+            if (point.x < xLo || point.x > xHi || point.z < zLo || point.z > zHi) {
+                return 0.0f;
+            }
+            return std::min({point.x - xLo, xHi - point.x, point.z - zLo, zHi - point.z});
+        };
+        const auto visitCell = [&](int x, int z) {
+            if (x < range.firstX || x > range.lastX || z < range.firstZ || z > range.lastZ) {
+                return;
+            }
+            const auto found = cellLookup_.find(cellKey(x, z));
+            if (found != cellLookup_.end()) {
+                consider(cells_[static_cast<size_t>(found->second)]);
+            }
+        };
+        for (int ring = firstRing; ring <= lastRing; ++ring) {
+            if (full() && best.front().distance <= ringDistance(ring)) {
+                break;
+            }
+            if (ring == 0) {
+                visitCell(px, pz);
+                continue;
+            }
+            for (int x = std::max(px - ring, range.firstX); x <= std::min(px + ring, range.lastX); ++x) {
+                visitCell(x, pz - ring);
+                visitCell(x, pz + ring);
+            }
+            for (int z = std::max(pz - ring + 1, range.firstZ); z <= std::min(pz + ring - 1, range.lastZ); ++z) {
+                visitCell(px - ring, z);
+                visitCell(px + ring, z);
+            }
+        }
+    }
+
+    std::sort(best.begin(), best.end(), closer);
+    for (const Candidate& candidate : best) {
+        outHandles.push_back(candidate.handle);
+    }
+}
+
+int SpatialGrid::cellFor(const Aabb& bounds) {
+    const glm::vec3 center = 0.5f * (bounds.min + bounds.max);
+    const glm::vec3 halfExtent = 0.5f * (bounds.max - bounds.min);
+    if (!finite(center) || halfExtent.x > cellSize_ || halfExtent.z > cellSize_) {
+        return kOversizedCell;
+    }
+    const int x = static_cast<int>(std::floor(center.x * inverseCellSize_));
+    const int z = static_cast<int>(std::floor(center.z * inverseCellSize_));
+    const auto [found, inserted] = cellLookup_.try_emplace(cellKey(x, z), static_cast<int>(cells_.size()));
+    if (inserted) {
+        Cell created;
+        created.x = x;
+        created.z = z;
+        created.bounds = emptyBounds();
+        cells_.push_back(std::move(created));
+        if (minCellX_ > maxCellX_) {
+            minCellX_ = maxCellX_ = x;
+            minCellZ_ = maxCellZ_ = z;
+        } else {
+            minCellX_ = std::min(minCellX_, x);
+            maxCellX_ = std::max(maxCellX_, x);
+            minCellZ_ = std::min(minCellZ_, z);
+            maxCellZ_ = std::max(maxCellZ_, z);
+        }
+    }
+    return found->second;
+}
+
+void SpatialGrid::link(int handle, int cellIndex) {
+    Item& item = items_[static_cast<size_t>(handle)];
+    Cell& target = cell(cellIndex);
+    item.cell = cellIndex;
+    item.slot = static_cast<int>(target.items.size());
+    target.items.push_back(handle);
+    target.bounds.min = glm::min(target.bounds.min, item.bounds.min);
+    target.bounds.max = glm::max(target.bounds.max, item.bounds.max);
+    target.flags |= item.flags;
+}
+
+void SpatialGrid::unlink(int handle) {
+    const Item& item = items_[static_cast<size_t>(handle)];
+    Cell& source = cell(item.cell);
+    const int moved = source.items.back();
+    source.items[static_cast<size_t>(item.slot)] = moved;
+    items_[static_cast<size_t>(moved)].slot = item.slot;
+    source.items.pop_back();
+    refit(source);
+}
+
+void SpatialGrid::refit(Cell& target) const {
+    target.bounds = emptyBounds();
+    target.flags = 0;
+    for (const int handle : target.items) {
+        const Item& item = items_[static_cast<size_t>(handle)];
+        target.bounds.min = glm::min(target.bounds.min, item.bounds.min);
+        target.bounds.max = glm::max(target.bounds.max, item.bounds.max);
+        target.flags |= item.flags;
+    }
+}
+
+}  // namespace render
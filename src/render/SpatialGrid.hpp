@@ -0,0 +1,208 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+
+#include "Frustum.hpp"
+
+namespace render {
+
+/**
+ * Loose uniform grid over the XZ plane for culling world-space boxes. An item lives in the one
+ * cell holding its bounds center and each cell's bounds grow to cover its items, so a query only
+ * visits cells near its own footprint and tests items of the cells it intersects. Items wider than
+ * a cell stay in a separate list every query tests. Cells are hashed, so the covered area is
+ * unbounded, and moving an item only refits the cells it leaves and enters.
+ *
+ * Queries are const and touch no shared state: any number of threads may query while nobody
+ * updates the grid.
+ */
+class SpatialGrid {
+public:
+    /**
+     * Maximum number of frusta one query accepts.
+     */
+    static constexpr int kMaxQueryFrusta = 6;
+
+    /**
+     * Grid occupancy.
+     */
+    struct Stats {
+        int items{0};
+        /**
+         * Cells created since the last clear(), empty or not.
+         */
+        int cells{0};
+        /**
+         * Items too wide for a cell, tested by every query.
+         */
+        int oversized{0};
+    };
+
+    /**
+     * Creates an empty grid.
+     * @param cellSize Cell edge length in world units; items up to this half-width stay in cells.
+     */
+    explicit SpatialGrid(float cellSize = 8.0f);
+
+    /**
+     * Removes every item; handles restart at 0 and come back in insertion order.
+     */
+    void clear();
+    /**
+     * Adds an item.
+     * @param bounds World-space bounds.
+     * @param flags Bits matched against query masks; an item without bits is never returned.
+     * @return Handle of the item, the lowest one free.
+     */
+    int insert(const Aabb& bounds, uint32_t flags);
+    /**
+     * Moves or reflags an item.
+     * @param handle Handle from insert().
+     * @param bounds New world-space bounds.
+     * @param flags New query bits.
+     */
+    void update(int handle, const Aabb& bounds, uint32_t flags);
+    /**
+     * Removes an item; its handle may be returned by a later insert().
+     * @param handle Handle from insert().
+     */
+    void remove(int handle);
+
+    /**
+     * Returns the bounds an item was last given.
+     */
+    const Aabb& bounds(int handle) const { return items_[static_cast<size_t>(handle)].bounds; }
+    /**
+     * Returns the query bits of an item.
+     */
+    uint32_t flags(int handle) const { return items_[static_cast<size_t>(handle)].flags; }
+    /**
+     * Returns the current occupancy.
+     */
+    Stats stats() const;
+
+    /**
+     * Collects the items flagged with any bit of flagMask that intersect at least one frustum.
+     * @param viewProj World-to-clip matrices of the frusta.
+     * @param count Number of matrices (at most kMaxQueryFrusta).
+     * @param flagMask Bits an item must share to be returned.
+     * @param outHandles Receives the handles in ascending order (cleared first).
+     */
+    void query(const glm::mat4* viewProj, int count, uint32_t flagMask, std::vector<int>& outHandles) const;
+    /**
+     * Collects the items flagged with any bit of flagMask that intersect a box.
+     * @param box World-space box.
+     * @param flagMask Bits an item must share to be returned.
+     * @param outHandles Receives the handles in ascending order (cleared first).
+     */
+    void query(const Aabb& box, uint32_t flagMask, std::vector<int>& outHandles) const;
+    /**
+     * Collects the items closest to a point, measured to their bounds, searching rings of cells
+     * outward until no closer item can remain.
+     * @param point World-space point.
+     * @param count Maximum number of items returned.
+     * @param flagMask Bits an item must share to be returned.
+     * @param within World-to-clip matrix of a frustum the items must intersect, or nullptr; the
+     * search then stays inside the frustum's footprint.
+     * @param outHandles Receives the handles, closest first (cleared first).
+     */
+    void nearest(
+        const glm::vec3& point,
+        int count,
+        uint32_t flagMask,
+        const glm::mat4* within,
+        std::vector<int>& outHandles
+    ) const;
+
+private:
+    /**
+     * Cell index of the list holding items wider than a cell.
+     */
+    static constexpr int kOversizedCell = -1;
+
+    struct Item {
+        Aabb bounds{};
+        uint32_t flags{0};
+        /**
+         * Index into cells_, kOversizedCell, or below that for a free handle.
+         */
+        int cell{kOversizedCell - 1};
+        /**
+         * Position in the cell's item list.
+         */
+        int slot{0};
+    };
+
+    struct Cell {
+        int x{0};
+        int z{0};
+        /**
+         * Union of the item bounds; invalid while empty.
+         */
+        Aabb bounds{};
+        /**
+         * Union of the item flags.
+         */
+        uint32_t flags{0};
+        std::vector<int> items;
+    };
+
+    /**
+     * Returns the cell an item with these bounds belongs in, creating it if needed.
+     */
+    int cellFor(const Aabb& bounds);
+    Cell& cell(int index) { return index == kOversizedCell ? oversized_ : cells_[static_cast<size_t>(index)]; }
+    const Cell& cell(int index) const { return index == kOversizedCell ? oversized_ : cells_[static_cast<size_t>(index)]; }
+    void link(int handle, int cellIndex);
+    void unlink(int handle);
+    /**
+     * Recomputes a cell's bounds and flags from its items.
+     */
+    void refit(Cell& target) const;
+    /**
+     * Inclusive cell coordinates, clipped to the occupied ones.
+     */
+    struct CellRange {
+        int firstX{0};
+        int lastX{-1};
+        int firstZ{0};
+        int lastZ{-1};
+    };
+
+    /**
+     * Returns the occupied cells that may hold items intersecting a world box.
+     * @return false when there are none.
+     */
+    bool cellRange(const Aabb& box, CellRange& outRange) const;
+    /**
+     * Calls visit for every cell that may hold items intersecting the world box, oversized included.
+     */
+    template <typename Visit>
+    void forEachCell(const Aabb& box, Visit&& visit) const;
+
+    float cellSize_{8.0f};
+    float inverseCellSize_{0.125f};
+    std::vector<Item> items_;
+    /**
+     * Min-heap of released handles.
+     */
+    std::vector<int> freeHandles_;
+    std::vector<Cell> cells_;
+    Cell oversized_;
+    std::unordered_map<uint64_t, int> cellLookup_;
+    /**
+     * Cell coordinates covered by cells_ (inclusive); queries clip their footprint to them.
+     */
+    int minCellX_{0};
+    int maxCellX_{-1};
+    int minCellZ_{0};
+    int maxCellZ_{-1};
+    int itemCount_{0};
+};
+
+}  // namespace render
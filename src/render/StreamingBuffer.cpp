@@ -0,0 +1,204 @@
+#include "StreamingBuffer.hpp"
+
+#include <algorithm>
+
+#include <spdlog/spdlog.h>
+
+namespace {
+
+constexpr GLsizeiptr kRegionGranularity = 256;
+
+GLintptr alignUp(GLintptr value, GLintptr alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+}  // namespace
+
+namespace render {
+
+StreamingBuffer::~StreamingBuffer() {
+    destroy();
+}
+
+bool StreamingBuffer::init(GLenum target, GLsizeiptr regionSize, const GlFunctions& gl) {
+    destroy();
+
+    target_ = target;
+    bufferStorage_ = gl.bufferStorage;
+    alignment_ = 16;
+    if (target_ == GL_UNIFORM_BUFFER) {
+        GLint uboAlignment = 0;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uboAlignment);
+        alignment_ = std::max<GLintptr>(alignment_, uboAlignment);
+    }
+    return allocate(regionSize);
+}
+
+void StreamingBuffer::destroy() {
+    release();
+    regionSize_ = 0;
+    stallCount_ = 0;
+}
+
+bool StreamingBuffer::allocate(GLsizeiptr regionSize) {
+    release();
+
+    regionSize_ = alignUp(std::max<GLsizeiptr>(regionSize, kRegionGranularity), kRegionGranularity);
+    const GLsizeiptr totalSize = regionSize_ * kRegionCount;
+
+    glGenBuffers(1, &buffer_);
+    glBindBuffer(target_, buffer_);
+    if (bufferStorage_) {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        bufferStorage_(target_, totalSize, nullptr, flags);
+        persistentPtr_ = glMapBufferRange(target_, 0, totalSize, flags);
+        persistent_ = persistentPtr_ != nullptr;
+        if (!persistent_) {
+            spdlog::warn("StreamingBuffer: persistent mapping failed, using per-frame mapping");
+            glDeleteBuffers(1, &buffer_);
+            glGenBuffers(1, &buffer_);
+            glBindBuffer(target_, buffer_);
+        }
+    }
+    if (!persistent_) {
+        glBufferData(target_, totalSize, nullptr, GL_STREAM_DRAW);
+    }
+    glBindBuffer(target_, 0);
+
+    if (buffer_ == 0) {
+        spdlog::error("StreamingBuffer: failed to create buffer");
+        return false;
+    }
+    region_ = 0;
+    cursor_ = 0;
+    revision_++;
+    return true;
+}
+
+void StreamingBuffer::release() {
+    for (GLsync& fence : fences_) {
+        if (fence) {
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+    if (buffer_ != 0) {
+        if (persistent_ || mapped_) {
+            glBindBuffer(target_, buffer_);
+            glUnmapBuffer(target_);
+            glBindBuffer(target_, 0);
+        }
+        glDeleteBuffers(1, &buffer_);
+        buffer_ = 0;
+    }
+    persistentPtr_ = nullptr;
+    persistent_ = false;
+    mapped_ = false;
+    frameOpen_ = false;
+}
+
+void StreamingBuffer::waitRegion(int region) {
+    GLsync& fence = fences_[static_cast<size_t>(region)];
+    if (!fence) {
+        return;
+    }
+    GLenum result = glClientWaitSync(fence, 0, 0);
+    if (result == GL_TIMEOUT_EXPIRED) {
+        stallCount_++;
+        do {
+            result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+        } while (result == GL_TIMEOUT_EXPIRED);
+    }
+    if (result == GL_WAIT_FAILED) {
+        spdlog::warn("StreamingBuffer: fence wait failed");
+    }
+    glDeleteSync(fence);
+    fence = nullptr;
+}
+
+void StreamingBuffer::beginFrame(GLsizeiptr requiredSize) {
+    if (frameOpen_) {
+        endFrame();
+    }
+    if (buffer_ == 0 || requiredSize > regionSize_) {
+        // Orphan the old ring; the driver keeps its storage alive until pending reads finish.
+        const GLsizeiptr grown = std::max(requiredSize, regionSize_ * 2);
+        if (!allocate(grown)) {
+            return;
+        }
+    } else {
+        region_ = (region_ + 1) % kRegionCount;
+    }
+    waitRegion(region_);
+    cursor_ = 0;
+    frameOpen_ = true;
+}
+
+void* StreamingBuffer::map(GLsizeiptr size, GLintptr& outOffset) {
+    outOffset = 0;
+    if (!frameOpen_ || size <= 0) {
+        return nullptr;
+    }
+    if (mapped_) {
+        unmap();
+    }
+    const GLintptr start = alignUp(cursor_, alignment_);
+    if (start + size > regionSize_) {
+        spdlog::error("StreamingBuffer: region overflow ({} + {} > {} bytes)", start, size, regionSize_);
+        return nullptr;
+    }
+    const GLintptr offset = static_cast<GLintptr>(region_) * regionSize_ + start;
+    cursor_ = start + size;
+    outOffset = offset;
+
+    if (persistent_) {
+        return static_cast<char*>(persistentPtr_) + offset;
+    }
+    glBindBuffer(target_, buffer_);
+    // The region fence already guarantees the GPU is done with this range.
+    void* ptr = glMapBufferRange(
+        target_,
+        offset,
+        size,
+        GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT
+    );
+    mapped_ = ptr != nullptr;
+    if (!mapped_) {
+        glBindBuffer(target_, 0);
+        spdlog::error("StreamingBuffer: glMapBufferRange failed");
+    }
+    return ptr;
+}
+
+bool StreamingBuffer::fits(GLsizeiptr size) const {
+    return frameOpen_ && alignUp(cursor_, alignment_) + size <= regionSize_;
+}
+
+void StreamingBuffer::unmap() {
+    if (!mapped_) {
+        return;
+    }
+    glBindBuffer(target_, buffer_);
+    glUnmapBuffer(target_);
+    glBindBuffer(target_, 0);
+    mapped_ = false;
+}
+
+void StreamingBuffer::endFrame() {
+    if (!frameOpen_) {
+        return;
+    }
+    unmap();
+    GLsync& fence = fences_[static_cast<size_t>(region_)];
+    if (fence) {
+        glDeleteSync(fence);
+    }
+    fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    frameOpen_ = false;
+}
+
+void StreamingBuffer::bindRange(GLuint index, GLintptr offset, GLsizeiptr size) const {
+    glBindBufferRange(target_, index, buffer_, offset, size);
+}
+
+}  // namespace render
@@ -0,0 +1,144 @@
+#ifndef GL_GLEXT_PROTOTYPES
+#define GL_GLEXT_PROTOTYPES
+#endif
+#pragma once
+
+#include <SDL_opengl.h>
+
+#include <array>
+
+#include "GlFunctions.hpp"
+
+namespace render {
+
+/**
+ * Ring of per-frame buffer regions for CPU-to-GPU streaming without implicit syncs.
+ * Each frame writes into its own region; a fence per region guards reuse until the GPU is done.
+ * Uses persistent coherent mapping when buffer storage is available, otherwise unsynchronized
+ * glMapBufferRange with range invalidation.
+ */
+class StreamingBuffer {
+public:
+    /**
+     * Number of frames that may be in flight before a region is reused.
+     */
+    static constexpr int kRegionCount = 3;
+
+    /**
+     * Creates an empty streaming buffer without allocating GL objects.
+     */
+    StreamingBuffer() = default;
+    /**
+     * Releases the buffer and fences if created.
+     */
+    ~StreamingBuffer();
+
+    /**
+     * Non-copyable to avoid double-deleting GL buffers and fences.
+     */
+    StreamingBuffer(const StreamingBuffer&) = delete;
+    /**
+     * Non-copyable assignment to avoid double-deleting GL buffers and fences.
+     */
+    StreamingBuffer& operator=(const StreamingBuffer&) = delete;
+
+    /**
+     * Allocates the ring.
+     * @param target Buffer binding target (e.g., GL_TEXTURE_BUFFER, GL_UNIFORM_BUFFER).
+     * @param regionSize Initial bytes available per frame.
+     * @param gl Runtime-resolved GL entry points (buffer storage is optional).
+     * @return true if the buffer was created.
+     */
+    bool init(GLenum target, GLsizeiptr regionSize, const GlFunctions& gl);
+    /**
+     * Unmaps and releases the buffer and all fences.
+     */
+    void destroy();
+
+    /**
+     * Moves to the next region, waiting for the GPU to release it if needed.
+     * Grows the ring first when requiredSize exceeds the region size.
+     * @param requiredSize Bytes the frame will write (0 keeps the current size).
+     */
+    void beginFrame(GLsizeiptr requiredSize = 0);
+    /**
+     * Returns writable memory for size bytes inside the current region.
+     * @param size Bytes to write.
+     * @param outOffset Receives the byte offset of the allocation in the buffer.
+     * @return Pointer to write through, or nullptr when the region is full.
+     */
+    void* map(GLsizeiptr size, GLintptr& outOffset);
+    /**
+     * Returns true if size more bytes fit in the current region.
+     * @param size Bytes the next map call would write.
+     */
+    bool fits(GLsizeiptr size) const;
+    /**
+     * Ends writes from the last map call; must precede any GL command that reads the data.
+     */
+    void unmap();
+    /**
+     * Fences the current region once every command reading it has been submitted.
+     */
+    void endFrame();
+
+    /**
+     * Binds a range of the buffer to an indexed target (uniform blocks).
+     * @param index Binding point.
+     * @param offset Byte offset returned by map.
+     * @param size Bytes to bind.
+     */
+    void bindRange(GLuint index, GLintptr offset, GLsizeiptr size) const;
+
+    /**
+     * Returns the GL buffer id, or 0 if not created.
+     */
+    GLuint id() const { return buffer_; }
+    /**
+     * Returns a counter that changes whenever the buffer is reallocated.
+     */
+    int revision() const { return revision_; }
+    /**
+     * Returns true when the buffer is persistently mapped.
+     */
+    bool persistent() const { return persistent_; }
+    /**
+     * Returns how many region waits actually blocked on the GPU.
+     */
+    int stallCount() const { return stallCount_; }
+    /**
+     * Returns the alignment applied to each map call's offset.
+     */
+    GLintptr alignment() const { return alignment_; }
+
+private:
+    /**
+     * Creates the buffer storage for kRegionCount regions of regionSize bytes.
+     */
+    bool allocate(GLsizeiptr regionSize);
+    /**
+     * Deletes the buffer object and fences, keeping configuration.
+     */
+    void release();
+    /**
+     * Blocks until a region's fence has signaled, then deletes it.
+     */
+    void waitRegion(int region);
+
+    GLenum target_{GL_ARRAY_BUFFER};
+    GLuint buffer_{0};
+    GLsizeiptr regionSize_{0};
+    GLintptr alignment_{16};
+    PFNGLBUFFERSTORAGEPROC bufferStorage_{nullptr};
+    std::array<GLsync, kRegionCount> fences_{};
+    void* persistentPtr_{nullptr};
+    bool persistent_{false};
+    bool mapped_{false};
+    bool frameOpen_{false};
+    int region_{0};
+    GLintptr cursor_{0};
+    int revision_{0};
+    int stallCount_{0};
+};
+
+}  // namespace render
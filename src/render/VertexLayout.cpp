@@ -0,0 +1,97 @@
+#include "VertexLayout.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <glm/glm.hpp>
+
+namespace {
+
+constexpr float kPositionQuantum = 32767.0f;
+
+int16_t quantizeSigned(float value) {
+    return static_cast<int16_t>(std::lround(std::clamp(value, -1.0f, 1.0f) * kPositionQuantum));
+}
+
+uint8_t quantizeUnsigned(float value) {
+    return static_cast<uint8_t>(std::lround(std::clamp(value, 0.0f, 1.0f) * 255.0f));
+}
+
+glm::vec2 encodeOctahedral(glm::vec3 n) {
+    n /= std::max(std::abs(n.x) + std::abs(n.y) + std::abs(n.z), 1e-6f);
+    glm::vec2 f(n.x, n.y);
+    if (n.z < 0.0f) {
+        f = (glm::vec2(1.0f) - glm::abs(glm::vec2(n.y, n.x))) * glm::vec2(n.x >= 0.0f ? 1.0f : -1.0f, n.y >= 0.0f ? 1.0f : -1.0f);
+    }
+    return f;
+}
+
+}  // namespace
+
+namespace render {
+
+VertexLayout VertexLayout::forFormat(Format format) {
+    VertexLayout layout{};
+    layout.format = format;
+    if (format == Format::Compact) {
+        // Integer attributes are fetched unnormalized so the dequantization is exact on every GL version.
+        layout.strides = {static_cast<GLsizei>(4 * sizeof(int16_t)), static_cast<GLsizei>(2 * sizeof(int16_t) + 4)};
+        layout.attributes = {{
+            {0, 3, GL_SHORT, GL_FALSE, 0, kPositionStream},
+            {1, 2, GL_SHORT, GL_FALSE, 0, kSurfaceStream},
+            {2, 4, GL_UNSIGNED_BYTE, GL_TRUE, static_cast<GLuint>(2 * sizeof(int16_t)), kSurfaceStream},
+        }};
+    } else {
+        layout.strides = {static_cast<GLsizei>(3 * sizeof(float)), static_cast<GLsizei>(6 * sizeof(float))};
+        layout.attributes = {{
+            {0, 3, GL_FLOAT, GL_FALSE, 0, kPositionStream},
+            {1, 3, GL_FLOAT, GL_FALSE, 0, kSurfaceStream},
+            {2, 3, GL_FLOAT, GL_FALSE, static_cast<GLuint>(3 * sizeof(float)), kSurfaceStream},
+        }};
+    }
+    return layout;
+}
+
+void VertexLayout::dequantization(const Aabb& bounds, glm::vec4& outScale, glm::vec4& outOffset) const {
+    if (format == Format::Standard) {
+        outScale = glm::vec4(1.0f, 1.0f, 1.0f, 0.0f);
+        outOffset = glm::vec4(0.0f);
+        return;
+    }
+    const glm::vec3 center = 0.5f * (bounds.min + bounds.max);
+    const glm::vec3 extent = glm::max(0.5f * (bounds.max - bounds.min), glm::vec3(1e-6f));
+    outScale = glm::vec4(extent / kPositionQuantum, 0.0f);
+    outOffset = glm::vec4(center, 1.0f);
+}
+
+void VertexLayout::encode(
+    const float* source,
+    const glm::vec4& scale,
+    const glm::vec4& offset,
+    uint8_t* outPosition,
+    uint8_t* outSurface
+) const {
+    if (format == Format::Standard) {
+        std::memcpy(outPosition, source, 3 * sizeof(float));
+        std::memcpy(outSurface, source + 3, 6 * sizeof(float));
+        return;
+    }
+    const glm::vec3 position(source[0], source[1], source[2]);
+    const glm::vec3 local = (position - glm::vec3(offset)) / (glm::vec3(scale) * kPositionQuantum);
+    const int16_t packedPosition[4] = {quantizeSigned(local.x), quantizeSigned(local.y), quantizeSigned(local.z), 0};
+    std::memcpy(outPosition, packedPosition, sizeof(packedPosition));
+
+    const glm::vec2 octahedral = encodeOctahedral(glm::vec3(source[3], source[4], source[5]));
+    const int16_t packedNormal[2] = {quantizeSigned(octahedral.x), quantizeSigned(octahedral.y)};
+    const uint8_t packedColor[4] = {
+        quantizeUnsigned(source[6]),
+        quantizeUnsigned(source[7]),
+        quantizeUnsigned(source[8]),
+        255,
+    };
+    std::memcpy(outSurface, packedNormal, sizeof(packedNormal));
+    std::memcpy(outSurface + sizeof(packedNormal), packedColor, sizeof(packedColor));
+}
+
+}  // namespace render
@@ -0,0 +1,95 @@
+#ifndef GL_GLEXT_PROTOTYPES
+#define GL_GLEXT_PROTOTYPES
+#endif
+#pragma once
+
+#include <SDL_opengl.h>
+
+#include <array>
+#include <cstdint>
+
+#include <glm/vec4.hpp>
+
+#include "Frustum.hpp"
+
+namespace render {
+
+/**
+ * One vertex attribute inside a vertex stream.
+ */
+struct VertexAttribute {
+    GLuint location{0};
+    GLint components{0};
+    GLenum type{GL_FLOAT};
+    GLboolean normalized{GL_FALSE};
+    GLuint offset{0};
+    /**
+     * Stream index (kPositionStream or kSurfaceStream).
+     */
+    int stream{0};
+};
+
+/**
+ * Describes how mesh vertices are stored on the GPU.
+ * Positions live in their own stream so depth-only passes fetch nothing else; normals and colors
+ * share the surface stream. Shaders reconstruct positions as aPos * aPositionScale.xyz +
+ * aPositionOffset.xyz from a per-mesh dequantization entry, and aPositionOffset.w flags
+ * octahedral normals. Scene shaders then apply the per-instance transform rows and color
+ * multiplier (MeshPool::Instance) fetched at kInstanceTransformLocation and kInstanceColorLocation.
+ */
+struct VertexLayout {
+    enum class Format {
+        /**
+         * float3 position, float3 normal, float3 color (36 bytes).
+         */
+        Standard,
+        /**
+         * int16x4 position relative to the mesh bounds, int16x2 octahedral normal, RGBA8 color (16 bytes).
+         */
+        Compact,
+    };
+
+    static constexpr int kPositionStream = 0;
+    static constexpr int kSurfaceStream = 1;
+    static constexpr int kStreamCount = 2;
+    static constexpr GLuint kPositionScaleLocation = 3;
+    static constexpr GLuint kPositionOffsetLocation = 4;
+    /**
+     * First of the three locations holding the rows of the instance transform.
+     */
+    static constexpr GLuint kInstanceTransformLocation = 5;
+    static constexpr GLuint kInstanceColorLocation = 8;
+
+    Format format{Format::Standard};
+    std::array<GLsizei, kStreamCount> strides{};
+    std::array<VertexAttribute, 3> attributes{};
+
+    /**
+     * Returns the descriptor for a storage format.
+     */
+    static VertexLayout forFormat(Format format);
+
+    /**
+     * Returns the total bytes per vertex across both streams.
+     */
+    GLsizei vertexSize() const { return strides[kPositionStream] + strides[kSurfaceStream]; }
+
+    /**
+     * Computes a mesh's dequantization entry from its bounds.
+     * @param bounds Mesh position bounds.
+     * @param outScale Receives the per-axis position scale.
+     * @param outOffset Receives the position offset; w is 1 for octahedral normals.
+     */
+    void dequantization(const Aabb& bounds, glm::vec4& outScale, glm::vec4& outOffset) const;
+    /**
+     * Encodes one 9-float source vertex (position, normal, color) into both streams.
+     * @param source Source vertex.
+     * @param scale Dequantization scale from dequantization().
+     * @param offset Dequantization offset from dequantization().
+     * @param outPosition Receives strides[kPositionStream] bytes.
+     * @param outSurface Receives strides[kSurfaceStream] bytes.
+     */
+    void encode(const float* source, const glm::vec4& scale, const glm::vec4& offset, uint8_t* outPosition, uint8_t* outSurface) const;
+};
+
+}  // namespace render
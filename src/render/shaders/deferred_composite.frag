@@ -1,4 +1,9 @@
 #version 410 core
+// One build per RenderEngine::DebugView (values must match); the engine prepends the define.
+#ifndef DEBUG_VIEW
+#define DEBUG_VIEW 0
+#endif
+// Must match ShadowSystem::kMaxCascades.
 #define MAX_CASCADES 4
 in vec2 vUv;
 out vec4 FragColor;
@@ -7,107 +12,149 @@ uniform sampler2D uLightBuffer;
 uniform sampler2D uGAlbedoMetal;
 uniform sampler2D uGNormalRough;
 uniform sampler2D uDepth;
-uniform sampler2DArray uShadowMap;
-uniform mat4 uShadowMatrices[MAX_CASCADES];
-uniform float uCascadeSplits[MAX_CASCADES];
-uniform int uCascadeCount;
-uniform vec2 uShadowTexelSize;
-uniform int uShadowPcfRadius;
-uniform mat4 uInvProj;
-uniform vec3 uDirLightDir;
-uniform float uShadowBiasMin;
-uniform float uShadowBiasSlope;
-uniform int uShadowDebugCascade;
-uniform int uDebugMode;
+// The directional cascade array read through a non-comparing sampler (ShadowMap view).
+uniform sampler2DArray uShadowDepth;
+// Shadow factor and cascade written by the directional pass (ShadowFactor/ShadowCascade views).
+uniform sampler2D uShadowInfo;
+// 2 when point/spot lighting was accumulated at half resolution into uLocalLight (with the depth
+// of each texel's shaded pixel in uLocalDepth); 0 when it is already in uLightBuffer.
+uniform int uLocalLightStride;
+uniform sampler2D uLocalLight;
+uniform sampler2D uLocalDepth;
+// std140 mirror of render::FrameUniforms (ShaderUniforms.hpp).
+layout(std140) uniform FrameUniforms {
+    mat4 uView;
+    mat4 uProj;
+    mat4 uViewProj;
+    mat4 uInvProj;
+    mat4 uInvView;
+    vec3 uDirLightDir;
+    float uDirLightIntensity;
+    vec3 uDirLightColor;
+    int uLightTexelOffset;
+    vec3 uAmbient;
+    int uLightCount;
+    vec2 uScreenSize;
+    int uDebugMode;
+    int uShadowDebugCascade;
+    vec2 uUvScale;
+    vec2 uUvMax;
+};
 
 vec3 tonemap(vec3 color) {
     return color / (color + vec3(1.0));
 }
 
+// Inverse of the octahedral mapping written by deferred_gbuffer.frag.
+vec3 decodeNormal(vec2 encoded) {
+    vec2 f = encoded * 2.0 - 1.0;
+    vec3 n = vec3(f, 1.0 - abs(f.x) - abs(f.y));
+    float t = clamp(-n.z, 0.0, 1.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
+
 vec3 reconstructViewPos(vec2 uv, float depth) {
     vec4 ndc = vec4(uv * 2.0 - 1.0, depth * 2.0 - 1.0, 1.0);
     vec4 view = uInvProj * ndc;
     return view.xyz / view.w;
 }
 
-float sampleShadowMap(vec3 shadowCoord, int layer, float bias) {
-    if (shadowCoord.z > 1.0 || shadowCoord.x < 0.0 || shadowCoord.x > 1.0 || shadowCoord.y < 0.0 || shadowCoord.y > 1.0) {
-        return 1.0;
-    }
-    float shadow = 0.0;
-    int taps = 0;
-    for (int y = -uShadowPcfRadius; y <= uShadowPcfRadius; ++y) {
-        for (int x = -uShadowPcfRadius; x <= uShadowPcfRadius; ++x) {
-            vec2 offset = vec2(x, y) * uShadowTexelSize;
-            float depth = texture(uShadowMap, vec3(shadowCoord.xy + offset, layer)).r;
-            shadow += (shadowCoord.z - bias <= depth) ? 1.0 : 0.0;
-            taps++;
+float viewDepth(float depth) {
+    return -reconstructViewPos(vec2(0.5), depth).z;
+}
+
+// Joint bilateral upsample: bilinear weights over the 2x2 nearest half-resolution texels, scaled
+// by how well each texel's depth and normal match this pixel, so light does not bleed over edges.
+vec3 upsampleLocalLight(float depth, vec3 normal) {
+    ivec2 lowSize = (ivec2(uScreenSize) + 1) / 2;
+    // Half-resolution texel i shades full-resolution pixel 2i + 1, centered at 2i + 1.5.
+    vec2 lowPos = (vUv * uScreenSize - 1.5) * 0.5;
+    ivec2 base = ivec2(floor(lowPos));
+    vec2 f = lowPos - vec2(base);
+    float z = viewDepth(depth);
+    float sigma = 0.1 + 0.01 * z;
+
+    vec3 sum = vec3(0.0);
+    float total = 0.0;
+    vec3 closest = vec3(0.0);
+    float closestDelta = 1.0e30;
+    for (int i = 0; i < 4; ++i) {
+        ivec2 offset = ivec2(i & 1, i >> 1);
+        ivec2 texel = clamp(base + offset, ivec2(0), lowSize - 1);
+        ivec2 source = min(texel * 2 + 1, ivec2(uScreenSize) - 1);
+        vec3 light = texelFetch(uLocalLight, texel, 0).rgb;
+        float delta = abs(viewDepth(texelFetch(uLocalDepth, texel, 0).r) - z);
+        vec3 tapNormal = decodeNormal(texelFetch(uGNormalRough, source, 0).xy);
+        vec2 bilinear = mix(1.0 - f, f, vec2(offset));
+        float weight = bilinear.x * bilinear.y *
+                       exp(-(delta * delta) / (sigma * sigma)) *
+                       pow(max(dot(normal, tapNormal), 0.0), 8.0);
+        sum += light * weight;
+        total += weight;
+        if (delta < closestDelta) {
+            closestDelta = delta;
+            closest = light;
         }
     }
-    return shadow / max(float(taps), 1.0);
+    // Every tap lies across an edge (thin features): fall back to the one nearest in depth.
+    return total > 1.0e-4 ? sum / total : closest;
+}
+
+vec3 localLight(vec2 texUv) {
+    if (uLocalLightStride != 2) {
+        return vec3(0.0);
+    }
+    float depth = texture(uDepth, texUv).r;
+    if (depth >= 0.99999) {
+        return vec3(0.0);
+    }
+    return upsampleLocalLight(depth, decodeNormal(texture(uGNormalRough, texUv).xy));
 }
 
 void main() {
+    // Under dynamic resolution the lighting covers part of its textures; the light buffer's
+    // bilinear filter upscales it.
+    vec2 texUv = min(vUv * uUvScale, uUvMax);
     vec3 color;
-    if (uDebugMode == 0) {
-        vec3 hdr = texture(uLightBuffer, vUv).rgb;
-        color = tonemap(hdr);
-    } else if (uDebugMode == 1) {
-        color = texture(uGAlbedoMetal, vUv).rgb;
-    } else if (uDebugMode == 2) {
-        vec3 normal = normalize(texture(uGNormalRough, vUv).xyz);
-        color = normal * 0.5 + 0.5;
-    } else if (uDebugMode == 3) {
-        float rough = texture(uGNormalRough, vUv).a;
-        float metal = texture(uGAlbedoMetal, vUv).a;
-        color = vec3(rough, metal, 0.0);
-    } else if (uDebugMode == 4) {
-        float depth = texture(uDepth, vUv).r;
-        color = vec3(depth);
-    } else if (uDebugMode == 6) {
-        int cascade = clamp(uShadowDebugCascade, 0, uCascadeCount - 1);
-        float depth = texture(uShadowMap, vec3(vUv, cascade)).r;
-        color = vec3(depth);
-    } else if (uDebugMode == 7 || uDebugMode == 8) {
-        float depth = texture(uDepth, vUv).r;
-        if (depth >= 0.99999) {
-            color = vec3(0.0);
+#if DEBUG_VIEW == 0
+    vec3 hdr = texture(uLightBuffer, texUv).rgb + localLight(texUv);
+    color = tonemap(hdr);
+#elif DEBUG_VIEW == 1
+    color = texture(uGAlbedoMetal, texUv).rgb;
+#elif DEBUG_VIEW == 2
+    vec3 normal = decodeNormal(texture(uGNormalRough, texUv).xy);
+    color = normal * 0.5 + 0.5;
+#elif DEBUG_VIEW == 3
+    float rough = texture(uGNormalRough, texUv).b;
+    float metal = texture(uGAlbedoMetal, texUv).a;
+    color = vec3(rough, metal, 0.0);
+#elif DEBUG_VIEW == 4
+    float depth = texture(uDepth, texUv).r;
+    color = vec3(depth);
+#elif DEBUG_VIEW == 6
+    float depth = texture(uShadowDepth, vec3(vUv, uShadowDebugCascade)).r;
+    color = vec3(depth);
+#elif DEBUG_VIEW == 7
+    color = vec3(texture(uShadowInfo, texUv).r);
+#elif DEBUG_VIEW == 8
+    if (texture(uDepth, texUv).r >= 0.99999) {
+        color = vec3(0.0);
+    } else {
+        int cascade = int(texture(uShadowInfo, texUv).g * float(MAX_CASCADES - 1) + 0.5);
+        if (cascade == 0) {
+            color = vec3(0.85, 0.15, 0.15);
+        } else if (cascade == 1) {
+            color = vec3(0.15, 0.85, 0.15);
+        } else if (cascade == 2) {
+            color = vec3(0.15, 0.25, 0.85);
         } else {
-            vec4 normalRough = texture(uGNormalRough, vUv);
-            vec3 normal = normalize(normalRough.xyz);
-            vec3 viewPos = reconstructViewPos(vUv, depth);
-            float viewDepth = -viewPos.z;
-            int cascade = 0;
-            for (int i = 0; i < uCascadeCount - 1; ++i) {
-                if (viewDepth > uCascadeSplits[i]) {
-                    cascade = i + 1;
-                }
-            }
-
-            if (uDebugMode == 8) {
-                if (cascade == 0) {
-                    color = vec3(0.85, 0.15, 0.15);
-                } else if (cascade == 1) {
-                    color = vec3(0.15, 0.85, 0.15);
-                } else if (cascade == 2) {
-                    color = vec3(0.15, 0.25, 0.85);
-                } else {
-                    color = vec3(0.85, 0.85, 0.15);
-                }
-            } else {
-                vec3 L = normalize(-uDirLightDir);
-                float ndotl = max(dot(normal, L), 0.0);
-                float bias = max(uShadowBiasMin, uShadowBiasSlope * (1.0 - ndotl));
-                vec4 shadowPos = uShadowMatrices[cascade] * vec4(viewPos, 1.0);
-                vec3 shadowCoord = shadowPos.xyz / shadowPos.w;
-                shadowCoord = shadowCoord * 0.5 + 0.5;
-                float shadow = sampleShadowMap(shadowCoord, cascade, bias);
-                color = vec3(shadow);
-            }
+            color = vec3(0.85, 0.85, 0.15);
         }
-    } else {
-        color = texture(uLightBuffer, vUv).rgb;
     }
+#else
+    color = texture(uLightBuffer, texUv).rgb + localLight(texUv);
+#endif
 
     color = pow(clamp(color, 0.0, 1.0), vec3(1.0 / 2.2));
     FragColor = vec4(color, 1.0);
@@ -0,0 +1,29 @@
+#version 410 core
+// Copies, for each half-resolution lighting pixel, the depth of the full-resolution pixel it
+// shades (the one deferred_volume.frag reconstructs), so light volumes depth-test against it.
+
+uniform sampler2D uDepth;
+// std140 mirror of render::FrameUniforms (ShaderUniforms.hpp).
+layout(std140) uniform FrameUniforms {
+    mat4 uView;
+    mat4 uProj;
+    mat4 uViewProj;
+    mat4 uInvProj;
+    mat4 uInvView;
+    vec3 uDirLightDir;
+    float uDirLightIntensity;
+    vec3 uDirLightColor;
+    int uLightTexelOffset;
+    vec3 uAmbient;
+    int uLightCount;
+    vec2 uScreenSize;
+    int uDebugMode;
+    int uShadowDebugCascade;
+    vec2 uUvScale;
+    vec2 uUvMax;
+};
+
+void main() {
+    ivec2 pixel = min(ivec2(gl_FragCoord.xy) * 2 + 1, ivec2(uScreenSize) - 1);
+    gl_FragDepth = texelFetch(uDepth, pixel, 0).r;
+}
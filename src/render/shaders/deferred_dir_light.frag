@@ -1,24 +1,81 @@
 #version 410 core
+// Must match ShadowSystem::kMaxCascades / kMaxSpotShadows / kMaxPointShadows.
 #define MAX_CASCADES 4
+#define MAX_SPOT_SHADOWS 16
+#define MAX_POINT_SHADOWS 4
 in vec2 vUv;
-out vec4 FragColor;
+layout(location = 0) out vec4 FragColor;
+// Shadow factor (r) and cascade index / (MAX_CASCADES - 1) (g) for the composite's shadow debug
+// views; only bound to a target while one of them is shown.
+layout(location = 1) out vec2 ShadowInfo;
 
 uniform sampler2D uGAlbedoMetal;
 uniform sampler2D uGNormalRough;
 uniform sampler2D uDepth;
-uniform sampler2DArray uShadowMap;
-uniform mat4 uShadowMatrices[MAX_CASCADES];
-uniform float uCascadeSplits[MAX_CASCADES];
-uniform int uCascadeCount;
-uniform vec2 uShadowTexelSize;
-uniform float uShadowBiasMin;
-uniform float uShadowBiasSlope;
-uniform int uShadowPcfRadius;
-uniform mat4 uInvProj;
-uniform vec3 uDirLightDir;
-uniform vec3 uDirLightColor;
-uniform float uDirLightIntensity;
-uniform vec3 uAmbient;
+uniform sampler2DArrayShadow uShadowMap;
+// std140 mirror of render::FrameUniforms (ShaderUniforms.hpp).
+layout(std140) uniform FrameUniforms {
+    mat4 uView;
+    mat4 uProj;
+    mat4 uViewProj;
+    mat4 uInvProj;
+    mat4 uInvView;
+    vec3 uDirLightDir;
+    float uDirLightIntensity;
+    vec3 uDirLightColor;
+    int uLightTexelOffset;
+    vec3 uAmbient;
+    int uLightCount;
+    vec2 uScreenSize;
+    int uDebugMode;
+    int uShadowDebugCascade;
+    vec2 uUvScale;
+    vec2 uUvMax;
+};
+
+// std140 mirror of render::ShadowUniforms (ShaderUniforms.hpp).
+layout(std140) uniform ShadowUniforms {
+    mat4 uShadowMatrices[MAX_CASCADES];
+    mat4 uSpotShadowMatrices[MAX_SPOT_SHADOWS];
+    vec4 uSpotShadowRects[MAX_SPOT_SHADOWS];
+    vec4 uPointShadowLights[MAX_POINT_SHADOWS];
+    vec4 uCascadeSplits;
+    vec2 uShadowTexelSize;
+    float uShadowBiasMin;
+    float uShadowBiasSlope;
+    vec2 uSpotShadowTexelSize;
+    float uPointShadowDiskRadius;
+    int uCascadeCount;
+    int uShadowPcfRadius;
+    int uSpotShadowCount;
+    int uSpotShadowPcfRadius;
+    int uPointShadowCount;
+    int uPointShadowPcfRadius;
+    int uShadowFilter;
+};
+
+// Must match ShadowSystem::ShadowFilter.
+#define SHADOW_FILTER_PCF 0
+#define SHADOW_FILTER_POISSON 1
+const vec2 kPoissonDisk[8] = vec2[](
+    vec2(-0.942016, -0.399062),
+    vec2(0.945586, -0.768907),
+    vec2(-0.094184, -0.929389),
+    vec2(0.344959, 0.293878),
+    vec2(-0.915886, 0.457714),
+    vec2(-0.815442, -0.879125),
+    vec2(-0.382775, 0.276768),
+    vec2(0.974844, 0.756484)
+);
+
+// Inverse of the octahedral mapping written by deferred_gbuffer.frag.
+vec3 decodeNormal(vec2 encoded) {
+    vec2 f = encoded * 2.0 - 1.0;
+    vec3 n = vec3(f, 1.0 - abs(f.x) - abs(f.y));
+    float t = clamp(-n.z, 0.0, 1.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
 
 vec3 reconstructViewPos(vec2 uv, float depth) {
     vec4 ndc = vec4(uv * 2.0 - 1.0, depth * 2.0 - 1.0, 1.0);
@@ -26,37 +83,48 @@ vec3 reconstructViewPos(vec2 uv, float depth) {
     return view.xyz / view.w;
 }
 
+// Every tap is a hardware depth compare with bilinear filtering, so it blends 2x2 texels.
 float sampleShadowMap(vec3 shadowCoord, int layer, float bias) {
     if (shadowCoord.z > 1.0 || shadowCoord.x < 0.0 || shadowCoord.x > 1.0 || shadowCoord.y < 0.0 || shadowCoord.y > 1.0) {
         return 1.0;
     }
+    float reference = shadowCoord.z - bias;
     float shadow = 0.0;
-    int taps = 0;
-    for (int y = -uShadowPcfRadius; y <= uShadowPcfRadius; ++y) {
-        for (int x = -uShadowPcfRadius; x <= uShadowPcfRadius; ++x) {
-            vec2 offset = vec2(x, y) * uShadowTexelSize;
-            float depth = texture(uShadowMap, vec3(shadowCoord.xy + offset, layer)).r;
-            shadow += (shadowCoord.z - bias <= depth) ? 1.0 : 0.0;
-            taps++;
+    if (uShadowFilter == SHADOW_FILTER_POISSON) {
+        vec2 scale = (float(uShadowPcfRadius) + 0.5) * uShadowTexelSize;
+        for (int i = 0; i < 8; ++i) {
+            shadow += texture(uShadowMap, vec4(shadowCoord.xy + kPoissonDisk[i] * scale, layer, reference));
+        }
+        return shadow / 8.0;
+    }
+    // Half-texel offsets: 2r taps per axis cover the 2r + 1 texels of a radius-r grid.
+    int taps = max(2 * uShadowPcfRadius, 1);
+    float center = float(taps - 1) * 0.5;
+    for (int y = 0; y < taps; ++y) {
+        for (int x = 0; x < taps; ++x) {
+            vec2 offset = (vec2(x, y) - center) * uShadowTexelSize;
+            shadow += texture(uShadowMap, vec4(shadowCoord.xy + offset, layer, reference));
         }
     }
-    return shadow / max(float(taps), 1.0);
+    return shadow / float(taps * taps);
 }
 
 void main() {
-    float depth = texture(uDepth, vUv).r;
+    vec2 texUv = vUv * uUvScale;
+    float depth = texture(uDepth, texUv).r;
     if (depth >= 0.99999) {
         FragColor = vec4(0.0);
+        ShadowInfo = vec2(0.0);
         return;
     }
 
-    vec4 albedoMetal = texture(uGAlbedoMetal, vUv);
-    vec4 normalRough = texture(uGNormalRough, vUv);
+    vec4 albedoMetal = texture(uGAlbedoMetal, texUv);
+    vec4 normalRough = texture(uGNormalRough, texUv);
 
     vec3 albedo = albedoMetal.rgb;
     float metallic = albedoMetal.a;
-    vec3 normal = normalize(normalRough.xyz);
-    float roughness = normalRough.a;
+    vec3 normal = decodeNormal(normalRough.xy);
+    float roughness = normalRough.b;
 
     vec3 viewPos = reconstructViewPos(vUv, depth);
     vec3 V = normalize(-viewPos);
@@ -89,4 +157,5 @@ void main() {
     color += (diffuse + specular) * uDirLightColor * uDirLightIntensity * ndotl * shadow;
 
     FragColor = vec4(color, 1.0);
+    ShadowInfo = vec2(shadow, float(cascade) / float(MAX_CASCADES - 1));
 }
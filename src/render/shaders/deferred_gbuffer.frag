@@ -4,14 +4,22 @@ in vec3 vAlbedo;
 
 layout(location = 0) out vec4 gAlbedoMetal;
 layout(location = 1) out vec4 gNormalRough;
-layout(location = 2) out float gDepth;
 
 uniform float uMetallic;
 uniform float uRoughness;
 
+// Octahedral mapping of a unit vector to [0, 1]^2, stored in the RGB10A2 normal target.
+vec2 encodeNormal(vec3 n) {
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    vec2 f = n.xy;
+    if (n.z < 0.0) {
+        f = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    }
+    return f * 0.5 + 0.5;
+}
+
 void main() {
     vec3 normal = normalize(vNormal);
     gAlbedoMetal = vec4(vAlbedo, uMetallic);
-    gNormalRough = vec4(normal, uRoughness);
-    gDepth = gl_FragCoord.z;
+    gNormalRough = vec4(encodeNormal(normal), uRoughness, 0.0);
 }
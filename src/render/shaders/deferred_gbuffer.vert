@@ -2,15 +2,62 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec3 aColor;
+layout (location = 3) in vec4 aPositionScale;
+layout (location = 4) in vec4 aPositionOffset;
+// Instance transform rows and color multiplier (render::MeshPool::Instance).
+layout (location = 5) in vec4 aInstanceRow0;
+layout (location = 6) in vec4 aInstanceRow1;
+layout (location = 7) in vec4 aInstanceRow2;
+layout (location = 8) in vec4 aInstanceColor;
 
-uniform mat4 uMVP;
-uniform mat4 uView;
+// std140 mirror of render::FrameUniforms (ShaderUniforms.hpp).
+layout(std140) uniform FrameUniforms {
+    mat4 uView;
+    mat4 uProj;
+    mat4 uViewProj;
+    mat4 uInvProj;
+    mat4 uInvView;
+    vec3 uDirLightDir;
+    float uDirLightIntensity;
+    vec3 uDirLightColor;
+    int uLightTexelOffset;
+    vec3 uAmbient;
+    int uLightCount;
+    vec2 uScreenSize;
+    int uDebugMode;
+    int uShadowDebugCascade;
+    vec2 uUvScale;
+    vec2 uUvMax;
+};
 
 out vec3 vNormal;
 out vec3 vAlbedo;
 
+// Compact meshes (aPositionOffset.w == 1) store octahedral normals as 16-bit integers.
+vec3 meshNormal() {
+    if (aPositionOffset.w < 0.5) {
+        return aNormal;
+    }
+    vec2 f = aNormal.xy / 32767.0;
+    vec3 n = vec3(f, 1.0 - abs(f.x) - abs(f.y));
+    if (n.z < 0.0) {
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    }
+    return normalize(n);
+}
+
+vec3 instancePosition(vec3 position) {
+    vec4 p = vec4(position, 1.0);
+    return vec3(dot(aInstanceRow0, p), dot(aInstanceRow1, p), dot(aInstanceRow2, p));
+}
+
+// Instance transforms are rigid or uniformly scaled, so their 3x3 part also places normals.
+vec3 instanceDirection(vec3 direction) {
+    return vec3(dot(aInstanceRow0.xyz, direction), dot(aInstanceRow1.xyz, direction), dot(aInstanceRow2.xyz, direction));
+}
+
 void main() {
-    vNormal = mat3(uView) * aNormal;
-    vAlbedo = aColor;
-    gl_Position = uMVP * vec4(aPos, 1.0);
+    vNormal = mat3(uView) * instanceDirection(meshNormal());
+    vAlbedo = aColor * aInstanceColor.rgb;
+    gl_Position = uViewProj * vec4(instancePosition(aPos * aPositionScale.xyz + aPositionOffset.xyz), 1.0);
 }
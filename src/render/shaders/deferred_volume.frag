@@ -1,4 +1,25 @@
 #version 410 core
+// Must match ShadowSystem::kMaxCascades / kMaxSpotShadows / kMaxPointShadows.
+#define MAX_CASCADES 4
+#define MAX_SPOT_SHADOWS 16
+#define MAX_POINT_SHADOWS 4
+
+// Permutation defines (RenderEngine::volumeKey): every light drawn with one build has the same
+// type and shadow state, and the PCF radius and filter are fixed, so none of them branch or loop
+// at run time. The defaults build a shadowed point light with a 3x3 PCF footprint.
+#ifndef LIGHT_SPOT
+#define LIGHT_SPOT 0
+#endif
+#ifndef LIGHT_SHADOWED
+#define LIGHT_SHADOWED 1
+#endif
+#ifndef SHADOW_PCF_RADIUS
+#define SHADOW_PCF_RADIUS 1
+#endif
+#ifndef SHADOW_FILTER
+#define SHADOW_FILTER 0
+#endif
+
 flat in int vLightIndex;
 out vec4 FragColor;
 
@@ -6,62 +27,141 @@ uniform sampler2D uGAlbedoMetal;
 uniform sampler2D uGNormalRough;
 uniform sampler2D uDepth;
 uniform samplerBuffer uLightBuffer;
-uniform mat4 uInvProj;
-uniform mat4 uInvView;
-uniform vec2 uScreenSize;
-uniform int uIsSpot;
-uniform sampler2DArray uSpotShadowMap;
-uniform samplerCubeArray uPointShadowMap;
-uniform mat4 uSpotShadowMatrices[4];
-uniform int uSpotShadowCount;
-uniform vec2 uSpotShadowTexelSize;
-uniform int uSpotShadowPcfRadius;
-uniform int uPointShadowCount;
-uniform float uPointShadowDiskRadius;
-uniform int uPointShadowPcfRadius;
-
-float sampleShadowMap2D(sampler2DArray map, vec3 uvw, int layer, float bias, vec2 texelSize, int radius) {
-    if (uvw.z > 1.0 || uvw.x < 0.0 || uvw.x > 1.0 || uvw.y < 0.0 || uvw.y > 1.0) {
+// std140 mirror of render::FrameUniforms (ShaderUniforms.hpp).
+layout(std140) uniform FrameUniforms {
+    mat4 uView;
+    mat4 uProj;
+    mat4 uViewProj;
+    mat4 uInvProj;
+    mat4 uInvView;
+    vec3 uDirLightDir;
+    float uDirLightIntensity;
+    vec3 uDirLightColor;
+    int uLightTexelOffset;
+    vec3 uAmbient;
+    int uLightCount;
+    vec2 uScreenSize;
+    int uDebugMode;
+    int uShadowDebugCascade;
+    vec2 uUvScale;
+    vec2 uUvMax;
+};
+
+// std140 mirror of render::ShadowUniforms (ShaderUniforms.hpp).
+layout(std140) uniform ShadowUniforms {
+    mat4 uShadowMatrices[MAX_CASCADES];
+    mat4 uSpotShadowMatrices[MAX_SPOT_SHADOWS];
+    vec4 uSpotShadowRects[MAX_SPOT_SHADOWS];
+    vec4 uPointShadowLights[MAX_POINT_SHADOWS];
+    vec4 uCascadeSplits;
+    vec2 uShadowTexelSize;
+    float uShadowBiasMin;
+    float uShadowBiasSlope;
+    vec2 uSpotShadowTexelSize;
+    float uPointShadowDiskRadius;
+    int uCascadeCount;
+    int uShadowPcfRadius;
+    int uSpotShadowCount;
+    int uSpotShadowPcfRadius;
+    int uPointShadowCount;
+    int uPointShadowPcfRadius;
+    int uShadowFilter;
+};
+
+// Must match ShadowSystem::ShadowFilter.
+#define SHADOW_FILTER_PCF 0
+#define SHADOW_FILTER_POISSON 1
+const vec2 kPoissonDisk[8] = vec2[](
+    vec2(-0.942016, -0.399062),
+    vec2(0.945586, -0.768907),
+    vec2(-0.094184, -0.929389),
+    vec2(0.344959, 0.293878),
+    vec2(-0.915886, 0.457714),
+    vec2(-0.815442, -0.879125),
+    vec2(-0.382775, 0.276768),
+    vec2(0.974844, 0.756484)
+);
+// Full-resolution pixels per target pixel along each axis: 2 when lighting accumulates at half
+// resolution, where each target pixel shades one pixel of its 2x2 block.
+uniform int uPixelStride;
+uniform sampler2DShadow uSpotShadowMap;
+uniform samplerCubeArrayShadow uPointShadowMap;
+
+#if SHADOW_PCF_RADIUS == 0
+#define SHADOW_TAPS 1
+#else
+#define SHADOW_TAPS (2 * SHADOW_PCF_RADIUS)
+#endif
+
+#if LIGHT_SHADOWED && LIGHT_SPOT
+// Every tap is a hardware depth compare with bilinear filtering, so it blends 2x2 texels.
+float sampleShadowAtlas(vec3 uvw, vec4 rect, float bias) {
+    if (rect.z <= 0.0 || uvw.z > 1.0 || uvw.x < 0.0 || uvw.x > 1.0 || uvw.y < 0.0 || uvw.y > 1.0) {
         return 1.0;
     }
+    // Keep PCF taps inside the tile so neighbouring atlas entries never bleed in.
+    vec2 tileMin = rect.xy + uSpotShadowTexelSize * 0.5;
+    vec2 tileMax = rect.xy + rect.zw - uSpotShadowTexelSize * 0.5;
+    vec2 uv = rect.xy + uvw.xy * rect.zw;
+    float reference = uvw.z - bias;
     float shadow = 0.0;
-    int taps = 0;
-    for (int y = -radius; y <= radius; ++y) {
-        for (int x = -radius; x <= radius; ++x) {
-            vec2 offset = vec2(x, y) * texelSize;
-            float depth = texture(map, vec3(uvw.xy + offset, layer)).r;
-            shadow += (uvw.z - bias <= depth) ? 1.0 : 0.0;
-            taps++;
+#if SHADOW_FILTER == SHADOW_FILTER_POISSON
+    vec2 scale = (float(SHADOW_PCF_RADIUS) + 0.5) * uSpotShadowTexelSize;
+    for (int i = 0; i < 8; ++i) {
+        shadow += texture(uSpotShadowMap, vec3(clamp(uv + kPoissonDisk[i] * scale, tileMin, tileMax), reference));
+    }
+    return shadow / 8.0;
+#else
+    // Half-texel offsets: 2r taps per axis cover the 2r + 1 texels of a radius-r grid.
+    const float center = float(SHADOW_TAPS - 1) * 0.5;
+    for (int y = 0; y < SHADOW_TAPS; ++y) {
+        for (int x = 0; x < SHADOW_TAPS; ++x) {
+            vec2 offset = (vec2(x, y) - center) * uSpotShadowTexelSize;
+            shadow += texture(uSpotShadowMap, vec3(clamp(uv + offset, tileMin, tileMax), reference));
         }
     }
-    return shadow / max(float(taps), 1.0);
+    return shadow / float(SHADOW_TAPS * SHADOW_TAPS);
+#endif
 }
+#endif
 
-float sampleShadowMapCube(
-    samplerCubeArray map,
-    vec3 dir,
-    float depth,
-    int layer,
-    float bias,
-    float diskRadius,
-    int radius
-) {
+#if LIGHT_SHADOWED && !LIGHT_SPOT
+float sampleShadowMapCube(vec3 dir, float depth, int layer, float bias) {
     vec3 up = abs(dir.z) < 0.999 ? vec3(0.0, 0.0, 1.0) : vec3(0.0, 1.0, 0.0);
     vec3 right = normalize(cross(up, dir));
     vec3 upDir = cross(dir, right);
 
+    float reference = depth - bias;
     float shadow = 0.0;
-    int taps = 0;
-    for (int y = -radius; y <= radius; ++y) {
-        for (int x = -radius; x <= radius; ++x) {
-            vec2 offset = vec2(x, y) * diskRadius;
+#if SHADOW_FILTER == SHADOW_FILTER_POISSON
+    float scale = (float(SHADOW_PCF_RADIUS) + 0.5) * uPointShadowDiskRadius;
+    for (int i = 0; i < 8; ++i) {
+        vec2 offset = kPoissonDisk[i] * scale;
+        vec3 sampleDir = normalize(dir + right * offset.x + upDir * offset.y);
+        shadow += texture(uPointShadowMap, vec4(sampleDir, layer), reference);
+    }
+    return shadow / 8.0;
+#else
+    const float center = float(SHADOW_TAPS - 1) * 0.5;
+    for (int y = 0; y < SHADOW_TAPS; ++y) {
+        for (int x = 0; x < SHADOW_TAPS; ++x) {
+            vec2 offset = (vec2(x, y) - center) * uPointShadowDiskRadius;
             vec3 sampleDir = normalize(dir + right * offset.x + upDir * offset.y);
-            float mapDepth = texture(map, vec4(sampleDir, layer)).r;
-            shadow += (depth - bias <= mapDepth) ? 1.0 : 0.0;
-            taps++;
+            shadow += texture(uPointShadowMap, vec4(sampleDir, layer), reference);
         }
     }
-    return shadow / max(float(taps), 1.0);
+    return shadow / float(SHADOW_TAPS * SHADOW_TAPS);
+#endif
+}
+#endif
+
+// Inverse of the octahedral mapping written by deferred_gbuffer.frag.
+vec3 decodeNormal(vec2 encoded) {
+    vec2 f = encoded * 2.0 - 1.0;
+    vec3 n = vec3(f, 1.0 - abs(f.x) - abs(f.y));
+    float t = clamp(-n.z, 0.0, 1.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
 }
 
 vec3 reconstructViewPos(vec2 uv, float depth) {
@@ -71,28 +171,34 @@ vec3 reconstructViewPos(vec2 uv, float depth) {
 }
 
 void main() {
-    vec2 uv = gl_FragCoord.xy / uScreenSize;
-    float depth = texture(uDepth, uv).r;
+    ivec2 pixel = min(ivec2(gl_FragCoord.xy) * uPixelStride + (uPixelStride - 1), ivec2(uScreenSize) - 1);
+    vec2 uv = (vec2(pixel) + 0.5) / uScreenSize;
+    vec2 texUv = uv * uUvScale;
+    float depth = texture(uDepth, texUv).r;
     if (depth >= 0.99999) {
         discard;
     }
 
-    vec4 albedoMetal = texture(uGAlbedoMetal, uv);
-    vec4 normalRough = texture(uGNormalRough, uv);
+    vec4 albedoMetal = texture(uGAlbedoMetal, texUv);
+    vec4 normalRough = texture(uGNormalRough, texUv);
 
     vec3 albedo = albedoMetal.rgb;
     float metallic = albedoMetal.a;
-    vec3 normal = normalize(normalRough.xyz);
-    float roughness = normalRough.a;
+    vec3 normal = decodeNormal(normalRough.xy);
+    float roughness = normalRough.b;
 
     vec3 viewPos = reconstructViewPos(uv, depth);
 
-    int base = vLightIndex * 5;
+    int base = uLightTexelOffset + vLightIndex * 5;
     vec4 posRadius = texelFetch(uLightBuffer, base);
     vec4 colorIntensity = texelFetch(uLightBuffer, base + 1);
+#if LIGHT_SPOT
     vec4 dirType = texelFetch(uLightBuffer, base + 2);
     vec4 spotParams = texelFetch(uLightBuffer, base + 3);
+#endif
+#if LIGHT_SHADOWED
     vec4 shadowInfo = texelFetch(uLightBuffer, base + 4);
+#endif
 
     vec3 lightPos = posRadius.xyz;
     float radius = posRadius.w;
@@ -107,14 +213,13 @@ void main() {
     float attenuation = clamp(1.0 - dist / radius, 0.0, 1.0);
     attenuation *= attenuation;
 
-    if (uIsSpot == 1) {
-        vec3 spotDir = normalize(dirType.xyz);
-        float cosTheta = dot(normalize(-L), spotDir);
-        float inner = spotParams.x;
-        float outer = spotParams.y;
-        float spot = smoothstep(outer, inner, cosTheta);
-        attenuation *= spot;
-    }
+#if LIGHT_SPOT
+    vec3 spotDir = normalize(dirType.xyz);
+    float cosTheta = dot(normalize(-L), spotDir);
+    float inner = spotParams.x;
+    float outer = spotParams.y;
+    attenuation *= smoothstep(outer, inner, cosTheta);
+#endif
 
     float ndotl = max(dot(normal, L), 0.0);
     if (ndotl <= 0.0) {
@@ -132,39 +237,26 @@ void main() {
 
     vec3 lightColor = colorIntensity.rgb * colorIntensity.w;
     float shadow = 1.0;
-    int shadowType = int(shadowInfo.x + 0.5);
+#if LIGHT_SHADOWED
+    // The engine only draws lights with a granted slot through a shadowed build.
     int shadowIndex = int(shadowInfo.y + 0.5);
     float bias = max(shadowInfo.z, shadowInfo.w * (1.0 - ndotl));
-
-    if (shadowType == 1 && shadowIndex >= 0 && shadowIndex < uSpotShadowCount) {
-        vec4 shadowPos = uSpotShadowMatrices[shadowIndex] * vec4(viewPos, 1.0);
-        vec3 shadowCoord = shadowPos.xyz / shadowPos.w;
-        shadowCoord = shadowCoord * 0.5 + 0.5;
-        shadow = sampleShadowMap2D(
-            uSpotShadowMap,
-            shadowCoord,
-            shadowIndex,
-            bias,
-            uSpotShadowTexelSize,
-            uSpotShadowPcfRadius
-        );
-    } else if (shadowType == 2 && shadowIndex >= 0 && shadowIndex < uPointShadowCount) {
+#if LIGHT_SPOT
+    vec4 shadowPos = uSpotShadowMatrices[shadowIndex] * vec4(viewPos, 1.0);
+    vec3 shadowCoord = shadowPos.xyz / shadowPos.w;
+    shadowCoord = shadowCoord * 0.5 + 0.5;
+    shadow = sampleShadowAtlas(shadowCoord, uSpotShadowRects[shadowIndex], bias);
+#else
+    // Compare against the position the slice was rendered from (it may be a cached frame).
+    vec4 shadowLight = uPointShadowLights[shadowIndex];
+    if (shadowLight.w > 0.0) {
         vec3 worldPos = vec3(uInvView * vec4(viewPos, 1.0));
-        vec3 lightWorld = vec3(uInvView * vec4(lightPos, 1.0));
-        vec3 toLightWorld = worldPos - lightWorld;
-        float worldDist = length(toLightWorld);
-        float depth01 = clamp(worldDist / radius, 0.0, 1.0);
-        vec3 dir = normalize(toLightWorld);
-        shadow = sampleShadowMapCube(
-            uPointShadowMap,
-            dir,
-            depth01,
-            shadowIndex,
-            bias,
-            uPointShadowDiskRadius,
-            uPointShadowPcfRadius
-        );
+        vec3 toLightWorld = worldPos - shadowLight.xyz;
+        float depth01 = clamp(length(toLightWorld) / shadowLight.w, 0.0, 1.0);
+        shadow = sampleShadowMapCube(normalize(toLightWorld), depth01, shadowIndex, bias);
     }
+#endif
+#endif
 
     vec3 color = (diffuse + specular) * lightColor * ndotl * attenuation * shadow;
 
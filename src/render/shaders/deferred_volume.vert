@@ -1,31 +1,64 @@
 #version 410 core
 layout (location = 0) in vec3 aPos;
+layout (location = 3) in vec4 aPositionScale;
+layout (location = 4) in vec4 aPositionOffset;
 
-uniform mat4 uProj;
+// std140 mirror of render::FrameUniforms (ShaderUniforms.hpp).
+layout(std140) uniform FrameUniforms {
+    mat4 uView;
+    mat4 uProj;
+    mat4 uViewProj;
+    mat4 uInvProj;
+    mat4 uInvView;
+    vec3 uDirLightDir;
+    float uDirLightIntensity;
+    vec3 uDirLightColor;
+    int uLightTexelOffset;
+    vec3 uAmbient;
+    int uLightCount;
+    vec2 uScreenSize;
+    int uDebugMode;
+    int uShadowDebugCascade;
+    vec2 uUvScale;
+    vec2 uUvMax;
+};
 uniform samplerBuffer uLightBuffer;
 uniform int uLightOffset;
+// The shading permutations fix the volume shape with LIGHT_SPOT; the stencil mark program picks
+// it at run time.
+#ifdef LIGHT_SPOT
+#define IS_SPOT (LIGHT_SPOT == 1)
+#else
 uniform int uIsSpot;
+#define IS_SPOT (uIsSpot == 1)
+#endif
+// Set when drawing an occlusion-culled group: instances index the visible-light list instead.
+uniform usamplerBuffer uVisibleLights;
+uniform int uUseVisibleLights;
 
 flat out int vLightIndex;
 
 void main() {
-    int lightIndex = uLightOffset + gl_InstanceID;
+    int lightIndex = uUseVisibleLights == 1
+        ? int(texelFetch(uVisibleLights, uLightOffset + gl_InstanceID).r)
+        : uLightOffset + gl_InstanceID;
     vLightIndex = lightIndex;
-    int base = lightIndex * 5;
+    int base = uLightTexelOffset + lightIndex * 5;
 
     vec4 posRadius = texelFetch(uLightBuffer, base);
     vec4 dirType = texelFetch(uLightBuffer, base + 2);
     vec4 spotParams = texelFetch(uLightBuffer, base + 3);
 
+    vec3 meshPos = aPos * aPositionScale.xyz + aPositionOffset.xyz;
     vec3 lightPos = posRadius.xyz;
     float radius = posRadius.w;
 
     vec3 viewPos;
-    if (uIsSpot == 1) {
+    if (IS_SPOT) {
         vec3 dir = normalize(dirType.xyz);
         float coneLength = spotParams.z;
         float coneRadius = spotParams.w * coneLength;
-        vec3 scaled = vec3(aPos.x * coneRadius, aPos.y * coneRadius, aPos.z * coneLength);
+        vec3 scaled = vec3(meshPos.x * coneRadius, meshPos.y * coneRadius, meshPos.z * coneLength);
 
         vec3 up = abs(dir.z) < 0.999 ? vec3(0.0, 0.0, 1.0) : vec3(0.0, 1.0, 0.0);
         vec3 right = normalize(cross(up, dir));
@@ -33,7 +66,7 @@ void main() {
         vec3 rotated = right * scaled.x + up2 * scaled.y + dir * scaled.z;
         viewPos = lightPos + rotated;
     } else {
-        viewPos = lightPos + aPos * radius;
+        viewPos = lightPos + meshPos * radius;
     }
 
     gl_Position = uProj * vec4(viewPos, 1.0);
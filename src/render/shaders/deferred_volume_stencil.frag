@@ -0,0 +1,5 @@
+#version 410 core
+// Stencil mark pass for light volumes: only depth/stencil results matter.
+
+void main() {
+}
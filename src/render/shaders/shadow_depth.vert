@@ -1,8 +1,22 @@
 #version 410 core
 layout (location = 0) in vec3 aPos;
+layout (location = 3) in vec4 aPositionScale;
+layout (location = 4) in vec4 aPositionOffset;
+// Instance transform rows (render::MeshPool::Instance).
+layout (location = 5) in vec4 aInstanceRow0;
+layout (location = 6) in vec4 aInstanceRow1;
+layout (location = 7) in vec4 aInstanceRow2;
 
 uniform mat4 uLightMVP;
 
+out vec3 vWorldPos;
+
+vec3 instancePosition(vec3 position) {
+    vec4 p = vec4(position, 1.0);
+    return vec3(dot(aInstanceRow0, p), dot(aInstanceRow1, p), dot(aInstanceRow2, p));
+}
+
 void main() {
-    gl_Position = uLightMVP * vec4(aPos, 1.0);
+    vWorldPos = instancePosition(aPos * aPositionScale.xyz + aPositionOffset.xyz);
+    gl_Position = uLightMVP * vec4(vWorldPos, 1.0);
 }
@@ -0,0 +1,10 @@
+#version 410 core
+in vec3 vWorldPos;
+
+uniform vec3 uLightPos;
+uniform float uFarPlane;
+
+void main() {
+    // Point shadows store linear distance so lighting can compare against dist / radius.
+    gl_FragDepth = length(vWorldPos - uLightPos) / uFarPlane;
+}
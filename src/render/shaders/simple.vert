@@ -2,14 +2,44 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec3 aColor;
+layout (location = 3) in vec4 aPositionScale;
+layout (location = 4) in vec4 aPositionOffset;
+// Instance transform rows and color multiplier (render::MeshPool::Instance).
+layout (location = 5) in vec4 aInstanceRow0;
+layout (location = 6) in vec4 aInstanceRow1;
+layout (location = 7) in vec4 aInstanceRow2;
+layout (location = 8) in vec4 aInstanceColor;
 
 uniform mat4 uMVP;
 uniform vec3 uLightDir;
 
 out vec3 vColor;
 
+// Compact meshes (aPositionOffset.w == 1) store octahedral normals as 16-bit integers.
+vec3 meshNormal() {
+    if (aPositionOffset.w < 0.5) {
+        return aNormal;
+    }
+    vec2 f = aNormal.xy / 32767.0;
+    vec3 n = vec3(f, 1.0 - abs(f.x) - abs(f.y));
+    if (n.z < 0.0) {
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    }
+    return normalize(n);
+}
+
+vec3 instancePosition(vec3 position) {
+    vec4 p = vec4(position, 1.0);
+    return vec3(dot(aInstanceRow0, p), dot(aInstanceRow1, p), dot(aInstanceRow2, p));
+}
+
+// Instance transforms are rigid or uniformly scaled, so their 3x3 part also places normals.
+vec3 instanceDirection(vec3 direction) {
+    return vec3(dot(aInstanceRow0.xyz, direction), dot(aInstanceRow1.xyz, direction), dot(aInstanceRow2.xyz, direction));
+}
+
 void main() {
-    gl_Position = uMVP * vec4(aPos, 1.0);
-    float ndotl = max(dot(normalize(aNormal), -normalize(uLightDir)), 0.2);
-    vColor = aColor * ndotl;
+    gl_Position = uMVP * vec4(instancePosition(aPos * aPositionScale.xyz + aPositionOffset.xyz), 1.0);
+    float ndotl = max(dot(instanceDirection(meshNormal()), -normalize(uLightDir)), 0.2);
+    vColor = aColor * aInstanceColor.rgb * ndotl;
 }